@@ -0,0 +1,274 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host benchmark of the boolean packing kernels in source/bitpack.c
+ * against a loop that moves one bit at a time, and a check of plans with
+ * signals of up to 7 bits. Not part of the firmware build, see
+ * .cyignore.
+ *
+ * Build and run, add -DBITPACK_FORCE_WORD32 to run the 32-bit kernels
+ * used on the target on a 64-bit host:
+ *   cc -O2 -Isource bench/bitpack_bench.c source/bitpack.c -o bitpack_bench
+ *   ./bitpack_bench [signals] [iterations]
+ */
+
+#include "bitpack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_SIGNALS    512
+#define DEFAULT_ITERATIONS 200000
+
+static void naive_gather (
+   const uint8_t * values,
+   uint32_t n,
+   uint8_t * frame,
+   uint32_t bit)
+{
+   for (uint32_t i = 0; i < n; i++, bit++)
+   {
+      if (values[i])
+      {
+         frame[bit / 8] |= 1u << (bit % 8);
+      }
+      else
+      {
+         frame[bit / 8] &= ~(1u << (bit % 8));
+      }
+   }
+}
+
+static void naive_scatter (
+   uint8_t * values,
+   uint32_t n,
+   const uint8_t * frame,
+   uint32_t bit)
+{
+   for (uint32_t i = 0; i < n; i++, bit++)
+   {
+      values[i] = (frame[bit / 8] >> (bit % 8)) & 1;
+   }
+}
+
+/* Pack and unpack a plan of signals of 1 to BITPACK_MAX_WIDTH bits and
+ * compare with one bit at a time */
+static int check_fields (uint32_t n)
+{
+   uint8_t * values = malloc (n);
+   uint8_t * check = malloc (n);
+   uint8_t * widths = malloc (n);
+   bitpack_run_t * runs = malloc (n * sizeof (*runs));
+   uint8_t * frame = calloc (n, 1);
+   uint8_t * expected = calloc (n, 1);
+   bitpack_plan_t plan;
+   uint32_t bit = 0;
+   int errors = 0;
+
+   if (
+      values == NULL || check == NULL || widths == NULL || runs == NULL ||
+      frame == NULL || expected == NULL)
+   {
+      exit (1);
+   }
+
+   bitpack_plan_init (&plan, runs, n);
+   for (uint32_t i = 0; i < n; i++)
+   {
+      widths[i] = (rand() & 1) ? 1 : 1 + rand() % BITPACK_MAX_WIDTH;
+      values[i] = rand() & ((1u << widths[i]) - 1);
+      errors += bitpack_plan_add_field (&plan, &values[i], bit, widths[i]) != 0;
+      for (uint8_t j = 0; j < widths[i]; j++, bit++)
+      {
+         expected[bit / 8] |= ((values[i] >> j) & 1) << (bit % 8);
+      }
+   }
+
+   errors += bitpack_plan_add_field (&plan, &values[0], bit, 0) == 0;
+   errors += bitpack_plan_add_field (&plan, &values[0], bit, 8) == 0;
+
+   bitpack_pack (&plan, frame);
+   if (plan.n_bits != bit || memcmp (frame, expected, BITPACK_BYTES (bit)) != 0)
+   {
+      printf ("field pack mismatch\n");
+      errors++;
+   }
+
+   memcpy (check, values, n);
+   memset (values, 0xFF, n);
+   bitpack_unpack (&plan, frame);
+   if (memcmp (check, values, n) != 0)
+   {
+      printf ("field unpack mismatch\n");
+      errors++;
+   }
+
+   printf (
+      "%u signals of 1-%d bits in %u runs: %s\n",
+      n,
+      BITPACK_MAX_WIDTH,
+      plan.n_runs,
+      errors ? "FAILED" : "ok");
+
+   free (values);
+   free (check);
+   free (widths);
+   free (runs);
+   free (frame);
+   free (expected);
+   return errors;
+}
+
+static double now_ns (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+typedef void (*gather_t) (const uint8_t *, uint32_t, uint8_t *, uint32_t);
+typedef void (*scatter_t) (uint8_t *, uint32_t, const uint8_t *, uint32_t);
+
+static double bench_gather (
+   gather_t f,
+   const uint8_t * values,
+   uint32_t n,
+   uint8_t * frame,
+   uint32_t bit,
+   uint32_t iterations)
+{
+   double start = now_ns();
+
+   for (uint32_t i = 0; i < iterations; i++)
+   {
+      f (values, n, frame, bit);
+      __asm__ volatile ("" : : "r"(frame) : "memory");
+   }
+   return (now_ns() - start) / iterations;
+}
+
+static double bench_scatter (
+   scatter_t f,
+   uint8_t * values,
+   uint32_t n,
+   const uint8_t * frame,
+   uint32_t bit,
+   uint32_t iterations)
+{
+   double start = now_ns();
+
+   for (uint32_t i = 0; i < iterations; i++)
+   {
+      f (values, n, frame, bit);
+      __asm__ volatile ("" : : "r"(values) : "memory");
+   }
+   return (now_ns() - start) / iterations;
+}
+
+int main (int argc, char * argv[])
+{
+   uint32_t n = (argc > 1) ? strtoul (argv[1], NULL, 0) : DEFAULT_SIGNALS;
+   uint32_t iterations =
+      (argc > 2) ? strtoul (argv[2], NULL, 0) : DEFAULT_ITERATIONS;
+   uint32_t frame_size = BITPACK_BYTES (n + 7);
+   uint8_t * values = malloc (n);
+   uint8_t * check = malloc (n);
+   uint8_t * frame = malloc (frame_size);
+   uint8_t * expected = malloc (frame_size);
+   int errors = 0;
+
+   if (values == NULL || check == NULL || frame == NULL || expected == NULL)
+   {
+      return 1;
+   }
+
+   srand (1);
+   for (uint32_t i = 0; i < n; i++)
+   {
+      values[i] = (rand() & 3) ? rand() & 1 : rand() & 0xFF;
+   }
+
+   printf ("%u signals, %u iterations\n", n, iterations);
+   printf (
+      "%-8s %-8s %12s %12s %8s\n",
+      "op",
+      "bit",
+      "naive ns",
+      "swar ns",
+      "speedup");
+
+   for (uint32_t bit = 0; bit < 8; bit += 3)
+   {
+      double t_naive;
+      double t_swar;
+
+      /* Check against naive result with random surrounding bits */
+      for (uint32_t i = 0; i < frame_size; i++)
+      {
+         expected[i] = frame[i] = rand();
+      }
+      naive_gather (values, n, expected, bit);
+      bitpack_gather (values, n, frame, bit);
+      if (memcmp (frame, expected, frame_size) != 0)
+      {
+         printf ("gather mismatch at bit %u\n", bit);
+         errors++;
+      }
+
+      bitpack_scatter (check, n, frame, bit);
+      for (uint32_t i = 0; i < n; i++)
+      {
+         if (check[i] != (values[i] != 0))
+         {
+            printf ("scatter mismatch at bit %u, signal %u\n", bit, i);
+            errors++;
+            break;
+         }
+      }
+
+      t_naive =
+         bench_gather (naive_gather, values, n, frame, bit, iterations);
+      t_swar =
+         bench_gather (bitpack_gather, values, n, frame, bit, iterations);
+      printf (
+         "%-8s %-8u %12.1f %12.1f %7.1fx\n",
+         "pack",
+         bit,
+         t_naive,
+         t_swar,
+         t_naive / t_swar);
+
+      t_naive =
+         bench_scatter (naive_scatter, check, n, frame, bit, iterations);
+      t_swar =
+         bench_scatter (bitpack_scatter, check, n, frame, bit, iterations);
+      printf (
+         "%-8s %-8u %12.1f %12.1f %7.1fx\n",
+         "unpack",
+         bit,
+         t_naive,
+         t_swar,
+         t_naive / t_swar);
+   }
+
+   errors += check_fields (n);
+
+   free (values);
+   free (check);
+   free (frame);
+   free (expected);
+   return errors ? 1 : 0;
+}
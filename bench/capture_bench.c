@@ -0,0 +1,487 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host test and benchmark of the Ethernet frame capture in
+ * source/capture.c.
+ *
+ * A mix of typical fieldbus traffic is generated: VLAN tagged PROFINET
+ * RT frames, UDP to and from port 34964, Modbus TCP, ARP and LLDP. Each
+ * frame carries its number so that the export can be checked. The tests
+ * check the filters, the pcapng export including timestamps across
+ * wraparounds of the cycle counter, the once mode, and that frames
+ * captured by two threads racing for slots are never torn. Reports the
+ * cost per frame that matches and per frame that is filtered out.
+ *
+ * Not part of the firmware build, see .cyignore.
+ *
+ * Build and run:
+ *   cc -O2 -Isource bench/capture_bench.c source/capture.c -lpthread \
+ *      -o capture_bench
+ *   ./capture_bench [file.pcapng]
+ */
+
+#include "capture.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BUFFER_SIZE (32 * 1024)
+#define SNAPLEN     96
+#define CLOCK_HZ    250000000u
+#define N_KINDS     6
+#define RACE_FRAMES 200000
+
+static uint8_t buf[BUFFER_SIZE] __attribute__ ((aligned (4)));
+static uint64_t fake_cycles;
+static uint32_t failures;
+
+static uint64_t now_ns (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* 64-bit cycle counter, truncated like DWT CYCCNT */
+static uint32_t fake_clock (uint32_t * ms)
+{
+   *ms = (uint32_t)(fake_cycles / (CLOCK_HZ / 1000));
+   return (uint32_t)fake_cycles;
+}
+
+static uint32_t host_clock (uint32_t * ms)
+{
+   uint64_t ns = now_ns();
+
+   *ms = (uint32_t)(ns / 1000000);
+   return (uint32_t)(ns / 4); /* 250 MHz */
+}
+
+static void put16 (uint8_t * p, uint16_t v)
+{
+   p[0] = v >> 8;
+   p[1] = v & 0xFF;
+}
+
+/* Frame n of the traffic mix, returns the length */
+static uint16_t generate (uint8_t * f, uint32_t n, uint8_t * dir)
+{
+   uint8_t * p = f + 12;
+   uint16_t len;
+
+   memset (f, 0, 1514);
+   memset (f, 0xAA, 6);
+   memset (f + 6, 0xBB, 6);
+   *dir = (n & 1) ? CAPTURE_OUT : CAPTURE_IN;
+
+   switch (n % N_KINDS)
+   {
+   case 0:
+   case 1:
+      /* PROFINET RT, VLAN 0 priority 6 */
+      put16 (p, 0x8100);
+      put16 (p + 2, 0xC000);
+      put16 (p + 4, 0x8892);
+      put16 (p + 6, 0x8000);
+      len = 64 + 20 * (n % 7);
+      break;
+   case 2:
+   case 3:
+      /* UDP, PROFINET context manager */
+      put16 (p, 0x0800);
+      p[2] = 0x45;
+      p[11] = 17;
+      put16 (p + 22, (n % N_KINDS == 2) ? 49152 : 34964);
+      put16 (p + 24, (n % N_KINDS == 2) ? 34964 : 49152);
+      len = 200 + (n % 100);
+      break;
+   case 4:
+      /* Modbus TCP */
+      put16 (p, 0x0800);
+      p[2] = 0x45;
+      p[11] = 6;
+      put16 (p + 22, 502);
+      put16 (p + 24, 40000);
+      len = 66;
+      break;
+   default:
+      put16 (p, (n % 12 == 5) ? 0x0806 : 0x88CC);
+      len = 60;
+      break;
+   }
+
+   /* Frame number at the end of the snap, checked by the export */
+   memcpy (f + SNAPLEN - 4, &n, 4);
+   return len < SNAPLEN ? SNAPLEN : len;
+}
+
+static void filter (capture_filter_t * f, const char * text)
+{
+   char copy[128];
+   char * argv[16];
+   int argc = 0;
+
+   snprintf (copy, sizeof (copy), "%s", text);
+   for (char * s = strtok (copy, " "); s != NULL; s = strtok (NULL, " "))
+   {
+      argv[argc++] = s;
+   }
+   if (capture_filter_compile (f, argc, argv) != 0)
+   {
+      printf ("filter \"%s\": compile failed\n", text);
+      failures++;
+   }
+}
+
+static void feed (capture_t * c, uint32_t first, uint32_t n, uint64_t step)
+{
+   uint8_t frame[1514];
+
+   for (uint32_t i = first; i < first + n; i++)
+   {
+      uint8_t dir;
+      uint16_t len = generate (frame, i, &dir);
+
+      capture_frame (c, frame, len, len, dir, NULL, NULL);
+      fake_cycles += step;
+   }
+}
+
+/* Export to memory, parse the pcapng and check every frame */
+typedef struct parsed
+{
+   uint32_t frames;
+   uint32_t first;
+   uint32_t last;
+   uint64_t first_ns;
+   uint64_t last_ns;
+   uint32_t bytes;
+} parsed_t;
+
+static uint32_t get32 (const uint8_t * p)
+{
+   uint32_t v;
+
+   memcpy (&v, p, 4);
+   return v;
+}
+
+static int parse (const capture_t * c, const char * test, parsed_t * out)
+{
+   static uint8_t file[1024 * 1024];
+   static capture_reader_t rd;
+   size_t size = 0;
+   size_t n;
+   size_t pos;
+   bool sequential = true;
+
+   capture_read_start (c, &rd);
+   /* Odd reads, as a TFTP block or a shell line would do */
+   while ((n = capture_read (c, &rd, file + size, 333)) != 0)
+   {
+      size += n;
+   }
+
+   memset (out, 0, sizeof (*out));
+   out->bytes = size;
+   if (size < 60 || get32 (file) != 0x0A0D0D0A || get32 (file + 28) != 1)
+   {
+      printf ("%s: bad section or interface header\n", test);
+      failures++;
+      return -1;
+   }
+
+   for (pos = 60; pos + 12 <= size; pos += get32 (file + pos + 4))
+   {
+      const uint8_t * b = file + pos;
+      uint32_t caplen = get32 (b + 20);
+      uint32_t len = get32 (b + 24);
+      uint64_t ns = ((uint64_t)get32 (b + 12) << 32) | get32 (b + 16);
+      uint32_t frame_no;
+      uint8_t frame[1514];
+      uint8_t dir;
+
+      if (get32 (b) != 6 || get32 (b + 4) != get32 (b + get32 (b + 4) - 4))
+      {
+         printf ("%s: bad block at %zu\n", test, pos);
+         failures++;
+         return -1;
+      }
+
+      memcpy (&frame_no, b + 28 + SNAPLEN - 4, 4);
+      if (
+         caplen != SNAPLEN || len != generate (frame, frame_no, &dir) ||
+         memcmp (b + 28, frame, SNAPLEN) != 0 ||
+         get32 (b + 28 + ((SNAPLEN + 3) & ~3) + 4) != dir)
+      {
+         printf ("%s: frame %u torn or wrong\n", test, frame_no);
+         failures++;
+         return -1;
+      }
+
+      if (out->frames == 0)
+      {
+         out->first = frame_no;
+         out->first_ns = ns;
+      }
+      else if (frame_no <= out->last || ns < out->last_ns)
+      {
+         sequential = false;
+      }
+      out->last = frame_no;
+      out->last_ns = ns;
+      out->frames++;
+   }
+
+   if (pos != size)
+   {
+      printf ("%s: trailing bytes\n", test);
+      failures++;
+      return -1;
+   }
+   return sequential ? 0 : 1;
+}
+
+static void test_filter (
+   capture_t * c,
+   const char * text,
+   uint32_t frames,
+   uint32_t expect)
+{
+   capture_filter_t f;
+   parsed_t p;
+
+   filter (&f, text);
+   capture_start (c, &f, false);
+   feed (c, 0, frames, 1000);
+   capture_stop (c);
+
+   if (c->captured != expect || parse (c, text, &p) != 0)
+   {
+      printf (
+         "filter \"%s\": captured %u, expected %u\n",
+         text,
+         c->captured,
+         expect);
+      failures++;
+      return;
+   }
+   printf ("filter  : %-28s %5u of %u frames\n", text, c->captured, frames);
+}
+
+/* Steps of 10 s, about 2.5e9 cycles, wrap the counter every other frame */
+static void test_timestamps (capture_t * c)
+{
+   capture_filter_t f = {0};
+   parsed_t p;
+   uint64_t step = 10ull * CLOCK_HZ + 12345;
+   uint64_t expect_ns;
+
+   fake_cycles = 0x12345678;
+   capture_start (c, &f, true);
+   feed (c, 0, 20, step);
+   capture_stop (c);
+
+   parse (c, "timestamps", &p);
+   expect_ns = (uint64_t)((double)step * 19 * 1e9 / CLOCK_HZ);
+   if (p.frames != 20 || p.last_ns - p.first_ns != expect_ns)
+   {
+      printf (
+         "timestamps: %u frames, span %llu ns, expected %llu ns\n",
+         p.frames,
+         (unsigned long long)(p.last_ns - p.first_ns),
+         (unsigned long long)expect_ns);
+      failures++;
+      return;
+   }
+   printf ("time    : 19 steps of %.6f s across wraparounds, exact\n",
+           (double)step / CLOCK_HZ);
+}
+
+static void test_once (capture_t * c)
+{
+   capture_filter_t f = {0};
+   parsed_t p;
+
+   capture_start (c, &f, true);
+   feed (c, 0, 1000, 1000);
+
+   if (
+      c->state != CAPTURE_FULL || parse (c, "once", &p) != 0 ||
+      p.frames != c->n_slots || p.first != 0 ||
+      c->dropped != 1000u - c->n_slots)
+   {
+      printf ("once: %u frames from %u, dropped %u\n", p.frames, p.first,
+              c->dropped);
+      failures++;
+      return;
+   }
+   printf ("once    : first %u frames kept, %u dropped\n", p.frames,
+           c->dropped);
+}
+
+typedef struct racer
+{
+   capture_t * c;
+   uint32_t first;
+} racer_t;
+
+static void * race_thread (void * arg)
+{
+   racer_t * r = arg;
+   uint8_t frame[1514];
+
+   for (uint32_t i = r->first; i < r->first + RACE_FRAMES; i++)
+   {
+      uint8_t dir;
+      uint16_t len = generate (frame, i, &dir);
+
+      capture_frame (r->c, frame, len, len, dir, NULL, NULL);
+      if ((i & 63) == 0)
+      {
+         sched_yield();
+      }
+   }
+   return NULL;
+}
+
+/* Two writers, standing in for the receive interrupt and the tcpip task */
+static void test_race (capture_t * c)
+{
+   capture_filter_t f = {0};
+   racer_t r[2] = {{c, 0}, {c, 10000000}};
+   pthread_t thread[2];
+   parsed_t p;
+
+   capture_start (c, &f, false);
+   for (int i = 0; i < 2; i++)
+   {
+      pthread_create (&thread[i], NULL, race_thread, &r[i]);
+   }
+   for (int i = 0; i < 2; i++)
+   {
+      pthread_join (thread[i], NULL);
+   }
+   capture_stop (c);
+
+   /* Interleaved, so frame numbers are not sequential */
+   if (parse (c, "race", &p) < 0 || p.frames != capture_count (c))
+   {
+      failures++;
+      return;
+   }
+   printf (
+      "race    : %u frames from 2 writers, last %u kept, none torn\n",
+      c->captured,
+      p.frames);
+}
+
+static void bench (capture_t * c, const char * text, const char * what)
+{
+   static uint8_t frames[N_KINDS][1514];
+   static uint16_t lens[N_KINDS];
+   static uint8_t dirs[N_KINDS];
+   capture_filter_t f;
+   uint32_t loops = 2000000;
+   uint64_t start;
+
+   for (int i = 0; i < N_KINDS; i++)
+   {
+      lens[i] = generate (frames[i], i, &dirs[i]);
+   }
+
+   filter (&f, text);
+   capture_start (c, &f, false);
+   start = now_ns();
+   for (uint32_t i = 0; i < loops; i++)
+   {
+      uint32_t k = i % N_KINDS;
+
+      capture_frame (c, frames[k], lens[k], lens[k], dirs[k], NULL, NULL);
+   }
+   printf (
+      "cost    : %-28s %.1f ns per frame, %s\n",
+      text,
+      (double)(now_ns() - start) / loops,
+      what);
+   capture_stop (c);
+}
+
+int main (int argc, char * argv[])
+{
+   static capture_t c;
+
+   capture_init (&c, buf, sizeof (buf), fake_clock, CLOCK_HZ, SNAPLEN);
+   printf (
+      "buffer %d KiB, snaplen %d, %u slots of %u bytes\n",
+      BUFFER_SIZE / 1024,
+      SNAPLEN,
+      c.n_slots,
+      c.slot_size);
+
+   test_filter (&c, "", 600, 600);
+   test_filter (&c, "ether pn", 600, 200);
+   test_filter (&c, "vlan 0", 600, 200);
+   test_filter (&c, "not vlan", 600, 400);
+   test_filter (&c, "udp port 34964", 600, 200);
+   test_filter (&c, "in udp port 34964", 600, 100);
+   test_filter (&c, "tcp port 502", 600, 100);
+   test_filter (&c, "not ether pn not port 34964", 600, 200);
+   test_filter (&c, "ether lldp", 600, 50);
+   test_filter (&c, "arp", 600, 50);
+
+   test_timestamps (&c);
+   test_once (&c);
+
+   capture_init (&c, buf, sizeof (buf), host_clock, CLOCK_HZ, SNAPLEN);
+   test_race (&c);
+
+   bench (&c, "", "all captured");
+   bench (&c, "ether pn", "one in three captured");
+   bench (&c, "ether 0x1234", "none captured");
+   bench (&c, "in tcp port 502", "none captured");
+
+   if (argc > 1)
+   {
+      static capture_reader_t rd;
+      uint8_t chunk[512];
+      FILE * f = fopen (argv[1], "wb");
+      capture_filter_t all = {0};
+      size_t n;
+
+      capture_init (&c, buf, sizeof (buf), host_clock, CLOCK_HZ, SNAPLEN);
+      capture_start (&c, &all, true);
+      feed (&c, 0, 100, 0);
+      capture_stop (&c);
+      capture_read_start (&c, &rd);
+      while ((n = capture_read (&c, &rd, chunk, sizeof (chunk))) != 0)
+      {
+         fwrite (chunk, 1, n, f);
+      }
+      fclose (f);
+      printf ("wrote 100 frames to %s\n", argv[1]);
+   }
+
+   if (failures != 0)
+   {
+      printf ("FAILED\n");
+      return 1;
+   }
+   printf ("OK\n");
+   return 0;
+}
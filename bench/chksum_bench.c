@@ -0,0 +1,200 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host test and benchmark of the unrolled internet checksum in
+ * lwip/lwip_chksum.c against a reference that sums one 16-bit word at a
+ * time as described in RFC 1071.
+ *
+ * Every length up to max_len is checked at every alignment within a
+ * 32-bit word and a 64-bit word, on random data and on data of all ones
+ * which maximises the carries. Then both are timed for typical frame
+ * payload lengths, aligned and unaligned.
+ *
+ * Not part of the firmware build, see .cyignore.
+ *
+ * Build and run:
+ *   cc -O2 -I. -Isource -DAPP_DISABLE_TCM bench/chksum_bench.c \
+ *      lwip/lwip_chksum.c -o chksum_bench
+ *   ./chksum_bench [max_len] [iterations]
+ */
+
+#include "lwip/lwip_chksum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_MAX_LEN    1600
+#define DEFAULT_ITERATIONS 200000
+#define MAX_ALIGN          8
+
+/* Ones' complement sum in the same byte order as lwIP, i.e. the sum of
+ * the big endian words stored in memory in network byte order */
+static uint16_t reference_chksum (const void * dataptr, int len)
+{
+   const uint8_t * p = dataptr;
+   uint32_t sum = 0;
+   uint8_t out[2];
+   uint16_t result;
+
+   while (len > 1)
+   {
+      sum += ((uint32_t)p[0] << 8) | p[1];
+      p += 2;
+      len -= 2;
+   }
+   if (len > 0)
+   {
+      sum += (uint32_t)p[0] << 8;
+   }
+   while (sum > 0xffff)
+   {
+      sum = (sum >> 16) + (sum & 0xffff);
+   }
+
+   out[0] = (uint8_t)(sum >> 8);
+   out[1] = (uint8_t)sum;
+   memcpy (&result, out, sizeof (result));
+   return result;
+}
+
+static double now_ns (void)
+{
+   struct timespec ts;
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int check (const uint8_t * buf, int max_len, const char * what)
+{
+   int errors = 0;
+
+   for (int align = 0; align < MAX_ALIGN; align++)
+   {
+      for (int len = 0; len <= max_len; len++)
+      {
+         uint16_t expected = reference_chksum (buf + align, len);
+         uint16_t actual = lwip_chksum_unrolled (buf + align, len);
+
+         if (actual != expected)
+         {
+            if (errors < 10)
+            {
+               printf (
+                  "MISMATCH %s align %d len %d: 0x%04x expected 0x%04x\n",
+                  what,
+                  align,
+                  len,
+                  actual,
+                  expected);
+            }
+            errors++;
+         }
+      }
+   }
+
+   return errors;
+}
+
+static double time_chksum (
+   uint16_t (*fn) (const void *, int),
+   const uint8_t * data,
+   int len,
+   unsigned int iterations)
+{
+   volatile uint16_t sink = 0;
+   double start = now_ns();
+
+   for (unsigned int i = 0; i < iterations; i++)
+   {
+      sink += fn (data, len);
+   }
+
+   (void)sink;
+   return (now_ns() - start) / iterations;
+}
+
+int main (int argc, char * argv[])
+{
+   static const int lengths[] = {20, 64, 576, 1472};
+   int max_len = (argc > 1) ? atoi (argv[1]) : DEFAULT_MAX_LEN;
+   unsigned int iterations =
+      (argc > 2) ? (unsigned int)atoi (argv[2]) : DEFAULT_ITERATIONS;
+   uint8_t * buf;
+   int errors = 0;
+
+   if (max_len < 1500)
+   {
+      max_len = 1500;
+   }
+
+   buf = malloc (max_len + MAX_ALIGN);
+   if (buf == NULL)
+   {
+      return 1;
+   }
+
+   srand (1);
+   for (int i = 0; i < max_len + MAX_ALIGN; i++)
+   {
+      buf[i] = (uint8_t)rand();
+   }
+   errors += check (buf, max_len, "random");
+
+   memset (buf, 0xff, max_len + MAX_ALIGN);
+   errors += check (buf, max_len, "ones");
+
+   printf (
+      "Checked lengths 0..%d at %d alignments: %s\n",
+      max_len,
+      MAX_ALIGN,
+      errors ? "FAILED" : "ok");
+
+   for (int i = 0; i < max_len + MAX_ALIGN; i++)
+   {
+      buf[i] = (uint8_t)rand();
+   }
+
+   printf (
+      "%6s %6s %14s %14s %8s\n",
+      "len",
+      "align",
+      "reference [ns]",
+      "unrolled [ns]",
+      "speedup");
+   for (size_t i = 0; i < sizeof (lengths) / sizeof (lengths[0]); i++)
+   {
+      for (int align = 0; align < 2; align++)
+      {
+         double ref =
+            time_chksum (reference_chksum, buf + align, lengths[i], iterations);
+         double unrolled = time_chksum (
+            lwip_chksum_unrolled,
+            buf + align,
+            lengths[i],
+            iterations);
+
+         printf (
+            "%6d %6d %14.1f %14.1f %8.2f\n",
+            lengths[i],
+            align,
+            ref,
+            unrolled,
+            ref / unrolled);
+      }
+   }
+
+   free (buf);
+   return errors ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host test and benchmark of the signal conditioning stage in
+ * source/conditioning.c against a scalar reference that handles one
+ * channel at a time with a switch on the filter. Not part of the
+ * firmware build, see .cyignore.
+ *
+ * Build and run:
+ *   cc -O2 -Isource bench/conditioning_bench.c source/conditioning.c \
+ *      -lm -o conditioning_bench
+ *   ./conditioning_bench [channels] [cycles]
+ */
+
+#include "conditioning.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_CHANNELS 256
+#define DEFAULT_CYCLES   20000
+#define WINDOW           8
+#define TOLERANCE        1e-4f
+
+typedef struct ref_channel
+{
+   conditioning_filter_t filter;
+   conditioning_channel_t cfg;
+   float value;
+   float history[WINDOW];
+} ref_channel_t;
+
+/* Scalar reference, one channel at a time */
+static void ref_run (
+   ref_channel_t * ch,
+   const float * raw,
+   uint32_t n,
+   uint32_t cycle,
+   float * out)
+{
+   for (uint32_t i = 0; i < n; i++)
+   {
+      ref_channel_t * c = &ch[i];
+      float x = raw[i] * c->cfg.gain + c->cfg.offset;
+      float sum = 0;
+
+      x = fminf (fmaxf (x, c->cfg.min), c->cfg.max);
+
+      switch (c->filter)
+      {
+      case CONDITIONING_FILTER_IIR:
+         if (cycle == 0)
+         {
+            c->value = x;
+         }
+         c->value += c->cfg.alpha * (x - c->value);
+         break;
+      case CONDITIONING_FILTER_AVG:
+         for (int k = 0; k < WINDOW && cycle == 0; k++)
+         {
+            c->history[k] = x;
+         }
+         c->history[cycle % WINDOW] = x;
+         for (int k = 0; k < WINDOW; k++)
+         {
+            sum += c->history[k];
+         }
+         c->value = sum / WINDOW;
+         break;
+      default:
+         c->value = x;
+         break;
+      }
+      out[i] = c->value;
+   }
+}
+
+static double now_ns (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static float frand (float lo, float hi)
+{
+   return lo + (hi - lo) * rand() / (float)RAND_MAX;
+}
+
+int main (int argc, char * argv[])
+{
+   uint32_t n = (argc > 1) ? strtoul (argv[1], NULL, 0) : DEFAULT_CHANNELS;
+   uint32_t cycles =
+      (argc > 2) ? strtoul (argv[2], NULL, 0) : DEFAULT_CYCLES;
+   uint16_t n_iir = n / 2;
+   uint16_t n_avg = n / 4;
+   ref_channel_t * ref = calloc (n, sizeof (*ref));
+   float * raw = calloc (n, sizeof (float));
+   float * out = calloc (n, sizeof (float));
+   float * ref_out = calloc (n, sizeof (float));
+   conditioning_t c;
+   double t_ref = 0;
+   double t_vec = 0;
+   float max_error = 0;
+
+   if (
+      ref == NULL || raw == NULL || out == NULL || ref_out == NULL ||
+      conditioning_init (&c, n_iir, n_avg, n - n_iir - n_avg, WINDOW) != 0)
+   {
+      return 1;
+   }
+
+   srand (1);
+   for (uint32_t i = 0; i < n; i++)
+   {
+      if (i < n_iir)
+      {
+         ref[i].filter = CONDITIONING_FILTER_IIR;
+      }
+      else if (i < n_iir + n_avg)
+      {
+         ref[i].filter = CONDITIONING_FILTER_AVG;
+      }
+      else
+      {
+         ref[i].filter = CONDITIONING_FILTER_NONE;
+      }
+      ref[i].cfg.gain = frand (0.001f, 0.1f);
+      ref[i].cfg.offset = frand (-50, 50);
+      ref[i].cfg.min = -100;
+      ref[i].cfg.max = frand (50, 200);
+      ref[i].cfg.alpha = frand (0.01f, 1);
+      conditioning_set (&c, i, &ref[i].cfg, &out[i]);
+   }
+
+   for (uint32_t cycle = 0; cycle < cycles; cycle++)
+   {
+      double start;
+
+      for (uint32_t i = 0; i < n; i++)
+      {
+         raw[i] = frand (-1000, 4000);
+      }
+
+      start = now_ns();
+      ref_run (ref, raw, n, cycle, ref_out);
+      t_ref += now_ns() - start;
+
+      memcpy (c.raw, raw, n * sizeof (float));
+      start = now_ns();
+      conditioning_run (&c);
+      t_vec += now_ns() - start;
+
+      for (uint32_t i = 0; i < n; i++)
+      {
+         float error =
+            fabsf (out[i] - ref_out[i]) / fmaxf (1, fabsf (ref_out[i]));
+
+         max_error = fmaxf (max_error, error);
+      }
+   }
+
+   printf (
+      "%u channels (%u IIR, %u average), %u cycles\n",
+      n,
+      n_iir,
+      n_avg,
+      cycles);
+   printf ("scalar reference : %8.1f ns/cycle\n", t_ref / cycles);
+   printf ("conditioning     : %8.1f ns/cycle\n", t_vec / cycles);
+   printf ("speedup          : %8.1fx\n", t_ref / t_vec);
+   printf ("max rel. error   : %8.2g\n", max_error);
+
+   if (max_error > TOLERANCE)
+   {
+      printf ("FAILED, error above %g\n", TOLERANCE);
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,169 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host test and benchmark of the local logic interpreter in
+ * source/logic.c. Runs a program of blocks that each combine an INT16
+ * input, a UINT8 output and a memory cell, checks the result against
+ * the same computation in C and reports executed instructions per
+ * microsecond. Not part of the firmware build, see .cyignore.
+ *
+ * Build and run:
+ *   cc -O2 -Isource bench/logic_bench.c source/logic.c source/crc.c \
+ *      -o logic_bench
+ *   ./logic_bench [blocks] [cycles]
+ */
+
+#include "logic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_BLOCKS  64
+#define DEFAULT_CYCLES  100000
+#define INSNS_PER_BLOCK 12
+
+static double now_ns (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static logic_insn_t insn (logic_op_t op, uint8_t a, int16_t b)
+{
+   logic_insn_t i = {.op = op, .a = a, .b = b};
+   return i;
+}
+
+/* Block k: out[k] = mem[k] += ((in[k] << 3) ^ out[k]) & 0x7f */
+static uint32_t add_block (logic_insn_t * p, uint16_t k, uint16_t n)
+{
+   uint8_t m = k % LOGIC_MEM_SIZE;
+   uint32_t i = 0;
+
+   p[i++] = insn (LOGIC_OP_LOAD, 0, k);
+   p[i++] = insn (LOGIC_OP_PUSH, 0, 3);
+   p[i++] = insn (LOGIC_OP_SHL, 0, 0);
+   p[i++] = insn (LOGIC_OP_LOAD, 0, n + k);
+   p[i++] = insn (LOGIC_OP_XOR, 0, 0);
+   p[i++] = insn (LOGIC_OP_PUSH, 0, 0x7f);
+   p[i++] = insn (LOGIC_OP_AND, 0, 0);
+   p[i++] = insn (LOGIC_OP_LDM, m, 0);
+   p[i++] = insn (LOGIC_OP_ADD, 0, 0);
+   p[i++] = insn (LOGIC_OP_DUP, 0, 0);
+   p[i++] = insn (LOGIC_OP_STM, m, 0);
+   p[i++] = insn (LOGIC_OP_STORE, 0, n + k);
+   return i;
+}
+
+static void ref_run (
+   const int16_t * in,
+   uint8_t * out,
+   uint32_t * mem,
+   uint16_t n)
+{
+   for (uint16_t k = 0; k < n; k++)
+   {
+      uint32_t * m = &mem[k % LOGIC_MEM_SIZE];
+
+      *m += (((uint32_t)(int32_t)in[k] << 3) ^ out[k]) & 0x7f;
+      out[k] = (uint8_t)*m;
+   }
+}
+
+int main (int argc, char * argv[])
+{
+   uint16_t n = (argc > 1) ? strtoul (argv[1], NULL, 0) : DEFAULT_BLOCKS;
+   uint32_t cycles = (argc > 2) ? strtoul (argv[2], NULL, 0) : DEFAULT_CYCLES;
+   uint32_t n_insns = n * INSNS_PER_BLOCK + 1;
+   logic_header_t * header;
+   logic_insn_t * insns;
+   uint32_t size = sizeof (*header) + n_insns * sizeof (logic_insn_t);
+   logic_var_t * vars = calloc (2 * n, sizeof (*vars));
+   int16_t * in = calloc (n, sizeof (*in));
+   uint8_t * out = calloc (n, sizeof (*out));
+   uint8_t * ref_out = calloc (n, sizeof (*ref_out));
+   uint32_t ref_mem[LOGIC_MEM_SIZE] = {0};
+   uint8_t * program = calloc (1, size);
+   const char * error;
+   logic_t logic;
+   uint32_t pos = 0;
+   double t = 0;
+
+   if (
+      vars == NULL || in == NULL || out == NULL || ref_out == NULL ||
+      program == NULL || n_insns > LOGIC_MAX_INSNS)
+   {
+      printf (
+         "Invalid number of blocks, at most %d\n",
+         LOGIC_MAX_INSNS / INSNS_PER_BLOCK);
+      return 1;
+   }
+
+   header = (logic_header_t *)program;
+   insns = (logic_insn_t *)(program + sizeof (*header));
+   for (uint16_t k = 0; k < n; k++)
+   {
+      vars[k] = (logic_var_t){&in[k], NULL, LOGIC_TYPE_I16, false};
+      vars[n + k] = (logic_var_t){&out[k], NULL, LOGIC_TYPE_U8, true};
+      pos += add_block (&insns[pos], k, n);
+   }
+   insns[pos++] = insn (LOGIC_OP_END, 0, 0);
+
+   header->magic = LOGIC_MAGIC;
+   header->version = LOGIC_VERSION;
+   header->n_insns = n_insns;
+   header->crc = logic_crc (insns, n_insns * sizeof (logic_insn_t));
+   header->avail = n_insns;
+
+   if (logic_load (&logic, program, size, vars, 2 * n, &error) != 0)
+   {
+      printf ("Failed to load program: %s\n", error);
+      return 1;
+   }
+
+   srand (1);
+   for (uint32_t cycle = 0; cycle < cycles; cycle++)
+   {
+      double start;
+
+      for (uint16_t k = 0; k < n; k++)
+      {
+         in[k] = rand();
+      }
+
+      start = now_ns();
+      logic_run (&logic, &logic.sync);
+      t += now_ns() - start;
+
+      ref_run (in, ref_out, ref_mem, n);
+      if (memcmp (out, ref_out, n) != 0)
+      {
+         printf ("FAILED, outputs differ in cycle %u\n", cycle);
+         return 1;
+      }
+   }
+
+   printf ("%u blocks, %u instructions, %u cycles\n", n, n_insns, cycles);
+   printf ("estimated WCET   : %8u CPU cycles\n", logic.sync.wcet);
+   printf ("run time         : %8.1f ns\n", t / cycles);
+   printf (
+      "throughput       : %8.1f instructions/us\n",
+      (double)n_insns * cycles / t * 1e3);
+
+   logic_free (&logic);
+   return 0;
+}
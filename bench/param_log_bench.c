@@ -0,0 +1,492 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host test and benchmark of the parameter log in source/param_log.c on
+ * a RAM block device.
+ *
+ * The PLC writes parameters in bursts, a setpoint being ramped or a
+ * recipe being downloaded. The log is flushed after every write, as
+ * without coalescing, and once per burst, as the parameter store does
+ * once writes have settled. After every flush the log is loaded into a
+ * second set of parameters, as after a power cycle, and compared.
+ *
+ * The block device counts page programs and block erases the way a
+ * NOR flash would see them: writes to a file program every page they
+ * touch, a page that was partly programmed by an earlier append is
+ * programmed again, entering a new block erases it, and every close and
+ * remove commits one page of metadata. The flash time is estimated from
+ * these counts and the given page program and block erase times; the CPU
+ * time of a flush on the host is measured.
+ *
+ * Then writes are made to fail at every position within a compaction
+ * and an append, and the values are checked to stay dirty and to be
+ * written by the next successful flush.
+ *
+ * Not part of the firmware build, see .cyignore.
+ *
+ * Build and run:
+ *   cc -O2 -Isource bench/param_log_bench.c source/param_log.c \
+ *      source/crc.c -o param_log_bench
+ *   ./param_log_bench [params] [bursts] [prog_us] [erase_us]
+ */
+
+#include "param_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_PARAMS   32
+#define DEFAULT_BURSTS   1000
+#define DEFAULT_PROG_US  500
+#define DEFAULT_ERASE_US 30000
+
+#define PROG_SIZE    256
+#define BLOCK_SIZE   4096
+#define MAX_FILE     (64 * 1024)
+#define COMPACT_SIZE 4096
+#define BURST_PARAMS 8  /* Parameters written by each burst */
+#define BURST_WRITES 10 /* Writes of each parameter in a burst */
+
+typedef struct ram_file
+{
+   const char * name;
+   int exists;
+   uint32_t size;
+   uint8_t data[MAX_FILE];
+} ram_file_t;
+
+typedef struct ram_handle
+{
+   ram_file_t * file;
+   uint32_t pos;
+   uint32_t start; /* Size when opened for writing */
+   int writing;
+} ram_handle_t;
+
+typedef struct flash_stats
+{
+   uint32_t writes;
+   uint32_t progs;
+   uint32_t erases;
+} flash_stats_t;
+
+static ram_file_t files[2] = {{.name = "params.0"}, {.name = "params.1"}};
+static ram_handle_t handle;
+static flash_stats_t flash;
+static int fail_after = -1; /* Writes before failing, -1 never */
+
+static ram_file_t * find (const char * name)
+{
+   for (int i = 0; i < 2; i++)
+   {
+      if (strcmp (files[i].name, name) == 0)
+      {
+         return &files[i];
+      }
+   }
+   return NULL;
+}
+
+static void * fs_open (const char * name, const char * mode)
+{
+   ram_file_t * file = find (name);
+
+   if (file == NULL || handle.file != NULL)
+   {
+      return NULL;
+   }
+   if (mode[0] == 'r' && !file->exists)
+   {
+      return NULL;
+   }
+
+   if (mode[0] == 'w')
+   {
+      file->size = 0;
+   }
+   file->exists = 1;
+
+   handle.file = file;
+   handle.pos = (mode[0] == 'a') ? file->size : 0;
+   handle.start = handle.pos;
+   handle.writing = mode[0] != 'r';
+   return &handle;
+}
+
+static size_t fs_read (void * data, size_t len, void * f)
+{
+   ram_handle_t * h = f;
+   size_t n = h->file->size - h->pos;
+
+   n = (len < n) ? len : n;
+   memcpy (data, h->file->data + h->pos, n);
+   h->pos += n;
+   return n;
+}
+
+static size_t fs_write (const void * data, size_t len, void * f)
+{
+   ram_handle_t * h = f;
+
+   if (fail_after == 0 || h->pos + len > MAX_FILE)
+   {
+      return 0;
+   }
+   if (fail_after > 0)
+   {
+      fail_after--;
+   }
+
+   memcpy (h->file->data + h->pos, data, len);
+   h->pos += len;
+   h->file->size = h->pos;
+   flash.writes++;
+   return len;
+}
+
+static int fs_close (void * f)
+{
+   ram_handle_t * h = f;
+   uint32_t end = h->file->size;
+
+   if (h->writing && end > h->start)
+   {
+      flash.progs += (end + PROG_SIZE - 1) / PROG_SIZE - h->start / PROG_SIZE;
+      flash.erases += (end + BLOCK_SIZE - 1) / BLOCK_SIZE -
+                      (h->start + BLOCK_SIZE - 1) / BLOCK_SIZE;
+   }
+   if (h->writing)
+   {
+      flash.progs++;
+   }
+
+   h->file = NULL;
+   return 0;
+}
+
+static int fs_remove (const char * name)
+{
+   ram_file_t * file = find (name);
+
+   if (file == NULL || !file->exists)
+   {
+      return -1;
+   }
+
+   file->exists = 0;
+   file->size = 0;
+   flash.progs++;
+   return 0;
+}
+
+static void fs_lock (void)
+{
+}
+
+static void fs_unlock (void)
+{
+}
+
+static const param_log_fs_t fs = {
+   .open = fs_open,
+   .read = fs_read,
+   .write = fs_write,
+   .close = fs_close,
+   .remove = fs_remove,
+   .lock = fs_lock,
+   .unlock = fs_unlock,
+};
+
+typedef struct store
+{
+   param_log_t log;
+   param_log_entry_t * entries;
+   uint32_t * values;
+} store_t;
+
+static double now_us (void)
+{
+   struct timespec ts;
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void store_init (store_t * s, uint16_t n)
+{
+   s->entries = calloc (n, sizeof (*s->entries));
+   s->values = calloc (n, sizeof (*s->values));
+   if (s->entries == NULL || s->values == NULL)
+   {
+      exit (1);
+   }
+
+   for (uint16_t i = 0; i < n; i++)
+   {
+      s->entries[i].value = &s->values[i];
+      s->entries[i].size = sizeof (s->values[i]);
+   }
+
+   if (
+      param_log_init (
+         &s->log,
+         &fs,
+         files[0].name,
+         files[1].name,
+         s->entries,
+         n,
+         0x12345678,
+         COMPACT_SIZE) != 0)
+   {
+      exit (1);
+   }
+}
+
+static void store_free (store_t * s)
+{
+   free (s->log.scratch);
+   free (s->entries);
+   free (s->values);
+}
+
+static void reset_flash (void)
+{
+   for (int i = 0; i < 2; i++)
+   {
+      files[i].exists = 0;
+      files[i].size = 0;
+   }
+   memset (&flash, 0, sizeof (flash));
+   fail_after = -1;
+}
+
+static void plc_write (store_t * s, uint16_t ix, uint32_t value)
+{
+   s->values[ix] = value;
+   s->entries[ix].dirty = 1;
+}
+
+/* Load the log as after a power cycle and compare with the values */
+static int verify (const store_t * s, uint16_t n)
+{
+   flash_stats_t saved = flash;
+   store_t loaded;
+   int errors = 0;
+
+   store_init (&loaded, n);
+   if (param_log_load (&loaded.log) != 0)
+   {
+      errors++;
+   }
+   else if (memcmp (loaded.values, s->values, n * sizeof (uint32_t)) != 0)
+   {
+      errors++;
+   }
+   store_free (&loaded);
+
+   flash = saved;
+   return errors;
+}
+
+static int run (
+   const char * name,
+   uint16_t n,
+   uint32_t bursts,
+   int coalesce,
+   uint32_t prog_us,
+   uint32_t erase_us)
+{
+   store_t s;
+   uint32_t plc_writes = 0;
+   uint32_t flushes = 0;
+   double cpu_total = 0;
+   double cpu_max = 0;
+   double flash_ms;
+   int errors = 0;
+
+   reset_flash();
+   store_init (&s, n);
+   srand (1);
+
+   for (uint32_t b = 0; b < bursts; b++)
+   {
+      uint16_t first = rand() % (n - BURST_PARAMS + 1);
+
+      for (int w = 0; w < BURST_WRITES; w++)
+      {
+         for (uint16_t i = first; i < first + BURST_PARAMS; i++)
+         {
+            plc_write (&s, i, rand());
+            plc_writes++;
+
+            if (!coalesce || (w == BURST_WRITES - 1 &&
+                              i == first + BURST_PARAMS - 1))
+            {
+               double start = now_us();
+               double elapsed;
+
+               errors += param_log_flush (&s.log) != 0;
+               elapsed = now_us() - start;
+               cpu_total += elapsed;
+               if (elapsed > cpu_max)
+               {
+                  cpu_max = elapsed;
+               }
+               flushes++;
+               errors += verify (&s, n);
+            }
+         }
+      }
+   }
+
+   flash_ms = (flash.progs * (double)prog_us + flash.erases * (double)erase_us) /
+              1000.0;
+   printf (
+      "%-10s %8u %8u %8u %9u %8u %7u %6u %10.0f %9.2f %8.1f %7.1f\n",
+      name,
+      plc_writes,
+      flushes,
+      s.log.stats.records,
+      s.log.stats.bytes,
+      flash.writes,
+      flash.progs,
+      flash.erases,
+      flash_ms,
+      flash_ms / flushes,
+      cpu_total / flushes,
+      cpu_max);
+
+   store_free (&s);
+   return errors;
+}
+
+/* Fail a write of a flush, then check that the values written by the PLC
+ * stay dirty and that the next flush writes all values. Returns number of
+ * errors, or -1 when the flush has fewer writes than fail. */
+static int fail_flush (uint16_t n, int compaction, int fail)
+{
+   store_t s;
+   int errors = 0;
+   int result;
+
+   reset_flash();
+   store_init (&s, n);
+
+   for (uint16_t i = 0; i < n; i++)
+   {
+      plc_write (&s, i, i);
+   }
+   errors += param_log_flush (&s.log) != 0;
+
+   if (compaction)
+   {
+      s.log.size = COMPACT_SIZE;
+   }
+   for (uint16_t i = 0; i < n; i += 3)
+   {
+      plc_write (&s, i, 1000 + i);
+   }
+
+   fail_after = fail;
+   result = param_log_flush (&s.log);
+   fail_after = -1;
+   if (result == 0)
+   {
+      store_free (&s);
+      return -1;
+   }
+
+   /* Values not written stay dirty */
+   for (uint16_t i = 0; i < n; i += 3)
+   {
+      errors += !s.entries[i].dirty;
+   }
+
+   for (uint16_t i = 1; i < n; i += 5)
+   {
+      plc_write (&s, i, 2000 + i);
+   }
+
+   errors += param_log_flush (&s.log) != 0;
+   errors += verify (&s, n);
+
+   store_free (&s);
+   return errors;
+}
+
+int main (int argc, char * argv[])
+{
+   uint16_t n = (argc > 1) ? atoi (argv[1]) : DEFAULT_PARAMS;
+   uint32_t bursts = (argc > 2) ? atoi (argv[2]) : DEFAULT_BURSTS;
+   uint32_t prog_us = (argc > 3) ? atoi (argv[3]) : DEFAULT_PROG_US;
+   uint32_t erase_us = (argc > 4) ? atoi (argv[4]) : DEFAULT_ERASE_US;
+   int errors = 0;
+
+   if (n < BURST_PARAMS)
+   {
+      n = BURST_PARAMS;
+   }
+
+   printf (
+      "%u parameters, %u bursts of %d writes to %d parameters\n"
+      "Page program %u us, block erase %u us\n",
+      n,
+      bursts,
+      BURST_WRITES * BURST_PARAMS,
+      BURST_PARAMS,
+      prog_us,
+      erase_us);
+   printf (
+      "%-10s %8s %8s %8s %9s %8s %7s %6s %10s %9s %8s %7s\n",
+      "",
+      "plc",
+      "flushes",
+      "records",
+      "bytes",
+      "writes",
+      "progs",
+      "erases",
+      "flash [ms]",
+      "per flush",
+      "cpu [us]",
+      "max");
+
+   errors += run ("each", n, bursts, 0, prog_us, erase_us);
+   errors += run ("coalesced", n, bursts, 1, prog_us, erase_us);
+
+   for (int compaction = 0; compaction < 2; compaction++)
+   {
+      int positions = 0;
+
+      for (int fail = 0;; fail++)
+      {
+         int result = fail_flush (n, compaction, fail);
+
+         if (result < 0)
+         {
+            break;
+         }
+         errors += result;
+         positions++;
+      }
+
+      printf (
+         "Failed write in %s at %d positions: %s\n",
+         compaction ? "compaction" : "append",
+         positions,
+         errors ? "FAILED" : "ok");
+   }
+
+   return errors ? 1 : 0;
+}
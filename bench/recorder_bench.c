@@ -0,0 +1,298 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host test and benchmark of the process data recorder in
+ * source/recorder.c.
+ *
+ * A signal table of typical process data is generated from the cycle
+ * number: a counter, a bool toggling now and then, a slow int16
+ * sawtooth, a float ramp, a constant and an int8 step. Each test
+ * records it and decodes the recording, checking every decoded value
+ * against the generator and the trigger window. Reports the cost per
+ * sample, the memory used per cycle compared to raw values and how many
+ * cycles the buffer holds.
+ *
+ * Not part of the firmware build, see .cyignore.
+ *
+ * Build and run:
+ *   cc -O2 -Isource bench/recorder_bench.c source/recorder.c -o recorder_bench
+ *   ./recorder_bench [buffer_kib]
+ */
+
+#include "recorder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_BUFFER_KIB 32
+#define N_SIGNALS          6
+
+typedef struct signals
+{
+   uint32_t counter;
+   uint8_t toggle;
+   int16_t saw;
+   float ramp;
+   uint16_t constant;
+   int8_t step;
+} signals_t;
+
+static signals_t sig;
+static uint32_t * buf;
+static uint32_t buf_size;
+static uint32_t failures;
+
+static uint64_t now_ns (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void generate (signals_t * s, uint32_t cycle)
+{
+   s->counter = cycle;
+   s->toggle = (cycle / 250) & 1;
+   s->saw = (int16_t)((cycle / 4) % 2000) - 1000;
+   s->ramp = 20.0f + (cycle % 1000) * 0.125f;
+   s->constant = 42;
+   s->step = (cycle / 3000) % 2 ? -5 : 5;
+}
+
+static void setup (recorder_t * r, uint8_t n)
+{
+   recorder_init (r, buf, buf_size);
+   recorder_add_channel (r, "counter", &sig.counter, 4, RECORDER_UINT);
+   recorder_add_channel (r, "toggle", &sig.toggle, 1, RECORDER_UINT);
+   recorder_add_channel (r, "saw", &sig.saw, 2, RECORDER_INT);
+   recorder_add_channel (r, "ramp", &sig.ramp, 4, RECORDER_REAL);
+   recorder_add_channel (r, "constant", &sig.constant, 2, RECORDER_UINT);
+   recorder_add_channel (r, "step", &sig.step, 1, RECORDER_INT);
+   r->n_channels = n;
+}
+
+/* Run until done or cycles, return cycles run */
+static uint32_t run (recorder_t * r, uint32_t cycles, uint64_t * max_ns)
+{
+   uint32_t c;
+
+   *max_ns = 0;
+   for (c = 0; c < cycles && recorder_active (r); c++)
+   {
+      uint64_t start;
+      uint64_t t;
+
+      generate (&sig, c);
+      start = now_ns();
+      recorder_sample (r);
+      t = now_ns() - start;
+      *max_ns = (t > *max_ns) ? t : *max_ns;
+   }
+   return c;
+}
+
+/* Decode and check, return cycles decoded */
+static uint32_t verify (
+   const recorder_t * r,
+   const char * test,
+   uint32_t first,
+   uint32_t last)
+{
+   recorder_reader_t rd;
+   uint32_t n = 0;
+   uint32_t expect = first;
+
+   if (recorder_read_start (r, &rd) != 0)
+   {
+      printf ("%s: nothing recorded\n", test);
+      failures++;
+      return 0;
+   }
+
+   while (recorder_read_next (r, &rd))
+   {
+      signals_t s;
+
+      if (rd.cycle != expect)
+      {
+         printf ("%s: cycle %u, expected %u\n", test, rd.cycle, expect);
+         failures++;
+         return n;
+      }
+      generate (&s, rd.cycle);
+      for (uint8_t i = 0; i < r->n_channels; i++)
+      {
+         const void * values[N_SIGNALS] = {
+            &s.counter,
+            &s.toggle,
+            &s.saw,
+            &s.ramp,
+            &s.constant,
+            &s.step};
+
+         if (rd.value[i] != recorder_load (&r->channels[i], values[i]))
+         {
+            printf ("%s: cycle %u channel %u mismatch\n", test, rd.cycle, i);
+            failures++;
+            return n;
+         }
+      }
+      expect++;
+      n++;
+   }
+
+   if (expect != last + 1)
+   {
+      printf ("%s: last cycle %u, expected %u\n", test, expect - 1, last);
+      failures++;
+   }
+   return n;
+}
+
+static uint32_t used_bytes (const recorder_t * r)
+{
+   uint32_t used = 0;
+
+   for (uint16_t i = 0; i < r->count; i++)
+   {
+      used += recorder_block (r, i)->used;
+   }
+   return used;
+}
+
+/* Free running, the ring keeps the latest cycles */
+static void test_free_running (void)
+{
+   static recorder_t r;
+   uint64_t start;
+   uint64_t elapsed;
+   uint64_t max_ns;
+   uint32_t cycles = 1000000;
+   uint32_t first;
+   uint32_t n;
+
+   setup (&r, N_SIGNALS);
+   recorder_arm (&r, RECORDER_TRIGGER_NONE, 0, 0, 0, 0);
+   start = now_ns();
+   run (&r, cycles, &max_ns);
+   elapsed = now_ns() - start;
+   recorder_stop (&r);
+
+   first = recorder_first (&r);
+   n = verify (&r, "free running", first, cycles - 1);
+
+   printf (
+      "free    : %u cycles, %.0f ns avg %.0f ns max per sample, %u records, "
+      "%u key frames\n",
+      cycles,
+      (double)elapsed / cycles,
+      (double)max_ns,
+      r.records,
+      r.key_frames);
+   printf (
+      "          %u cycles kept in %u bytes, %.2f bytes/cycle, raw %u "
+      "bytes/cycle, %.0fx\n",
+      n,
+      used_bytes (&r),
+      (double)used_bytes (&r) / n,
+      N_SIGNALS * 4,
+      (double)n * N_SIGNALS * 4 / used_bytes (&r));
+}
+
+/* Trigger on a threshold of the sawtooth and on an edge of the toggle */
+static void test_trigger (
+   const char * test,
+   recorder_trigger_t trigger,
+   uint8_t ch,
+   uint32_t level,
+   uint32_t pre,
+   uint32_t post,
+   uint32_t expect_trigger)
+{
+   static recorder_t r;
+   uint64_t max_ns;
+   uint32_t first;
+
+   setup (&r, N_SIGNALS);
+   recorder_arm (&r, trigger, ch, level, pre, post);
+   run (&r, 10000000, &max_ns);
+
+   if (!r.triggered || r.trigger_cycle != expect_trigger)
+   {
+      printf (
+         "%s: triggered %d at %u, expected %u\n",
+         test,
+         r.triggered,
+         r.trigger_cycle,
+         expect_trigger);
+      failures++;
+      return;
+   }
+
+   first = recorder_first (&r);
+   if (!r.truncated && first != (expect_trigger > pre ? expect_trigger - pre : 0))
+   {
+      printf ("%s: pre-trigger window starts at %u\n", test, first);
+      failures++;
+   }
+   verify (&r, test, first, r.cycle - 1);
+
+   printf (
+      "%-8s: trigger at %u, cycles %u..%u (%d..%d), %s, max %.0f ns\n",
+      test,
+      r.trigger_cycle,
+      first,
+      r.cycle - 1,
+      (int)(first - r.trigger_cycle),
+      (int)(r.cycle - 1 - r.trigger_cycle),
+      r.truncated ? "truncated" : "complete",
+      (double)max_ns);
+}
+
+int main (int argc, char * argv[])
+{
+   uint32_t kib = (argc > 1) ? strtoul (argv[1], NULL, 0) : DEFAULT_BUFFER_KIB;
+   float level = 50.0f;
+   uint32_t level_bits;
+
+   buf_size = kib * 1024;
+   buf = malloc (buf_size);
+   memcpy (&level_bits, &level, sizeof (level_bits));
+
+   printf (
+      "buffer %u KiB, %u blocks, %d signals\n",
+      kib,
+      buf_size / RECORDER_BLOCK_SIZE,
+      N_SIGNALS);
+
+   test_free_running();
+   /* saw reaches 500 at cycle 6000, pre and post window fit */
+   test_trigger ("rise", RECORDER_TRIGGER_RISE, 2, 500, 2000, 2000, 6000);
+   /* toggle falls at cycle 500 */
+   test_trigger ("edge", RECORDER_TRIGGER_FALL, 1, 0, 100, 100, 500);
+   /* ramp drops from 144.875 to 20 at cycle 1000 */
+   test_trigger ("real", RECORDER_TRIGGER_FALL, 3, level_bits, 300, 300, 1000);
+   /* post-trigger window too long for the buffer */
+   test_trigger ("long", RECORDER_TRIGGER_CHANGE, 1, 0, 5000, 10000000, 250);
+
+   if (failures != 0)
+   {
+      printf ("FAILED\n");
+      return 1;
+   }
+   printf ("OK\n");
+   return 0;
+}
@@ -0,0 +1,233 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host test and benchmark of the triple buffered snapshots in
+ * source/snapshot.c. A writer thread, standing in for the cyclic
+ * callbacks, fills an image with its cycle number and publishes it every
+ * period. A reader thread, standing in for the gateway task, acquires
+ * and checks the image in a tight loop. Any mix of two cycles in one
+ * acquired image is reported as torn. For comparison the same is done
+ * with a mutex around the image, where the writer may have to wait for
+ * the reader. Not part of the firmware build, see .cyignore.
+ *
+ * Build and run:
+ *   cc -O2 -Isource bench/snapshot_bench.c source/snapshot.c -lpthread \
+ *      -o snapshot_bench
+ *   ./snapshot_bench [size] [period_us] [cycles]
+ */
+
+#include "snapshot.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_SIZE      1024
+#define DEFAULT_PERIOD_US 250
+#define DEFAULT_CYCLES    4000
+
+typedef struct result
+{
+   uint64_t write_total; /* ns */
+   uint64_t write_max;
+   uint64_t reads;
+   uint64_t torn;
+   uint64_t stale; /* Went back to an older cycle */
+} result_t;
+
+typedef struct bench
+{
+   bool use_mutex;
+   uint32_t size;
+   uint32_t period;
+   uint32_t cycles;
+   atomic_bool done;
+   snapshot_t snapshot;
+   pthread_mutex_t lock;
+   uint8_t * image; /* For the mutex variant */
+   result_t result;
+} bench_t;
+
+static uint64_t now_ns (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void fill (uint8_t * buf, uint32_t size, uint32_t cycle)
+{
+   for (uint32_t i = 0; i < size; i += sizeof (cycle))
+   {
+      memcpy (buf + i, &cycle, sizeof (cycle));
+   }
+}
+
+/* Returns the cycle of an image, or UINT32_MAX if torn */
+static uint32_t check (const uint8_t * buf, uint32_t size)
+{
+   uint32_t cycle;
+
+   memcpy (&cycle, buf, sizeof (cycle));
+   for (uint32_t i = sizeof (cycle); i < size; i += sizeof (cycle))
+   {
+      if (memcmp (buf + i, &cycle, sizeof (cycle)) != 0)
+      {
+         return UINT32_MAX;
+      }
+   }
+   return cycle;
+}
+
+static void * writer (void * arg)
+{
+   bench_t * b = arg;
+   uint64_t t = now_ns();
+
+   for (uint32_t cycle = 1; cycle <= b->cycles; cycle++)
+   {
+      struct timespec ts;
+      uint64_t start;
+      uint64_t elapsed;
+
+      t += b->period;
+      ts.tv_sec = t / 1000000000ull;
+      ts.tv_nsec = t % 1000000000ull;
+      clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+      start = now_ns();
+      if (b->use_mutex)
+      {
+         pthread_mutex_lock (&b->lock);
+         fill (b->image, b->size, cycle);
+         pthread_mutex_unlock (&b->lock);
+      }
+      else
+      {
+         fill (snapshot_write_buffer (&b->snapshot), b->size, cycle);
+         snapshot_publish (&b->snapshot);
+      }
+      elapsed = now_ns() - start;
+
+      b->result.write_total += elapsed;
+      if (elapsed > b->result.write_max)
+      {
+         b->result.write_max = elapsed;
+      }
+   }
+
+   atomic_store (&b->done, true);
+   return NULL;
+}
+
+static void reader (bench_t * b)
+{
+   uint8_t * copy = malloc (b->size);
+   uint32_t last = 0;
+
+   while (!atomic_load (&b->done))
+   {
+      uint32_t cycle;
+
+      if (b->use_mutex)
+      {
+         /* Serve a request while holding the image */
+         pthread_mutex_lock (&b->lock);
+         memcpy (copy, b->image, b->size);
+         cycle = check (copy, b->size);
+         pthread_mutex_unlock (&b->lock);
+      }
+      else
+      {
+         cycle = check (snapshot_acquire (&b->snapshot, NULL), b->size);
+      }
+
+      b->result.reads++;
+      if (cycle == UINT32_MAX)
+      {
+         b->result.torn++;
+      }
+      else if (cycle < last)
+      {
+         b->result.stale++;
+      }
+      else
+      {
+         last = cycle;
+      }
+   }
+   free (copy);
+}
+
+int main (int argc, char * argv[])
+{
+   uint32_t size = (argc > 1) ? strtoul (argv[1], NULL, 0) : DEFAULT_SIZE;
+   uint32_t period_us =
+      (argc > 2) ? strtoul (argv[2], NULL, 0) : DEFAULT_PERIOD_US;
+   uint32_t cycles = (argc > 3) ? strtoul (argv[3], NULL, 0) : DEFAULT_CYCLES;
+   int failed = 0;
+
+   size = (size + 3) & ~3u;
+   printf (
+      "image %u bytes, period %u us, %u cycles\n",
+      size,
+      period_us,
+      cycles);
+   printf ("variant    write avg/max (ns)      reads   torn  stale\n");
+
+   for (int use_mutex = 0; use_mutex <= 1; use_mutex++)
+   {
+      bench_t * b = calloc (1, sizeof (*b));
+      pthread_t thread;
+
+      b->use_mutex = use_mutex;
+      b->size = size;
+      b->period = period_us * 1000;
+      b->cycles = cycles;
+      pthread_mutex_init (&b->lock, NULL);
+      b->image = calloc (1, size);
+      if (b->image == NULL || snapshot_init (&b->snapshot, size) != 0)
+      {
+         printf ("out of memory\n");
+         return 1;
+      }
+
+      pthread_create (&thread, NULL, writer, b);
+      reader (b);
+      pthread_join (thread, NULL);
+
+      printf (
+         "%-8s %8.0f %10llu %10llu %6llu %6llu\n",
+         use_mutex ? "mutex" : "snapshot",
+         (double)b->result.write_total / cycles,
+         (unsigned long long)b->result.write_max,
+         (unsigned long long)b->result.reads,
+         (unsigned long long)b->result.torn,
+         (unsigned long long)b->result.stale);
+
+      if (!use_mutex && (b->result.torn != 0 || b->result.stale != 0))
+      {
+         failed = 1;
+      }
+      free (b->snapshot.buf[0]);
+      free (b->image);
+      free (b);
+   }
+
+   printf ("%s\n", failed ? "FAILED" : "OK");
+   return failed;
+}
@@ -0,0 +1,659 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host load test of the process data stream in source/stream.c.
+ *
+ * A signal table of typical process data is updated every tick: a
+ * counter, a float ramp, a few bools toggling now and then and a number
+ * of signals that never change. Simulated viewers connect, each with a
+ * connection that takes a given number of bytes per tick: fast ones,
+ * slow ones that cannot keep up, ones that stop reading for a while and
+ * ones that disconnect. Every viewer parses the events it receives and
+ * its copy of the signals is checked against the signal table of the
+ * tick of each event. The static assets are checked on a kept open
+ * connection, with a conditional request and a slow reader. Then the
+ * cost of a tick is measured for an increasing number of fast viewers.
+ *
+ * Not part of the firmware build, see .cyignore.
+ *
+ * Build and run:
+ *   cc -O2 -Isource bench/stream_bench.c source/stream.c -lm \
+ *      -o stream_bench
+ *   ./stream_bench [max_viewers]
+ */
+
+#include "stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_FIELDS        40
+#define MAX_VIEWERS     256
+#define HISTORY         64
+#define RX_SIZE         (64 * 1024)
+#define VALUE_SIZE      24
+#define DEFAULT_VIEWERS 128
+#define TICKS           2000
+
+typedef struct viewer
+{
+   int capacity;     /* Bytes taken per tick, -1 to fail */
+   int budget;       /* Left this tick */
+   int stop_at;      /* Tick to stop reading, 0 for never */
+   int resume_at;
+   int fail_at;      /* Tick to disconnect, 0 for never */
+   bool open;
+   bool closed;      /* By the stream */
+   bool headers;
+   bool meta;
+   uint32_t seq;
+   uint32_t events;
+   uint32_t fulls;
+   uint32_t deltas;
+   uint32_t len;
+   stream_client_t * c;
+   char rx[RX_SIZE];
+   char value[N_FIELDS][VALUE_SIZE];
+} viewer_t;
+
+static stream_t stream;
+static stream_field_t fields[N_FIELDS];
+static uint8_t prev[256];
+static stream_client_t clients[MAX_VIEWERS];
+static viewer_t * viewers;
+static uint8_t history[HISTORY][256];
+static uint32_t tick;
+static uint32_t failures;
+
+/* Stand-ins for the compressed assets */
+static const uint8_t page[] = "<html>viewer</html>";
+static const uint8_t script[] = "var viewer = 1; /* ... */";
+
+static const web_asset_t assets[] = {
+   {
+      .path = "/",
+      .type = "text/html",
+      .etag = "\"11112222\"",
+      .data = page,
+      .size = sizeof (page) - 1,
+      .immutable = false,
+   },
+   {
+      .path = "/viewer.js",
+      .type = "text/javascript",
+      .etag = "\"33334444\"",
+      .data = script,
+      .size = sizeof (script) - 1,
+      .immutable = true,
+   },
+};
+
+static uint64_t now_ns (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int viewer_send (int fd, const void * buf, uint16_t len)
+{
+   viewer_t * v = &viewers[fd];
+   int n;
+
+   if (v->fail_at != 0 && (int)tick >= v->fail_at)
+   {
+      return -1;
+   }
+   if (v->stop_at != 0 && (int)tick >= v->stop_at && (int)tick < v->resume_at)
+   {
+      return 0;
+   }
+
+   n = (len < v->budget) ? len : v->budget;
+   if (v->len + n > RX_SIZE)
+   {
+      n = RX_SIZE - v->len;
+   }
+   memcpy (v->rx + v->len, buf, n);
+   v->len += n;
+   v->budget -= n;
+   return n;
+}
+
+static void viewer_close (int fd)
+{
+   viewers[fd].closed = true;
+}
+
+static const stream_ops_t ops = {viewer_send, viewer_close};
+
+/* Signal table of a tick */
+static void generate (uint8_t * image, uint32_t t)
+{
+   uint32_t counter = t;
+   float ramp = (t % 500) * 0.25f - 10.0f;
+
+   memset (image, 0, stream.image_size);
+   memcpy (image + fields[0].offset, &counter, 4);
+   memcpy (image + fields[1].offset, &ramp, 4);
+   for (int i = 2; i < 6; i++)
+   {
+      image[fields[i].offset] = (t / (7 * i)) & 1;
+   }
+   image[fields[6].offset + t % 8] = t & 0xFF;
+   for (int i = 7; i < N_FIELDS; i++)
+   {
+      image[fields[i].offset] = i;
+   }
+}
+
+static void expected (const uint8_t * image, int i, char * out)
+{
+   const stream_field_t * f = &fields[i];
+   const uint8_t * p = image + f->offset;
+   uint32_t u32 = 0;
+   float real;
+
+   switch (f->type)
+   {
+   case STREAM_REAL:
+      memcpy (&real, p, 4);
+      snprintf (out, VALUE_SIZE, "%.9g", (double)real);
+      break;
+   case STREAM_OCTETS:
+      out[0] = '"';
+      for (int j = 0; j < f->size; j++)
+      {
+         snprintf (out + 1 + 2 * j, 3, "%02x", p[j]);
+      }
+      strcpy (out + 1 + 2 * f->size, "\"");
+      break;
+   case STREAM_INT:
+      snprintf (out, VALUE_SIZE, "%d", (int8_t)p[0]);
+      break;
+   default:
+      memcpy (&u32, p, f->size);
+      snprintf (out, VALUE_SIZE, "%u", u32);
+      break;
+   }
+}
+
+static void setup (void)
+{
+   static const char * names[N_FIELDS];
+   static char text[N_FIELDS][16];
+
+   stream_init (
+      &stream,
+      fields,
+      N_FIELDS,
+      prev,
+      clients,
+      MAX_VIEWERS,
+      &ops,
+      assets,
+      sizeof (assets) / sizeof (assets[0]));
+   for (int i = 0; i < N_FIELDS; i++)
+   {
+      snprintf (text[i], sizeof (text[i]), "Signal %d", i);
+      names[i] = text[i];
+   }
+   stream_add_field (&stream, "Counter", names[0], STREAM_UINT, 4, false);
+   stream_add_field (&stream, "Analog", names[1], STREAM_REAL, 4, false);
+   for (int i = 2; i < 6; i++)
+   {
+      stream_add_field (&stream, "DI", names[i], STREAM_UINT, 1, false);
+   }
+   stream_add_field (&stream, "Raw", names[6], STREAM_OCTETS, 8, false);
+   for (int i = 7; i < N_FIELDS; i++)
+   {
+      stream_add_field (&stream, "DO", names[i], STREAM_INT, 1, true);
+   }
+}
+
+/* Apply a "v" value list to the copy of the viewer */
+static int apply (viewer_t * v, char * data, bool full)
+{
+   char * p = strstr (data, "\"v\":") + 5;
+   int i = 0;
+
+   while (*p != ']' && *p != '}')
+   {
+      char * end;
+
+      if (!full)
+      {
+         i = strtol (p + 1, &end, 10);
+         p = end + 2;
+      }
+      end = p + strcspn (p, ",]}");
+      if (i >= N_FIELDS || end - p >= VALUE_SIZE)
+      {
+         return -1;
+      }
+      memcpy (v->value[i], p, end - p);
+      v->value[i][end - p] = '\0';
+      i++;
+      p = (*end == ',') ? end + 1 : end;
+   }
+   return (full && i != N_FIELDS) ? -1 : 0;
+}
+
+/* Parse complete events, check the copy after each */
+static void viewer_parse (viewer_t * v, int ix)
+{
+   char * p = v->rx;
+   char * end;
+
+   v->rx[v->len] = '\0';
+   if (!v->headers)
+   {
+      end = strstr (p, "\r\n\r\n");
+      if (end == NULL)
+      {
+         return;
+      }
+      if (strncmp (p, "HTTP/1.1 200 OK", 15) != 0)
+      {
+         printf ("viewer %d: bad response\n", ix);
+         failures++;
+      }
+      v->headers = true;
+      p = end + 4;
+   }
+
+   while ((end = strstr (p, "\n\n")) != NULL)
+   {
+      char * data = strstr (p, "data: ");
+      uint32_t seq;
+
+      *end = '\0';
+      if (strncmp (p, "event: ", 7) == 0 && data != NULL)
+      {
+         char * ev = p + 7;
+
+         v->events++;
+         if (strncmp (ev, "meta", 4) == 0)
+         {
+            v->meta = strstr (data, "\"Counter.Signal 0\"") != NULL &&
+                      strstr (data, "\"type\":\"octets64\"") != NULL;
+         }
+         else
+         {
+            bool full = strncmp (ev, "full", 4) == 0;
+
+            seq = strtoul (strstr (data, "\"seq\":") + 6, NULL, 10);
+            if (
+               !v->meta || (!full && seq != v->seq + 1) || seq > tick ||
+               tick - seq >= HISTORY || apply (v, data, full) != 0)
+            {
+               printf ("viewer %d: bad event at seq %u\n", ix, seq);
+               failures++;
+               v->open = false;
+               return;
+            }
+            v->seq = seq;
+            v->fulls += full ? 1 : 0;
+            v->deltas += full ? 0 : 1;
+
+            for (int i = 0; i < N_FIELDS; i++)
+            {
+               char value[VALUE_SIZE];
+
+               expected (history[seq % HISTORY], i, value);
+               if (strcmp (value, v->value[i]) != 0)
+               {
+                  printf (
+                     "viewer %d: seq %u signal %d is %s, expected %s\n",
+                     ix,
+                     seq,
+                     i,
+                     v->value[i],
+                     value);
+                  failures++;
+                  v->open = false;
+                  return;
+               }
+            }
+         }
+      }
+      p = end + 2;
+   }
+
+   v->len -= p - v->rx;
+   memmove (v->rx, p, v->len);
+}
+
+static void connect (int ix, const char * request)
+{
+   stream_client_t * c = stream_open (&stream, ix);
+
+   viewers[ix].open = c != NULL;
+   viewers[ix].c = c;
+   if (c != NULL && request != NULL)
+   {
+      stream_receive (&stream, c, request, strlen (request));
+   }
+}
+
+static void run_tick (int n)
+{
+   tick++;
+   generate (history[tick % HISTORY], tick);
+   for (int i = 0; i < n; i++)
+   {
+      viewers[i].budget = viewers[i].capacity;
+   }
+   stream_tick (&stream, history[tick % HISTORY], tick);
+}
+
+/* Mixed viewers, every event of every viewer checked */
+static void test_backpressure (void)
+{
+   const char * req = "GET /stream HTTP/1.1\r\nHost: device\r\n\r\n";
+   int n = 12;
+
+   setup();
+   tick = 0;
+   memset (viewers, 0, sizeof (*viewers) * MAX_VIEWERS);
+   for (int i = 0; i < n; i++)
+   {
+      viewer_t * v = &viewers[i];
+
+      v->capacity = 1 << 16;
+      if (i % 4 == 1)
+      {
+         v->capacity = 60 + 10 * i; /* Slow, less than an event per tick */
+      }
+      else if (i % 4 == 2)
+      {
+         v->stop_at = 100 + 10 * i; /* Stops reading for a while */
+         v->resume_at = v->stop_at + 50 + i;
+      }
+      else if (i % 4 == 3 && i > 4)
+      {
+         v->fail_at = 500; /* Disconnects */
+      }
+   }
+
+   for (int t = 0; t < TICKS; t++)
+   {
+      if (t == 10)
+      {
+         for (int i = 0; i < n; i++)
+         {
+            connect (i, req);
+         }
+         connect (n, "GET / HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n");
+         connect (n + 1, "GET /nothing HTTP/1.1\r\n\r\n");
+         connect (n + 2, "GET /stream HTTP/1.1\r\n"); /* Never completes */
+         viewers[n].capacity = viewers[n + 1].capacity = 1 << 16;
+      }
+      run_tick (n + 3);
+      for (int i = 0; i < n; i++)
+      {
+         if (viewers[i].open && !viewers[i].closed)
+         {
+            viewer_parse (&viewers[i], i);
+         }
+      }
+   }
+
+   for (int i = 0; i < n; i++)
+   {
+      viewer_t * v = &viewers[i];
+      bool fails = v->fail_at != 0;
+
+      if (!v->open || v->closed != fails || (!fails && v->seq + 20 < tick))
+      {
+         printf (
+            "viewer %d: open %d closed %d at seq %u of %u\n",
+            i,
+            v->open,
+            v->closed,
+            v->seq,
+            tick);
+         failures++;
+      }
+      printf (
+         "viewer %2d: %-9s %5u deltas %4u fulls %4u skipped%s\n",
+         i,
+         v->fail_at      ? "closing"
+         : v->stop_at    ? "stopping"
+         : v->capacity < 1000 ? "slow"
+                              : "fast",
+         v->deltas,
+         v->fulls,
+         clients[i].skipped,
+         v->closed ? ", closed" : "");
+   }
+
+   if (
+      !viewers[n].closed ||
+      strstr (viewers[n].rx, (const char *)page) == NULL ||
+      !viewers[n + 1].closed || strstr (viewers[n + 1].rx, "404") == NULL ||
+      !viewers[n + 2].closed || stream.stats.stalled != 1)
+   {
+      printf ("page, 404 or stalled request not handled\n");
+      failures++;
+   }
+   printf (
+      "stream   : %u ticks, %u deltas and %u fulls encoded, %u bytes sent\n",
+      stream.stats.ticks,
+      stream.stats.deltas,
+      stream.stats.fulls,
+      stream.stats.bytes);
+}
+
+/* Send a request on a connection, return what was received after some
+ * ticks */
+static const char * request (int ix, const char * req)
+{
+   viewer_t * v = &viewers[ix];
+
+   v->len = 0;
+   stream_receive (&stream, v->c, req, strlen (req));
+   for (int t = 0; t < 200 && !v->closed; t++)
+   {
+      v->budget = v->capacity;
+      stream_writable (&stream, v->c);
+      if (v->c->phase == STREAM_REQUEST)
+      {
+         break;
+      }
+      run_tick (0);
+   }
+   v->rx[v->len] = '\0';
+   return v->rx;
+}
+
+static void expect (int ix, const char * rsp, const char * text, bool found)
+{
+   if ((strstr (rsp, text) != NULL) != found)
+   {
+      printf (
+         "asset connection %d: \"%s\" %s in\n%s\n",
+         ix,
+         text,
+         found ? "missing" : "unexpected",
+         rsp);
+      failures++;
+   }
+}
+
+/* Static assets on kept open connections */
+static void test_assets (void)
+{
+   static char large[STREAM_MAX_REQUEST + 100];
+   char header[700];
+   const char * rsp;
+
+   setup();
+   tick = 0;
+   memset (viewers, 0, sizeof (*viewers) * MAX_VIEWERS);
+   for (int i = 0; i < 4; i++)
+   {
+      viewers[i].capacity = 1 << 16;
+      connect (i, NULL);
+   }
+
+   /* A browser request, most of it ignored */
+   memset (header, 'x', sizeof (header));
+   memcpy (header, "User-Agent: ", 12);
+   header[sizeof (header) - 1] = '\0';
+   snprintf (
+      large,
+      sizeof (large),
+      "GET / HTTP/1.1\r\nHost: device\r\n%s\r\n"
+      "accept-encoding: gzip, deflate, br\r\n\r\n",
+      header);
+   rsp = request (0, large);
+   expect (0, rsp, "HTTP/1.1 200 OK\r\n", true);
+   expect (0, rsp, "Content-Encoding: gzip\r\n", true);
+   expect (0, rsp, "Content-Length: 19\r\n", true);
+   expect (0, rsp, "ETag: \"11112222\"\r\n", true);
+   expect (0, rsp, "Cache-Control: no-cache\r\n", true);
+   expect (0, rsp, "\r\n\r\n<html>viewer</html>", true);
+
+   rsp = request (
+      0,
+      "GET /viewer.js?v=33334444 HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n");
+   expect (0, rsp, "Cache-Control: public, max-age=31536000, immutable", true);
+   expect (0, rsp, (const char *)script, true);
+
+   rsp = request (
+      0,
+      "GET / HTTP/1.1\r\nAccept-Encoding: gzip\r\n"
+      "If-None-Match: \"11112222\"\r\n\r\n");
+   expect (0, rsp, "HTTP/1.1 304 Not Modified\r\n", true);
+   expect (0, rsp, "<html>", false);
+
+   rsp = request (
+      0,
+      "GET / HTTP/1.1\r\nAccept-Encoding: gzip\r\n"
+      "If-None-Match: \"00000000\"\r\n\r\n");
+   expect (0, rsp, "<html>viewer</html>", true);
+
+   rsp = request (0, "GET /viewer.js HTTP/1.1\r\n\r\n");
+   expect (0, rsp, "HTTP/1.1 406 Not Acceptable", true);
+
+   rsp = request (1, "GET /favicon.ico HTTP/1.1\r\n\r\n");
+   expect (1, rsp, "HTTP/1.1 404 Not Found", true);
+
+   memset (large, 'x', sizeof (large) - 1);
+   memcpy (large, "GET / HTTP/1.1\r\n", 16);
+   rsp = request (2, large);
+   expect (2, rsp, "HTTP/1.1 400 Bad Request", true);
+
+   /* A slow reader gets headers and body in order */
+   viewers[3].capacity = 7;
+   rsp = request (3, "GET / HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n");
+   expect (3, rsp, "no-cache\r\nVary: Accept-Encoding\r\n\r\n<html>", true);
+   expect (3, rsp, "<html>viewer</html>", true);
+
+   if (
+      !viewers[0].closed || !viewers[1].closed || !viewers[2].closed ||
+      viewers[3].closed || stream.stats.assets != 4 ||
+      stream.stats.not_modified != 1)
+   {
+      printf (
+         "assets: closed %d %d %d %d, %u sent, %u not modified\n",
+         viewers[0].closed,
+         viewers[1].closed,
+         viewers[2].closed,
+         viewers[3].closed,
+         stream.stats.assets,
+         stream.stats.not_modified);
+      failures++;
+   }
+   printf (
+      "assets   : %u sent, %u not modified\n",
+      stream.stats.assets,
+      stream.stats.not_modified);
+}
+
+/* Cost of a tick for fast viewers */
+static void bench (int n)
+{
+   const char * req = "GET /stream HTTP/1.1\r\n\r\n";
+   uint64_t start;
+   uint64_t elapsed;
+   uint32_t bytes;
+   int ticks = 1000;
+
+   setup();
+   tick = 0;
+   memset (viewers, 0, sizeof (*viewers) * MAX_VIEWERS);
+   for (int i = 0; i < n; i++)
+   {
+      viewers[i].capacity = 1 << 16;
+      connect (i, req);
+   }
+   for (int t = 0; t < 10; t++)
+   {
+      run_tick (n);
+   }
+
+   bytes = stream.stats.bytes;
+   start = now_ns();
+   for (int t = 0; t < ticks; t++)
+   {
+      run_tick (n);
+      /* Drop what was received */
+      for (int i = 0; i < n; i++)
+      {
+         viewers[i].len = 0;
+      }
+   }
+   elapsed = now_ns() - start;
+
+   printf (
+      "%8d %10.2f %10.3f %10.1f\n",
+      n,
+      (double)elapsed / ticks / 1000,
+      (double)elapsed / ticks / 1000 / n,
+      (double)(stream.stats.bytes - bytes) / ticks / n);
+}
+
+int main (int argc, char * argv[])
+{
+   int max = (argc > 1) ? atoi (argv[1]) : DEFAULT_VIEWERS;
+
+   viewers = calloc (MAX_VIEWERS, sizeof (*viewers));
+   max = (max > MAX_VIEWERS - 3) ? MAX_VIEWERS - 3 : max;
+
+   test_backpressure();
+   test_assets();
+
+   printf (
+      "\n%8s %10s %10s %10s\n",
+      "viewers",
+      "us/tick",
+      "us/viewer",
+      "B/viewer");
+   for (int n = 1; n <= max; n *= 2)
+   {
+      bench (n);
+   }
+
+   if (failures != 0)
+   {
+      printf ("FAILED\n");
+      return 1;
+   }
+   printf ("OK\n");
+   return 0;
+}
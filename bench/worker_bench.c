@@ -0,0 +1,201 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host benchmark of the worker wait policies in source/worker.c. A mock
+ * bus thread signals a cycle edge every period, the worker thread waits
+ * for it as told by the policy, sleeping on a condition variable or
+ * polling, and then does a fixed amount of work. Reports CPU use of the
+ * worker thread and wake-up latency for each mode. Not part of the
+ * firmware build, see .cyignore.
+ *
+ * Build and run:
+ *   cc -O2 -Isource bench/worker_bench.c source/worker.c -lpthread \
+ *      -o worker_bench
+ *   ./worker_bench [period_us] [window_us] [cycles]
+ */
+
+#include "worker.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DEFAULT_PERIOD_US 1000
+#define DEFAULT_WINDOW_US 50
+#define DEFAULT_CYCLES    2000
+#define WORK_US           50
+
+typedef struct bus
+{
+   pthread_mutex_t lock;
+   pthread_cond_t cond;
+   atomic_uint seq;
+   atomic_uint edge; /* Time of latest edge */
+   atomic_bool done;
+   uint32_t period;
+   uint32_t cycles;
+} bus_t;
+
+static uint64_t now_ns (clockid_t clock)
+{
+   struct timespec ts;
+
+   clock_gettime (clock, &ts);
+   return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint32_t now (void)
+{
+   return (uint32_t)now_ns (CLOCK_MONOTONIC);
+}
+
+static void * bus_thread (void * arg)
+{
+   bus_t * bus = arg;
+   uint64_t t = now_ns (CLOCK_MONOTONIC);
+
+   for (uint32_t i = 0; i < bus->cycles; i++)
+   {
+      struct timespec ts;
+
+      t += bus->period;
+      ts.tv_sec = t / 1000000000ull;
+      ts.tv_nsec = t % 1000000000ull;
+      clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+      atomic_store (&bus->edge, now());
+      pthread_mutex_lock (&bus->lock);
+      atomic_fetch_add (&bus->seq, 1);
+      pthread_cond_signal (&bus->cond);
+      pthread_mutex_unlock (&bus->lock);
+   }
+
+   pthread_mutex_lock (&bus->lock);
+   atomic_store (&bus->done, true);
+   pthread_cond_signal (&bus->cond);
+   pthread_mutex_unlock (&bus->lock);
+   return NULL;
+}
+
+/* Sleep until the next edge, or until timeout ns have passed */
+static void sleep_for_edge (bus_t * bus, unsigned int seen, uint32_t timeout)
+{
+   struct timespec ts;
+
+   pthread_mutex_lock (&bus->lock);
+   if (timeout == WORKER_FOREVER)
+   {
+      while (atomic_load (&bus->seq) == seen && !atomic_load (&bus->done))
+      {
+         pthread_cond_wait (&bus->cond, &bus->lock);
+      }
+   }
+   else if (atomic_load (&bus->seq) == seen)
+   {
+      uint64_t t = now_ns (CLOCK_REALTIME) + timeout;
+
+      ts.tv_sec = t / 1000000000ull;
+      ts.tv_nsec = t % 1000000000ull;
+      pthread_cond_timedwait (&bus->cond, &bus->lock, &ts);
+   }
+   pthread_mutex_unlock (&bus->lock);
+}
+
+static void run (bus_t * bus, worker_t * w, double * cpu)
+{
+   unsigned int seen = atomic_load (&bus->seq);
+   uint64_t cpu_start = now_ns (CLOCK_THREAD_CPUTIME_ID);
+   uint64_t start = now_ns (CLOCK_MONOTONIC);
+   uint32_t idle_start = now();
+
+   while (!atomic_load (&bus->done))
+   {
+      uint32_t timeout = worker_sleep_time (w, now());
+      uint32_t t;
+
+      if (atomic_load (&bus->seq) != seen)
+      {
+         uint32_t edge = atomic_load (&bus->edge);
+
+         t = now();
+         seen = atomic_load (&bus->seq);
+         worker_idle (w, t, t - idle_start, false);
+         worker_wakeup (w, t, &edge);
+
+         /* Cycle work, e.g. process data exchange */
+         while (now() - t < WORK_US * 1000)
+            ;
+         idle_start = now();
+         continue;
+      }
+
+      if (timeout != 0)
+      {
+         sleep_for_edge (bus, seen, timeout);
+         t = now();
+         worker_idle (w, t, t - idle_start, true);
+         idle_start = t;
+      }
+   }
+
+   *cpu = (double)(now_ns (CLOCK_THREAD_CPUTIME_ID) - cpu_start) /
+          (now_ns (CLOCK_MONOTONIC) - start);
+}
+
+int main (int argc, char * argv[])
+{
+   uint32_t period_us =
+      (argc > 1) ? strtoul (argv[1], NULL, 0) : DEFAULT_PERIOD_US;
+   uint32_t window_us =
+      (argc > 2) ? strtoul (argv[2], NULL, 0) : DEFAULT_WINDOW_US;
+   uint32_t cycles = (argc > 3) ? strtoul (argv[3], NULL, 0) : DEFAULT_CYCLES;
+
+   printf (
+      "period %u us, window %u us, work %u us, %u cycles\n",
+      period_us,
+      window_us,
+      WORK_US,
+      cycles);
+   printf ("mode        cpu    load  latency min/avg/max (us)  sleeps\n");
+
+   for (int mode = WORKER_BLOCKING; mode <= WORKER_ADAPTIVE; mode++)
+   {
+      bus_t bus = {
+         .lock = PTHREAD_MUTEX_INITIALIZER,
+         .cond = PTHREAD_COND_INITIALIZER,
+         .period = period_us * 1000,
+         .cycles = cycles,
+      };
+      pthread_t thread;
+      worker_t w;
+      double cpu;
+
+      worker_init (&w, mode, window_us * 1000, now());
+      pthread_create (&thread, NULL, bus_thread, &bus);
+      run (&bus, &w, &cpu);
+      pthread_join (thread, NULL);
+
+      printf (
+         "%-10s %5.1f%% %5u%%  %6.1f %6.1f %8.1f        %6u\n",
+         worker_mode_name (mode),
+         cpu * 100,
+         worker_load (&w, now()),
+         w.stats.latency_min / 1e3,
+         (double)w.stats.latency_total / w.stats.n_wakeups / 1e3,
+         w.stats.latency_max / 1e3,
+         w.stats.n_sleeps);
+   }
+   return 0;
+}
@@ -20,7 +20,7 @@
 
 up_data_t up_data;
 
-up_signal_info_t up_vars[] = {
+const up_signal_info_t up_vars[] = {
    {.value = (void *)&up_data.I8.Input_8_bits.value,
     .status = &up_data.I8.Input_8_bits.status},
    {.value = (void *)&up_data.O8.Output_8_bits.value,
@@ -33,7 +33,7 @@ up_signal_info_t up_vars[] = {
     .status = NULL},
 };
 
-static up_signal_t inputs_I8[] = {
+static const up_signal_t inputs_I8[] = {
    {
       .name = "Input 8 bits",
       .ix = 0,
@@ -44,7 +44,7 @@ static up_signal_t inputs_I8[] = {
    },
 };
 
-static up_signal_t outputs_O8[] = {
+static const up_signal_t outputs_O8[] = {
    {
       .name = "Output 8 bits",
       .ix = 1,
@@ -55,7 +55,7 @@ static up_signal_t outputs_O8[] = {
    },
 };
 
-static up_signal_t inputs_I8O8[] = {
+static const up_signal_t inputs_I8O8[] = {
    {
       .name = "Input 8 bits",
       .ix = 2,
@@ -66,7 +66,7 @@ static up_signal_t inputs_I8O8[] = {
    },
 };
 
-static up_signal_t outputs_I8O8[] = {
+static const up_signal_t outputs_I8O8[] = {
    {
       .name = "Output 8 bits",
       .ix = 3,
@@ -77,7 +77,7 @@ static up_signal_t outputs_I8O8[] = {
    },
 };
 
-static up_param_t parameters_I8O8[] = {
+static const up_param_t parameters_I8O8[] = {
    {
       .name = "Parameter 1",
       .ix = 4,
@@ -87,31 +87,31 @@ static up_param_t parameters_I8O8[] = {
    },
 };
 
-up_slot_t slots[] = {
+const up_slot_t slots[] = {
    {
       .name = "I8",
       .input_bitlength = 8,
       .output_bitlength = 0,
       .n_inputs = NELEMENTS (inputs_I8),
-      .inputs = inputs_I8,
+      .inputs = (up_signal_t *)inputs_I8,
    },
    {
       .name = "O8",
       .input_bitlength = 0,
       .output_bitlength = 8,
       .n_outputs = NELEMENTS (outputs_O8),
-      .outputs = outputs_O8,
+      .outputs = (up_signal_t *)outputs_O8,
    },
    {
       .name = "I8O8",
       .input_bitlength = 8,
       .output_bitlength = 8,
       .n_inputs = NELEMENTS (inputs_I8O8),
-      .inputs = inputs_I8O8,
+      .inputs = (up_signal_t *)inputs_I8O8,
       .n_outputs = NELEMENTS (outputs_I8O8),
-      .outputs = outputs_I8O8,
+      .outputs = (up_signal_t *)outputs_I8O8,
       .n_params = NELEMENTS (parameters_I8O8),
-      .params = parameters_I8O8,
+      .params = (up_param_t *)parameters_I8O8,
    },
 };
 
@@ -121,16 +121,16 @@ up_device_t up_device = {
    .cfg.webgui_enable = true,
    .bustype = UP_BUSTYPE_MOCK,
    .n_slots = NELEMENTS (slots),
-   .slots = slots,
+   .slots = (up_slot_t *)slots,
 };
 
-up_pn_param_t pn_I8O8_parameters[] = {
+const up_pn_param_t pn_I8O8_parameters[] = {
    {
       .pn_index = 123,
    },
 };
 
-up_pn_module_t pn_modules[] = {
+const up_pn_module_t pn_modules[] = {
    {
       .module_id = 0x00000100,
       .submodule_id = 0x00000101,
@@ -143,11 +143,11 @@ up_pn_module_t pn_modules[] = {
       .module_id = 0x00000300,
       .submodule_id = 0x00000301,
       .n_params = 1,
-      .params = pn_I8O8_parameters,
+      .params = (up_pn_param_t *)pn_I8O8_parameters,
    },
 };
 
-up_pn_slot_t pn_slots[] = {
+const up_pn_slot_t pn_slots[] = {
    {
       .module_ix = 0,
    },
@@ -159,7 +159,7 @@ up_pn_slot_t pn_slots[] = {
    },
 };
 
-up_profinet_config_t up_profinet_config = {
+const up_profinet_config_t up_profinet_config = {
    .vendor_id = 0x0493,
    .device_id = 0x0003,
    .dap_module_id = 0x00000001,
@@ -180,11 +180,11 @@ up_profinet_config_t up_profinet_config = {
    .revision_counter = 0,
    .n_modules = 3,
    .n_slots = 3,
-   .modules = pn_modules,
-   .slots = pn_slots,
+   .modules = (up_pn_module_t *)pn_modules,
+   .slots = (up_pn_slot_t *)pn_slots,
 };
 
-up_ciaobject_t ecat_I8_Inputs_txpdo_entries[] = {
+const up_ciaobject_t ecat_I8_Inputs_txpdo_entries[] = {
    {
       .index = 0x7000,
       .subindex = 0,
@@ -193,16 +193,16 @@ up_ciaobject_t ecat_I8_Inputs_txpdo_entries[] = {
    },
 };
 
-up_ciapdo_t ecat_I8_txpdos[] = {
+const up_ciapdo_t ecat_I8_txpdos[] = {
    {
       .name = "Inputs",
       .index = 0x1A00,
       .n_entries = 1,
-      .entries = ecat_I8_Inputs_txpdo_entries,
+      .entries = (up_ciaobject_t *)ecat_I8_Inputs_txpdo_entries,
    },
 };
 
-up_ciaobject_t ecat_O8_Outputs_rxpdo_entries[] = {
+const up_ciaobject_t ecat_O8_Outputs_rxpdo_entries[] = {
    {
       .index = 0x6000,
       .subindex = 0,
@@ -211,16 +211,16 @@ up_ciaobject_t ecat_O8_Outputs_rxpdo_entries[] = {
    },
 };
 
-up_ciapdo_t ecat_O8_rxpdos[] = {
+const up_ciapdo_t ecat_O8_rxpdos[] = {
    {
       .name = "Outputs",
       .index = 0x1600,
       .n_entries = 1,
-      .entries = ecat_O8_Outputs_rxpdo_entries,
+      .entries = (up_ciaobject_t *)ecat_O8_Outputs_rxpdo_entries,
    },
 };
 
-up_ciaobject_t ecat_I8O8_Inputs_txpdo_entries[] = {
+const up_ciaobject_t ecat_I8O8_Inputs_txpdo_entries[] = {
    {
       .index = 0x7000,
       .subindex = 0,
@@ -229,16 +229,16 @@ up_ciaobject_t ecat_I8O8_Inputs_txpdo_entries[] = {
    },
 };
 
-up_ciapdo_t ecat_I8O8_txpdos[] = {
+const up_ciapdo_t ecat_I8O8_txpdos[] = {
    {
       .name = "Inputs",
       .index = 0x1A00,
       .n_entries = 1,
-      .entries = ecat_I8O8_Inputs_txpdo_entries,
+      .entries = (up_ciaobject_t *)ecat_I8O8_Inputs_txpdo_entries,
    },
 };
 
-up_ciaobject_t ecat_I8O8_Outputs_rxpdo_entries[] = {
+const up_ciaobject_t ecat_I8O8_Outputs_rxpdo_entries[] = {
    {
       .index = 0x6000,
       .subindex = 0,
@@ -247,16 +247,16 @@ up_ciaobject_t ecat_I8O8_Outputs_rxpdo_entries[] = {
    },
 };
 
-up_ciapdo_t ecat_I8O8_rxpdos[] = {
+const up_ciapdo_t ecat_I8O8_rxpdos[] = {
    {
       .name = "Outputs",
       .index = 0x1600,
       .n_entries = 1,
-      .entries = ecat_I8O8_Outputs_rxpdo_entries,
+      .entries = (up_ciaobject_t *)ecat_I8O8_Outputs_rxpdo_entries,
    },
 };
 
-up_ciaobject_t ecat_I8O8_objects[] = {
+const up_ciaobject_t ecat_I8O8_objects[] = {
    {
       .index = 0x8000,
       .subindex = 0,
@@ -265,14 +265,14 @@ up_ciaobject_t ecat_I8O8_objects[] = {
    },
 };
 
-up_ecat_module_t ecat_modules[] = {
+const up_ecat_module_t ecat_modules[] = {
    {
       .profile = 5001,
       .n_rxpdos = 0,
       .n_txpdos = 1,
       .n_objects = 0,
       .rxpdos = NULL,
-      .txpdos = ecat_I8_txpdos,
+      .txpdos = (up_ciapdo_t *)ecat_I8_txpdos,
       .objects = NULL,
    },
    {
@@ -280,7 +280,7 @@ up_ecat_module_t ecat_modules[] = {
       .n_rxpdos = 1,
       .n_txpdos = 0,
       .n_objects = 0,
-      .rxpdos = ecat_O8_rxpdos,
+      .rxpdos = (up_ciapdo_t *)ecat_O8_rxpdos,
       .txpdos = NULL,
       .objects = NULL,
    },
@@ -289,13 +289,13 @@ up_ecat_module_t ecat_modules[] = {
       .n_rxpdos = 1,
       .n_txpdos = 1,
       .n_objects = 1,
-      .rxpdos = ecat_I8O8_rxpdos,
-      .txpdos = ecat_I8O8_txpdos,
-      .objects = ecat_I8O8_objects,
+      .rxpdos = (up_ciapdo_t *)ecat_I8O8_rxpdos,
+      .txpdos = (up_ciapdo_t *)ecat_I8O8_txpdos,
+      .objects = (up_ciaobject_t *)ecat_I8O8_objects,
    },
 };
 
-up_ecat_slot_t ecat_slots[] = {
+const up_ecat_slot_t ecat_slots[] = {
    {
       .module_ix = 0,
    },
@@ -307,7 +307,7 @@ up_ecat_slot_t ecat_slots[] = {
    },
 };
 
-up_ecat_device_t up_ethercat_config = {
+const up_ecat_device_t up_ethercat_config = {
    .profile = 5001,
    .vendor = 0x1337,
    .productcode = 0x1001,
@@ -319,11 +319,11 @@ up_ecat_device_t up_ethercat_config = {
    .index_increment = 0x0100, /* TODO */
    .n_modules = 3,
    .n_slots = 3,
-   .modules = ecat_modules,
-   .slots = ecat_slots,
+   .modules = (up_ecat_module_t *)ecat_modules,
+   .slots = (up_ecat_slot_t *)ecat_slots,
 };
 
-up_ethernetip_config_t up_ethernetip_config = {
+const up_ethernetip_config_t up_ethernetip_config = {
    .vendor_id = 1772,
    .device_type = 43,
    .product_code = 10,
@@ -338,11 +338,11 @@ up_ethernetip_config_t up_ethernetip_config = {
    .listen_only_heartbeat_assembly_id = 104,
 };
 
-up_modbus_config_t up_modbus_config = {
+const up_modbus_config_t up_modbus_config = {
    .port = 502,
 };
 
-static up_cclink_item_t cclink_I8_inputs[] = {
+static const up_cclink_item_t cclink_I8_inputs[] = {
    {
       /* Input 8 bits */
       .index = 0,
@@ -350,13 +350,13 @@ static up_cclink_item_t cclink_I8_inputs[] = {
    },
 };
 
-static up_cclink_item_t cclink_I8_outputs[] = {
+static const up_cclink_item_t cclink_I8_outputs[] = {
 };
 
-static up_cclink_item_t cclink_O8_inputs[] = {
+static const up_cclink_item_t cclink_O8_inputs[] = {
 };
 
-static up_cclink_item_t cclink_O8_outputs[] = {
+static const up_cclink_item_t cclink_O8_outputs[] = {
    {
       /* Output 8 bits */
       .index = 0,
@@ -364,7 +364,7 @@ static up_cclink_item_t cclink_O8_outputs[] = {
    },
 };
 
-static up_cclink_item_t cclink_I8O8_inputs[] = {
+static const up_cclink_item_t cclink_I8O8_inputs[] = {
    {
       /* Input 8 bits */
       .index = 0,
@@ -372,7 +372,7 @@ static up_cclink_item_t cclink_I8O8_inputs[] = {
    },
 };
 
-static up_cclink_item_t cclink_I8O8_outputs[] = {
+static const up_cclink_item_t cclink_I8O8_outputs[] = {
    {
       /* Output 8 bits */
       .index = 0,
@@ -380,28 +380,28 @@ static up_cclink_item_t cclink_I8O8_outputs[] = {
    },
 };
 
-static up_cclink_module_t cclink_modules[] = {
+static const up_cclink_module_t cclink_modules[] = {
    {
       .n_inputs = 1,
       .n_outputs = 0,
-      .inputs = cclink_I8_inputs,
-      .outputs = cclink_I8_outputs,
+      .inputs = (up_cclink_item_t *)cclink_I8_inputs,
+      .outputs = (up_cclink_item_t *)cclink_I8_outputs,
    },
    {
       .n_inputs = 0,
       .n_outputs = 1,
-      .inputs = cclink_O8_inputs,
-      .outputs = cclink_O8_outputs,
+      .inputs = (up_cclink_item_t *)cclink_O8_inputs,
+      .outputs = (up_cclink_item_t *)cclink_O8_outputs,
    },
    {
       .n_inputs = 1,
       .n_outputs = 1,
-      .inputs = cclink_I8O8_inputs,
-      .outputs = cclink_I8O8_outputs,
+      .inputs = (up_cclink_item_t *)cclink_I8O8_inputs,
+      .outputs = (up_cclink_item_t *)cclink_I8O8_outputs,
    },
 };
 
-static up_cclink_station_t cclink_stations[] = {
+static const up_cclink_station_t cclink_stations[] = {
    {
       .module_ix = 0,
    },
@@ -413,14 +413,14 @@ static up_cclink_station_t cclink_stations[] = {
    },
 };
 
-up_cclink_config_t up_cclink_config = {
+const up_cclink_config_t up_cclink_config = {
    .vendor_code = 0x1067,
    .model_code = 0x1234,
    .equipment_ver = 0x0001,
    .n_modules = 3,
    .n_stations = 3,
-   .modules = cclink_modules,
-   .stations = cclink_stations,
+   .modules = (up_cclink_module_t *)cclink_modules,
+   .stations = (up_cclink_station_t *)cclink_stations,
 };
 
-up_mockadapter_config_t up_mock_config = {0};
\ No newline at end of file
+const up_mockadapter_config_t up_mock_config = {0};
\ No newline at end of file
@@ -64,14 +64,14 @@ typedef struct up_data
 } up_data_t;
 
 extern up_data_t up_data;
-extern up_signal_info_t up_vars[];
+extern const up_signal_info_t up_vars[];
 extern up_device_t up_device;
-extern up_profinet_config_t up_profinet_config;
-extern up_ecat_device_t up_ethercat_config;
-extern up_ethernetip_config_t up_ethernetip_config;
-extern up_modbus_config_t up_modbus_config;
-extern up_cclink_config_t up_cclink_config;
-extern up_mockadapter_config_t up_mock_config;
+extern const up_profinet_config_t up_profinet_config;
+extern const up_ecat_device_t up_ethercat_config;
+extern const up_ethernetip_config_t up_ethernetip_config;
+extern const up_modbus_config_t up_modbus_config;
+extern const up_cclink_config_t up_cclink_config;
+extern const up_mockadapter_config_t up_mock_config;
 
 #ifdef __cplusplus
 }
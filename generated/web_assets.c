@@ -0,0 +1,151 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/* Generated by uphy-web-assets.py from web/, do not edit */
+
+#include "web_assets.h"
+
+static const uint8_t asset_style_css[] = {
+   0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0x65, 0x90,
+   0xdb, 0x6a, 0xc4, 0x20, 0x14, 0x45, 0xdf, 0xf3, 0x15, 0x07, 0xf2, 0x5a,
+   0x07, 0x32, 0x94, 0xd0, 0x9a, 0xaf, 0x39, 0xea, 0xd1, 0x48, 0xbd, 0xa1,
+   0x0e, 0x64, 0x5a, 0xfa, 0xef, 0x35, 0x66, 0x86, 0x69, 0x3b, 0x2f, 0x22,
+   0xec, 0xbd, 0xb6, 0x0b, 0x45, 0x54, 0x57, 0xf8, 0x1a, 0x00, 0x74, 0x0c,
+   0x95, 0x69, 0xf4, 0xd6, 0x5d, 0x39, 0x14, 0x0c, 0x85, 0x15, 0xca, 0x56,
+   0x2f, 0x2d, 0xf2, 0x98, 0x8d, 0x0d, 0x1c, 0x26, 0xf2, 0x70, 0x26, 0xbf,
+   0x0c, 0xdf, 0xc3, 0xb0, 0x12, 0x2a, 0xca, 0x9d, 0x54, 0xb6, 0x24, 0x87,
+   0x8d, 0xd2, 0x8e, 0xb6, 0xbd, 0x8f, 0xce, 0x9a, 0xc0, 0x6c, 0x25, 0x5f,
+   0x38, 0x08, 0x2c, 0xe4, 0x6c, 0xa0, 0x3d, 0x30, 0x98, 0xfa, 0xca, 0xb1,
+   0x30, 0x3d, 0xde, 0x2d, 0xf6, 0x93, 0x5a, 0x72, 0x7a, 0xbd, 0x65, 0x63,
+   0xa9, 0x58, 0xa9, 0xe7, 0x32, 0xba, 0x98, 0x39, 0x8c, 0xf3, 0x3c, 0x2f,
+   0xff, 0x35, 0x7d, 0x0c, 0xb1, 0x24, 0x94, 0xd4, 0xa1, 0x8a, 0xc2, 0x1d,
+   0x8c, 0x88, 0xb9, 0xc9, 0xb1, 0x86, 0x3a, 0x4c, 0xa5, 0x2d, 0xdf, 0x6f,
+   0x47, 0x6f, 0xed, 0xa5, 0x4a, 0x5b, 0x65, 0x5d, 0x95, 0x83, 0x23, 0x5d,
+   0x97, 0x07, 0x28, 0x62, 0xad, 0xd1, 0x37, 0xa1, 0xb4, 0x41, 0x89, 0xce,
+   0x2a, 0x18, 0xa5, 0x94, 0x07, 0xac, 0x5e, 0xee, 0x03, 0x09, 0x95, 0xb2,
+   0xc1, 0x70, 0x38, 0xb7, 0xda, 0xd4, 0x8e, 0x5b, 0x81, 0x3b, 0x2c, 0x95,
+   0xc9, 0xd5, 0x3a, 0xf5, 0xfc, 0xb3, 0xbf, 0x94, 0xff, 0x2a, 0x64, 0x6b,
+   0xd6, 0x7a, 0x2c, 0xe4, 0x93, 0x5c, 0x31, 0x18, 0x52, 0xf0, 0x3c, 0x26,
+   0x50, 0x7e, 0x98, 0x1c, 0x2f, 0x41, 0xb5, 0x3f, 0xd1, 0x9a, 0xde, 0xf1,
+   0x6d, 0x87, 0x7e, 0x00, 0x48, 0x0a, 0x4d, 0xc5, 0xc7, 0x01, 0x00, 0x00,
+};
+
+static const uint8_t asset_viewer_js[] = {
+   0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0xa5, 0x55,
+   0xcb, 0x6e, 0xdb, 0x30, 0x10, 0xbc, 0xfb, 0x2b, 0x16, 0xcc, 0x85, 0x42,
+   0x1d, 0x39, 0x40, 0x6f, 0x35, 0x8c, 0x00, 0x0d, 0x7c, 0x68, 0x51, 0x38,
+   0x45, 0xdd, 0x5b, 0xd0, 0x03, 0x23, 0xae, 0x6c, 0xb6, 0x32, 0xe9, 0x92,
+   0x94, 0x1f, 0x28, 0xf4, 0xef, 0x5d, 0x92, 0x92, 0x5f, 0x71, 0x5a, 0x1b,
+   0xb9, 0x08, 0xc2, 0x7a, 0x67, 0x76, 0x67, 0x38, 0x94, 0x07, 0x03, 0xf8,
+   0x6a, 0x4d, 0x81, 0xce, 0x81, 0x14, 0x5e, 0xc0, 0x4a, 0xe1, 0x1a, 0x6d,
+   0x1f, 0x2c, 0x0a, 0xe9, 0xc0, 0xcf, 0x11, 0xa6, 0x68, 0x57, 0x68, 0x6f,
+   0xa7, 0xa8, 0x3d, 0x8c, 0x57, 0xf4, 0x74, 0x60, 0x4a, 0x18, 0x38, 0x4f,
+   0x2d, 0x8b, 0xbc, 0x37, 0x18, 0x50, 0x07, 0x82, 0x33, 0xb5, 0x2d, 0xb0,
+   0xab, 0xce, 0xa1, 0x34, 0x36, 0xa2, 0x31, 0x22, 0xf2, 0x5e, 0x8f, 0x97,
+   0xb5, 0x2e, 0xbc, 0x32, 0x1a, 0x78, 0x06, 0x7f, 0x7a, 0x00, 0xac, 0x76,
+   0x04, 0xf3, 0x56, 0x15, 0x9e, 0x0d, 0x7b, 0x54, 0x58, 0x09, 0x0b, 0xcf,
+   0x46, 0x6e, 0x61, 0x04, 0xd2, 0x14, 0xf5, 0x82, 0x80, 0xf9, 0x0c, 0xfd,
+   0xb8, 0xc2, 0xf0, 0xfa, 0x71, 0xfb, 0x49, 0x72, 0xe6, 0xd4, 0x4c, 0x8b,
+   0xca, 0xb1, 0x6c, 0xd8, 0x02, 0x9c, 0x17, 0x1e, 0xff, 0x89, 0x08, 0x0d,
+   0xfb, 0xfe, 0x02, 0xab, 0xca, 0x51, 0xff, 0xd3, 0x8f, 0xae, 0x92, 0x36,
+   0xa4, 0x92, 0xc6, 0x75, 0x12, 0x38, 0x8d, 0x5a, 0x38, 0x6b, 0xd5, 0x04,
+   0x30, 0xf5, 0xee, 0xf6, 0xaf, 0x97, 0xe4, 0x14, 0x72, 0xb5, 0xe9, 0x13,
+   0xbe, 0xaa, 0x31, 0xc9, 0xd9, 0xd3, 0x13, 0x55, 0x9c, 0xf2, 0xa4, 0x36,
+   0x71, 0x08, 0x80, 0x2a, 0x81, 0xa7, 0x5f, 0x46, 0x23, 0xa8, 0xb5, 0xc4,
+   0x52, 0x69, 0x94, 0x1d, 0x0e, 0xc8, 0x6c, 0x5f, 0x5b, 0x9d, 0x7a, 0x9b,
+   0xf8, 0x0c, 0xdd, 0xb9, 0xc7, 0x8d, 0x7f, 0x30, 0xda, 0x07, 0xe7, 0x47,
+   0x69, 0x56, 0x64, 0xd0, 0x35, 0x51, 0xdd, 0x03, 0xbb, 0x65, 0xf0, 0x21,
+   0x95, 0x87, 0x7b, 0xd0, 0x52, 0x58, 0xea, 0x9f, 0x18, 0x89, 0x79, 0x51,
+   0x09, 0xe7, 0x26, 0x62, 0x11, 0xfc, 0x61, 0xc5, 0x5c, 0xe8, 0x19, 0x4a,
+   0x96, 0x5a, 0x1d, 0xfa, 0xef, 0x6a, 0x81, 0xa6, 0xf6, 0x2f, 0xce, 0xe5,
+   0xbf, 0x4c, 0x2d, 0x45, 0xd3, 0x87, 0xf7, 0x77, 0x77, 0xd1, 0xd8, 0x26,
+   0xf8, 0xd3, 0x9e, 0xb4, 0x90, 0x32, 0x9a, 0xf8, 0x45, 0x39, 0x5a, 0x1c,
+   0x2d, 0x67, 0x0b, 0xf4, 0x82, 0xf5, 0xf7, 0xfe, 0xf1, 0x9d, 0x63, 0xe1,
+   0xb4, 0x4f, 0x54, 0x76, 0xec, 0xc7, 0xe7, 0x04, 0xf0, 0x79, 0xfa, 0x38,
+   0x09, 0x1b, 0x39, 0xe4, 0x98, 0x87, 0xa4, 0x66, 0x39, 0x45, 0x6c, 0x2c,
+   0x8a, 0xf9, 0x81, 0x80, 0x52, 0x61, 0x75, 0x60, 0x6b, 0x38, 0x10, 0x6b,
+   0xd6, 0xc4, 0x12, 0x07, 0x29, 0xed, 0xd0, 0xfa, 0x6f, 0x66, 0xcd, 0xb3,
+   0x61, 0x67, 0xbc, 0x59, 0xb7, 0xe5, 0x07, 0x9a, 0xc7, 0xb3, 0x93, 0x65,
+   0x22, 0x5f, 0xae, 0x49, 0xf7, 0x55, 0x00, 0xa9, 0xec, 0x55, 0xfd, 0x7e,
+   0xbb, 0xdc, 0x0d, 0x88, 0xba, 0xf3, 0x65, 0xed, 0xe6, 0xfc, 0x14, 0xdb,
+   0x6e, 0xdd, 0x24, 0xcb, 0x53, 0x28, 0x5f, 0x35, 0xbd, 0xa4, 0x8c, 0x9c,
+   0x37, 0x3d, 0xb8, 0x12, 0xaf, 0xfa, 0xe8, 0x8c, 0xa9, 0x69, 0x44, 0x78,
+   0xcd, 0x57, 0x67, 0x0c, 0x8e, 0x61, 0xeb, 0x83, 0xda, 0x1c, 0x47, 0x25,
+   0x46, 0xfd, 0xea, 0xb8, 0x36, 0xed, 0xb4, 0x78, 0x43, 0x4f, 0x63, 0x70,
+   0xc3, 0xe0, 0x5d, 0xda, 0xc3, 0xe1, 0xef, 0x4b, 0x04, 0x4b, 0xac, 0x5e,
+   0x8b, 0xd9, 0x05, 0x8a, 0x1f, 0x9f, 0x7f, 0x62, 0xe1, 0xf3, 0x5f, 0xb8,
+   0x75, 0x3c, 0xa9, 0x3f, 0x97, 0xaf, 0x43, 0xdd, 0x07, 0x5f, 0x81, 0x04,
+   0x08, 0x1e, 0x64, 0x6f, 0x57, 0x66, 0xb4, 0x59, 0xa2, 0x0e, 0xd9, 0x78,
+   0x71, 0x2f, 0xcf, 0xd2, 0x15, 0x46, 0x6b, 0x5a, 0xbd, 0xbd, 0xd9, 0xcd,
+   0x31, 0x15, 0x5a, 0x4b, 0xdf, 0xe1, 0x8b, 0xb9, 0xa4, 0x72, 0x3b, 0xba,
+   0xf0, 0x17, 0xe0, 0xed, 0x56, 0xe9, 0x59, 0x47, 0xdc, 0x64, 0xe1, 0xe2,
+   0xfc, 0x05, 0x2d, 0x15, 0x35, 0x57, 0x31, 0x06, 0x00, 0x00,
+};
+
+static const uint8_t asset_index_html[] = {
+   0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0x55, 0x51,
+   0x4d, 0x4f, 0xc3, 0x30, 0x0c, 0xbd, 0xef, 0x57, 0x84, 0x9c, 0xe9, 0xba,
+   0xd2, 0x09, 0x98, 0x94, 0x96, 0x03, 0xe3, 0xcc, 0x24, 0x06, 0x12, 0x47,
+   0x37, 0xf1, 0x96, 0x40, 0x96, 0x56, 0x89, 0xb7, 0xa9, 0xff, 0x9e, 0xa4,
+   0x1f, 0x93, 0x38, 0x44, 0xf6, 0xf3, 0xc7, 0xf3, 0xb3, 0x23, 0xee, 0xb6,
+   0xef, 0xaf, 0xfb, 0xef, 0xdd, 0x1b, 0xd3, 0x74, 0xb2, 0xf5, 0x42, 0xcc,
+   0x06, 0x41, 0x45, 0x73, 0x42, 0x02, 0x26, 0x35, 0xf8, 0x80, 0x54, 0xf1,
+   0x33, 0x1d, 0xb2, 0x67, 0x3e, 0x87, 0x1d, 0x9c, 0xb0, 0xe2, 0x17, 0x83,
+   0xd7, 0xae, 0xf5, 0xc4, 0x99, 0x6c, 0x1d, 0xa1, 0x8b, 0x65, 0x57, 0xa3,
+   0x48, 0x57, 0x0a, 0x2f, 0x46, 0x62, 0x36, 0x80, 0x7b, 0x66, 0x9c, 0x21,
+   0x03, 0x36, 0x0b, 0x12, 0x2c, 0x56, 0x45, 0x22, 0x21, 0x43, 0x16, 0xeb,
+   0xcf, 0x6c, 0xa7, 0x7b, 0xd6, 0xf9, 0x56, 0x62, 0x08, 0x4c, 0x01, 0x81,
+   0xc8, 0xc7, 0xcc, 0x42, 0x58, 0xe3, 0x7e, 0x99, 0x47, 0x5b, 0xf1, 0x40,
+   0xbd, 0xc5, 0xa0, 0x11, 0xe3, 0x1c, 0xed, 0xf1, 0x30, 0x45, 0x96, 0x32,
+   0x84, 0x97, 0x4b, 0xa5, 0xca, 0xa2, 0xdc, 0x60, 0xd1, 0x14, 0x72, 0xf5,
+   0xf0, 0xb4, 0x92, 0x83, 0xc4, 0x7c, 0xda, 0xa0, 0x69, 0x55, 0x3f, 0xed,
+   0x83, 0x3e, 0x39, 0x45, 0xbd, 0xfb, 0x37, 0x2c, 0x06, 0x16, 0x22, 0x74,
+   0xe0, 0x98, 0x51, 0x89, 0x16, 0x08, 0x79, 0x1d, 0x77, 0x71, 0x28, 0xc9,
+   0xb8, 0xa3, 0xc8, 0x53, 0x6e, 0x26, 0x1c, 0x28, 0x08, 0x9a, 0x41, 0x1e,
+   0x0d, 0x23, 0x04, 0xf9, 0xf8, 0x74, 0xfd, 0x61, 0x8e, 0x0e, 0x6c, 0x14,
+   0xaf, 0x07, 0xb8, 0x35, 0xfe, 0xe6, 0xef, 0xfb, 0x0e, 0x6f, 0xe0, 0x0b,
+   0xec, 0x79, 0x42, 0x79, 0x6a, 0xcd, 0x69, 0x52, 0x4a, 0x49, 0xea, 0x28,
+   0x62, 0xa0, 0x0a, 0x3c, 0x25, 0x27, 0xfd, 0xf9, 0x3c, 0x34, 0x48, 0x6f,
+   0x3a, 0x62, 0xc1, 0xcb, 0xf1, 0xf6, 0xe8, 0x97, 0x3f, 0xe9, 0x06, 0x6b,
+   0x90, 0x8f, 0x58, 0xe0, 0x66, 0xb3, 0x2e, 0xb1, 0xc1, 0x43, 0x99, 0x9a,
+   0xc7, 0xda, 0xd4, 0x3d, 0xb3, 0x8c, 0xbf, 0xfb, 0x07, 0xb7, 0xbb, 0x9e,
+   0xe7, 0xf5, 0x01, 0x00, 0x00,
+};
+
+const web_asset_t web_assets[] = {
+   {
+      .path = "/style.css",
+      .type = "text/css",
+      .etag = "\"d3139e1b1c0270c8\"",
+      .data = asset_style_css,
+      .size = sizeof (asset_style_css),
+      .immutable = true,
+   },
+   {
+      .path = "/viewer.js",
+      .type = "text/javascript",
+      .etag = "\"4ac6e1e9943ebef3\"",
+      .data = asset_viewer_js,
+      .size = sizeof (asset_viewer_js),
+      .immutable = true,
+   },
+   {
+      .path = "/",
+      .type = "text/html; charset=utf-8",
+      .etag = "\"b5bff37724a4d8d4\"",
+      .data = asset_index_html,
+      .size = sizeof (asset_index_html),
+      .immutable = false,
+   },
+};
+
+const uint16_t web_n_assets = sizeof (web_assets) / sizeof (web_assets[0]);
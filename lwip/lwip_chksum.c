@@ -0,0 +1,72 @@
+#include "lwip/lwip_chksum.h"
+
+#include "mem_sections.h"
+
+/* As FOLD_U32T and SWAP_BYTES_IN_WORD in lwIP. No lwIP headers are
+ * included so that this file also builds on the host, see
+ * bench/chksum_bench.c. */
+#define CHKSUM_FOLD(u) ((uint32_t)(((u) >> 16) + ((u) & 0x0000ffffUL)))
+#define CHKSUM_SWAP(w) ((((w) & 0xff) << 8) | (((w) & 0xff00) >> 8))
+
+APP_ITCM_FUNC uint16_t lwip_chksum_unrolled(const void *dataptr, int len)
+{
+  const uint8_t *pb = (const uint8_t *)dataptr;
+  const uint32_t *pl;
+  uint64_t sum = 0;
+  uint32_t sum32;
+  uint16_t t = 0;
+  int odd = ((uintptr_t)pb & 1);
+
+  /* Get aligned to uint16_t. Bytes are swapped back at the end. */
+  if (odd && len > 0) {
+    ((uint8_t *)&t)[1] = *pb++;
+    len--;
+  }
+
+  /* Get aligned to uint32_t */
+  if (((uintptr_t)pb & 2) && len >= 2) {
+    sum += *(const uint16_t *)(const void *)pb;
+    pb += 2;
+    len -= 2;
+  }
+
+  pl = (const uint32_t *)(const void *)pb;
+  while (len >= 32) {
+    sum += (uint64_t)pl[0] + pl[1] + pl[2] + pl[3] +
+           (uint64_t)pl[4] + pl[5] + pl[6] + pl[7];
+    pl += 8;
+    len -= 32;
+  }
+
+  while (len >= 4) {
+    sum += *pl++;
+    len -= 4;
+  }
+
+  pb = (const uint8_t *)pl;
+  if (len >= 2) {
+    sum += *(const uint16_t *)(const void *)pb;
+    pb += 2;
+    len -= 2;
+  }
+
+  /* Consume left-over byte, if any */
+  if (len > 0) {
+    ((uint8_t *)&t)[0] = *pb;
+  }
+  sum += t;
+
+  /* Fold 64-bit sum to 16 bits */
+  sum = (sum >> 32) + (sum & 0xffffffffUL);
+  sum = (sum >> 32) + (sum & 0xffffffffUL);
+  sum32 = (uint32_t)sum;
+  sum32 = CHKSUM_FOLD(sum32);
+  sum32 = CHKSUM_FOLD(sum32);
+
+  /* Swap if alignment was odd */
+  if (odd) {
+    sum32 = CHKSUM_SWAP(sum32);
+  }
+
+  return (uint16_t)sum32;
+}
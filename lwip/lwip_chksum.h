@@ -0,0 +1,27 @@
+/**
+ * Checksum support
+ *
+ * Software internet checksum used by lwIP (LWIP_CHKSUM in lwipopts.h).
+ *
+ * Included by lwipopts.h, so this header must not include any lwIP headers.
+ */
+
+#ifndef LWIP_CHKSUM_H
+#define LWIP_CHKSUM_H
+
+#include <stdint.h>
+
+/**
+ * Internet checksum, 32-bit word based and unrolled.
+ *
+ * Drop-in replacement for lwip_standard_chksum(). Sums 32 bytes per loop
+ * iteration into a 64-bit accumulator, which lets the compiler use
+ * load-multiple and add-with-carry instructions on Cortex-M7.
+ *
+ * \param dataptr Data to checksum, any alignment.
+ * \param len     Length of data in bytes.
+ * \return Ones' complement sum (not inverted) in network byte order.
+ */
+uint16_t lwip_chksum_unrolled(const void *dataptr, int len);
+
+#endif /* LWIP_CHKSUM_H */
@@ -0,0 +1,120 @@
+#include "lwip/lwip_chksum.h"
+#include "lwip/lwip_chksum_net.h"
+#include "lwip/def.h"
+#include "lwip/netif.h"
+#include "lwip/tcpip.h"
+
+#include "cycle_stats.h"
+#include "shell.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+static struct netif *offload_netif;
+
+void lwip_checksum_offload_init(struct netif *netif, ETH_Type *mac)
+{
+  /* RX: MAC verifies IPv4/TCP/UDP checksums and drops bad frames.
+   * TX: MAC inserts IPv4/TCP/UDP checksums. ICMP is not offloaded. */
+  mac->NETWORK_CONFIG |= ETH_NETWORK_CONFIG_RECEIVE_CHECKSUM_OFFLOAD_ENABLE_Msk;
+  mac->DMA_CONFIG |= ETH_DMA_CONFIG_TX_PBUF_TCP_EN_Msk;
+
+  offload_netif = netif;
+  lwip_checksum_offload(netif, true);
+}
+
+void lwip_checksum_offload(struct netif *netif, bool enable)
+{
+  if (enable) {
+    NETIF_SET_CHECKSUM_CTRL(netif, NETIF_CHECKSUM_GEN_ICMP | NETIF_CHECKSUM_CHECK_ICMP);
+  } else {
+    NETIF_SET_CHECKSUM_CTRL(netif, NETIF_CHECKSUM_ENABLE_ALL);
+  }
+}
+
+static int _cmd_chksum_offload(int argc, char *argv[])
+{
+  if (offload_netif == NULL) {
+    printf("No network interface with checksum offload\n");
+    return 0;
+  }
+
+  if (argc == 2 && (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "off") == 0)) {
+    LOCK_TCPIP_CORE();
+    lwip_checksum_offload(offload_netif, strcmp(argv[1], "on") == 0);
+    UNLOCK_TCPIP_CORE();
+  } else if (argc != 1) {
+    printf("error - try \"help %s\"\n", argv[0]);
+    return -1;
+  }
+
+  printf("%c%c%u checksum offload %s\n", offload_netif->name[0],
+         offload_netif->name[1], offload_netif->num,
+         (offload_netif->chksum_flags & NETIF_CHECKSUM_GEN_TCP) ? "off" : "on");
+
+  return 0;
+}
+
+const shell_cmd_t cmd_chksum_offload = {
+  .cmd = _cmd_chksum_offload,
+  .name = "chksum_offload",
+  .help_short = "show or set checksum offload",
+  .help_long = "Show or set IPv4/TCP/UDP checksum offload to the Ethernet\n"
+               "MAC. With offload off, all checksums are computed by the\n"
+               "unrolled software checksum.\n"
+               "Usage: chksum_offload [on|off]\n"};
+
+SHELL_CMD(cmd_chksum_offload);
+
+#define CHKSUM_BENCH_LEN    1472
+#define CHKSUM_BENCH_ROUNDS 1000
+
+u16_t lwip_standard_chksum(const void *dataptr, int len);
+
+static int _cmd_chksum_bench(int argc, char *argv[])
+{
+  static u32_t buf[(CHKSUM_BENCH_LEN + 3) / 4];
+  u8_t *data = (u8_t *)buf;
+  u32_t start;
+  u32_t cycles_std;
+  u32_t cycles_unrolled;
+  u16_t sum_std = 0;
+  u16_t sum_unrolled = 0;
+
+  LWIP_UNUSED_ARG(argc);
+  LWIP_UNUSED_ARG(argv);
+
+  for (int i = 0; i < CHKSUM_BENCH_LEN; i++) {
+    data[i] = (u8_t)(i * 7 + 3);
+  }
+
+  start = cycle_stats_now();
+  for (int i = 0; i < CHKSUM_BENCH_ROUNDS; i++) {
+    sum_std += lwip_standard_chksum(data + (i & 1), CHKSUM_BENCH_LEN - 1);
+  }
+  cycles_std = cycle_stats_now() - start;
+
+  start = cycle_stats_now();
+  for (int i = 0; i < CHKSUM_BENCH_ROUNDS; i++) {
+    sum_unrolled += lwip_chksum_unrolled(data + (i & 1), CHKSUM_BENCH_LEN - 1);
+  }
+  cycles_unrolled = cycle_stats_now() - start;
+
+  printf("%d byte checksum, average of %d rounds\n", CHKSUM_BENCH_LEN - 1, CHKSUM_BENCH_ROUNDS);
+  printf("  lwip_standard_chksum : %" PRIu32 " cycles\n", cycles_std / CHKSUM_BENCH_ROUNDS);
+  printf("  lwip_chksum_unrolled : %" PRIu32 " cycles\n", cycles_unrolled / CHKSUM_BENCH_ROUNDS);
+  printf("  result %s\n", (sum_std == sum_unrolled) ? "ok" : "MISMATCH");
+
+  return 0;
+}
+
+const shell_cmd_t cmd_chksum_bench = {
+  .cmd = _cmd_chksum_bench,
+  .name = "chksum_bench",
+  .help_short = "benchmark internet checksum",
+  .help_long = "Compare cycle count of the lwIP reference checksum and\n"
+               "the unrolled checksum used by the stack.\n"
+               "Usage: chksum_bench\n"};
+
+SHELL_CMD(cmd_chksum_bench);
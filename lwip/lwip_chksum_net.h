@@ -0,0 +1,46 @@
+/**
+ * Checksum offload
+ *
+ * Per network interface selection between Ethernet MAC checksum offload and
+ * the software checksum (lwip_chksum.h).
+ */
+
+#ifndef LWIP_CHKSUM_NET_H
+#define LWIP_CHKSUM_NET_H
+
+#include "cy_device.h"
+#include "lwip/netif.h"
+
+#include <stdbool.h>
+
+/**
+ * Attach the Ethernet MAC of a network interface and enable checksum offload
+ * for it.
+ *
+ * Enables IPv4/TCP/UDP checksum insertion and verification in the MAC, then
+ * calls lwip_checksum_offload() to disable the corresponding software
+ * checksums of the network interface. Only one interface can be attached.
+ *
+ * Must be called with the TCPIP core locked.
+ *
+ *\param netif Ethernet network interface.
+ *\param mac   Ethernet MAC used by the network interface.
+ */
+void lwip_checksum_offload_init(struct netif *netif, ETH_Type *mac);
+
+/**
+ * Select checksum offload for a network interface.
+ *
+ * With offload, lwIP only generates and checks ICMP checksums on the network
+ * interface. Without offload, lwIP generates and checks all checksums in
+ * software. The MAC settings are left unchanged, a checksum inserted by
+ * software is overwritten by the same value.
+ *
+ * Must be called with the TCPIP core locked.
+ *
+ *\param netif  Network interface.
+ *\param enable Use offload if true, software checksums if false.
+ */
+void lwip_checksum_offload(struct netif *netif, bool enable);
+
+#endif /* LWIP_CHKSUM_NET_H */
@@ -21,3 +21,44 @@ void lwip_set_hook_for_unknown_eth_protocol(struct netif *netif, netif_input_fn
   lwip_hook_for_unknown_eth_protocol = hook;
 }
 #endif /* LWIP_HOOK_UNKNOWN_ETH_PROTOCOL */
+
+static lwip_capture_fn lwip_hook_for_capture;
+static netif_input_fn lwip_capture_input_next;
+static netif_linkoutput_fn lwip_capture_linkoutput_next;
+
+static err_t lwip_capture_input(struct pbuf *pbuf, struct netif *netif)
+{
+  lwip_capture_fn hook = lwip_hook_for_capture;
+
+  if(hook != NULL)
+  {
+    hook(pbuf, netif, LWIP_CAPTURE_IN);
+  }
+  return lwip_capture_input_next(pbuf, netif);
+}
+
+static err_t lwip_capture_linkoutput(struct netif *netif, struct pbuf *pbuf)
+{
+  lwip_capture_fn hook = lwip_hook_for_capture;
+
+  if(hook != NULL)
+  {
+    hook(pbuf, netif, LWIP_CAPTURE_OUT);
+  }
+  return lwip_capture_linkoutput_next(netif, pbuf);
+}
+
+void lwip_set_hook_for_capture(struct netif *netif, lwip_capture_fn hook)
+{
+  if(netif->input != lwip_capture_input)
+  {
+    lwip_capture_input_next = netif->input;
+    netif->input = lwip_capture_input;
+  }
+  if(netif->linkoutput != lwip_capture_linkoutput)
+  {
+    lwip_capture_linkoutput_next = netif->linkoutput;
+    netif->linkoutput = lwip_capture_linkoutput;
+  }
+  lwip_hook_for_capture = hook;
+}
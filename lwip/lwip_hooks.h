@@ -38,4 +38,33 @@ err_t lwip_hook_unknown_eth_protocol(struct pbuf *pbuf, struct netif *netif);
  */
 void lwip_set_hook_for_unknown_eth_protocol(struct netif *netif, netif_input_fn hook);
 
+/** Direction of a frame passed to the capture hook */
+#define LWIP_CAPTURE_IN  1
+#define LWIP_CAPTURE_OUT 2
+
+/**
+ * Capture hook, called for each frame received on or sent from a netif.
+ *
+ * \param pbuf  Payload points to ethernet header! Must not be modified
+ *              or freed.
+ * \param netif Network interface.
+ * \param dir   LWIP_CAPTURE_IN or LWIP_CAPTURE_OUT.
+ */
+typedef void (*lwip_capture_fn)(struct pbuf *pbuf, struct netif *netif, u8_t dir);
+
+/**
+ * Configure function to be called for each frame received on or sent
+ * from a netif, e.g. to capture frames for debugging.
+ *
+ * The first call wraps netif->input and netif->linkoutput, so it must be
+ * made after the netif is added and with the tcpip core locked. Only one
+ * netif is supported. Received frames are passed before tcpip_input(),
+ * from the context of the driver, and sent frames from the context that
+ * sends them.
+ *
+ *\param netif Network interface.
+ *\param hook  Hook function, NULL to not call any function.
+ */
+void lwip_set_hook_for_capture(struct netif *netif, lwip_capture_fn hook);
+
 #endif /* LWIP_HOOKS_H */
@@ -182,37 +182,82 @@
 #define TCPIP_THREAD_PRIO               (4)
 #define DEFAULT_RAW_RECVMBOX_SIZE       (12)
 #define DEFAULT_UDP_RECVMBOX_SIZE       (12)
-#define DEFAULT_ACCEPTMBOX_SIZE         (8)
+#define DEFAULT_ACCEPTMBOX_SIZE         (8 + MODBUS_MAX_CLIENTS)
+
+/**
+ * TCP_LISTEN_BACKLOG: limit the number of connections that a listening
+ * socket has received but not yet accepted. Clients that connect faster than
+ * a server accepts them then cannot take the TCP PCBs reserved for other
+ * servers. The backlog argument of listen() sets the limit, and
+ * TCP_DEFAULT_LISTEN_BACKLOG applies to listeners that do not set it.
+ */
+#define TCP_LISTEN_BACKLOG              (1)
+#define TCP_DEFAULT_LISTEN_BACKLOG      (MODBUS_MAX_CLIENTS)
+
+/**
+ * MODBUS_MAX_CLIENTS: number of concurrent Modbus TCP clients (HMI/SCADA)
+ * supported by the Modbus TCP server. TCP PCBs, segments and netconns are
+ * reserved for each client on top of what the rest of the application
+ * uses. Clients above the limit are disconnected, most idle first, see
+ * source/modbus_conn.c.
+ */
+#ifndef MODBUS_MAX_CLIENTS
+#define MODBUS_MAX_CLIENTS              (8)
+#endif
+
+/**
+ * GATEWAY_MAX_CLIENTS: number of concurrent clients of the read-only
+ * Modbus TCP gateway, see source/gateway.c. Reserved like the Modbus TCP
+ * clients. The gateway also uses one listening socket.
+ */
+#ifndef GATEWAY_MAX_CLIENTS
+#define GATEWAY_MAX_CLIENTS             (4)
+#endif
+
+/**
+ * STREAM_MAX_CLIENTS: number of concurrent web viewers of the process
+ * data stream, see source/stream_net.c. Reserved like the Modbus TCP
+ * clients. The stream also uses one listening socket.
+ */
+#ifndef STREAM_MAX_CLIENTS
+#define STREAM_MAX_CLIENTS              (4)
+#endif
 
 /**
  * MEMP_NUM_UDP_PCB: the number of UDP protocol control blocks. One
- * per active UDP "connection".
+ * per active UDP "connection". One is reserved for the TFTP server
+ * serving frame captures, see source/capture_net.c.
  * (requires the LWIP_UDP option)
  */
-#define MEMP_NUM_UDP_PCB                8
+#define MEMP_NUM_UDP_PCB                (8 + 1)
 
 /**
  * MEMP_NUM_TCP_PCB: the number of simultaneously active TCP connections.
  * (requires the LWIP_TCP option)
  */
-#define MEMP_NUM_TCP_PCB                8
+#define MEMP_NUM_TCP_PCB \
+   (8 + MODBUS_MAX_CLIENTS + GATEWAY_MAX_CLIENTS + STREAM_MAX_CLIENTS)
 
 /**
- * MEMP_NUM_TCP_PCB_LISTEN: the number of listening TCP connections.
+ * MEMP_NUM_TCP_PCB_LISTEN: the number of listening TCP connections. One
+ * each is reserved for the Modbus TCP gateway and the process data stream.
  * (requires the LWIP_TCP option)
  */
-#define MEMP_NUM_TCP_PCB_LISTEN         8
+#define MEMP_NUM_TCP_PCB_LISTEN         (8 + 1 + 1)
 
 /**
  * MEMP_NUM_TCP_SEG: the number of simultaneously queued TCP segments.
  * (requires the LWIP_TCP option)
  */
-#define MEMP_NUM_TCP_SEG                27
+#define MEMP_NUM_TCP_SEG \
+   (27 + 2 * MODBUS_MAX_CLIENTS + 2 * GATEWAY_MAX_CLIENTS + \
+    2 * STREAM_MAX_CLIENTS)
 
 /**
  * MEMP_NUM_SYS_TIMEOUT: the number of simultaneously active timeouts.
+ * One is used by the TFTP server during a transfer.
  */
-#define MEMP_NUM_SYS_TIMEOUT            17
+#define MEMP_NUM_SYS_TIMEOUT            (17 + 1)
 
 /**
  * PBUF_POOL_SIZE: the number of buffers in the pbuf pool.
@@ -229,7 +274,9 @@
  * MEMP_NUM_NETCONN: the number of struct netconns.
  * (only needed if you use the sequential API, like api_lib.c)
  */
-#define MEMP_NUM_NETCONN                16
+#define MEMP_NUM_NETCONN \
+   (16 + MODBUS_MAX_CLIENTS + 1 + GATEWAY_MAX_CLIENTS + 1 + \
+    STREAM_MAX_CLIENTS)
 
 
 /* Turn off LWIP_STATS in Release build */
@@ -239,6 +286,13 @@
 #define LWIP_STATS 0
 #endif
 
+/* 32-bit counters, 16-bit counters wrap within minutes under cyclic
+ * traffic which breaks interval deltas in netstat */
+#define LWIP_STATS_LARGE                1
+
+/* Keep pool names, used by netstat */
+#define LWIP_STATS_DISPLAY              LWIP_STATS
+
 /**
  * LWIP_TCPIP_CORE_LOCKING
  * Creates a global mutex that is held during TCPIP thread operations.
@@ -278,6 +332,12 @@
 #define LWIP_NETIF_LINK_CALLBACK      (1)
 #define LWIP_NETIF_REMOVE_CALLBACK    (1)
 
+/* Unrolled 32-bit checksum, see lwip_chksum.c. Used for the protocols that
+ * are not offloaded to the MAC of a netif (lwip_checksum_offload()).
+ * LWIP_CHKSUM_ALGORITHM selects the reference implementation kept for
+ * benchmarking (chksum_bench). */
+#include "lwip/lwip_chksum.h"
+#define LWIP_CHKSUM                   lwip_chksum_unrolled
 #define LWIP_CHKSUM_ALGORITHM         (3)
 
 extern void sys_check_core_locking() ;
@@ -0,0 +1,410 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Application configuration blob.
+ *
+ * All boot time settings are kept in one versioned, CRC protected struct
+ * which is read with a single filesystem read, instead of opening and
+ * parsing one text file per setting.
+ */
+
+#include "app_config.h"
+#include "crc.h"
+#include "cycle_stats.h"
+#include "shell.h"
+#include "rte_fs.h"
+#include "lwip/ip4_addr.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONFIG_FILE           STORAGE_ROOT "config.bin"
+#define LEGACY_AUTOSTART_FILE STORAGE_ROOT "autostart"
+
+app_config_t app_config;
+
+/* Cycle counter when configuration became ready, counted from main() */
+static uint32_t ready_cycles;
+
+/* Size of a configuration ending before a field, padded as the struct */
+#define CONFIG_SIZE_BEFORE(field) ((offsetof (app_config_t, field) + 3) & ~3u)
+
+/* Size of each earlier version, by version - 1 */
+static const uint16_t old_sizes[APP_CONFIG_VERSION - 1] = {
+   CONFIG_SIZE_BEFORE (io),
+   CONFIG_SIZE_BEFORE (gateway_port),
+   CONFIG_SIZE_BEFORE (static_ip),
+};
+
+static uint32_t config_crc (app_config_t * config, size_t size)
+{
+   uint32_t saved = config->crc;
+   uint32_t crc;
+
+   config->crc = 0;
+   crc = crc32 (config, size);
+   config->crc = saved;
+
+   return crc;
+}
+
+static void set_defaults (app_config_t * config)
+{
+   memset (config, 0, sizeof (*config));
+   config->magic = APP_CONFIG_MAGIC;
+   config->version = APP_CONFIG_VERSION;
+   config->size = sizeof (*config);
+   config->ip_mode = APP_CONFIG_IP_AUTO;
+}
+
+static bool is_valid (app_config_t * config, size_t n)
+{
+   return config->magic == APP_CONFIG_MAGIC &&
+          config->version == APP_CONFIG_VERSION &&
+          config->size == sizeof (*config) && n == sizeof (*config) &&
+          config->crc == config_crc (config, sizeof (*config));
+}
+
+/* Keep the settings of an earlier version, with defaults for the
+ * fields added since. Fields are only ever appended and default to 0. */
+static bool migrate (app_config_t * config, size_t n)
+{
+   uint16_t size;
+
+   if (
+      config->magic != APP_CONFIG_MAGIC || config->version < 1 ||
+      config->version >= APP_CONFIG_VERSION)
+   {
+      return false;
+   }
+
+   size = old_sizes[config->version - 1];
+   if (
+      config->size != size || n != size ||
+      config->crc != config_crc (config, size))
+   {
+      return false;
+   }
+
+   memset ((uint8_t *)config + size, 0, sizeof (*config) - size);
+   config->version = APP_CONFIG_VERSION;
+   config->size = sizeof (*config);
+   return true;
+}
+
+int app_config_load (void)
+{
+   RTE_FILE * f;
+   size_t n = 0;
+
+   f = rte_fs_fopen (CONFIG_FILE, "r");
+   if (f != NULL)
+   {
+      n = rte_fs_fread (&app_config, 1, sizeof (app_config), f);
+      rte_fs_fclose (f);
+   }
+
+   ready_cycles = cycle_stats_now();
+
+   if (is_valid (&app_config, n) || migrate (&app_config, n))
+   {
+      return 0;
+   }
+
+   set_defaults (&app_config);
+   return -1;
+}
+
+int app_config_save (void)
+{
+   RTE_FILE * f;
+   size_t n;
+
+   app_config.magic = APP_CONFIG_MAGIC;
+   app_config.version = APP_CONFIG_VERSION;
+   app_config.size = sizeof (app_config);
+   app_config.crc = config_crc (&app_config, sizeof (app_config));
+
+   f = rte_fs_fopen (CONFIG_FILE, "w");
+   if (f == NULL)
+   {
+      return -1;
+   }
+
+   n = rte_fs_fwrite (&app_config, 1, sizeof (app_config), f);
+   rte_fs_fclose (f);
+
+   if (n != sizeof (app_config))
+   {
+      return -1;
+   }
+
+   /* Configuration now owns the autostart setting */
+   rte_fs_remove (LEGACY_AUTOSTART_FILE);
+   return 0;
+}
+
+int app_config_read_legacy_autostart (char * protocol, size_t size)
+{
+   RTE_FILE * f = rte_fs_fopen (LEGACY_AUTOSTART_FILE, "r");
+   size_t n;
+
+   if (f == NULL)
+   {
+      return -1;
+   }
+
+   n = rte_fs_fread (protocol, 1, size - 1, f);
+   rte_fs_fclose (f);
+   protocol[n] = '\0';
+
+   return 0;
+}
+
+static const char * ip_mode_str (uint8_t mode)
+{
+   switch (mode)
+   {
+   case APP_CONFIG_IP_STATIC:
+      return "static";
+   case APP_CONFIG_IP_DHCP:
+      return "dhcp";
+   case APP_CONFIG_IP_AUTO:
+   default:
+      return "auto";
+   }
+}
+
+static void print_addr (const char * name, uint32_t addr)
+{
+   ip4_addr_t ip = {.addr = addr};
+
+   printf ("%-12s : %s\n", name, addr ? ip4addr_ntoa (&ip) : "(default)");
+}
+
+/* Return true if len > 0 and the first len characters are digits */
+static bool is_digits (const char * s, size_t len)
+{
+   for (size_t i = 0; i < len; i++)
+   {
+      if (s[i] < '0' || s[i] > '9')
+      {
+         return false;
+      }
+   }
+
+   return len > 0;
+}
+
+bool app_config_station_name_valid (const char * name)
+{
+   const char * label = name;
+   size_t n_labels = 0;
+   bool numeric = true;
+
+   if (strlen (name) > APP_CONFIG_STATION_NAME_SIZE - 1)
+   {
+      return false;
+   }
+
+   /* Reserved for IDNA encoded names */
+   if (strncmp (name, "xn-", 3) == 0)
+   {
+      return false;
+   }
+
+   while (label != NULL)
+   {
+      const char * end = strchr (label, '.');
+      size_t len = (end != NULL) ? (size_t)(end - label) : strlen (label);
+
+      if (len == 0 || len > 63 || label[0] == '-' || label[len - 1] == '-')
+      {
+         return false;
+      }
+
+      for (size_t i = 0; i < len; i++)
+      {
+         char c = label[i];
+
+         if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-'))
+         {
+            return false;
+         }
+      }
+
+      if (len > 3 || !is_digits (label, len))
+      {
+         numeric = false;
+      }
+
+      n_labels++;
+      label = (end != NULL) ? end + 1 : NULL;
+   }
+
+   /* Not an IPv4 address */
+   if (n_labels == 4 && numeric)
+   {
+      return false;
+   }
+
+   /* Not port-xyz or port-xyz-abcde, reserved for port names. The index
+    * checks are only reached when the preceding characters are digits. */
+   if (
+      strncmp (name, "port-", 5) == 0 && is_digits (name + 5, 3) &&
+      (name[8] == '\0' || name[8] == '.' ||
+       (name[8] == '-' && is_digits (name + 9, 5) &&
+        (name[14] == '\0' || name[14] == '.'))))
+   {
+      return false;
+   }
+
+   return true;
+}
+
+static int config_ip (int argc, char * argv[])
+{
+   ip4_addr_t ip;
+   ip4_addr_t netmask;
+   ip4_addr_t gw;
+
+   if (argc == 3 && strcmp (argv[2], "auto") == 0)
+   {
+      app_config.ip_mode = APP_CONFIG_IP_AUTO;
+   }
+   else if (argc == 3 && strcmp (argv[2], "dhcp") == 0)
+   {
+      app_config.ip_mode = APP_CONFIG_IP_DHCP;
+   }
+   else if (argc == 3 && strcmp (argv[2], "static") == 0)
+   {
+      app_config.ip_mode = APP_CONFIG_IP_STATIC;
+   }
+   else if (
+      argc == 6 && strcmp (argv[2], "static") == 0 &&
+      ip4addr_aton (argv[3], &ip) && ip.addr != 0 &&
+      ip4addr_aton (argv[4], &netmask) &&
+      ip4_addr_netmask_valid (netmask.addr) && ip4addr_aton (argv[5], &gw))
+   {
+      app_config.ip_mode = APP_CONFIG_IP_STATIC;
+      app_config.static_ip = ip.addr;
+      app_config.static_netmask = netmask.addr;
+      app_config.static_gateway = gw.addr;
+   }
+   else
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   return app_config_save();
+}
+
+static int _cmd_config (int argc, char * argv[])
+{
+   if (argc >= 3 && strcmp (argv[1], "ip") == 0)
+   {
+      return config_ip (argc, argv);
+   }
+
+   if (argc == 3 && strcmp (argv[1], "station") == 0)
+   {
+      if (!app_config_station_name_valid (argv[2]))
+      {
+         printf ("Invalid Profinet station name\n");
+         return -1;
+      }
+
+      strncpy (
+         app_config.station_name,
+         argv[2],
+         sizeof (app_config.station_name) - 1);
+      return app_config_save();
+   }
+
+   if (argc == 3 && strcmp (argv[1], "gateway") == 0)
+   {
+      unsigned long port =
+         (strcmp (argv[2], "off") == 0) ? 0 : strtoul (argv[2], NULL, 0);
+
+      if (port > UINT16_MAX || (port == 0 && strcmp (argv[2], "off") != 0))
+      {
+         printf ("error - try \"help %s\"\n", argv[0]);
+         return -1;
+      }
+      app_config.gateway_port = port;
+      return app_config_save();
+   }
+
+   if (argc == 2 && strcmp (argv[1], "erase") == 0)
+   {
+      set_defaults (&app_config);
+      return rte_fs_remove (CONFIG_FILE);
+   }
+
+   if (argc != 1)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   printf ("Version      : %" PRIu16 "\n", app_config.version);
+   printf ("Size         : %" PRIu16 " bytes\n", app_config.size);
+   printf ("Autostart    : %s\n", app_config.autostart ? "yes" : "no");
+   printf ("Bustype      : %" PRIu8 "\n", app_config.bustype);
+   printf ("IP mode      : %s\n", ip_mode_str (app_config.ip_mode));
+   print_addr ("Static IP", app_config.static_ip);
+   if (app_config.static_ip != 0)
+   {
+      print_addr ("Netmask", app_config.static_netmask);
+      print_addr ("Default gw", app_config.static_gateway);
+   }
+   printf (
+      "Station name : %s\n",
+      app_config.station_name[0] ? app_config.station_name : "(default)");
+   if (app_config.gateway_port != 0)
+   {
+      printf ("Gateway port : %" PRIu16 "\n", app_config.gateway_port);
+   }
+   else
+   {
+      printf ("Gateway port : off\n");
+   }
+   printf (
+      "Ready after  : %" PRIu32 " us from main()\n",
+      cycle_stats_to_us (ready_cycles));
+
+   return 0;
+}
+
+const shell_cmd_t cmd_config = {
+   .cmd = _cmd_config,
+   .name = "config",
+   .help_short = "show or set boot configuration",
+   .help_long = "Show or set the stored boot configuration.\n"
+                "Usage: config\n"
+                "       config ip <auto|static|dhcp>\n"
+                "       config ip static <addr> <netmask> <gateway>\n"
+                "       config station <name>\n"
+                "       config gateway <port|off>\n"
+                "       config erase\n"
+                "Use up_autostart to configure the autostart protocol.\n"
+                "Static addresses default to those of network.h.\n"
+                "The read-only Modbus TCP gateway starts with U-Phy.\n"
+                "The station name must be a valid Profinet NameOfStation.\n"
+                "Ready after is counted from main(), not from reset.\n"};
+
+SHELL_CMD (cmd_config);
@@ -0,0 +1,127 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef APP_CONFIG_H_
+#define APP_CONFIG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define APP_CONFIG_MAGIC   0x43465055 /* "UPFC" */
+#define APP_CONFIG_VERSION 4
+
+/* Max Profinet station name length is 240 */
+#define APP_CONFIG_STATION_NAME_SIZE (240 + 1)
+
+/* Process data exchange settings are kept per bustype, up to this value */
+#define APP_CONFIG_MAX_BUSTYPES 8
+
+typedef enum app_config_ip_mode
+{
+   APP_CONFIG_IP_AUTO = 0, /* Static for Profinet/CC-Link, else DHCP */
+   APP_CONFIG_IP_STATIC,
+   APP_CONFIG_IP_DHCP,
+} app_config_ip_mode_t;
+
+typedef enum app_config_io_mode
+{
+   APP_CONFIG_IO_SYNC = 0,   /* Exchange in cb_sync/cb_avail every cycle */
+   APP_CONFIG_IO_ASYNC,      /* Exchange in the worker loop */
+   APP_CONFIG_IO_DECIMATED,  /* Exchange in cb_sync/cb_avail every Nth cycle */
+} app_config_io_mode_t;
+
+typedef struct app_config_io
+{
+   uint8_t mode;       /* app_config_io_mode_t */
+   uint8_t decimation; /* N, for APP_CONFIG_IO_DECIMATED */
+} app_config_io_t;
+
+/**
+ * Application configuration.
+ *
+ * Stored as a single binary blob, read with one filesystem read at boot.
+ * The header is validated against magic, version, size and CRC, and the
+ * defaults are used if any check fails.
+ */
+typedef struct app_config
+{
+   /* Header */
+   uint32_t magic;
+   uint16_t version;
+   uint16_t size;
+   uint32_t crc; /* CRC-32 of the blob with crc set to 0 */
+
+   /* Configuration */
+   uint8_t autostart;
+   uint8_t bustype; /* up_bustype_t */
+   uint8_t ip_mode; /* app_config_ip_mode_t */
+   uint8_t reserved;
+   char station_name[APP_CONFIG_STATION_NAME_SIZE];
+
+   /* Added in version 2 */
+   app_config_io_t io[APP_CONFIG_MAX_BUSTYPES]; /* By up_bustype_t */
+
+   /* Added in version 3 */
+   uint16_t gateway_port; /* Read-only Modbus TCP gateway, 0 if off */
+
+   /* Added in version 4. Static IPv4 settings in network byte order, the
+    * defaults of network.h are used if static_ip is 0 */
+   uint32_t static_ip;
+   uint32_t static_netmask;
+   uint32_t static_gateway;
+} app_config_t;
+
+/* Active configuration, valid after app_config_load() */
+extern app_config_t app_config;
+
+/**
+ * Load the configuration blob from the filesystem.
+ *
+ * Falls back to defaults if no valid blob is found.
+ *
+ * @return 0 if a stored configuration was loaded, -1 if defaults are used
+ */
+extern int app_config_load (void);
+
+/**
+ * Read the autostart protocol name saved by earlier versions of the
+ * application, for migration to the configuration blob.
+ *
+ * @param protocol   Buffer for protocol name
+ * @param size       Size of buffer
+ * @return 0 if a legacy autostart file was found, -1 if not
+ */
+extern int app_config_read_legacy_autostart (char * protocol, size_t size);
+
+/**
+ * Save the active configuration.
+ *
+ * @return 0 on success, -1 on error
+ */
+extern int app_config_save (void);
+
+/**
+ * Check a Profinet station name (NameOfStation).
+ *
+ * The name is at most 240 characters in labels separated by '.'. Each label
+ * is 1-63 characters of a-z, 0-9 and '-' and does not start or end with '-'.
+ * The name does not start with "xn-" and does not have the form of an IPv4
+ * address (n.n.n.n). The first label is not "port-xyz" or "port-xyz-abcde",
+ * where a-e and x-z are digits.
+ *
+ * @param name       Station name
+ * @return true if the name is valid, false if not
+ */
+extern bool app_config_station_name_valid (const char * name);
+
+#endif /* APP_CONFIG_H_ */
@@ -0,0 +1,291 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Packing of boolean signals between process image and frame bits.
+ *
+ * Runs of signals are moved eight at a time. Eight value bytes are
+ * loaded as words, reduced to one bit per byte and gathered into a frame
+ * byte with a multiply, and a frame byte is spread back into eight value
+ * bytes the same way. Only the bits before the first byte boundary of a
+ * run and after the last are handled one by one.
+ *
+ * Signals of 2 to 7 bits are moved one bit at a time.
+ *
+ * The file has no target dependencies, so that it can be benchmarked on
+ * the host, see bench/bitpack_bench.c. 64-bit words are used on hosts
+ * with 64-bit registers; define BITPACK_FORCE_WORD32 to run the 32-bit
+ * kernels of the target instead.
+ */
+
+#include "bitpack.h"
+
+#include <string.h>
+
+/* Use 64-bit words on hosts with 64-bit registers */
+#if UINTPTR_MAX > 0xFFFFFFFFu && !defined(BITPACK_FORCE_WORD32)
+#define BITPACK_WORD64
+#endif
+
+static inline uint32_t load32 (const void * p)
+{
+   uint32_t x;
+
+   memcpy (&x, p, sizeof (x));
+   return x;
+}
+
+static inline void store32 (void * p, uint32_t x)
+{
+   memcpy (p, &x, sizeof (x));
+}
+
+/* Gather bit 7 of four bytes into bits 0-3 */
+static inline uint32_t gather4 (uint32_t x)
+{
+   return ((x >> 7) * 0x10204080u) >> 28;
+}
+
+/* Set bit 7 of each byte that is not 0 and clear all other bits */
+static inline uint32_t nonzero4 (uint32_t x)
+{
+   return (((x & 0x7F7F7F7Fu) + 0x7F7F7F7Fu) | x) & 0x80808080u;
+}
+
+/* Spread bits 0-3 into bit 0 of four bytes */
+static inline uint32_t spread4 (uint32_t x)
+{
+   return (x * 0x00204081u) & 0x01010101u;
+}
+
+static inline uint8_t gather8 (const uint8_t * values)
+{
+#ifdef BITPACK_WORD64
+   uint64_t x;
+
+   memcpy (&x, values, sizeof (x));
+   x = (((x & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | x) &
+       0x8080808080808080ull;
+   return ((x >> 7) * 0x0102040810204080ull) >> 56;
+#else
+   return gather4 (nonzero4 (load32 (values))) |
+          gather4 (nonzero4 (load32 (values + 4))) << 4;
+#endif
+}
+
+static inline void spread8 (uint8_t * values, uint8_t b)
+{
+#ifdef BITPACK_WORD64
+   uint64_t x = spread4 (b & 0x0F) | (uint64_t)spread4 (b >> 4) << 32;
+
+   memcpy (values, &x, sizeof (x));
+#else
+   store32 (values, spread4 (b & 0x0F));
+   store32 (values + 4, spread4 (b >> 4));
+#endif
+}
+
+static inline void put_bit (uint8_t * frame, uint32_t bit, uint8_t value)
+{
+   uint8_t mask = 1u << (bit & 7);
+
+   if (value != 0)
+   {
+      frame[bit / 8] |= mask;
+   }
+   else
+   {
+      frame[bit / 8] &= ~mask;
+   }
+}
+
+static inline uint8_t get_bit (const uint8_t * frame, uint32_t bit)
+{
+   return (frame[bit / 8] >> (bit & 7)) & 1;
+}
+
+void bitpack_gather (
+   const uint8_t * values,
+   uint32_t n,
+   uint8_t * frame,
+   uint32_t bit)
+{
+   while (n > 0 && (bit & 7) != 0)
+   {
+      put_bit (frame, bit++, *values++);
+      n--;
+   }
+
+   frame += bit / 8;
+   while (n >= 32)
+   {
+      uint32_t w = gather8 (values);
+
+      w |= gather8 (values + 8) << 8;
+      w |= gather8 (values + 16) << 16;
+      w |= (uint32_t)gather8 (values + 24) << 24;
+      store32 (frame, w);
+      values += 32;
+      frame += 4;
+      n -= 32;
+   }
+   while (n >= 8)
+   {
+      *frame++ = gather8 (values);
+      values += 8;
+      n -= 8;
+   }
+
+   for (uint32_t i = 0; i < n; i++)
+   {
+      put_bit (frame, i, values[i]);
+   }
+}
+
+void bitpack_scatter (
+   uint8_t * values,
+   uint32_t n,
+   const uint8_t * frame,
+   uint32_t bit)
+{
+   while (n > 0 && (bit & 7) != 0)
+   {
+      *values++ = get_bit (frame, bit++);
+      n--;
+   }
+
+   frame += bit / 8;
+   while (n >= 32)
+   {
+      uint32_t w = load32 (frame);
+
+      spread8 (values, w);
+      spread8 (values + 8, w >> 8);
+      spread8 (values + 16, w >> 16);
+      spread8 (values + 24, w >> 24);
+      values += 32;
+      frame += 4;
+      n -= 32;
+   }
+   while (n >= 8)
+   {
+      spread8 (values, *frame++);
+      values += 8;
+      n -= 8;
+   }
+
+   for (uint32_t i = 0; i < n; i++)
+   {
+      values[i] = get_bit (frame, i);
+   }
+}
+
+void bitpack_plan_init (
+   bitpack_plan_t * plan,
+   bitpack_run_t * runs,
+   uint16_t max_runs)
+{
+   plan->runs = runs;
+   plan->max_runs = max_runs;
+   plan->n_runs = 0;
+   plan->n_bits = 0;
+}
+
+int bitpack_plan_add_field (
+   bitpack_plan_t * plan,
+   uint8_t * value,
+   uint16_t bit,
+   uint8_t width)
+{
+   bitpack_run_t * run = NULL;
+
+   if (width == 0 || width > BITPACK_MAX_WIDTH || bit + width > UINT16_MAX)
+   {
+      return -1;
+   }
+
+   if (plan->n_runs > 0 && width == 1)
+   {
+      run = &plan->runs[plan->n_runs - 1];
+      if (
+         run->width != 1 || value != run->values + run->n ||
+         bit != run->bit + run->n)
+      {
+         run = NULL;
+      }
+   }
+
+   if (run == NULL)
+   {
+      if (plan->n_runs == plan->max_runs)
+      {
+         return -1;
+      }
+      run = &plan->runs[plan->n_runs++];
+      run->values = value;
+      run->bit = bit;
+      run->n = 0;
+      run->width = width;
+   }
+
+   run->n++;
+   if (bit + width > plan->n_bits)
+   {
+      plan->n_bits = bit + width;
+   }
+   return 0;
+}
+
+int bitpack_plan_add (bitpack_plan_t * plan, uint8_t * value, uint16_t bit)
+{
+   return bitpack_plan_add_field (plan, value, bit, 1);
+}
+
+void bitpack_pack (const bitpack_plan_t * plan, uint8_t * frame)
+{
+   for (uint16_t i = 0; i < plan->n_runs; i++)
+   {
+      const bitpack_run_t * run = &plan->runs[i];
+
+      if (run->width == 1)
+      {
+         bitpack_gather (run->values, run->n, frame, run->bit);
+         continue;
+      }
+
+      for (uint8_t j = 0; j < run->width; j++)
+      {
+         put_bit (frame, run->bit + j, (*run->values >> j) & 1);
+      }
+   }
+}
+
+void bitpack_unpack (const bitpack_plan_t * plan, const uint8_t * frame)
+{
+   for (uint16_t i = 0; i < plan->n_runs; i++)
+   {
+      const bitpack_run_t * run = &plan->runs[i];
+      uint8_t value = 0;
+
+      if (run->width == 1)
+      {
+         bitpack_scatter (run->values, run->n, frame, run->bit);
+         continue;
+      }
+
+      for (uint8_t j = 0; j < run->width; j++)
+      {
+         value |= get_bit (frame, run->bit + j) << j;
+      }
+      *run->values = value;
+   }
+}
@@ -0,0 +1,143 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef BITPACK_H_
+#define BITPACK_H_
+
+#include <stdint.h>
+
+/* Number of bytes in a frame of n bits */
+#define BITPACK_BYTES(n) (((n) + 7) / 8)
+
+/* Widest signal packed into frame bits, wider signals take whole bytes */
+#define BITPACK_MAX_WIDTH 7
+
+/**
+ * Boolean signals with consecutive values in the process image, one byte
+ * per signal, and consecutive bits in the frame. Bit i of a frame is bit
+ * i % 8 of byte i / 8.
+ *
+ * A signal of 2 to BITPACK_MAX_WIDTH bits forms a run of its own, with
+ * its value in the low bits of one byte and its bits, least significant
+ * first, in consecutive frame bits.
+ */
+typedef struct bitpack_run
+{
+   uint8_t * values;
+   uint16_t bit; /* First bit in frame */
+   uint16_t n;
+   uint8_t width; /* Bits per signal, 1 for boolean runs */
+} bitpack_run_t;
+
+/* Mapping between process image and frame bits, e.g. for one slot. The
+ * application builds plans for the up_bits shell command only, no
+ * protocol frame is packed with them. */
+typedef struct bitpack_plan
+{
+   bitpack_run_t * runs;
+   uint16_t max_runs;
+   uint16_t n_runs;
+   uint16_t n_bits; /* Bits used in frame */
+} bitpack_plan_t;
+
+/**
+ * Initialise an empty plan.
+ *
+ * @param plan       Plan
+ * @param runs       Storage for runs
+ * @param max_runs   Number of runs in storage, at most one per signal is
+ *                   needed
+ */
+extern void bitpack_plan_init (
+   bitpack_plan_t * plan,
+   bitpack_run_t * runs,
+   uint16_t max_runs);
+
+/**
+ * Add a boolean signal to a plan. Signals that follow the previous one
+ * both in the process image and in the frame extend its run.
+ *
+ * @param plan       Plan
+ * @param value      Value of signal in process image, 0 or 1
+ * @param bit        Bit in frame
+ * @return 0 on success, -1 if out of runs
+ */
+extern int bitpack_plan_add (
+   bitpack_plan_t * plan,
+   uint8_t * value,
+   uint16_t bit);
+
+/**
+ * Add a signal of 1 to BITPACK_MAX_WIDTH bits to a plan. A 1-bit signal
+ * is added as by bitpack_plan_add().
+ *
+ * @param plan       Plan
+ * @param value      Value of signal in process image, in the low bits
+ * @param bit        First bit in frame
+ * @param width      Number of bits
+ * @return 0 on success, -1 if out of runs or width is not supported
+ */
+extern int bitpack_plan_add_field (
+   bitpack_plan_t * plan,
+   uint8_t * value,
+   uint16_t bit,
+   uint8_t width);
+
+/**
+ * Pack the signals of a plan into a frame. Other bits of the frame are
+ * left unchanged.
+ *
+ * @param plan       Plan
+ * @param frame      Frame, at least BITPACK_BYTES(plan->n_bits) bytes
+ */
+extern void bitpack_pack (const bitpack_plan_t * plan, uint8_t * frame);
+
+/**
+ * Unpack the signals of a plan from a frame into the process image.
+ *
+ * @param plan       Plan
+ * @param frame      Frame, at least BITPACK_BYTES(plan->n_bits) bytes
+ */
+extern void bitpack_unpack (
+   const bitpack_plan_t * plan,
+   const uint8_t * frame);
+
+/**
+ * Pack n values, one byte each, into n frame bits from bit. A value is
+ * true if not 0.
+ *
+ * @param values     Values
+ * @param n          Number of values
+ * @param frame      Frame
+ * @param bit        First bit in frame
+ */
+extern void bitpack_gather (
+   const uint8_t * values,
+   uint32_t n,
+   uint8_t * frame,
+   uint32_t bit);
+
+/**
+ * Unpack n frame bits from bit into n values, one byte each, 0 or 1.
+ *
+ * @param values     Values
+ * @param n          Number of values
+ * @param frame      Frame
+ * @param bit        First bit in frame
+ */
+extern void bitpack_scatter (
+   uint8_t * values,
+   uint32_t n,
+   const uint8_t * frame,
+   uint32_t bit);
+
+#endif /* BITPACK_H_ */
@@ -0,0 +1,209 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Byte order conversion of the process image using precomputed plans.
+ *
+ * A plan lists runs of consecutive fields of the same width, generated
+ * by uphy-model-blob.py or built at startup. Conversion is a loop over
+ * the runs with no per signal datatype switch. 16-bit fields are swapped
+ * two at a time with REV16, 32-bit fields with REV.
+ */
+
+#include "byteswap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__arm__)
+#include "cy_device.h"
+#define REV(x)   __REV (x)
+#define REV16(x) __REV16 (x)
+#else
+#define REV(x)   __builtin_bswap32 (x)
+#define REV16(x) ((((x) & 0x00FF00FFu) << 8) | (((x) >> 8) & 0x00FF00FFu))
+#endif
+
+static inline uint32_t load32 (const void * p)
+{
+   uint32_t x;
+
+   memcpy (&x, p, sizeof (x));
+   return x;
+}
+
+static inline void store32 (void * p, uint32_t x)
+{
+   memcpy (p, &x, sizeof (x));
+}
+
+/* Swap bytes of each 16-bit word in n 32-bit words */
+static void rev16 (uint8_t * dst, const uint8_t * src, uint32_t n)
+{
+   for (uint32_t i = 0; i < n; i++)
+   {
+      store32 (dst + 4 * i, REV16 (load32 (src + 4 * i)));
+   }
+}
+
+/* Reverse bytes of n 32-bit words */
+static void rev32 (uint8_t * dst, const uint8_t * src, uint32_t n)
+{
+   for (uint32_t i = 0; i < n; i++)
+   {
+      store32 (dst + 4 * i, REV (load32 (src + 4 * i)));
+   }
+}
+
+/* Reverse bytes of n 64-bit words */
+static void rev64 (uint8_t * dst, const uint8_t * src, uint32_t n)
+{
+   for (uint32_t i = 0; i < n; i++)
+   {
+      uint32_t lo = load32 (src + 8 * i);
+      uint32_t hi = load32 (src + 8 * i + 4);
+
+      store32 (dst + 8 * i, REV (hi));
+      store32 (dst + 8 * i + 4, REV (lo));
+   }
+}
+
+void byteswap_convert (
+   const byteswap_plan_t * plan,
+   uint8_t * dst,
+   const uint8_t * src,
+   byteswap_order_t order)
+{
+   for (uint16_t i = 0; i < plan->n_runs; i++)
+   {
+      const model_blob_swap_run_t * run = &plan->runs[i];
+      const uint8_t * s = src + run->offset;
+      uint8_t * d = dst + run->offset;
+
+      if (run->width == 2)
+      {
+         rev16 (d, s, run->count / 2);
+         if (run->count & 1)
+         {
+            uint32_t last = 2 * (run->count - 1);
+            uint8_t b = s[last];
+
+            d[last] = s[last + 1];
+            d[last + 1] = b;
+         }
+      }
+      else if (order == BYTESWAP_WORDS)
+      {
+         rev16 (d, s, run->count * run->width / 4);
+      }
+      else if (run->width == 4)
+      {
+         rev32 (d, s, run->count);
+      }
+      else
+      {
+         rev64 (d, s, run->count);
+      }
+   }
+}
+
+static uint16_t field_width (up_dtype_t datatype)
+{
+   switch (datatype)
+   {
+   case UP_DTYPE_UINT16:
+   case UP_DTYPE_INT16:
+      return 2;
+   case UP_DTYPE_UINT32:
+   case UP_DTYPE_INT32:
+   case UP_DTYPE_REAL32:
+      return 4;
+   default:
+      return 0;
+   }
+}
+
+int byteswap_plan_build (
+   byteswap_plan_t * plan,
+   const up_signal_t * signals,
+   uint16_t n,
+   const up_signal_info_t * vars,
+   const uint8_t * base)
+{
+   model_blob_swap_run_t * runs;
+   uint16_t n_fields = 0;
+   uint16_t n_runs = 0;
+
+   plan->runs = NULL;
+   plan->n_runs = 0;
+
+   for (uint16_t i = 0; i < n; i++)
+   {
+      n_fields += (field_width (signals[i].datatype) != 0);
+   }
+   if (n_fields == 0)
+   {
+      return 0;
+   }
+
+   runs = malloc (n_fields * sizeof (*runs));
+   if (runs == NULL)
+   {
+      return -1;
+   }
+
+   /* One run per field, sorted by offset */
+   for (uint16_t i = 0; i < n; i++)
+   {
+      model_blob_swap_run_t field = {
+         .offset = (const uint8_t *)vars[signals[i].ix].value - base,
+         .width = field_width (signals[i].datatype),
+         .count = 1,
+      };
+      uint16_t j = n_runs;
+
+      if (field.width == 0)
+      {
+         continue;
+      }
+      while (j > 0 && runs[j - 1].offset > field.offset)
+      {
+         runs[j] = runs[j - 1];
+         j--;
+      }
+      runs[j] = field;
+      n_runs++;
+   }
+
+   /* Merge consecutive fields of the same width */
+   n_fields = n_runs;
+   n_runs = 1;
+   for (uint16_t i = 1; i < n_fields; i++)
+   {
+      model_blob_swap_run_t * run = &runs[n_runs - 1];
+
+      if (
+         runs[i].width == run->width &&
+         runs[i].offset == run->offset + run->width * run->count)
+      {
+         run->count++;
+      }
+      else
+      {
+         runs[n_runs++] = runs[i];
+      }
+   }
+
+   plan->runs = runs;
+   plan->n_runs = n_runs;
+   return 0;
+}
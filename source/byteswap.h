@@ -0,0 +1,72 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef BYTESWAP_H_
+#define BYTESWAP_H_
+
+#include "model_blob.h"
+#include "up_types.h"
+
+#include <stdint.h>
+
+typedef enum byteswap_order
+{
+   /* Most significant byte first, e.g. Profinet and CC-Link */
+   BYTESWAP_BIG_ENDIAN,
+   /* 16-bit big endian words, least significant word first, e.g. Modbus
+    * registers of devices with swapped word order */
+   BYTESWAP_WORDS,
+} byteswap_order_t;
+
+/* Fields of the inputs or outputs of a slot that depend on byte order.
+ * The application uses plans for the up_frame shell command only. */
+typedef struct byteswap_plan
+{
+   const model_blob_swap_run_t * runs;
+   uint16_t n_runs;
+} byteswap_plan_t;
+
+/**
+ * Build a plan from signal descriptors, for models without plans in the
+ * blob. Runs are allocated from the heap.
+ *
+ * @param plan       Plan to build
+ * @param signals    Inputs or outputs of a slot
+ * @param n          Number of signals
+ * @param vars       Signal values and statuses
+ * @param base       Start of process image, run offsets are relative
+ *                   to this
+ * @return 0 on success, -1 if out of memory
+ */
+extern int byteswap_plan_build (
+   byteswap_plan_t * plan,
+   const up_signal_t * signals,
+   uint16_t n,
+   const up_signal_info_t * vars,
+   const uint8_t * base);
+
+/**
+ * Convert all fields of a plan between native (little endian) and the
+ * given byte order. Bytes outside the fields are not touched.
+ *
+ * @param plan       Plan
+ * @param dst        Destination process image, may be the same as src
+ * @param src        Source process image
+ * @param order      Byte order
+ */
+extern void byteswap_convert (
+   const byteswap_plan_t * plan,
+   uint8_t * dst,
+   const uint8_t * src,
+   byteswap_order_t order);
+
+#endif /* BYTESWAP_H_ */
@@ -0,0 +1,63 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * CM7 data cache and MPU configuration.
+ *
+ * The Ethernet MAC descriptors and frame buffers are accessed by DMA and
+ * are not cache maintained by the driver. They are collected in the
+ * .noncache section by the linker script and mapped as normal,
+ * non-cacheable memory by a dedicated MPU region, which allows the data
+ * cache to be enabled for the rest of the system.
+ */
+
+#include "cache_config.h"
+#include "cy_device.h"
+
+#include <stdint.h>
+
+/* Highest priority region, overrides any other mapping of the area */
+#define NONCACHE_MPU_REGION 15u
+
+/* Symbols exported by the linker */
+extern uint8_t __base_noncache_region;
+extern uint8_t __size_noncache_region;
+
+static uint32_t mpu_region_size (uint32_t size)
+{
+   /* MPU encodes a region size of 2^(n+1) bytes as n */
+   return (uint32_t)(31 - __builtin_clz (size)) - 1;
+}
+
+void cache_config_init (void)
+{
+   uint32_t base = (uint32_t)&__base_noncache_region;
+   uint32_t size = (uint32_t)&__size_noncache_region;
+
+   /* Flush anything written to the region through the cache (zero
+    * initialization at startup) before making it non-cacheable */
+   SCB_CleanInvalidateDCache();
+
+   ARM_MPU_Disable();
+   ARM_MPU_SetRegion (
+      ARM_MPU_RBAR (NONCACHE_MPU_REGION, base),
+      ARM_MPU_RASR (
+         1u,                  /* Execute never */
+         ARM_MPU_AP_FULL,     /* Read/write access */
+         1u,                  /* TEX=1, C=0, B=0: normal, non-cacheable */
+         1u,                  /* Shareable */
+         0u,                  /* Not cacheable */
+         0u,                  /* Not bufferable */
+         0x00u,               /* All subregions enabled */
+         mpu_region_size (size)));
+   ARM_MPU_Enable (MPU_CTRL_PRIVDEFENA_Msk);
+}
@@ -0,0 +1,24 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef CACHE_CONFIG_H_
+#define CACHE_CONFIG_H_
+
+/**
+ * Configure the MPU so that the Ethernet DMA region defined by the linker
+ * script (.noncache section) is excluded from the CM7 data cache.
+ *
+ * Must be called before the Ethernet interface is started.
+ */
+extern void cache_config_init (void);
+
+#endif /* CACHE_CONFIG_H_ */
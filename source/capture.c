@@ -0,0 +1,609 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Ethernet frame capture, see capture.h.
+ *
+ * Free of lwIP and RTOS dependencies so that it can be tested on a host,
+ * see bench/capture_bench.c. The hooks into lwIP, the clock and the
+ * exports are found in capture_net.c.
+ */
+
+#include "capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_ARP  0x0806
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERTYPE_QINQ 0x88A8
+#define ETHERTYPE_PN   0x8892
+#define ETHERTYPE_ECAT 0x88A4
+#define ETHERTYPE_LLDP 0x88CC
+#define ETHERTYPE_PTP  0x88F7
+
+#define IP_PROTO_TCP 6
+#define IP_PROTO_UDP 17
+
+#define VLAN_ANY 0xFFFF
+
+/* pcapng, see draft-ietf-opsawg-pcapng */
+#define PCAPNG_SHB           0x0A0D0D0A
+#define PCAPNG_IDB           0x00000001
+#define PCAPNG_EPB           0x00000006
+#define PCAPNG_BYTE_ORDER    0x1A2B3C4D
+#define PCAPNG_LINKTYPE_ETH  1
+#define PCAPNG_OPT_ENDOFOPT  0
+#define PCAPNG_OPT_TSRESOL   9 /* if_tsresol */
+#define PCAPNG_OPT_FLAGS     2 /* epb_flags */
+#define PCAPNG_TSRESOL_NS    9
+
+typedef struct frame_info
+{
+   uint16_t ethertype;
+   uint16_t vlan; /* VLAN_ANY if untagged */
+   int16_t proto; /* -1 if not IPv4 */
+   int32_t sport; /* -1 if not a TCP or UDP first fragment */
+   int32_t dport;
+} frame_info_t;
+
+static const struct
+{
+   const char * name;
+   uint16_t type;
+} ethertypes[] = {
+   {"ip", ETHERTYPE_IPV4},
+   {"arp", ETHERTYPE_ARP},
+   {"vlan", ETHERTYPE_VLAN},
+   {"pn", ETHERTYPE_PN},
+   {"ecat", ETHERTYPE_ECAT},
+   {"lldp", ETHERTYPE_LLDP},
+   {"ptp", ETHERTYPE_PTP},
+};
+
+static uint16_t get16 (const uint8_t * p)
+{
+   return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static bool parse_number (const char * s, uint32_t max, uint16_t * value)
+{
+   char * end;
+   unsigned long v = strtoul (s, &end, 0);
+
+   if (*s == '\0' || *end != '\0' || v > max)
+   {
+      return false;
+   }
+   *value = (uint16_t)v;
+   return true;
+}
+
+static bool parse_ethertype (const char * s, uint16_t * value)
+{
+   for (size_t i = 0; i < sizeof (ethertypes) / sizeof (ethertypes[0]); i++)
+   {
+      if (strcmp (s, ethertypes[i].name) == 0)
+      {
+         *value = ethertypes[i].type;
+         return true;
+      }
+   }
+   return parse_number (s, 0xFFFF, value);
+}
+
+int capture_filter_compile (capture_filter_t * f, int argc, char * argv[])
+{
+   int i = 0;
+
+   memset (f, 0, sizeof (*f));
+
+   while (i < argc)
+   {
+      capture_term_t term = {0};
+      const char * s;
+
+      if (strcmp (argv[i], "not") == 0)
+      {
+         term.negate = true;
+         i++;
+      }
+      if (i == argc || f->n_terms == CAPTURE_MAX_TERMS)
+      {
+         return -1;
+      }
+
+      s = argv[i++];
+      if (strcmp (s, "in") == 0 || strcmp (s, "out") == 0)
+      {
+         term.type = CAPTURE_TERM_DIR;
+         term.value = (s[0] == 'i') ? CAPTURE_IN : CAPTURE_OUT;
+      }
+      else if (strcmp (s, "vlan") == 0)
+      {
+         term.type = CAPTURE_TERM_VLAN;
+         term.value = VLAN_ANY;
+         if (i < argc && parse_number (argv[i], 4095, &term.value))
+         {
+            i++;
+         }
+      }
+      else if (strcmp (s, "ether") == 0)
+      {
+         term.type = CAPTURE_TERM_ETHER;
+         if (i == argc || !parse_ethertype (argv[i], &term.value))
+         {
+            return -1;
+         }
+         i++;
+      }
+      else if (strcmp (s, "ip") == 0 || strcmp (s, "arp") == 0)
+      {
+         term.type = CAPTURE_TERM_ETHER;
+         parse_ethertype (s, &term.value);
+      }
+      else if (strcmp (s, "tcp") == 0 || strcmp (s, "udp") == 0)
+      {
+         term.type = CAPTURE_TERM_PROTO;
+         term.value = (s[0] == 't') ? IP_PROTO_TCP : IP_PROTO_UDP;
+      }
+      else if (strcmp (s, "proto") == 0 || strcmp (s, "port") == 0)
+      {
+         term.type = (s[1] == 'r') ? CAPTURE_TERM_PROTO : CAPTURE_TERM_PORT;
+         if (
+            i == argc ||
+            !parse_number (
+               argv[i],
+               term.type == CAPTURE_TERM_PROTO ? 0xFF : 0xFFFF,
+               &term.value))
+         {
+            return -1;
+         }
+         i++;
+      }
+      else
+      {
+         return -1;
+      }
+
+      f->terms[f->n_terms++] = term;
+   }
+
+   return 0;
+}
+
+static void parse_frame (const uint8_t * p, uint16_t len, frame_info_t * info)
+{
+   uint16_t pos = 12;
+
+   info->ethertype = 0;
+   info->vlan = VLAN_ANY;
+   info->proto = -1;
+   info->sport = -1;
+   info->dport = -1;
+
+   if (len < 14)
+   {
+      return;
+   }
+
+   info->ethertype = get16 (p + pos);
+   while (
+      (info->ethertype == ETHERTYPE_VLAN ||
+       info->ethertype == ETHERTYPE_QINQ) &&
+      len >= pos + 6)
+   {
+      if (info->vlan == VLAN_ANY)
+      {
+         info->vlan = get16 (p + pos + 2) & 0x0FFF;
+      }
+      pos += 4;
+      info->ethertype = get16 (p + pos);
+   }
+   pos += 2;
+
+   if (info->ethertype == ETHERTYPE_IPV4 && len >= pos + 20)
+   {
+      const uint8_t * ip = p + pos;
+      uint16_t ihl = (ip[0] & 0x0F) * 4;
+      bool first_fragment = (get16 (ip + 6) & 0x1FFF) == 0;
+
+      info->proto = ip[9];
+      if (
+         (info->proto == IP_PROTO_TCP || info->proto == IP_PROTO_UDP) &&
+         first_fragment && len >= pos + ihl + 4)
+      {
+         info->sport = get16 (ip + ihl);
+         info->dport = get16 (ip + ihl + 2);
+      }
+   }
+}
+
+bool capture_filter_match (
+   const capture_filter_t * f,
+   const uint8_t * hdr,
+   uint16_t len,
+   uint8_t dir)
+{
+   frame_info_t info;
+   bool parsed = false;
+
+   for (uint8_t i = 0; i < f->n_terms; i++)
+   {
+      const capture_term_t * term = &f->terms[i];
+      bool match;
+
+      if (term->type != CAPTURE_TERM_DIR && !parsed)
+      {
+         parse_frame (hdr, len, &info);
+         parsed = true;
+      }
+
+      switch (term->type)
+      {
+      case CAPTURE_TERM_DIR:
+         match = dir == term->value;
+         break;
+      case CAPTURE_TERM_ETHER:
+         match = info.ethertype == term->value;
+         break;
+      case CAPTURE_TERM_VLAN:
+         match = info.vlan != VLAN_ANY &&
+                 (term->value == VLAN_ANY || info.vlan == term->value);
+         break;
+      case CAPTURE_TERM_PROTO:
+         match = info.proto == term->value;
+         break;
+      case CAPTURE_TERM_PORT:
+         match = info.sport == term->value || info.dport == term->value;
+         break;
+      default:
+         match = false;
+         break;
+      }
+
+      if (match == term->negate)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+int capture_set_snaplen (capture_t * c, uint16_t snaplen)
+{
+   uint16_t slot_size = (sizeof (capture_slot_t) + snaplen + 3) & ~3u;
+
+   if (
+      c->state == CAPTURE_RUNNING || snaplen < CAPTURE_MIN_SNAPLEN ||
+      snaplen > CAPTURE_MAX_SNAPLEN || c->size / slot_size < 2)
+   {
+      return -1;
+   }
+
+   c->snaplen = snaplen;
+   c->slot_size = slot_size;
+   c->n_slots = c->size / slot_size;
+   c->head = 0;
+   return 0;
+}
+
+int capture_init (
+   capture_t * c,
+   void * buf,
+   uint32_t size,
+   capture_clock_t clock,
+   uint32_t clock_hz,
+   uint16_t snaplen)
+{
+   memset (c, 0, sizeof (*c));
+   c->buf = buf;
+   c->size = size;
+   c->clock = clock;
+   c->clock_hz = clock_hz;
+   return capture_set_snaplen (c, snaplen);
+}
+
+static capture_slot_t * slot (const capture_t * c, uint32_t ix)
+{
+   return (capture_slot_t *)(c->buf + (ix % c->n_slots) * c->slot_size);
+}
+
+int capture_start (capture_t * c, const capture_filter_t * filter, bool once)
+{
+   if (c->state == CAPTURE_RUNNING)
+   {
+      return -1;
+   }
+
+   for (uint16_t i = 0; i < c->n_slots; i++)
+   {
+      slot (c, i)->seq = 0;
+   }
+   c->filter = *filter;
+   c->once = once;
+   c->head = 0;
+   c->seen = 0;
+   c->captured = 0;
+   c->dropped = 0;
+   __atomic_store_n (&c->state, CAPTURE_RUNNING, __ATOMIC_RELEASE);
+   return 0;
+}
+
+void capture_stop (capture_t * c)
+{
+   if (c->state == CAPTURE_RUNNING)
+   {
+      c->state = CAPTURE_STOPPED;
+   }
+}
+
+void capture_frame (
+   capture_t * c,
+   const uint8_t * hdr,
+   uint16_t hdr_len,
+   uint16_t len,
+   uint8_t dir,
+   capture_copy_t copy,
+   const void * frame)
+{
+   capture_slot_t * s;
+   uint32_t ix;
+   uint32_t ms;
+   uint16_t caplen;
+
+   if (c->state == CAPTURE_STOPPED)
+   {
+      return;
+   }
+
+   __atomic_fetch_add (&c->seen, 1, __ATOMIC_RELAXED);
+   if (!capture_filter_match (&c->filter, hdr, hdr_len, dir))
+   {
+      return;
+   }
+
+   ix = __atomic_fetch_add (&c->head, 1, __ATOMIC_RELAXED);
+   if (c->once && ix >= c->n_slots)
+   {
+      __atomic_fetch_add (&c->dropped, 1, __ATOMIC_RELAXED);
+      c->state = CAPTURE_FULL;
+      return;
+   }
+
+   /* Invalidate before overwriting, an export skips the slot */
+   s = slot (c, ix);
+   s->seq = 0;
+   __atomic_signal_fence (__ATOMIC_SEQ_CST);
+
+   caplen = (len < c->snaplen) ? len : c->snaplen;
+   s->cycles = c->clock (&ms);
+   s->ms = ms;
+   s->len = len;
+   s->caplen = caplen;
+   s->dir = dir;
+   if (copy != NULL)
+   {
+      copy (s->data, frame, caplen);
+   }
+   else
+   {
+      memcpy (s->data, hdr, (caplen < hdr_len) ? caplen : hdr_len);
+   }
+
+   __atomic_store_n (&s->seq, ix + 1, __ATOMIC_RELEASE);
+   __atomic_fetch_add (&c->captured, 1, __ATOMIC_RELAXED);
+}
+
+/* Range of frame indices in the ring */
+static void range (const capture_t * c, uint32_t * first, uint32_t * end)
+{
+   *end = c->head;
+   if (c->once && *end > c->n_slots)
+   {
+      *end = c->n_slots;
+   }
+   *first = (*end > c->n_slots) ? *end - c->n_slots : 0;
+}
+
+uint32_t capture_count (const capture_t * c)
+{
+   uint32_t first;
+   uint32_t end;
+   uint32_t n = 0;
+
+   range (c, &first, &end);
+   for (uint32_t ix = first; ix != end; ix++)
+   {
+      n += (slot (c, ix)->seq == ix + 1) ? 1 : 0;
+   }
+   return n;
+}
+
+/* Block builder, all fields in host byte order as allowed by pcapng */
+static uint8_t * put32 (uint8_t * p, uint32_t v)
+{
+   memcpy (p, &v, 4);
+   return p + 4;
+}
+
+static uint8_t * put16 (uint8_t * p, uint16_t v)
+{
+   memcpy (p, &v, 2);
+   return p + 2;
+}
+
+static uint16_t finish_block (uint8_t * block, uint8_t * p)
+{
+   uint32_t len = (uint32_t)(p - block) + 4;
+
+   put32 (block + 4, len);
+   put32 (p, len);
+   return (uint16_t)len;
+}
+
+static uint16_t stage_header (const capture_t * c, uint8_t * block)
+{
+   uint8_t * shb = block;
+   uint8_t * idb;
+   uint8_t * p;
+
+   p = put32 (shb, PCAPNG_SHB);
+   p += 4;
+   p = put32 (p, PCAPNG_BYTE_ORDER);
+   p = put16 (p, 1);
+   p = put16 (p, 0);
+   p = put32 (p, 0xFFFFFFFF); /* Section length not specified */
+   p = put32 (p, 0xFFFFFFFF);
+   idb = block + finish_block (shb, p);
+
+   p = put32 (idb, PCAPNG_IDB);
+   p += 4;
+   p = put16 (p, PCAPNG_LINKTYPE_ETH);
+   p = put16 (p, 0);
+   p = put32 (p, c->snaplen);
+   p = put16 (p, PCAPNG_OPT_TSRESOL);
+   p = put16 (p, 1);
+   *p++ = PCAPNG_TSRESOL_NS;
+   memset (p, 0, 3); /* Padding */
+   p += 3;
+   p = put32 (p, PCAPNG_OPT_ENDOFOPT);
+   return (uint16_t)(idb + finish_block (idb, p) - block);
+}
+
+/* Time since boot of a frame, given the previous frame */
+static void timestamp (
+   const capture_t * c,
+   capture_reader_t * rd,
+   uint32_t frame_cycles,
+   uint32_t frame_ms)
+{
+   uint64_t cycles = (uint32_t)(frame_cycles - rd->cycles);
+
+   if (rd->first)
+   {
+      rd->ns = (uint64_t)frame_ms * 1000000u;
+      rd->first = false;
+   }
+   else
+   {
+      /* Count the wraparounds of the cycle counter from the tick */
+      uint64_t expected = (uint64_t)(uint32_t)(frame_ms - rd->ms) *
+                          (c->clock_hz / 1000u);
+
+      if (expected > cycles)
+      {
+         cycles += ((expected - cycles + (1ull << 31)) >> 32) << 32;
+      }
+      rd->ns += (cycles / c->clock_hz) * 1000000000u +
+                (cycles % c->clock_hz) * 1000000000u / c->clock_hz;
+   }
+   rd->cycles = frame_cycles;
+   rd->ms = frame_ms;
+}
+
+/* Stage the next complete frame, return 0 at the end */
+static uint16_t stage_frame (
+   const capture_t * c,
+   capture_reader_t * rd,
+   uint8_t * block)
+{
+   while (rd->next != rd->end)
+   {
+      const capture_slot_t * s = slot (c, rd->next);
+      uint32_t ix = rd->next++;
+      uint16_t caplen = s->caplen;
+      uint32_t cycles = s->cycles;
+      uint32_t ms = s->ms;
+      uint16_t len = s->len;
+      uint8_t dir = s->dir;
+      uint8_t * p;
+
+      if (s->seq != ix + 1 || caplen > c->snaplen)
+      {
+         continue;
+      }
+
+      p = put32 (block, PCAPNG_EPB);
+      p += 4;
+      p = put32 (p, 0); /* Interface */
+      p += 8;           /* Timestamp, below */
+      p = put32 (p, caplen);
+      p = put32 (p, len);
+      memcpy (p, s->data, caplen);
+      memset (p + caplen, 0, (4 - (caplen & 3)) & 3);
+      p += (caplen + 3) & ~3u;
+      p = put16 (p, PCAPNG_OPT_FLAGS);
+      p = put16 (p, 4);
+      p = put32 (p, dir & 3);
+      p = put32 (p, PCAPNG_OPT_ENDOFOPT);
+
+      /* Overwritten while copied, not expected while stopped */
+      if (s->seq != ix + 1)
+      {
+         continue;
+      }
+
+      timestamp (c, rd, cycles, ms);
+      put32 (block + 12, (uint32_t)(rd->ns >> 32));
+      put32 (block + 16, (uint32_t)rd->ns);
+      return finish_block (block, p);
+   }
+   return 0;
+}
+
+void capture_read_start (const capture_t * c, capture_reader_t * rd)
+{
+   uint32_t first;
+
+   memset (rd, 0, sizeof (*rd));
+   range (c, &first, &rd->end);
+   rd->next = first;
+   rd->first = true;
+   rd->len = stage_header (c, (uint8_t *)rd->block);
+}
+
+size_t capture_read (
+   const capture_t * c,
+   capture_reader_t * rd,
+   void * buf,
+   size_t size)
+{
+   uint8_t * dst = buf;
+   size_t n = 0;
+
+   while (n < size)
+   {
+      size_t chunk;
+
+      if (rd->pos == rd->len)
+      {
+         rd->pos = 0;
+         rd->len = stage_frame (c, rd, (uint8_t *)rd->block);
+         if (rd->len == 0)
+         {
+            break;
+         }
+      }
+
+      chunk = rd->len - rd->pos;
+      if (chunk > size - n)
+      {
+         chunk = size - n;
+      }
+      memcpy (dst + n, (uint8_t *)rd->block + rd->pos, chunk);
+      rd->pos += chunk;
+      n += chunk;
+   }
+   return n;
+}
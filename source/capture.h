@@ -0,0 +1,273 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Capture of Ethernet frames into a RAM ring, exported as pcapng.
+ *
+ * Each frame that passes the filter is truncated to the snap length and
+ * copied into a fixed size slot together with the cycle counter and
+ * the millisecond tick. A slot is claimed with an atomic increment and
+ * marked complete when written, so frames may be captured from tasks
+ * and interrupts alike without locking. In ring mode the oldest frame
+ * is overwritten, in once mode capturing stops when the ring is full.
+ *
+ * The filter is evaluated on the first CAPTURE_HDR_LEN bytes of the
+ * frame, before anything is copied, so frames that do not match cost
+ * a few comparisons only.
+ *
+ * Timestamps are the time since boot. The cycle counter gives the
+ * resolution and the tick is used to count its wraparounds, which is
+ * correct as long as the tick is accurate to half a wraparound.
+ */
+
+#define CAPTURE_MAX_SNAPLEN 256
+#define CAPTURE_MIN_SNAPLEN 14
+#define CAPTURE_HDR_LEN     64 /* Bytes needed by the filter */
+#define CAPTURE_MAX_TERMS   8
+
+typedef enum capture_dir
+{
+   CAPTURE_IN = 1, /* Same as the pcapng epb_flags direction */
+   CAPTURE_OUT = 2,
+} capture_dir_t;
+
+typedef enum capture_state
+{
+   CAPTURE_STOPPED,
+   CAPTURE_RUNNING,
+   CAPTURE_FULL, /* Once mode, ring full */
+} capture_state_t;
+
+typedef enum capture_term_type
+{
+   CAPTURE_TERM_ETHER, /* EtherType, after any VLAN tags */
+   CAPTURE_TERM_VLAN,  /* VLAN tagged, with id unless value is 0xFFFF */
+   CAPTURE_TERM_PROTO, /* IPv4 protocol */
+   CAPTURE_TERM_PORT,  /* TCP or UDP source or destination port */
+   CAPTURE_TERM_DIR,   /* capture_dir_t */
+} capture_term_type_t;
+
+typedef struct capture_term
+{
+   uint8_t type; /* capture_term_type_t */
+   bool negate;
+   uint16_t value;
+} capture_term_t;
+
+/* All terms must match, an empty filter matches all frames */
+typedef struct capture_filter
+{
+   uint8_t n_terms;
+   capture_term_t terms[CAPTURE_MAX_TERMS];
+} capture_filter_t;
+
+/* Start of each slot, followed by the frame */
+typedef struct capture_slot
+{
+   volatile uint32_t seq; /* Frame index + 1 when complete */
+   uint32_t cycles;
+   uint32_t ms;
+   uint16_t len; /* Length on the wire, without FCS */
+   uint16_t caplen;
+   uint8_t dir; /* capture_dir_t */
+   uint8_t reserved[3];
+   uint8_t data[];
+} capture_slot_t;
+
+/* Cycle counter and millisecond tick */
+typedef uint32_t (*capture_clock_t) (uint32_t * ms);
+
+/* Copy n bytes from the start of the frame */
+typedef void (*capture_copy_t) (void * dst, const void * frame, uint16_t n);
+
+typedef struct capture
+{
+   /* Constant after init */
+   uint8_t * buf;
+   uint32_t size;
+   uint32_t clock_hz;
+   capture_clock_t clock;
+
+   /* Set while stopped */
+   uint16_t snaplen;
+   uint16_t slot_size;
+   uint16_t n_slots;
+   bool once;
+   capture_filter_t filter;
+
+   /* Updated by capture_frame() */
+   volatile uint8_t state; /* capture_state_t */
+   uint32_t head;          /* Frames claimed */
+   uint32_t seen;
+   uint32_t captured;
+   uint32_t dropped; /* Once mode, matched while full */
+} capture_t;
+
+/* pcapng export state, see capture_read_start() */
+typedef struct capture_reader
+{
+   uint32_t next; /* Frame index */
+   uint32_t end;
+   bool first;
+   uint32_t cycles;
+   uint32_t ms;
+   uint64_t ns;
+   uint16_t pos; /* Staged block */
+   uint16_t len;
+   uint32_t block[(32 + CAPTURE_MAX_SNAPLEN + 16) / 4];
+} capture_reader_t;
+
+/**
+ * Initialise capture.
+ *
+ * @param c          Capture
+ * @param buf        Ring buffer, 32-bit aligned
+ * @param size       Size of buffer
+ * @param clock      Clock read when a frame is captured
+ * @param clock_hz   Frequency of the cycle counter
+ * @param snaplen    Bytes kept of each frame
+ * @return 0 on success, -1 if the buffer is too small or snaplen invalid
+ */
+extern int capture_init (
+   capture_t * c,
+   void * buf,
+   uint32_t size,
+   capture_clock_t clock,
+   uint32_t clock_hz,
+   uint16_t snaplen);
+
+/**
+ * Change the snap length. Only while stopped, discards the capture.
+ *
+ * @return 0 on success, -1 if busy or invalid
+ */
+extern int capture_set_snaplen (capture_t * c, uint16_t snaplen);
+
+/**
+ * Compile a filter from shell arguments. Terms are ANDed and each may
+ * be preceded by "not":
+ *   in | out | vlan [<id>] | ether <type> | ip | arp | tcp | udp |
+ *   proto <n> | port <n>
+ * where <type> is a number or one of ip, arp, vlan, pn, ecat, lldp,
+ * ptp.
+ *
+ * @param f          Compiled filter
+ * @param argc       Number of arguments
+ * @param argv       Arguments
+ * @return 0 on success, -1 if invalid
+ */
+extern int capture_filter_compile (
+   capture_filter_t * f,
+   int argc,
+   char * argv[]);
+
+/**
+ * Test a frame against a filter.
+ *
+ * @param f          Compiled filter
+ * @param hdr        Start of frame
+ * @param len        Bytes available at hdr, CAPTURE_HDR_LEN is enough
+ * @param dir        capture_dir_t
+ * @return true if the frame matches
+ */
+extern bool capture_filter_match (
+   const capture_filter_t * f,
+   const uint8_t * hdr,
+   uint16_t len,
+   uint8_t dir);
+
+/**
+ * Start capturing. Only while stopped, discards the capture.
+ *
+ * @param c          Capture
+ * @param filter     Filter, copied
+ * @param once       Stop when full instead of overwriting
+ * @return 0 on success, -1 if busy
+ */
+extern int capture_start (
+   capture_t * c,
+   const capture_filter_t * filter,
+   bool once);
+
+/**
+ * Stop capturing, keeping what is captured.
+ */
+extern void capture_stop (capture_t * c);
+
+/**
+ * True while capturing.
+ */
+static inline bool capture_active (const capture_t * c)
+{
+   return c->state == CAPTURE_RUNNING;
+}
+
+/**
+ * Capture a frame if capturing and the frame matches the filter. May
+ * be called from interrupts. Frames that match while the ring is full in
+ * once mode are counted as dropped.
+ *
+ * @param c          Capture
+ * @param hdr        Start of frame, contiguous
+ * @param hdr_len    Bytes available at hdr
+ * @param len        Length of frame
+ * @param dir        capture_dir_t
+ * @param copy       Copies the frame, NULL to copy from hdr
+ * @param frame      Passed to copy
+ */
+extern void capture_frame (
+   capture_t * c,
+   const uint8_t * hdr,
+   uint16_t hdr_len,
+   uint16_t len,
+   uint8_t dir,
+   capture_copy_t copy,
+   const void * frame);
+
+/**
+ * Number of complete frames in the ring. Only while stopped.
+ */
+extern uint32_t capture_count (const capture_t * c);
+
+/**
+ * Start the pcapng export of the captured frames, oldest first. Only
+ * while stopped.
+ *
+ * @param c          Capture
+ * @param rd         Export state
+ */
+extern void capture_read_start (const capture_t * c, capture_reader_t * rd);
+
+/**
+ * Read the next part of the pcapng export. The buffer is filled
+ * completely unless the end is reached.
+ *
+ * @param c          Capture
+ * @param rd         Export state
+ * @param buf        Buffer
+ * @param size       Size of buffer
+ * @return bytes read, 0 at the end
+ */
+extern size_t capture_read (
+   const capture_t * c,
+   capture_reader_t * rd,
+   void * buf,
+   size_t size);
+
+#endif /* CAPTURE_H_ */
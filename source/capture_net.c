@@ -0,0 +1,387 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Ethernet frame capture on the default netif.
+ *
+ * Frames are passed to source/capture.c by the capture hook in
+ * lwip/lwip_hooks.c, on receive before tcpip_input() and on send before
+ * the driver. The 'capture' shell command starts and stops capturing
+ * and exports the ring as pcapng to the shell, to littlefs or over TFTP.
+ * Exporting stops a running capture.
+ *
+ * The Ethernet driver does not pass the hardware timestamps of the MAC
+ * to lwIP, so frames are stamped in software when the hook is called.
+ */
+
+#include "capture_net.h"
+#include "capture.h"
+#include "cycle_stats.h"
+#include "shell.h"
+
+#include "lwip/apps/tftp_server.h"
+#include "lwip/lwip_hooks.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcpip.h"
+#include "rte_fs.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Bytes per line of 'capture dump' */
+#define DUMP_LINE 32
+
+static uint32_t capture_buf[CAPTURE_NET_BUFFER_SIZE / sizeof (uint32_t)];
+static capture_t capture;
+static char filter_text[64];
+
+static capture_reader_t tftp_reader;
+static bool tftp_started;
+static bool tftp_busy;
+static uint32_t tftp_transfers;
+
+static uint32_t capture_clock (uint32_t * ms)
+{
+   *ms = xTaskGetTickCountFromISR() * portTICK_PERIOD_MS;
+   return cycle_stats_now();
+}
+
+static void capture_copy (void * dst, const void * frame, uint16_t n)
+{
+   pbuf_copy_partial ((const struct pbuf *)frame, dst, n, 0);
+}
+
+static void capture_hook (struct pbuf * p, struct netif * netif, u8_t dir)
+{
+   uint8_t hdr[CAPTURE_HDR_LEN];
+   const uint8_t * start = p->payload;
+   uint16_t len = p->len;
+
+   if (capture.state == CAPTURE_STOPPED)
+   {
+      return;
+   }
+
+   /* Sent frames are a single pbuf, received ones normally too */
+   if (len < CAPTURE_HDR_LEN && p->tot_len > p->len)
+   {
+      len = pbuf_copy_partial (p, hdr, sizeof (hdr), 0);
+      start = hdr;
+   }
+   capture_frame (&capture, start, len, p->tot_len, dir, capture_copy, p);
+}
+
+static void capture_halt (void)
+{
+   if (capture_active (&capture))
+   {
+      capture_stop (&capture);
+      printf ("Capture stopped\n");
+   }
+}
+
+/* TFTP callbacks, called by the tcpip thread */
+static void * tftp_open (const char * fname, const char * mode, u8_t write)
+{
+   if (write || tftp_busy || strcmp (fname, CAPTURE_NET_TFTP_FILE) != 0)
+   {
+      return NULL;
+   }
+
+   capture_stop (&capture);
+   capture_read_start (&capture, &tftp_reader);
+   tftp_busy = true;
+   tftp_transfers++;
+   return &tftp_reader;
+}
+
+static void tftp_close (void * handle)
+{
+   tftp_busy = false;
+}
+
+static int tftp_read (void * handle, void * buf, int bytes)
+{
+   return (int)capture_read (&capture, handle, buf, bytes);
+}
+
+static int tftp_write (void * handle, struct pbuf * p)
+{
+   return -1;
+}
+
+static const struct tftp_context tftp_ctx = {
+   .open = tftp_open,
+   .close = tftp_close,
+   .read = tftp_read,
+   .write = tftp_write,
+};
+
+static int capture_tftp_start (void)
+{
+   err_t error;
+
+   if (tftp_started)
+   {
+      return 0;
+   }
+
+   LOCK_TCPIP_CORE();
+   error = tftp_init (&tftp_ctx);
+   UNLOCK_TCPIP_CORE();
+
+   if (error != ERR_OK)
+   {
+      printf ("Failed to start TFTP server\n");
+      return -1;
+   }
+   tftp_started = true;
+   return 0;
+}
+
+static void capture_show (void)
+{
+   static const char * states[] = {"stopped", "running", "full"};
+
+   printf (
+      "Capture          : %s, %s\n",
+      states[capture.state],
+      capture.once ? "once" : "ring");
+   printf (
+      "Filter           : %s\n",
+      filter_text[0] != '\0' ? filter_text : "all frames");
+   printf (
+      "Snap length      : %u bytes, %u frames\n",
+      capture.snaplen,
+      capture.n_slots);
+   printf (
+      "Frames           : %" PRIu32 " seen, %" PRIu32 " captured, %" PRIu32
+      " dropped\n",
+      capture.seen,
+      capture.captured,
+      capture.dropped);
+   if (!capture_active (&capture))
+   {
+      printf ("In ring          : %" PRIu32 "\n", capture_count (&capture));
+   }
+   if (tftp_started)
+   {
+      printf (
+         "TFTP             : %s, %" PRIu32 " transfers\n",
+         CAPTURE_NET_TFTP_FILE,
+         tftp_transfers);
+   }
+}
+
+static int capture_start_args (int argc, char * argv[])
+{
+   capture_filter_t filter;
+   uint16_t snaplen = capture.snaplen;
+   bool once = false;
+   int i = 2;
+   int len = 0;
+
+   if (tftp_busy)
+   {
+      printf ("TFTP transfer in progress\n");
+      return -1;
+   }
+
+   if (i < argc && strcmp (argv[i], "once") == 0)
+   {
+      once = true;
+      i++;
+   }
+   if (i + 1 < argc && strcmp (argv[i], "snap") == 0)
+   {
+      snaplen = strtoul (argv[i + 1], NULL, 0);
+      i += 2;
+   }
+   if (capture_filter_compile (&filter, argc - i, &argv[i]) != 0)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   capture_stop (&capture);
+   if (capture_set_snaplen (&capture, snaplen) != 0)
+   {
+      printf (
+         "Snap length must be %d to %d bytes\n",
+         CAPTURE_MIN_SNAPLEN,
+         CAPTURE_MAX_SNAPLEN);
+      return -1;
+   }
+
+   filter_text[0] = '\0';
+   for (; i < argc && len < (int)sizeof (filter_text); i++)
+   {
+      len += snprintf (
+         filter_text + len,
+         sizeof (filter_text) - len,
+         "%s%s",
+         len ? " " : "",
+         argv[i]);
+   }
+
+   return capture_start (&capture, &filter, once);
+}
+
+static void capture_dump (void)
+{
+   static capture_reader_t rd;
+   uint8_t line[DUMP_LINE];
+   size_t n;
+
+   capture_read_start (&capture, &rd);
+   while ((n = capture_read (&capture, &rd, line, sizeof (line))) != 0)
+   {
+      for (size_t i = 0; i < n; i++)
+      {
+         printf ("%02x", line[i]);
+      }
+      printf ("\n");
+   }
+}
+
+static int capture_save (const char * file)
+{
+   static capture_reader_t rd;
+   static uint8_t chunk[512];
+   RTE_FILE * f;
+   size_t n;
+   int error = 0;
+
+   f = rte_fs_fopen (file, "w");
+   if (f == NULL)
+   {
+      printf ("Failed to open %s\n", file);
+      return -1;
+   }
+
+   capture_read_start (&capture, &rd);
+   while ((n = capture_read (&capture, &rd, chunk, sizeof (chunk))) != 0)
+   {
+      if (rte_fs_fwrite (chunk, 1, n, f) != n)
+      {
+         error = -1;
+         break;
+      }
+   }
+
+   rte_fs_fclose (f);
+   if (error != 0)
+   {
+      printf ("Failed to write %s\n", file);
+      rte_fs_remove (file);
+   }
+   return error;
+}
+
+int capture_net_init (void)
+{
+   if (
+      capture_init (
+         &capture,
+         capture_buf,
+         sizeof (capture_buf),
+         capture_clock,
+         SystemCoreClock,
+         CAPTURE_NET_SNAPLEN) != 0 ||
+      netif_default == NULL)
+   {
+      return -1;
+   }
+
+   LOCK_TCPIP_CORE();
+   lwip_set_hook_for_capture (netif_default, capture_hook);
+   UNLOCK_TCPIP_CORE();
+   return 0;
+}
+
+static int _cmd_capture (int argc, char * argv[])
+{
+   if (capture.buf == NULL)
+   {
+      printf ("Network not started\n");
+      return -1;
+   }
+
+   if (argc == 1)
+   {
+      capture_show();
+      return 0;
+   }
+
+   if (strcmp (argv[1], "start") == 0)
+   {
+      if (capture_start_args (argc, argv) != 0)
+      {
+         return -1;
+      }
+   }
+   else if (strcmp (argv[1], "stop") == 0 && argc == 2)
+   {
+      capture_stop (&capture);
+   }
+   else if (strcmp (argv[1], "dump") == 0 && argc == 2)
+   {
+      capture_halt();
+      capture_dump();
+      return 0;
+   }
+   else if (strcmp (argv[1], "save") == 0 && argc == 3)
+   {
+      capture_halt();
+      return capture_save (argv[2]);
+   }
+   else if (strcmp (argv[1], "tftp") == 0 && argc == 2)
+   {
+      if (capture_tftp_start() != 0)
+      {
+         return -1;
+      }
+   }
+   else
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   capture_show();
+   return 0;
+}
+
+const shell_cmd_t cmd_capture = {
+   .cmd = _cmd_capture,
+   .name = "capture",
+   .help_short = "capture Ethernet frames",
+   .help_long =
+      "Capture received and sent Ethernet frames, truncated to the snap\n"
+      "length, into a RAM ring. The ring keeps the latest frames, or the\n"
+      "first ones with 'once'. The filter terms are ANDed, each may be\n"
+      "preceded by 'not'. Export as pcapng: 'dump' prints hex, convert\n"
+      "with 'xxd -r -p', 'save' writes a file and 'tftp' serves\n"
+      CAPTURE_NET_TFTP_FILE ". Exporting stops the capture.\n"
+      "Usage: capture [stop | dump | save <file> | tftp]\n"
+      "       capture start [once] [snap <bytes>] [<filter>...]\n"
+      "Filter: in | out | vlan [<id>] | ether <type> | ip | arp | tcp |\n"
+      "        udp | proto <n> | port <n>\n"
+      "Types : <n> | ip | arp | vlan | pn | ecat | lldp | ptp\n"};
+
+SHELL_CMD (cmd_capture);
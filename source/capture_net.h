@@ -0,0 +1,33 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef CAPTURE_NET_H_
+#define CAPTURE_NET_H_
+
+/* RAM ring for captured frames */
+#define CAPTURE_NET_BUFFER_SIZE (32 * 1024)
+#define CAPTURE_NET_SNAPLEN     96
+
+/* Served by 'capture tftp' */
+#define CAPTURE_NET_TFTP_FILE "capture.pcapng"
+
+/**
+ * Hook frame capture into the default netif. Nothing is captured until
+ * started by the 'capture' shell command.
+ *
+ * Must be called after the network is connected.
+ *
+ * @return 0 on success, -1 on error
+ */
+extern int capture_net_init (void);
+
+#endif /* CAPTURE_NET_H_ */
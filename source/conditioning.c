@@ -0,0 +1,236 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Signal conditioning of analog inputs.
+ *
+ * Channel parameters and state are kept in separate arrays so that each
+ * step is one CMSIS-DSP vector call over all channels, or over the
+ * channels of one filter kind, instead of a per channel switch.
+ *
+ * On the host the vector operations are plain loops, see
+ * bench/conditioning_bench.c.
+ */
+
+#include "conditioning.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__arm__)
+#include "arm_math.h"
+
+#define vec_mul(a, b, dst, n)   arm_mult_f32 (a, b, dst, n)
+#define vec_add(a, b, dst, n)   arm_add_f32 (a, b, dst, n)
+#define vec_sub(a, b, dst, n)   arm_sub_f32 (a, b, dst, n)
+#define vec_scale(a, s, dst, n) arm_scale_f32 (a, s, dst, n)
+#else
+static void vec_mul (const float * a, const float * b, float * dst, uint32_t n)
+{
+   for (uint32_t i = 0; i < n; i++)
+   {
+      dst[i] = a[i] * b[i];
+   }
+}
+
+static void vec_add (const float * a, const float * b, float * dst, uint32_t n)
+{
+   for (uint32_t i = 0; i < n; i++)
+   {
+      dst[i] = a[i] + b[i];
+   }
+}
+
+static void vec_sub (const float * a, const float * b, float * dst, uint32_t n)
+{
+   for (uint32_t i = 0; i < n; i++)
+   {
+      dst[i] = a[i] - b[i];
+   }
+}
+
+static void vec_scale (const float * a, float s, float * dst, uint32_t n)
+{
+   for (uint32_t i = 0; i < n; i++)
+   {
+      dst[i] = a[i] * s;
+   }
+}
+#endif
+
+/* Clamp to per channel limits. CMSIS-DSP only clips to common limits,
+ * this loop compiles to compares and VSEL on the FPU. */
+static void clamp (
+   float * x,
+   const float * min,
+   const float * max,
+   uint32_t n)
+{
+   for (uint32_t i = 0; i < n; i++)
+   {
+      float v = x[i];
+
+      v = (v < min[i]) ? min[i] : v;
+      v = (v > max[i]) ? max[i] : v;
+      x[i] = v;
+   }
+}
+
+int conditioning_init (
+   conditioning_t * c,
+   uint16_t n_iir,
+   uint16_t n_avg,
+   uint16_t n_none,
+   uint16_t window)
+{
+   uint32_t n = n_iir + n_avg + n_none;
+   float * mem;
+
+   memset (c, 0, sizeof (*c));
+   if (n == 0)
+   {
+      return 0;
+   }
+   if (window == 0)
+   {
+      window = 1;
+   }
+
+   /* raw, value, gain, offset, min, max, alpha, scratch, sum, history */
+   mem = calloc (8 * n + n_avg + (uint32_t)window * n_avg, sizeof (float));
+   c->output = calloc (n, sizeof (*c->output));
+   if (mem == NULL || c->output == NULL)
+   {
+      free (mem);
+      free (c->output);
+      c->output = NULL;
+      return -1;
+   }
+
+   c->n = n;
+   c->n_iir = n_iir;
+   c->n_avg = n_avg;
+   c->window = window;
+
+   c->raw = mem;
+   c->value = c->raw + n;
+   c->gain = c->value + n;
+   c->offset = c->gain + n;
+   c->min = c->offset + n;
+   c->max = c->min + n;
+   c->alpha = c->max + n;
+   c->scratch = c->alpha + n;
+   c->sum = c->scratch + n;
+   c->history = c->sum + n_avg;
+   return 0;
+}
+
+void conditioning_set (
+   conditioning_t * c,
+   uint16_t i,
+   const conditioning_channel_t * cfg,
+   float * output)
+{
+   c->gain[i] = cfg->gain;
+   c->offset[i] = cfg->offset;
+   c->min[i] = cfg->min;
+   c->max[i] = cfg->max;
+   c->alpha[i] = cfg->alpha;
+   c->output[i] = output;
+   c->primed = false;
+}
+
+/* Start filters from the first sample instead of from 0 */
+static void prime (conditioning_t * c, const float * x)
+{
+   const float * avg = x + c->n_iir;
+
+   memcpy (c->value, x, c->n * sizeof (float));
+   for (uint16_t row = 0; row < c->window; row++)
+   {
+      memcpy (&c->history[row * c->n_avg], avg, c->n_avg * sizeof (float));
+   }
+   vec_scale (avg, c->window, c->sum, c->n_avg);
+   c->pos = 0;
+   c->primed = true;
+}
+
+static void run_avg (conditioning_t * c, const float * x)
+{
+   float * row = &c->history[c->pos * c->n_avg];
+   float * value = c->value + c->n_iir;
+
+   /* sum += x - oldest, then x replaces oldest */
+   vec_sub (x, row, value, c->n_avg);
+   vec_add (c->sum, value, c->sum, c->n_avg);
+   memcpy (row, x, c->n_avg * sizeof (float));
+
+   if (++c->pos == c->window)
+   {
+      /* Recompute sums once per window so rounding errors do not build
+       * up */
+      c->pos = 0;
+      memcpy (c->sum, c->history, c->n_avg * sizeof (float));
+      for (uint16_t i = 1; i < c->window; i++)
+      {
+         vec_add (c->sum, &c->history[i * c->n_avg], c->sum, c->n_avg);
+      }
+   }
+
+   vec_scale (c->sum, 1.0f / c->window, value, c->n_avg);
+}
+
+void conditioning_run (conditioning_t * c)
+{
+   float * x = c->scratch;
+   uint32_t n_filtered = c->n_iir + c->n_avg;
+
+   if (c->n == 0)
+   {
+      return;
+   }
+
+   vec_mul (c->raw, c->gain, x, c->n);
+   vec_add (x, c->offset, x, c->n);
+   clamp (x, c->min, c->max, c->n);
+
+   if (!c->primed)
+   {
+      prime (c, x);
+   }
+
+   if (c->n_iir > 0)
+   {
+      /* value += alpha * (x - value), x is not needed afterwards */
+      vec_sub (x, c->value, x, c->n_iir);
+      vec_mul (x, c->alpha, x, c->n_iir);
+      vec_add (c->value, x, c->value, c->n_iir);
+   }
+
+   if (c->n_avg > 0)
+   {
+      run_avg (c, x + c->n_iir);
+   }
+
+   memcpy (
+      c->value + n_filtered,
+      x + n_filtered,
+      (c->n - n_filtered) * sizeof (float));
+
+   for (uint16_t i = 0; i < c->n; i++)
+   {
+      if (c->output[i] != NULL)
+      {
+         memcpy (c->output[i], &c->value[i], sizeof (float));
+      }
+   }
+}
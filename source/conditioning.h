@@ -0,0 +1,107 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef CONDITIONING_H_
+#define CONDITIONING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Filter of a channel. Channels are ordered by filter. */
+typedef enum conditioning_filter
+{
+   CONDITIONING_FILTER_IIR = 0, /* First order low pass */
+   CONDITIONING_FILTER_AVG,     /* Moving average */
+   CONDITIONING_FILTER_NONE,
+} conditioning_filter_t;
+
+/* Configuration of one channel */
+typedef struct conditioning_channel
+{
+   float gain;   /* Engineering unit per raw unit */
+   float offset; /* Engineering value at raw 0 */
+   float min;    /* Clamp limits, in engineering units */
+   float max;
+   float alpha;  /* IIR coefficient, 0 < alpha <= 1 */
+} conditioning_channel_t;
+
+/**
+ * Conditioning of analog input channels, each step executed over arrays
+ * of all channels. A sample is scaled with gain and offset, clamped to
+ * min and max and filtered. Channels [0, n_iir) use the IIR filter,
+ * [n_iir, n_iir + n_avg) the moving average over window samples and the
+ * rest no filter.
+ */
+typedef struct conditioning
+{
+   uint16_t n;
+   uint16_t n_iir;
+   uint16_t n_avg;
+   uint16_t window;
+   uint16_t pos; /* Current row of history */
+   bool primed;
+
+   float * raw; /* Raw samples, written by input sampling */
+   float * value; /* Conditioned values */
+   float ** output; /* Where to store values, e.g. REAL32 input signals */
+
+   float * gain;
+   float * offset;
+   float * min;
+   float * max;
+   float * alpha;
+
+   float * scratch;
+   float * sum;     /* Sum of history, per moving average channel */
+   float * history; /* window rows of n_avg samples */
+} conditioning_t;
+
+/**
+ * Allocate a conditioning stage.
+ *
+ * @param c          Conditioning stage
+ * @param n_iir      Number of channels with IIR filter
+ * @param n_avg      Number of channels with moving average
+ * @param n_none     Number of channels without filter
+ * @param window     Moving average window, in samples
+ * @return 0 on success, -1 if out of memory
+ */
+extern int conditioning_init (
+   conditioning_t * c,
+   uint16_t n_iir,
+   uint16_t n_avg,
+   uint16_t n_none,
+   uint16_t window);
+
+/**
+ * Configure a channel.
+ *
+ * @param c          Conditioning stage
+ * @param i          Channel
+ * @param cfg        Configuration
+ * @param output     Where to store the conditioned value, may be NULL
+ */
+extern void conditioning_set (
+   conditioning_t * c,
+   uint16_t i,
+   const conditioning_channel_t * cfg,
+   float * output);
+
+/**
+ * Condition the current raw samples and store the values. Called once
+ * per cycle, between input sampling and up_write_inputs().
+ *
+ * @param c          Conditioning stage
+ */
+extern void conditioning_run (conditioning_t * c);
+
+#endif /* CONDITIONING_H_ */
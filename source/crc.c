@@ -0,0 +1,44 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * CRC-32 using a 16 entry nibble table, a compromise between flash usage
+ * and speed for the small blocks used for configuration data.
+ */
+
+#include "crc.h"
+
+static const uint32_t crc32_table[16] = {
+   0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+   0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+   0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+   0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t crc32_update (uint32_t crc, const void * data, size_t len)
+{
+   const uint8_t * p = data;
+
+   while (len-- > 0)
+   {
+      crc ^= *p++;
+      crc = (crc >> 4) ^ crc32_table[crc & 0x0F];
+      crc = (crc >> 4) ^ crc32_table[crc & 0x0F];
+   }
+
+   return crc;
+}
+
+uint32_t crc32 (const void * data, size_t len)
+{
+   return crc32_update (CRC32_INIT, data, len) ^ CRC32_INIT;
+}
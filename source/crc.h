@@ -0,0 +1,43 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRC32_INIT 0xFFFFFFFFu
+
+/**
+ * Update a CRC-32 (IEEE 802.3) with a block of data.
+ *
+ * Start with CRC32_INIT and invert the final value, or use crc32() for a
+ * single block.
+ *
+ * @param crc     Current CRC value
+ * @param data    Data
+ * @param len     Length of data in bytes
+ * @return Updated CRC value
+ */
+extern uint32_t crc32_update (uint32_t crc, const void * data, size_t len);
+
+/**
+ * CRC-32 (IEEE 802.3) of a block of data.
+ *
+ * @param data    Data
+ * @param len     Length of data in bytes
+ * @return CRC value
+ */
+extern uint32_t crc32 (const void * data, size_t len);
+
+#endif /* CRC_H_ */
@@ -0,0 +1,100 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Cycle count measurements using the Cortex-M7 DWT cycle counter.
+ */
+
+#include "cycle_stats.h"
+#include "shell.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DWT_LAR_UNLOCK 0xC5ACCE55u
+
+static cycle_stats_t * entries[CYCLE_STATS_MAX_ENTRIES];
+static uint16_t n_entries;
+
+void cycle_stats_init (void)
+{
+   CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+   DWT->LAR = DWT_LAR_UNLOCK;
+   DWT->CYCCNT = 0;
+   DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+int cycle_stats_register (cycle_stats_t * stats)
+{
+   if (n_entries >= CYCLE_STATS_MAX_ENTRIES)
+   {
+      return -1;
+   }
+
+   entries[n_entries++] = stats;
+   return 0;
+}
+
+void cycle_stats_reset (cycle_stats_t * stats)
+{
+   stats->count = 0;
+   stats->total = 0;
+   stats->min = UINT32_MAX;
+   stats->max = 0;
+}
+
+static int _cmd_cycles (int argc, char * argv[])
+{
+   if (argc == 2 && strcmp (argv[1], "reset") == 0)
+   {
+      for (uint16_t i = 0; i < n_entries; i++)
+      {
+         cycle_stats_reset (entries[i]);
+      }
+      return 0;
+   }
+
+   printf ("Core clock %" PRIu32 " Hz\n", SystemCoreClock);
+   printf (
+      "%-20s %10s %10s %10s %10s\n",
+      "name",
+      "count",
+      "min",
+      "avg",
+      "max");
+
+   for (uint16_t i = 0; i < n_entries; i++)
+   {
+      const cycle_stats_t * s = entries[i];
+      uint32_t avg = (s->count > 0) ? (uint32_t)(s->total / s->count) : 0;
+
+      printf (
+         "%-20s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n",
+         s->name,
+         s->count,
+         (s->count > 0) ? s->min : 0,
+         avg,
+         s->max);
+   }
+
+   return 0;
+}
+
+const shell_cmd_t cmd_cycles = {
+   .cmd = _cmd_cycles,
+   .name = "cycles",
+   .help_short = "show cycle count statistics",
+   .help_long = "Show execution time in CPU cycles for instrumented code.\n"
+                "Usage: cycles [reset]\n"};
+
+SHELL_CMD (cmd_cycles);
@@ -0,0 +1,100 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef CYCLE_STATS_H_
+#define CYCLE_STATS_H_
+
+#include <stdint.h>
+
+#include "cy_device.h"
+
+/* Max number of measurement points listed by the 'cycles' command */
+#define CYCLE_STATS_MAX_ENTRIES 16
+
+/**
+ * Execution time statistics for one measurement point, in CPU cycles.
+ */
+typedef struct cycle_stats
+{
+   const char * name;
+   uint32_t count;
+   uint32_t min;
+   uint32_t max;
+   uint64_t total;
+} cycle_stats_t;
+
+#define CYCLE_STATS_INIT(n)                                                    \
+   {                                                                           \
+      .name = (n), .min = UINT32_MAX                                           \
+   }
+
+/**
+ * Enable the DWT cycle counter.
+ * Must be called before any measurement is taken.
+ */
+extern void cycle_stats_init (void);
+
+/**
+ * Register a measurement point so that it is listed by the 'cycles'
+ * shell command.
+ *
+ * @param stats   Measurement point, must be statically allocated
+ * @return 0 on success, -1 if the registry is full
+ */
+extern int cycle_stats_register (cycle_stats_t * stats);
+
+/**
+ * Reset min, max and average of a measurement point.
+ *
+ * @param stats   Measurement point
+ */
+extern void cycle_stats_reset (cycle_stats_t * stats);
+
+/**
+ * Current value of the free running cycle counter.
+ */
+static inline uint32_t cycle_stats_now (void)
+{
+   return DWT->CYCCNT;
+}
+
+/**
+ * Convert cycles to microseconds using the current core clock.
+ */
+static inline uint32_t cycle_stats_to_us (uint32_t cycles)
+{
+   return cycles / (SystemCoreClock / 1000000u);
+}
+
+/**
+ * Add one sample to a measurement point.
+ *
+ * @param stats   Measurement point
+ * @param start   Cycle counter value at start of measured section
+ */
+static inline void cycle_stats_add (cycle_stats_t * stats, uint32_t start)
+{
+   uint32_t cycles = cycle_stats_now() - start;
+
+   stats->count++;
+   stats->total += cycles;
+   if (cycles < stats->min)
+   {
+      stats->min = cycles;
+   }
+   if (cycles > stats->max)
+   {
+      stats->max = cycles;
+   }
+}
+
+#endif /* CYCLE_STATS_H_ */
@@ -0,0 +1,613 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Read-only Modbus TCP gateway.
+ *
+ * U-Phy runs one protocol instance per core, so a second protocol on the
+ * same process image is served by the application. The cyclic callbacks
+ * convert the signals to Modbus registers in a triple buffered snapshot,
+ * which costs one pass over the signals per exchange. The gateway task
+ * serves each request from the latest complete snapshot, so all
+ * registers of a response are from the same cycle and the cyclic
+ * callbacks never wait for the gateway.
+ */
+
+#include "gateway.h"
+#include "cycle_stats.h"
+#include "mem_sections.h"
+#include "shell.h"
+#include "snapshot.h"
+
+#include "lwip/sockets.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MBAP_SIZE        7
+#define ADU_MAX_SIZE     260
+#define MAX_READ_REGS    125
+#define MAX_REGS         32767 /* Byte offsets in snapshot are 16-bit */
+
+#define FC_READ_HOLDING  0x03
+#define FC_READ_INPUT    0x04
+#define FC_WRITE_SINGLE  0x06
+#define FC_WRITE_COIL    0x05
+#define FC_WRITE_COILS   0x0F
+#define FC_WRITE_MULTI   0x10
+#define FC_READ_WRITE    0x17
+#define FC_EXCEPTION     0x80
+
+#define EX_ILLEGAL_FUNCTION 0x01
+#define EX_ILLEGAL_ADDRESS  0x02
+#define EX_ILLEGAL_VALUE    0x03
+
+typedef enum field_type
+{
+   FIELD_U8,
+   FIELD_U16,
+   FIELD_U32,
+   FIELD_BYTES,
+} field_type_t;
+
+/* Copy of one signal to its registers in the snapshot */
+typedef struct field
+{
+   const uint8_t * src;
+   uint16_t offset; /* Byte offset in snapshot */
+   uint8_t type;    /* field_type_t */
+   uint8_t size;    /* Bytes, for FIELD_BYTES */
+} field_t;
+
+typedef struct client
+{
+   int fd;
+   uint16_t len;
+   uint8_t buf[ADU_MAX_SIZE];
+} client_t;
+
+typedef struct gateway_stats
+{
+   uint32_t accepted;
+   uint32_t refused;
+   uint32_t requests;
+   uint32_t exceptions;
+   uint32_t writes; /* Rejected write requests */
+} gateway_stats_t;
+
+static const up_device_t * gw_device;
+static field_t * fields APP_DTCM_DATA;
+static uint16_t n_fields APP_DTCM_DATA;
+static bool started APP_DTCM_DATA;
+static snapshot_t snapshot APP_DTCM_DATA;
+static uint16_t n_input_regs;
+static uint16_t n_holding_regs;
+static uint16_t server_port;
+static client_t clients[GATEWAY_MAX_CLIENTS];
+static uint8_t response[ADU_MAX_SIZE];
+static gateway_stats_t stats;
+
+static cycle_stats_t publish_stats APP_DTCM_DATA =
+   CYCLE_STATS_INIT ("gw publish");
+static cycle_stats_t request_stats = CYCLE_STATS_INIT ("gw request");
+
+static uint16_t field_regs (uint16_t bitlength)
+{
+   return ((bitlength + 7) / 8 + 1) / 2;
+}
+
+/* Returns 0 on success, -1 if a signal does not fit the register map */
+static int add_fields (
+   const up_signal_t * signals,
+   uint16_t n,
+   const up_signal_info_t * vars,
+   uint16_t * reg)
+{
+   for (uint16_t i = 0; i < n; i++)
+   {
+      field_t * f = &fields[n_fields++];
+      uint16_t size = (signals[i].bitlength + 7) / 8;
+
+      if (
+         size > UINT8_MAX ||
+         field_regs (signals[i].bitlength) > MAX_REGS - *reg)
+      {
+         printf ("Gateway can not map signal %s\n", signals[i].name);
+         return -1;
+      }
+
+      f->src = vars[signals[i].ix].value;
+      f->offset = *reg * 2;
+      f->size = size;
+      switch (size)
+      {
+      case 1:
+         f->type = FIELD_U8;
+         break;
+      case 2:
+         f->type = FIELD_U16;
+         break;
+      case 4:
+         f->type = FIELD_U32;
+         break;
+      default:
+         f->type = FIELD_BYTES;
+         break;
+      }
+      *reg += field_regs (signals[i].bitlength);
+   }
+   return 0;
+}
+
+/* Modbus registers are big endian, 32-bit values high word first */
+APP_ITCM_FUNC void gateway_publish (void)
+{
+   uint32_t start;
+   uint8_t * buf;
+
+   if (!started)
+   {
+      return;
+   }
+
+   start = cycle_stats_now();
+   buf = snapshot_write_buffer (&snapshot);
+   for (uint16_t i = 0; i < n_fields; i++)
+   {
+      const field_t * f = &fields[i];
+      const uint8_t * s = f->src;
+      uint8_t * d = buf + f->offset;
+
+      switch (f->type)
+      {
+      case FIELD_U8:
+         d[0] = 0;
+         d[1] = s[0];
+         break;
+      case FIELD_U16:
+         d[0] = s[1];
+         d[1] = s[0];
+         break;
+      case FIELD_U32:
+         d[0] = s[3];
+         d[1] = s[2];
+         d[2] = s[1];
+         d[3] = s[0];
+         break;
+      default:
+         memcpy (d, s, f->size);
+         break;
+      }
+   }
+   snapshot_publish (&snapshot);
+   cycle_stats_add (&publish_stats, start);
+}
+
+static uint16_t get_u16 (const uint8_t * p)
+{
+   return (p[0] << 8) | p[1];
+}
+
+static void put_u16 (uint8_t * p, uint16_t v)
+{
+   p[0] = v >> 8;
+   p[1] = v & 0xFF;
+}
+
+static uint16_t exception (uint8_t * rsp, uint8_t function, uint8_t code)
+{
+   stats.exceptions++;
+   rsp[0] = function | FC_EXCEPTION;
+   rsp[1] = code;
+   return 2;
+}
+
+/* Handle a request PDU. Returns the length of the response PDU. */
+static uint16_t handle_pdu (const uint8_t * pdu, uint16_t len, uint8_t * rsp)
+{
+   const uint8_t * image;
+   uint16_t first = 0;
+   uint16_t n_regs = 0;
+   uint16_t addr;
+   uint16_t quantity;
+
+   stats.requests++;
+
+   switch (pdu[0])
+   {
+   case FC_READ_INPUT:
+      n_regs = n_input_regs;
+      break;
+   case FC_READ_HOLDING:
+      first = n_input_regs;
+      n_regs = n_holding_regs;
+      break;
+   case FC_WRITE_COIL:
+   case FC_WRITE_SINGLE:
+   case FC_WRITE_COILS:
+   case FC_WRITE_MULTI:
+   case FC_READ_WRITE:
+      /* Outputs are owned by the primary protocol */
+      stats.writes++;
+      return exception (rsp, pdu[0], EX_ILLEGAL_FUNCTION);
+   default:
+      return exception (rsp, pdu[0], EX_ILLEGAL_FUNCTION);
+   }
+
+   if (len != 5)
+   {
+      return exception (rsp, pdu[0], EX_ILLEGAL_VALUE);
+   }
+
+   addr = get_u16 (&pdu[1]);
+   quantity = get_u16 (&pdu[3]);
+   if (quantity < 1 || quantity > MAX_READ_REGS)
+   {
+      return exception (rsp, pdu[0], EX_ILLEGAL_VALUE);
+   }
+   if ((uint32_t)addr + quantity > n_regs)
+   {
+      return exception (rsp, pdu[0], EX_ILLEGAL_ADDRESS);
+   }
+
+   /* All registers of one response are from the same snapshot */
+   image = snapshot_acquire (&snapshot, NULL);
+   rsp[0] = pdu[0];
+   rsp[1] = quantity * 2;
+   memcpy (&rsp[2], image + (first + addr) * 2, quantity * 2);
+   return 2 + quantity * 2;
+}
+
+static void client_close (client_t * c)
+{
+   lwip_close (c->fd);
+   c->fd = -1;
+   c->len = 0;
+}
+
+/* Serve all complete ADUs received from a client. Returns -1 if the
+ * connection shall be closed. */
+static int client_serve (client_t * c)
+{
+   while (c->len >= MBAP_SIZE)
+   {
+      uint8_t * adu = c->buf;
+      uint16_t length = get_u16 (&adu[4]); /* Unit id and PDU */
+      uint16_t size = 6 + length;
+      uint16_t rsp_len;
+      uint32_t start;
+
+      if (get_u16 (&adu[2]) != 0 || length < 2 || size > ADU_MAX_SIZE)
+      {
+         return -1;
+      }
+      if (c->len < size)
+      {
+         return 0;
+      }
+
+      start = cycle_stats_now();
+      rsp_len = handle_pdu (
+         &adu[MBAP_SIZE],
+         length - 1,
+         &response[MBAP_SIZE]);
+      memcpy (response, adu, MBAP_SIZE);
+      put_u16 (&response[4], rsp_len + 1);
+      cycle_stats_add (&request_stats, start);
+
+      if (lwip_send (c->fd, response, MBAP_SIZE + rsp_len, 0) < 0)
+      {
+         return -1;
+      }
+
+      c->len -= size;
+      memmove (c->buf, c->buf + size, c->len);
+   }
+   return 0;
+}
+
+static void client_accept (int listen_fd)
+{
+   int fd = lwip_accept (listen_fd, NULL, NULL);
+   int one = 1;
+
+   if (fd < 0)
+   {
+      return;
+   }
+
+   for (int i = 0; i < GATEWAY_MAX_CLIENTS; i++)
+   {
+      if (clients[i].fd < 0)
+      {
+         lwip_setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+         clients[i].fd = fd;
+         clients[i].len = 0;
+         stats.accepted++;
+         return;
+      }
+   }
+
+   stats.refused++;
+   lwip_close (fd);
+}
+
+static int server_open (uint16_t port)
+{
+   struct sockaddr_in addr = {0};
+   int fd;
+
+   fd = lwip_socket (AF_INET, SOCK_STREAM, 0);
+   if (fd < 0)
+   {
+      return -1;
+   }
+
+   addr.sin_family = AF_INET;
+   addr.sin_port = lwip_htons (port);
+   addr.sin_addr.s_addr = lwip_htonl (INADDR_ANY);
+   if (
+      lwip_bind (fd, (struct sockaddr *)&addr, sizeof (addr)) != 0 ||
+      lwip_listen (fd, GATEWAY_MAX_CLIENTS) != 0)
+   {
+      lwip_close (fd);
+      return -1;
+   }
+   return fd;
+}
+
+static void gateway_task (void * arg)
+{
+   int listen_fd = (int)(intptr_t)arg;
+
+   for (;;)
+   {
+      fd_set fds;
+      int max_fd = listen_fd;
+
+      FD_ZERO (&fds);
+      FD_SET (listen_fd, &fds);
+      for (int i = 0; i < GATEWAY_MAX_CLIENTS; i++)
+      {
+         if (clients[i].fd >= 0)
+         {
+            FD_SET (clients[i].fd, &fds);
+            max_fd = (clients[i].fd > max_fd) ? clients[i].fd : max_fd;
+         }
+      }
+
+      if (lwip_select (max_fd + 1, &fds, NULL, NULL, NULL) <= 0)
+      {
+         continue;
+      }
+
+      for (int i = 0; i < GATEWAY_MAX_CLIENTS; i++)
+      {
+         client_t * c = &clients[i];
+         int n;
+
+         if (c->fd < 0 || !FD_ISSET (c->fd, &fds))
+         {
+            continue;
+         }
+
+         n = lwip_recv (c->fd, c->buf + c->len, sizeof (c->buf) - c->len, 0);
+         if (n <= 0)
+         {
+            client_close (c);
+            continue;
+         }
+         c->len += n;
+         if (client_serve (c) != 0)
+         {
+            client_close (c);
+         }
+      }
+
+      if (FD_ISSET (listen_fd, &fds))
+      {
+         client_accept (listen_fd);
+      }
+   }
+}
+
+int gateway_init (
+   const up_device_t * device,
+   const up_signal_info_t * vars,
+   uint16_t port)
+{
+   uint16_t n = 0;
+   uint16_t reg = 0;
+   int listen_fd;
+   int error = 0;
+
+   if (gw_device != NULL)
+   {
+      return -1;
+   }
+
+   for (uint16_t i = 0; i < device->n_slots; i++)
+   {
+      n += device->slots[i].n_inputs + device->slots[i].n_outputs;
+   }
+
+   fields = calloc (n, sizeof (*fields));
+   if (n > 0 && fields == NULL)
+   {
+      return -1;
+   }
+
+   n_fields = 0;
+   for (uint16_t i = 0; i < device->n_slots && error == 0; i++)
+   {
+      const up_slot_t * slot = &device->slots[i];
+
+      error = add_fields (slot->inputs, slot->n_inputs, vars, &reg);
+   }
+   n_input_regs = reg;
+   for (uint16_t i = 0; i < device->n_slots && error == 0; i++)
+   {
+      const up_slot_t * slot = &device->slots[i];
+
+      error = add_fields (slot->outputs, slot->n_outputs, vars, &reg);
+   }
+   n_holding_regs = reg - n_input_regs;
+
+   if (error != 0 || snapshot_init (&snapshot, reg * 2) != 0)
+   {
+      goto free_fields;
+   }
+
+   for (int i = 0; i < GATEWAY_MAX_CLIENTS; i++)
+   {
+      clients[i].fd = -1;
+   }
+
+   listen_fd = server_open (port);
+   if (listen_fd < 0)
+   {
+      printf ("Gateway failed to listen on port %" PRIu16 "\n", port);
+      goto free_snapshot;
+   }
+
+   if (
+      xTaskCreate (
+         gateway_task,
+         "gateway",
+         GATEWAY_TASK_STACK_SIZE,
+         (void *)(intptr_t)listen_fd,
+         GATEWAY_TASK_PRIORITY,
+         NULL) != pdPASS)
+   {
+      printf ("Gateway failed to create task\n");
+      goto close_listen;
+   }
+
+   gw_device = device;
+   server_port = port;
+   cycle_stats_register (&publish_stats);
+   cycle_stats_register (&request_stats);
+   started = true;
+
+   return 0;
+
+close_listen:
+   lwip_close (listen_fd);
+free_snapshot:
+   snapshot_free (&snapshot);
+free_fields:
+   free (fields);
+   fields = NULL;
+   n_fields = 0;
+   n_input_regs = 0;
+   n_holding_regs = 0;
+   return -1;
+}
+
+static void show_map (void)
+{
+   uint16_t k = 0;
+
+   printf ("Register  Area     Slot / Signal\n");
+   for (int dir = 0; dir < 2; dir++)
+   {
+      for (uint16_t i = 0; i < gw_device->n_slots; i++)
+      {
+         const up_slot_t * slot = &gw_device->slots[i];
+         const up_signal_t * signals = dir ? slot->outputs : slot->inputs;
+         uint16_t n = dir ? slot->n_outputs : slot->n_inputs;
+
+         for (uint16_t j = 0; j < n; j++)
+         {
+            uint16_t reg = fields[k++].offset / 2;
+
+            printf (
+               "%-8" PRIu16 "  %-7s  %s / %s\n",
+               dir ? reg - n_input_regs : reg,
+               dir ? "holding" : "input",
+               slot->name,
+               signals[j].name);
+         }
+      }
+   }
+}
+
+static int _cmd_gateway (int argc, char * argv[])
+{
+   uint16_t n_clients = 0;
+
+   if (argc > 2 || (argc == 2 && strcmp (argv[1], "map") != 0))
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   if (!started)
+   {
+      printf ("Gateway not started\n");
+      return 0;
+   }
+
+   if (argc == 2)
+   {
+      show_map();
+      return 0;
+   }
+
+   for (int i = 0; i < GATEWAY_MAX_CLIENTS; i++)
+   {
+      n_clients += (clients[i].fd >= 0) ? 1 : 0;
+   }
+
+   printf ("Port            : %" PRIu16 "\n", server_port);
+   printf (
+      "Registers       : %" PRIu16 " input, %" PRIu16 " holding\n",
+      n_input_regs,
+      n_holding_regs);
+   printf (
+      "Clients         : %" PRIu16 " of %d\n",
+      n_clients,
+      GATEWAY_MAX_CLIENTS);
+   printf ("Accepted        : %" PRIu32 "\n", stats.accepted);
+   printf ("Refused         : %" PRIu32 "\n", stats.refused);
+   printf ("Requests        : %" PRIu32 "\n", stats.requests);
+   printf ("Exceptions      : %" PRIu32 "\n", stats.exceptions);
+   printf ("Rejected writes : %" PRIu32 "\n", stats.writes);
+   if (publish_stats.count > 0)
+   {
+      printf (
+         "Publish         : avg %" PRIu32 " max %" PRIu32
+         " cycles per exchange\n",
+         (uint32_t)(publish_stats.total / publish_stats.count),
+         publish_stats.max);
+   }
+
+   return 0;
+}
+
+const shell_cmd_t cmd_gateway = {
+   .cmd = _cmd_gateway,
+   .name = "gateway",
+   .help_short = "show read-only Modbus TCP gateway",
+   .help_long =
+      "Show clients and statistics of the read-only Modbus TCP gateway,\n"
+      "or the register of each signal. Inputs are input registers,\n"
+      "outputs are holding registers. Enable with 'config gateway'.\n"
+      "Usage: gateway [map]\n"};
+
+SHELL_CMD (cmd_gateway);
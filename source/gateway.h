@@ -0,0 +1,54 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef GATEWAY_H_
+#define GATEWAY_H_
+
+#include "up_types.h"
+
+#include <stdint.h>
+
+#define GATEWAY_TASK_PRIORITY   (tskIDLE_PRIORITY + 1)
+#define GATEWAY_TASK_STACK_SIZE 1024
+
+/**
+ * Start the read-only Modbus TCP gateway.
+ *
+ * Serves the process data of the running protocol to Modbus TCP
+ * clients, e.g. HMIs, next to the protocol owning the outputs. Inputs
+ * are read as input registers (function code 4) and outputs as holding
+ * registers (function code 3). Each signal starts a new register, in
+ * slot order. Writes are rejected. Up to GATEWAY_MAX_CLIENTS (lwipopts.h)
+ * clients are served.
+ *
+ * The process image is copied to a snapshot once per exchange by
+ * gateway_publish(), requests are served from the latest snapshot
+ * without locking the process image.
+ *
+ * @param device     Device model
+ * @param vars       Signal table
+ * @param port       TCP port
+ * @return 0 on success, -1 on error
+ */
+extern int gateway_init (
+   const up_device_t * device,
+   const up_signal_info_t * vars,
+   uint16_t port);
+
+/**
+ * Publish the process image to gateway clients. Called from the cyclic
+ * callbacks after the inputs have been updated, does nothing if the
+ * gateway is not started.
+ */
+extern void gateway_publish (void);
+
+#endif /* GATEWAY_H_ */
@@ -0,0 +1,259 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+
+/*
+ * Process data exchange mode of the running bustype and the 'up_iomode'
+ * shell command. In decimated mode the exchange is done every
+ * io_decimation cycles.
+ */
+
+#include "iomode_cmd.h"
+#include "uphy_demo_app.h"
+#include "app_config.h"
+#include "cycle_stats.h"
+#include "mem_sections.h"
+#include "shell.h"
+#include "worker_cmd.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static up_bustype_t io_bustype;
+static bool io_selected;
+static uint8_t io_mode APP_DTCM_DATA;
+static uint8_t io_decimation APP_DTCM_DATA = 1;
+static uint8_t io_sync_skip APP_DTCM_DATA;
+static uint8_t io_avail_skip APP_DTCM_DATA;
+static uint32_t io_count APP_DTCM_DATA;
+static uint32_t io_last APP_DTCM_DATA;
+static cycle_stats_t io_interval_stats APP_DTCM_DATA =
+   CYCLE_STATS_INIT ("io interval");
+
+void iomode_cmd_select (up_bustype_t bustype)
+{
+   app_config_io_t io = {.mode = APP_CONFIG_IO_SYNC};
+
+   if (bustype < APP_CONFIG_MAX_BUSTYPES)
+   {
+      io = app_config.io[bustype];
+   }
+
+   io_mode = io.mode;
+   io_decimation = 1;
+   if (io.mode == APP_CONFIG_IO_DECIMATED && io.decimation > 1)
+   {
+      io_decimation = io.decimation;
+   }
+   io_sync_skip = 0;
+   io_avail_skip = 0;
+   io_count = 0;
+   cycle_stats_reset (&io_interval_stats);
+
+   if (!io_selected)
+   {
+      cycle_stats_register (&io_interval_stats);
+   }
+   io_bustype = bustype;
+   io_selected = true;
+}
+
+bool iomode_cmd_is_async (void)
+{
+   return io_mode == APP_CONFIG_IO_ASYNC;
+}
+
+APP_ITCM_FUNC bool iomode_cmd_sync_due (void)
+{
+   if (++io_sync_skip >= io_decimation)
+   {
+      io_sync_skip = 0;
+      return true;
+   }
+   return false;
+}
+
+APP_ITCM_FUNC bool iomode_cmd_avail_due (void)
+{
+   if (++io_avail_skip >= io_decimation)
+   {
+      io_avail_skip = 0;
+      return true;
+   }
+   return false;
+}
+
+APP_ITCM_FUNC void iomode_cmd_exchanged (uint32_t now)
+{
+   /* Time between exchanges bounds the age of the data */
+   if (io_count++ > 0)
+   {
+      cycle_stats_add (&io_interval_stats, io_last);
+   }
+   io_last = now;
+}
+
+static const char * io_mode_names[] = {
+   [APP_CONFIG_IO_SYNC] = "sync",
+   [APP_CONFIG_IO_ASYNC] = "async",
+   [APP_CONFIG_IO_DECIMATED] = "decimated",
+};
+
+static const char * io_mode_to_str (uint8_t mode)
+{
+   return (mode <= APP_CONFIG_IO_DECIMATED) ? io_mode_names[mode] : "unknown";
+}
+
+static int str_to_io_mode (const char * str, uint8_t * mode)
+{
+   for (uint8_t i = 0; i <= APP_CONFIG_IO_DECIMATED; i++)
+   {
+      if (strcmp (str, io_mode_names[i]) == 0)
+      {
+         *mode = i;
+         return 0;
+      }
+   }
+   return -1;
+}
+
+static void show_io_mode (void)
+{
+   cycle_stats_t interval = io_interval_stats;
+   uint32_t load;
+
+   printf ("Protocol    Mode       N\n");
+   for (int i = 0; i < APP_CONFIG_MAX_BUSTYPES; i++)
+   {
+      const app_config_io_t * io = &app_config.io[i];
+
+      if (strcmp (bus_config_to_str (i), "unknown") == 0)
+      {
+         continue;
+      }
+      printf ("%-11s %-10s", bus_config_to_str (i), io_mode_to_str (io->mode));
+      if (io->mode == APP_CONFIG_IO_DECIMATED)
+      {
+         printf (" %u", io->decimation);
+      }
+      printf ("\n");
+   }
+
+   if (!io_selected)
+   {
+      return;
+   }
+
+   load = worker_cmd_load();
+
+   printf (
+      "\nRunning %s in %s mode",
+      bus_config_to_str (io_bustype),
+      io_mode_to_str (io_mode));
+   if (io_decimation > 1)
+   {
+      printf (", every %u cycles", io_decimation);
+   }
+   printf ("\nCPU load    : %" PRIu32 "%%\n", load);
+   if (interval.count > 0)
+   {
+      printf (
+         "I/O interval: min %" PRIu32 " avg %" PRIu32 " max %" PRIu32
+         " us\n",
+         cycle_stats_to_us (interval.min),
+         cycle_stats_to_us ((uint32_t)(interval.total / interval.count)),
+         cycle_stats_to_us (interval.max));
+   }
+}
+
+int _cmd_iomode (int argc, char * argv[])
+{
+   up_bustype_t bustype;
+   app_config_io_t io = {0};
+   unsigned long n = 0;
+
+   if (argc == 1)
+   {
+      show_io_mode();
+      return 0;
+   }
+
+   if (argc == 4)
+   {
+      n = strtoul (argv[3], NULL, 0);
+   }
+   if (
+      argc < 3 || argc > 4 || str_to_io_mode (argv[2], &io.mode) != 0 ||
+      (io.mode == APP_CONFIG_IO_DECIMATED && (n < 2 || n > UINT8_MAX)))
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+   if (str_to_bus_config (argv[1], &bustype) != 0)
+   {
+      return -1;
+   }
+   if (bustype >= APP_CONFIG_MAX_BUSTYPES)
+   {
+      printf ("Bustype %d not configurable\n", bustype);
+      return -1;
+   }
+
+   io.decimation = (io.mode == APP_CONFIG_IO_DECIMATED) ? n : 0;
+   app_config.io[bustype] = io;
+   if (app_config_save() != 0)
+   {
+      printf ("Failed to save configuration\n");
+      return -1;
+   }
+
+   if (!io_selected || io_bustype != bustype)
+   {
+      return 0;
+   }
+
+   /* Switching between sync and decimated keeps the event mask and is
+    * applied directly */
+   if ((io.mode == APP_CONFIG_IO_ASYNC) == (io_mode == APP_CONFIG_IO_ASYNC))
+   {
+      taskENTER_CRITICAL();
+      iomode_cmd_select (bustype);
+      taskEXIT_CRITICAL();
+      printf ("Applied\n");
+   }
+   else
+   {
+      printf ("Takes effect when U-Phy is restarted\n");
+   }
+   return 0;
+}
+
+const shell_cmd_t cmd_iomode = {
+   .cmd = _cmd_iomode,
+   .name = "up_iomode",
+   .help_short = "show or set process data exchange mode",
+   .help_long =
+      "Show or set how process data is exchanged, per protocol:\n"
+      "sync      - in cb_sync/cb_avail every cycle\n"
+      "async     - in the worker loop, not tied to the bus cycle\n"
+      "decimated - in cb_sync/cb_avail every <n>th cycle\n"
+      "The setting is stored with the autostart configuration. Without\n"
+      "arguments, also shows CPU load and the time between exchanges of\n"
+      "the running protocol.\n"
+      "Usage: up_iomode [<protocol> sync|async|decimated [<n>]]\n"};
+
+SHELL_CMD (cmd_iomode);
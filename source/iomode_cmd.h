@@ -0,0 +1,57 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+
+#ifndef IOMODE_CMD_H_
+#define IOMODE_CMD_H_
+
+#include "up_types.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Use the process data exchange mode stored for a bustype. Called when
+ * U-Phy is initialised for the bustype. The mode is shown and changed
+ * with the 'up_iomode' shell command.
+ *
+ * @param bustype    Bustype being started
+ */
+extern void iomode_cmd_select (up_bustype_t bustype);
+
+/**
+ * Whether process data is exchanged in the worker loop instead of in the
+ * cyclic callbacks.
+ */
+extern bool iomode_cmd_is_async (void);
+
+/**
+ * Whether cb_sync exchanges process data this cycle. Called every
+ * cb_sync, counts the cycles in decimated mode.
+ */
+extern bool iomode_cmd_sync_due (void);
+
+/**
+ * Whether cb_avail exchanges process data this cycle. Called every
+ * cb_avail, counts the cycles in decimated mode.
+ */
+extern bool iomode_cmd_avail_due (void);
+
+/**
+ * Record an exchange of the inputs, for the time between exchanges shown
+ * by 'up_iomode'.
+ *
+ * @param now        Cycle counter at start of exchange
+ */
+extern void iomode_cmd_exchanged (uint32_t now);
+
+#endif /* IOMODE_CMD_H_ */
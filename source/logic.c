@@ -0,0 +1,550 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Bytecode interpreter for local logic.
+ *
+ * All checks are done when a program is loaded: opcodes, signal indexes,
+ * stack depth and jump targets. Signal accesses are decoded to one
+ * opcode per datatype with a direct pointer, so the interpreter loop has
+ * no checks and no lookups. With forward jumps only, the worst case
+ * execution time is the longest path through the section, computed from
+ * a cycle cost per opcode.
+ */
+
+#include "logic.h"
+
+#include "crc.h"
+#include "mem_sections.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Decoded opcodes, after the file opcodes */
+enum
+{
+   OP_LOAD_U8 = LOGIC_OP_MAX_OP,
+   OP_LOAD_U16,
+   OP_LOAD_U32,
+   OP_LOAD_I8,
+   OP_LOAD_I16,
+   OP_LOAD_I32,
+   OP_STORE_8,
+   OP_STORE_16,
+   OP_STORE_32,
+};
+
+/* Estimated Cortex-M7 cycles per opcode, including dispatch. Measured
+ * values are shown by the logic shell command. */
+#define DISPATCH_CYCLES 8
+
+static const uint8_t op_cycles[LOGIC_OP_MAX_OP] = {
+   [LOGIC_OP_END] = 4,
+   [LOGIC_OP_PUSH] = 2,
+   [LOGIC_OP_LOAD] = 4,
+   [LOGIC_OP_STORE] = 4,
+   [LOGIC_OP_STATUS] = 4,
+   [LOGIC_OP_LDM] = 2,
+   [LOGIC_OP_STM] = 2,
+   [LOGIC_OP_DUP] = 2,
+   [LOGIC_OP_DROP] = 1,
+   [LOGIC_OP_BIT] = 2,
+   [LOGIC_OP_NOT] = 2,
+   [LOGIC_OP_INV] = 2,
+   [LOGIC_OP_ADD] = 3,
+   [LOGIC_OP_SUB] = 3,
+   [LOGIC_OP_MUL] = 4,
+   [LOGIC_OP_AND] = 3,
+   [LOGIC_OP_OR] = 3,
+   [LOGIC_OP_XOR] = 3,
+   [LOGIC_OP_SHL] = 3,
+   [LOGIC_OP_SHR] = 3,
+   [LOGIC_OP_EQ] = 3,
+   [LOGIC_OP_NE] = 3,
+   [LOGIC_OP_LT] = 3,
+   [LOGIC_OP_LE] = 3,
+   [LOGIC_OP_GT] = 3,
+   [LOGIC_OP_GE] = 3,
+   [LOGIC_OP_MIN] = 3,
+   [LOGIC_OP_MAX] = 3,
+   [LOGIC_OP_JMP] = 4,
+   [LOGIC_OP_JZ] = 6,
+};
+
+/* Values popped and pushed by each opcode */
+static const int8_t op_pops[LOGIC_OP_MAX_OP] = {
+   [LOGIC_OP_STORE] = 1,
+   [LOGIC_OP_STM] = 1,
+   [LOGIC_OP_DUP] = 1,
+   [LOGIC_OP_DROP] = 1,
+   [LOGIC_OP_BIT] = 1,
+   [LOGIC_OP_NOT] = 1,
+   [LOGIC_OP_INV] = 1,
+   [LOGIC_OP_ADD ... LOGIC_OP_MAX] = 2,
+   [LOGIC_OP_JZ] = 1,
+};
+
+static const int8_t op_pushes[LOGIC_OP_MAX_OP] = {
+   [LOGIC_OP_PUSH] = 1,
+   [LOGIC_OP_LOAD] = 1,
+   [LOGIC_OP_STATUS] = 1,
+   [LOGIC_OP_LDM] = 1,
+   [LOGIC_OP_DUP] = 2,
+   [LOGIC_OP_BIT] = 1,
+   [LOGIC_OP_NOT] = 1,
+   [LOGIC_OP_INV] = 1,
+   [LOGIC_OP_ADD ... LOGIC_OP_MAX] = 1,
+};
+
+uint32_t logic_crc (const void * insns, uint32_t size)
+{
+   return crc32 (insns, size);
+}
+
+static uint8_t decode_load (uint8_t type)
+{
+   static const uint8_t ops[] = {
+      [LOGIC_TYPE_U8] = OP_LOAD_U8,
+      [LOGIC_TYPE_U16] = OP_LOAD_U16,
+      [LOGIC_TYPE_U32] = OP_LOAD_U32,
+      [LOGIC_TYPE_I8] = OP_LOAD_I8,
+      [LOGIC_TYPE_I16] = OP_LOAD_I16,
+      [LOGIC_TYPE_I32] = OP_LOAD_I32,
+   };
+
+   return ops[type];
+}
+
+static uint8_t decode_store (uint8_t type)
+{
+   static const uint8_t ops[] = {
+      [LOGIC_TYPE_U8] = OP_STORE_8,
+      [LOGIC_TYPE_U16] = OP_STORE_16,
+      [LOGIC_TYPE_U32] = OP_STORE_32,
+      [LOGIC_TYPE_I8] = OP_STORE_8,
+      [LOGIC_TYPE_I16] = OP_STORE_16,
+      [LOGIC_TYPE_I32] = OP_STORE_32,
+   };
+
+   return ops[type];
+}
+
+/* Check one instruction and decode it into code */
+static const char * decode (
+   const logic_insn_t * insn,
+   logic_code_t * code,
+   const logic_var_t * vars,
+   uint16_t n_vars)
+{
+   const logic_var_t * var;
+
+   code->op = insn->op;
+   code->a = insn->a;
+   code->b = insn->b;
+   code->p = NULL;
+
+   switch (insn->op)
+   {
+   case LOGIC_OP_LOAD:
+   case LOGIC_OP_STORE:
+   case LOGIC_OP_STATUS:
+      if ((uint16_t)insn->b >= n_vars)
+      {
+         return "signal index out of range";
+      }
+      var = &vars[(uint16_t)insn->b];
+      if (insn->op == LOGIC_OP_STATUS)
+      {
+         if (var->status == NULL)
+         {
+            return "signal has no status";
+         }
+         code->p = (void *)var->status;
+         break;
+      }
+      if (var->type >= LOGIC_TYPE_NONE || var->value == NULL)
+      {
+         return "signal datatype not supported";
+      }
+      if (insn->op == LOGIC_OP_STORE && !var->writable)
+      {
+         return "signal is not writable";
+      }
+      code->p = var->value;
+      code->op = (insn->op == LOGIC_OP_LOAD) ? decode_load (var->type)
+                                             : decode_store (var->type);
+      break;
+   case LOGIC_OP_LDM:
+   case LOGIC_OP_STM:
+      if (insn->a >= LOGIC_MEM_SIZE)
+      {
+         return "memory cell out of range";
+      }
+      break;
+   case LOGIC_OP_BIT:
+      if (insn->a >= 32)
+      {
+         return "bit out of range";
+      }
+      break;
+   case LOGIC_OP_JMP:
+   case LOGIC_OP_JZ:
+      if (insn->b <= 0)
+      {
+         return "jump is not forward";
+      }
+      break;
+   default:
+      if (insn->op >= LOGIC_OP_MAX_OP)
+      {
+         return "invalid opcode";
+      }
+      break;
+   }
+
+   return NULL;
+}
+
+/* Check stack use and control flow of a section and compute its worst
+ * case execution time as the longest path from the first instruction
+ * to an END */
+static const char * analyse (
+   logic_section_t * section,
+   const logic_insn_t * insns,
+   int8_t * depth,
+   uint32_t * cycles)
+{
+   uint16_t n = section->n;
+
+   section->wcet = 0;
+   section->n_reachable = 0;
+   if (n == 0)
+   {
+      return NULL;
+   }
+
+   memset (depth, -1, n * sizeof (*depth));
+   memset (cycles, 0, n * sizeof (*cycles));
+   depth[0] = 0;
+
+   for (uint16_t i = 0; i < n; i++)
+   {
+      uint8_t op = insns[i].op;
+      int d = depth[i];
+      uint32_t c;
+      uint16_t next[2];
+      uint16_t n_next = 0;
+
+      if (d < 0)
+      {
+         continue; /* Not reachable */
+      }
+
+      section->n_reachable++;
+      if (d < op_pops[op])
+      {
+         return "stack underflow";
+      }
+      d += op_pushes[op] - op_pops[op];
+      if (d > LOGIC_STACK_SIZE)
+      {
+         return "stack overflow";
+      }
+      c = cycles[i] + op_cycles[op] + DISPATCH_CYCLES;
+
+      if (op == LOGIC_OP_END)
+      {
+         if (c > section->wcet)
+         {
+            section->wcet = c;
+         }
+         continue;
+      }
+      if (op == LOGIC_OP_JMP || op == LOGIC_OP_JZ)
+      {
+         if (insns[i].b >= n - i)
+         {
+            return "jump out of section";
+         }
+         next[n_next++] = i + insns[i].b;
+      }
+      if (op != LOGIC_OP_JMP)
+      {
+         if (i + 1 >= n)
+         {
+            return "section does not end with END";
+         }
+         next[n_next++] = i + 1;
+      }
+
+      for (uint16_t k = 0; k < n_next; k++)
+      {
+         uint16_t j = next[k];
+
+         if (depth[j] >= 0 && depth[j] != d)
+         {
+            return "stack depth differs between paths";
+         }
+         depth[j] = d;
+         if (c > cycles[j])
+         {
+            cycles[j] = c;
+         }
+      }
+   }
+
+   return NULL;
+}
+
+int logic_load (
+   logic_t * logic,
+   const void * program,
+   uint32_t size,
+   const logic_var_t * vars,
+   uint16_t n_vars,
+   const char ** error)
+{
+   const char * e = NULL;
+   logic_header_t header;
+   const logic_insn_t * insns;
+   logic_code_t * code = NULL;
+   int8_t * depth = NULL;
+   uint32_t * cycles = NULL;
+
+   memset (logic, 0, sizeof (*logic));
+
+   if (size < sizeof (header))
+   {
+      e = "truncated header";
+      goto out;
+   }
+   memcpy (&header, program, sizeof (header));
+   insns = (const logic_insn_t *)((const uint8_t *)program + sizeof (header));
+
+   if (header.magic != LOGIC_MAGIC || header.version != LOGIC_VERSION)
+   {
+      e = "not a logic program or wrong version";
+      goto out;
+   }
+   if (
+      header.n_insns > LOGIC_MAX_INSNS ||
+      size != sizeof (header) + header.n_insns * sizeof (logic_insn_t) ||
+      header.avail > header.n_insns)
+   {
+      e = "invalid size";
+      goto out;
+   }
+   if (logic_crc (insns, header.n_insns * sizeof (logic_insn_t)) != header.crc)
+   {
+      e = "CRC mismatch";
+      goto out;
+   }
+   if (header.n_insns == 0)
+   {
+      goto out;
+   }
+
+   code = malloc (header.n_insns * sizeof (*code));
+   depth = malloc (header.n_insns * sizeof (*depth));
+   cycles = malloc (header.n_insns * sizeof (*cycles));
+   if (code == NULL || depth == NULL || cycles == NULL)
+   {
+      e = "out of memory";
+      goto out;
+   }
+
+   for (uint16_t i = 0; i < header.n_insns && e == NULL; i++)
+   {
+      e = decode (&insns[i], &code[i], vars, n_vars);
+   }
+
+   logic->sync.code = code;
+   logic->sync.n = header.avail;
+   logic->avail.code = code + header.avail;
+   logic->avail.n = header.n_insns - header.avail;
+
+   if (e == NULL)
+   {
+      e = analyse (&logic->sync, insns, depth, cycles);
+   }
+   if (e == NULL)
+   {
+      e = analyse (&logic->avail, insns + header.avail, depth, cycles);
+   }
+
+out:
+   free (depth);
+   free (cycles);
+   if (e != NULL)
+   {
+      free (code);
+      memset (logic, 0, sizeof (*logic));
+   }
+   if (error != NULL)
+   {
+      *error = e;
+   }
+   return (e == NULL) ? 0 : -1;
+}
+
+void logic_free (logic_t * logic)
+{
+   free (logic->sync.code);
+   memset (logic, 0, sizeof (*logic));
+}
+
+static inline uint32_t load32 (const void * p)
+{
+   uint32_t x;
+
+   memcpy (&x, p, sizeof (x));
+   return x;
+}
+
+static inline uint16_t load16 (const void * p)
+{
+   uint16_t x;
+
+   memcpy (&x, p, sizeof (x));
+   return x;
+}
+
+#define BINARY(expr)                                                           \
+   y = *sp--;                                                                  \
+   x = *sp;                                                                    \
+   *sp = (expr);                                                               \
+   break
+
+APP_ITCM_FUNC void logic_run (
+   logic_t * logic,
+   const logic_section_t * section)
+{
+   const logic_code_t * pc = section->code;
+   int32_t stack[LOGIC_STACK_SIZE + 1];
+   int32_t * sp = stack; /* Top of stack, stack[0] is unused */
+   int32_t x;
+   int32_t y;
+   uint16_t v16;
+   uint32_t v32;
+
+   if (section->n == 0)
+   {
+      return;
+   }
+
+   for (;; pc++)
+   {
+      switch (pc->op)
+      {
+      case LOGIC_OP_END:
+         return;
+      case LOGIC_OP_PUSH:
+         *++sp = pc->b;
+         break;
+      case LOGIC_OP_STATUS:
+         *++sp = *(const uint8_t *)pc->p;
+         break;
+      case LOGIC_OP_LDM:
+         *++sp = logic->mem[pc->a];
+         break;
+      case LOGIC_OP_STM:
+         logic->mem[pc->a] = *sp--;
+         break;
+      case LOGIC_OP_DUP:
+         x = *sp;
+         *++sp = x;
+         break;
+      case LOGIC_OP_DROP:
+         sp--;
+         break;
+      case LOGIC_OP_BIT:
+         *sp = ((uint32_t)*sp >> pc->a) & 1;
+         break;
+      case LOGIC_OP_NOT:
+         *sp = !*sp;
+         break;
+      case LOGIC_OP_INV:
+         *sp = ~*sp;
+         break;
+      case LOGIC_OP_ADD:
+         BINARY ((int32_t)((uint32_t)x + (uint32_t)y));
+      case LOGIC_OP_SUB:
+         BINARY ((int32_t)((uint32_t)x - (uint32_t)y));
+      case LOGIC_OP_MUL:
+         BINARY ((int32_t)((uint32_t)x * (uint32_t)y));
+      case LOGIC_OP_AND:
+         BINARY (x & y);
+      case LOGIC_OP_OR:
+         BINARY (x | y);
+      case LOGIC_OP_XOR:
+         BINARY (x ^ y);
+      case LOGIC_OP_SHL:
+         BINARY ((int32_t)((uint32_t)x << (y & 31)));
+      case LOGIC_OP_SHR:
+         BINARY ((int32_t)((uint32_t)x >> (y & 31)));
+      case LOGIC_OP_EQ:
+         BINARY (x == y);
+      case LOGIC_OP_NE:
+         BINARY (x != y);
+      case LOGIC_OP_LT:
+         BINARY (x < y);
+      case LOGIC_OP_LE:
+         BINARY (x <= y);
+      case LOGIC_OP_GT:
+         BINARY (x > y);
+      case LOGIC_OP_GE:
+         BINARY (x >= y);
+      case LOGIC_OP_MIN:
+         BINARY ((x < y) ? x : y);
+      case LOGIC_OP_MAX:
+         BINARY ((x > y) ? x : y);
+      case LOGIC_OP_JMP:
+         pc += pc->b - 1;
+         break;
+      case LOGIC_OP_JZ:
+         if (*sp-- == 0)
+         {
+            pc += pc->b - 1;
+         }
+         break;
+      case OP_LOAD_U8:
+         *++sp = *(const uint8_t *)pc->p;
+         break;
+      case OP_LOAD_U16:
+         *++sp = load16 (pc->p);
+         break;
+      case OP_LOAD_U32:
+      case OP_LOAD_I32:
+         *++sp = (int32_t)load32 (pc->p);
+         break;
+      case OP_LOAD_I8:
+         *++sp = *(const int8_t *)pc->p;
+         break;
+      case OP_LOAD_I16:
+         *++sp = (int16_t)load16 (pc->p);
+         break;
+      case OP_STORE_8:
+         *(uint8_t *)pc->p = (uint8_t)*sp--;
+         break;
+      case OP_STORE_16:
+         v16 = (uint16_t)*sp--;
+         memcpy (pc->p, &v16, sizeof (v16));
+         break;
+      case OP_STORE_32:
+         v32 = (uint32_t)*sp--;
+         memcpy (pc->p, &v32, sizeof (v32));
+         break;
+      default:
+         return;
+      }
+   }
+}
@@ -0,0 +1,177 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef LOGIC_H_
+#define LOGIC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Local logic executed on the process image every cycle.
+ *
+ * A program has a sync section, run in cb_sync before the inputs are
+ * written, and an avail section, run in cb_avail after the outputs are
+ * read. Both are sequences of 32-bit instructions for a stack machine
+ * with 32-bit signed values. Jumps go forward only, so every
+ * instruction executes at most once per run and the execution time is
+ * bounded by the program length.
+ *
+ * Programs are built by uphy-logic-asm.py. All offsets and indexes are
+ * checked when a program is loaded.
+ */
+
+#define LOGIC_MAGIC   0x474C5055 /* "UPLG" */
+#define LOGIC_VERSION 1
+
+#define LOGIC_STACK_SIZE 16
+#define LOGIC_MEM_SIZE   16
+#define LOGIC_MAX_INSNS  1024
+
+typedef enum logic_op
+{
+   LOGIC_OP_END = 0,
+   LOGIC_OP_PUSH,   /* Push b */
+   LOGIC_OP_LOAD,   /* Push value of signal b */
+   LOGIC_OP_STORE,  /* Pop value to signal b */
+   LOGIC_OP_STATUS, /* Push 1 if signal b has good status */
+   LOGIC_OP_LDM,    /* Push memory cell a */
+   LOGIC_OP_STM,    /* Pop to memory cell a */
+   LOGIC_OP_DUP,
+   LOGIC_OP_DROP,
+   LOGIC_OP_BIT, /* Pop x, push bit a of x */
+   LOGIC_OP_NOT, /* Pop x, push !x */
+   LOGIC_OP_INV, /* Pop x, push ~x */
+   LOGIC_OP_ADD, /* Pop y, pop x, push x op y */
+   LOGIC_OP_SUB,
+   LOGIC_OP_MUL,
+   LOGIC_OP_AND,
+   LOGIC_OP_OR,
+   LOGIC_OP_XOR,
+   LOGIC_OP_SHL,
+   LOGIC_OP_SHR,
+   LOGIC_OP_EQ,
+   LOGIC_OP_NE,
+   LOGIC_OP_LT,
+   LOGIC_OP_LE,
+   LOGIC_OP_GT,
+   LOGIC_OP_GE,
+   LOGIC_OP_MIN,
+   LOGIC_OP_MAX,
+   LOGIC_OP_JMP, /* Skip b instructions, b > 0 */
+   LOGIC_OP_JZ,  /* Pop x, skip b instructions if x is 0 */
+   LOGIC_OP_MAX_OP,
+} logic_op_t;
+
+/* Instruction as stored in a program file */
+typedef struct logic_insn
+{
+   uint8_t op; /* logic_op_t */
+   uint8_t a;
+   int16_t b;
+} logic_insn_t;
+
+/* Program file header, followed by n_insns instructions */
+typedef struct logic_header
+{
+   uint32_t magic;
+   uint16_t version;
+   uint16_t n_insns;
+   uint32_t crc;        /* CRC-32 of the instructions */
+   uint16_t avail;      /* First instruction of avail section */
+   uint16_t reserved;
+} logic_header_t;
+
+typedef enum logic_type
+{
+   LOGIC_TYPE_U8,
+   LOGIC_TYPE_U16,
+   LOGIC_TYPE_U32,
+   LOGIC_TYPE_I8,
+   LOGIC_TYPE_I16,
+   LOGIC_TYPE_I32,
+   LOGIC_TYPE_NONE, /* Not accessible from logic */
+} logic_type_t;
+
+/* Signal as seen by logic, by signal index */
+typedef struct logic_var
+{
+   void * value;
+   const uint8_t * status; /* NULL for parameters */
+   uint8_t type;           /* logic_type_t */
+   bool writable;
+} logic_var_t;
+
+/* Decoded instruction, with signal access resolved */
+typedef struct logic_code
+{
+   uint8_t op; /* Internal opcode, see logic.c */
+   uint8_t a;
+   int16_t b;
+   void * p;
+} logic_code_t;
+
+typedef struct logic_section
+{
+   logic_code_t * code;
+   uint16_t n;
+   uint16_t n_reachable;
+   uint32_t wcet; /* Estimated worst case execution time, in cycles */
+} logic_section_t;
+
+typedef struct logic
+{
+   logic_section_t sync;
+   logic_section_t avail;
+   int32_t mem[LOGIC_MEM_SIZE];
+} logic_t;
+
+/**
+ * Verify and decode a program.
+ *
+ * @param logic      Logic to set up
+ * @param program    Program file contents
+ * @param size       Size of program
+ * @param vars       Signals, by signal index
+ * @param n_vars     Number of signals
+ * @param error      Set to a description of the first error, may be NULL
+ * @return 0 on success, -1 on error
+ */
+extern int logic_load (
+   logic_t * logic,
+   const void * program,
+   uint32_t size,
+   const logic_var_t * vars,
+   uint16_t n_vars,
+   const char ** error);
+
+/**
+ * Release a loaded program.
+ *
+ * @param logic      Logic
+ */
+extern void logic_free (logic_t * logic);
+
+/**
+ * Run a section once.
+ *
+ * @param logic      Logic
+ * @param section    Section, &logic->sync or &logic->avail
+ */
+extern void logic_run (logic_t * logic, const logic_section_t * section);
+
+/**
+ * CRC-32 of the instructions of a program, as stored in the header.
+ */
+extern uint32_t logic_crc (const void * insns, uint32_t size);
+
+#endif /* LOGIC_H_ */
@@ -0,0 +1,263 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+
+/*
+ * Local logic loaded from the filesystem and the 'logic' shell command.
+ */
+
+#include "logic_cmd.h"
+#include "cycle_stats.h"
+#include "logic.h"
+#include "mem_sections.h"
+#include "shell.h"
+#include "rte_fs.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static logic_t logic APP_DTCM_DATA;
+static bool logic_enabled APP_DTCM_DATA;
+
+static cycle_stats_t logic_avail_stats APP_DTCM_DATA =
+   CYCLE_STATS_INIT ("logic avail");
+static cycle_stats_t logic_sync_stats APP_DTCM_DATA =
+   CYCLE_STATS_INIT ("logic sync");
+
+APP_ITCM_FUNC void logic_cmd_run_sync (void)
+{
+   uint32_t start;
+
+   if (!logic_enabled)
+   {
+      return;
+   }
+
+   start = cycle_stats_now();
+   logic_run (&logic, &logic.sync);
+   cycle_stats_add (&logic_sync_stats, start);
+}
+
+APP_ITCM_FUNC void logic_cmd_run_avail (void)
+{
+   uint32_t start;
+
+   if (!logic_enabled)
+   {
+      return;
+   }
+
+   start = cycle_stats_now();
+   logic_run (&logic, &logic.avail);
+   cycle_stats_add (&logic_avail_stats, start);
+}
+
+static uint8_t logic_type (up_dtype_t datatype)
+{
+   switch (datatype)
+   {
+   case UP_DTYPE_UINT8:
+      return LOGIC_TYPE_U8;
+   case UP_DTYPE_UINT16:
+      return LOGIC_TYPE_U16;
+   case UP_DTYPE_UINT32:
+      return LOGIC_TYPE_U32;
+   case UP_DTYPE_INT8:
+      return LOGIC_TYPE_I8;
+   case UP_DTYPE_INT16:
+      return LOGIC_TYPE_I16;
+   case UP_DTYPE_INT32:
+      return LOGIC_TYPE_I32;
+   default:
+      return LOGIC_TYPE_NONE;
+   }
+}
+
+static void add_logic_vars (
+   logic_var_t * vars,
+   const up_signal_info_t * info,
+   const up_signal_t * signals,
+   uint16_t n)
+{
+   for (uint16_t i = 0; i < n; i++)
+   {
+      logic_var_t * var = &vars[signals[i].ix];
+
+      var->value = info[signals[i].ix].value;
+      var->status = info[signals[i].ix].status;
+      var->type = logic_type (signals[i].datatype);
+      var->writable = true;
+   }
+}
+
+void logic_cmd_load (const up_device_t * device, const up_signal_info_t * info)
+{
+   logic_header_t header;
+   logic_var_t * vars = NULL;
+   uint8_t * program = NULL;
+   uint32_t size = 0;
+   uint32_t size_insns;
+   uint16_t n_vars = 0;
+   const char * error = "out of memory";
+   RTE_FILE * f;
+
+   f = rte_fs_fopen (LOGIC_CMD_FILE, "r");
+   if (f == NULL)
+   {
+      return;
+   }
+
+   if (
+      rte_fs_fread (&header, 1, sizeof (header), f) != sizeof (header) ||
+      header.n_insns > LOGIC_MAX_INSNS)
+   {
+      rte_fs_fclose (f);
+      printf ("Invalid logic program %s\n", LOGIC_CMD_FILE);
+      return;
+   }
+
+   size_insns = header.n_insns * sizeof (logic_insn_t);
+   program = malloc (sizeof (header) + size_insns);
+   if (program != NULL)
+   {
+      memcpy (program, &header, sizeof (header));
+      size = sizeof (header);
+      size += rte_fs_fread (program + size, 1, size_insns, f);
+   }
+   rte_fs_fclose (f);
+
+   for (uint16_t i = 0; i < device->n_slots; i++)
+   {
+      const up_slot_t * slot = &device->slots[i];
+
+      /* Signal indexes are numbered from 0 over all slots */
+      n_vars += slot->n_inputs + slot->n_outputs + slot->n_params;
+   }
+
+   vars = calloc (n_vars, sizeof (*vars));
+   if (program != NULL && vars != NULL)
+   {
+      for (uint16_t i = 0; i < n_vars; i++)
+      {
+         vars[i].type = LOGIC_TYPE_NONE;
+      }
+      for (uint16_t i = 0; i < device->n_slots; i++)
+      {
+         const up_slot_t * slot = &device->slots[i];
+
+         add_logic_vars (vars, info, slot->inputs, slot->n_inputs);
+         add_logic_vars (vars, info, slot->outputs, slot->n_outputs);
+         for (uint16_t j = 0; j < slot->n_params; j++)
+         {
+            logic_var_t * var = &vars[slot->params[j].ix];
+
+            var->value = info[slot->params[j].ix].value;
+            var->type = logic_type (slot->params[j].datatype);
+         }
+      }
+
+      if (logic_load (&logic, program, size, vars, n_vars, &error) == 0)
+      {
+         printf (
+            "Loaded logic %s, WCET %" PRIu32 " + %" PRIu32 " cycles\n",
+            LOGIC_CMD_FILE,
+            logic.sync.wcet,
+            logic.avail.wcet);
+         cycle_stats_register (&logic_sync_stats);
+         cycle_stats_register (&logic_avail_stats);
+         logic_enabled = true;
+         error = NULL;
+      }
+   }
+
+   if (error != NULL)
+   {
+      printf ("Invalid logic program %s: %s\n", LOGIC_CMD_FILE, error);
+   }
+   free (vars);
+   free (program);
+}
+
+static void show_logic (const char * name, const logic_section_t * section)
+{
+   const cycle_stats_t * stats =
+      (section == &logic.sync) ? &logic_sync_stats : &logic_avail_stats;
+
+   printf (
+      "%-6s %5u insns  WCET %6" PRIu32 " cycles (%" PRIu32 " us)",
+      name,
+      section->n,
+      section->wcet,
+      cycle_stats_to_us (section->wcet));
+   if (stats->count > 0)
+   {
+      printf ("  measured max %6" PRIu32 " cycles", stats->max);
+   }
+   printf ("\n");
+}
+
+int _cmd_logic (int argc, char * argv[])
+{
+   if (argc == 2 && (logic.sync.n + logic.avail.n) > 0)
+   {
+      if (strcmp (argv[1], "on") == 0)
+      {
+         logic_enabled = true;
+      }
+      else if (strcmp (argv[1], "off") == 0)
+      {
+         logic_enabled = false;
+      }
+      else
+      {
+         printf ("error - try \"help %s\"\n", argv[0]);
+         return -1;
+      }
+   }
+   else if (argc != 1)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   if ((logic.sync.n + logic.avail.n) == 0)
+   {
+      printf ("No logic loaded, see %s\n", LOGIC_CMD_FILE);
+      return 0;
+   }
+
+   printf ("Logic %s\n", logic_enabled ? "on" : "off");
+   show_logic ("sync", &logic.sync);
+   show_logic ("avail", &logic.avail);
+   printf ("Memory cells:");
+   for (int i = 0; i < LOGIC_MEM_SIZE; i++)
+   {
+      printf (" %" PRIi32, logic.mem[i]);
+   }
+   printf ("\n");
+   return 0;
+}
+
+const shell_cmd_t cmd_logic = {
+   .cmd = _cmd_logic,
+   .name = "logic",
+   .help_short = "show or enable local logic",
+   .help_long =
+      "Show the local logic program loaded from " LOGIC_CMD_FILE ",\n"
+      "its estimated worst case execution time per section and the\n"
+      "measured maximum. on/off enables or disables the logic.\n"
+      "Usage: logic [on|off]\n"};
+
+SHELL_CMD (cmd_logic);
@@ -0,0 +1,45 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+
+#ifndef LOGIC_CMD_H_
+#define LOGIC_CMD_H_
+
+#include "up_types.h"
+
+#define LOGIC_CMD_FILE STORAGE_ROOT "logic.bin"
+
+/**
+ * Load local logic from LOGIC_CMD_FILE, if present, and enable it.
+ * Signals are accessed by index, parameters are read only. The logic is
+ * shown and enabled or disabled with the 'logic' shell command.
+ *
+ * @param device     Device model
+ * @param info       Signal table
+ */
+extern void logic_cmd_load (
+   const up_device_t * device,
+   const up_signal_info_t * info);
+
+/**
+ * Run the sync section of the local logic. Called from cb_sync before
+ * the inputs are written, does nothing unless logic is enabled.
+ */
+extern void logic_cmd_run_sync (void);
+
+/**
+ * Run the avail section of the local logic. Called from cb_avail after
+ * the outputs are read, does nothing unless logic is enabled.
+ */
+extern void logic_cmd_run_avail (void);
+
+#endif /* LOGIC_CMD_H_ */
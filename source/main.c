@@ -28,6 +28,9 @@
 #include "osal_log.h"
 
 #include "uphy_demo_app.h"
+#include "cache_config.h"
+#include "cycle_stats.h"
+#include "mem_sections.h"
 #include "shell.h"
 #include "filesys.h"
 #include <inttypes.h>
@@ -128,7 +131,7 @@ void led_error (void)
  * bit value 1 => LED ON
  * bit value 0 => LED OFF
  */
-void digio_set_output (uint8_t data)
+APP_ITCM_FUNC void digio_set_output (uint8_t data)
 {
    cyhal_gpio_write (CYBSP_USER_LED1, (data & 0x01) ? LED_ON : LED_OFF);
    cyhal_gpio_write (CYBSP_USER_LED2, (data & 0x02) ? LED_ON : LED_OFF);
@@ -138,7 +141,7 @@ void digio_set_output (uint8_t data)
  * Button pressed => bit value 1
  * Button released => bit value 0
  */
-uint8 digio_get_input (void)
+APP_ITCM_FUNC uint8_t digio_get_input (void)
 {
    uint8_t data = 0;
 
@@ -308,6 +311,10 @@ int main (void)
 {
    cy_rslt_t result;
 
+   /* Enable cycle counter used for execution time measurements. Started
+    * first so that boot time can be measured from here. */
+   cycle_stats_init();
+
    /* Initialize the device and board peripherals */
    result = cybsp_init();
    if (result != CY_RSLT_SUCCESS)
@@ -315,6 +322,9 @@ int main (void)
       CY_ASSERT (0);
    }
 
+   /* Exclude Ethernet DMA buffers from the data cache */
+   cache_config_init();
+
    /* init all subsystems in task context */
    start_init_task();
 
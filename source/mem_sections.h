@@ -0,0 +1,40 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef MEM_SECTIONS_H_
+#define MEM_SECTIONS_H_
+
+/*
+ * Placement of hot code and data in the CM7_0 tightly coupled memories.
+ *
+ * Functions tagged APP_ITCM_FUNC are copied from flash to ITCM at startup
+ * and data tagged APP_DTCM_DATA is copied to DTCM. Both regions are 16 KiB
+ * (see uphy-linker-script.ld) so only code executed every U-Phy cycle
+ * belongs here. By input section name, the linker script also places the
+ * lwIP checksum routines (inet_chksum.o) in ITCM and the generated process
+ * image (up_data in model.o) in DTCM. The Ethernet driver, its interrupt
+ * handler and its descriptors are not in the TCMs.
+ *
+ * Define APP_DISABLE_TCM to keep the tagged application code and data in
+ * flash/SRAM, e.g. to compare cycle counts using the 'cycles' shell
+ * command. Library placement is controlled by the linker script only.
+ */
+
+#if defined(APP_DISABLE_TCM) || !defined(__GNUC__)
+#define APP_ITCM_FUNC
+#define APP_DTCM_DATA
+#else
+#define APP_ITCM_FUNC __attribute__ ((section (".cy_itcm"), noinline))
+#define APP_DTCM_DATA __attribute__ ((section (".cy_dtcm")))
+#endif
+
+#endif /* MEM_SECTIONS_H_ */
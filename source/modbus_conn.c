@@ -0,0 +1,224 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Modbus TCP client connection supervision.
+ *
+ * The Modbus TCP server in the U-Phy library accepts clients until the
+ * lwIP PCB pool is exhausted. HMI/SCADA clients that disappear without
+ * closing the connection, or that connect and stay silent, would then
+ * block new clients until TCP keepalive kicks in. This module runs in
+ * the TCPIP thread, tracks the clients of the server port and aborts
+ * idle connections and the most idle ones when over the client limit.
+ */
+
+#include "modbus_conn.h"
+#include "shell.h"
+
+#include "lwip/opt.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcp_priv.h"
+
+#include "FreeRTOS.h"
+#include "timers.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* lwIP TCP slow timer runs every TCP_SLOW_INTERVAL ms, pcb->tmr is
+ * updated on every received segment */
+#define TICKS_TO_S(t) (((t) * TCP_SLOW_INTERVAL) / 1000)
+
+typedef struct modbus_conn_stats
+{
+   uint16_t clients;
+   uint16_t max_clients;
+   uint32_t reaped_idle;
+   uint32_t reaped_limit;
+} modbus_conn_stats_t;
+
+static uint16_t server_port;
+static uint32_t idle_timeout = MODBUS_CONN_IDLE_TIMEOUT_DEFAULT;
+static modbus_conn_stats_t stats;
+static TimerHandle_t supervision_timer;
+
+static uint32_t pcb_idle_s (const struct tcp_pcb * pcb)
+{
+   return TICKS_TO_S (tcp_ticks - pcb->tmr);
+}
+
+/* Return the most idle client connection or NULL if none */
+static struct tcp_pcb * most_idle_client (uint16_t * n_clients)
+{
+   struct tcp_pcb * pcb;
+   struct tcp_pcb * idle = NULL;
+
+   *n_clients = 0;
+   for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next)
+   {
+      if (pcb->local_port != server_port || pcb->state != ESTABLISHED)
+      {
+         continue;
+      }
+
+      (*n_clients)++;
+      if (idle == NULL || (tcp_ticks - pcb->tmr) > (tcp_ticks - idle->tmr))
+      {
+         idle = pcb;
+      }
+   }
+
+   return idle;
+}
+
+/* Runs in TCPIP thread */
+static void modbus_conn_supervise (void * arg)
+{
+   struct tcp_pcb * pcb;
+   uint16_t n_clients;
+
+   (void)arg;
+
+   /* Abort one connection at a time, as the list is modified */
+   for (;;)
+   {
+      pcb = most_idle_client (&n_clients);
+      if (pcb == NULL)
+      {
+         break;
+      }
+
+      if (n_clients > MODBUS_MAX_CLIENTS)
+      {
+         stats.reaped_limit++;
+      }
+      else if (idle_timeout > 0 && pcb_idle_s (pcb) >= idle_timeout)
+      {
+         stats.reaped_idle++;
+      }
+      else
+      {
+         break;
+      }
+
+      tcp_abort (pcb);
+   }
+
+   stats.clients = n_clients;
+   if (n_clients > stats.max_clients)
+   {
+      stats.max_clients = n_clients;
+   }
+}
+
+static void supervision_timer_cb (TimerHandle_t timer)
+{
+   (void)timer;
+   tcpip_try_callback (modbus_conn_supervise, NULL);
+}
+
+int modbus_conn_init (uint16_t port)
+{
+   server_port = port;
+
+   if (supervision_timer == NULL)
+   {
+      supervision_timer = xTimerCreate (
+         "mbus_conn",
+         pdMS_TO_TICKS (MODBUS_CONN_SUPERVISION_INTERVAL),
+         pdTRUE,
+         NULL,
+         supervision_timer_cb);
+   }
+
+   if (supervision_timer == NULL ||
+       xTimerStart (supervision_timer, 0) != pdPASS)
+   {
+      printf ("Failed to start Modbus connection supervision\n");
+      return -1;
+   }
+
+   return 0;
+}
+
+void modbus_conn_stop (void)
+{
+   if (supervision_timer != NULL)
+   {
+      xTimerStop (supervision_timer, portMAX_DELAY);
+   }
+
+   /* A supervision run already queued to the TCPIP thread matches no
+    * connection */
+   server_port = 0;
+   stats.clients = 0;
+}
+
+static void print_clients (void)
+{
+   struct tcp_pcb * pcb;
+
+   LOCK_TCPIP_CORE();
+   for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next)
+   {
+      if (pcb->local_port == server_port && pcb->state == ESTABLISHED)
+      {
+         printf (
+            "  %-15s : %-5" PRIu16 " idle %" PRIu32 " s\n",
+            ipaddr_ntoa (&pcb->remote_ip),
+            pcb->remote_port,
+            pcb_idle_s (pcb));
+      }
+   }
+   UNLOCK_TCPIP_CORE();
+}
+
+static int _cmd_mbus_conn (int argc, char * argv[])
+{
+   if (argc == 2)
+   {
+      idle_timeout = strtoul (argv[1], NULL, 0);
+   }
+   else if (argc != 1)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   if (supervision_timer == NULL || server_port == 0)
+   {
+      printf ("Modbus TCP not started\n");
+      return 0;
+   }
+
+   printf ("Port            : %" PRIu16 "\n", server_port);
+   printf ("Client limit    : %d\n", MODBUS_MAX_CLIENTS);
+   printf ("Idle timeout    : %" PRIu32 " s\n", idle_timeout);
+   printf ("Clients         : %" PRIu16 "\n", stats.clients);
+   printf ("Max clients     : %" PRIu16 "\n", stats.max_clients);
+   printf ("Reaped (idle)   : %" PRIu32 "\n", stats.reaped_idle);
+   printf ("Reaped (limit)  : %" PRIu32 "\n", stats.reaped_limit);
+   print_clients();
+
+   return 0;
+}
+
+const shell_cmd_t cmd_mbus_conn = {
+   .cmd = _cmd_mbus_conn,
+   .name = "mbus_conn",
+   .help_short = "show Modbus TCP client connections",
+   .help_long = "Show Modbus TCP client connections and optionally set\n"
+                "the idle timeout (0 disables idle disconnect).\n"
+                "Usage: mbus_conn [idle_timeout_s]\n"};
+
+SHELL_CMD (cmd_mbus_conn);
@@ -0,0 +1,44 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef MODBUS_CONN_H_
+#define MODBUS_CONN_H_
+
+#include <stdint.h>
+
+/* Default time before an idle Modbus TCP client is disconnected, in
+ * seconds. 0 disables idle reaping. */
+#define MODBUS_CONN_IDLE_TIMEOUT_DEFAULT 60
+
+/* Interval between connection supervision runs, in milliseconds */
+#define MODBUS_CONN_SUPERVISION_INTERVAL 1000
+
+/**
+ * Start supervision of Modbus TCP client connections.
+ *
+ * Connections to the given local port are checked periodically. Clients
+ * idle for longer than the idle timeout are disconnected and, when more
+ * than MODBUS_MAX_CLIENTS (lwipopts.h) clients are connected, the most
+ * idle ones are disconnected to make room for new clients.
+ *
+ * @param port    Modbus TCP server port
+ * @return 0 on success, -1 on error
+ */
+extern int modbus_conn_init (uint16_t port);
+
+/**
+ * Stop supervision of Modbus TCP client connections, e.g. when switching
+ * to another protocol. Started again by modbus_conn_init().
+ */
+extern void modbus_conn_stop (void);
+
+#endif /* MODBUS_CONN_H_ */
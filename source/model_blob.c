@@ -0,0 +1,776 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Runtime loaded device model.
+ *
+ * A model blob is validated once and then used where it is stored, in
+ * code flash or in a single buffer read from the filesystem. Only the
+ * descriptor tables required by the U-Phy API and the process image are
+ * allocated, in one block sized from the blob header.
+ */
+
+#include "model_blob.h"
+#include "crc.h"
+#include "shell.h"
+#include "rte_fs.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MODEL_FILE STORAGE_ROOT "model.bin"
+
+/* The CRC covers everything after the crc field */
+#define CRC_START (offsetof (model_blob_header_t, crc) + sizeof (uint32_t))
+
+/* Model region in code flash, see uphy-linker-script.ld */
+extern const uint8_t __model_blob_start__[];
+extern const uint8_t __model_blob_end__[];
+
+static const up_dtype_t dtypes[MODEL_BLOB_DTYPE_MAX] = {
+   [MODEL_BLOB_DTYPE_UINT8] = UP_DTYPE_UINT8,
+   [MODEL_BLOB_DTYPE_UINT16] = UP_DTYPE_UINT16,
+   [MODEL_BLOB_DTYPE_UINT32] = UP_DTYPE_UINT32,
+   [MODEL_BLOB_DTYPE_INT8] = UP_DTYPE_INT8,
+   [MODEL_BLOB_DTYPE_INT16] = UP_DTYPE_INT16,
+   [MODEL_BLOB_DTYPE_INT32] = UP_DTYPE_INT32,
+   [MODEL_BLOB_DTYPE_REAL32] = UP_DTYPE_REAL32,
+   [MODEL_BLOB_DTYPE_OCTET_STRING] = UP_DTYPE_OCTET_STRING,
+};
+
+/* Active model, for the shell command */
+static const model_blob_model_t * active;
+
+/* Bump allocator for the descriptor tables */
+typedef struct arena
+{
+   uint8_t * next;
+   size_t left;
+} arena_t;
+
+static void * arena_get (arena_t * arena, size_t n, size_t size)
+{
+   size_t bytes = (n * size + 3) & ~(size_t)3;
+   void * p = arena->next;
+
+   if (bytes > arena->left)
+   {
+      return NULL;
+   }
+   arena->next += bytes;
+   arena->left -= bytes;
+   return p;
+}
+
+static size_t arena_size (size_t n, size_t size)
+{
+   return (n * size + 3) & ~(size_t)3;
+}
+
+static const void * at (const model_blob_header_t * blob, uint32_t offset)
+{
+   return (const uint8_t *)blob + offset;
+}
+
+/* Check that an array of n records at offset is inside the blob. n is
+ * compared to the space left, as n * size may overflow. */
+static bool in_blob (
+   const model_blob_header_t * blob,
+   uint32_t offset,
+   size_t n,
+   size_t size)
+{
+   if (n == 0)
+   {
+      return true;
+   }
+   return offset >= blob->header_size && (offset & 3) == 0 &&
+          offset < blob->size && n <= (blob->size - offset) / size;
+}
+
+static bool is_str (const model_blob_header_t * blob, uint32_t offset)
+{
+   if (offset == 0)
+   {
+      return true;
+   }
+   return offset >= blob->header_size && offset < blob->size &&
+          memchr (at (blob, offset), 0, blob->size - offset) != NULL;
+}
+
+static bool in_image (
+   const model_blob_header_t * blob,
+   const model_blob_region_t * region)
+{
+   return region->values <= blob->data_size &&
+          region->values_size <= blob->data_size - region->values &&
+          region->status <= blob->data_size &&
+          region->n <= blob->data_size - region->status;
+}
+
+static bool check_signals (
+   const model_blob_header_t * blob,
+   uint32_t offset,
+   uint16_t n)
+{
+   const model_blob_signal_t * s = at (blob, offset);
+   const model_blob_var_t * vars = at (blob, blob->vars);
+
+   if (!in_blob (blob, offset, n, sizeof (*s)))
+   {
+      return false;
+   }
+
+   for (uint16_t i = 0; i < n; i++)
+   {
+      if (
+         !is_str (blob, s[i].name) || s[i].ix >= blob->n_vars ||
+         s[i].datatype >= MODEL_BLOB_DTYPE_MAX)
+      {
+         return false;
+      }
+
+      /* Value must fit in the process image */
+      if (
+         vars[s[i].ix].value > blob->data_size ||
+         (s[i].bitlength + 7u) / 8 > blob->data_size - vars[s[i].ix].value)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+static bool check_names (const model_blob_header_t * blob)
+{
+   const model_blob_names_t * names = at (blob, blob->names);
+   const model_blob_slot_t * slots = at (blob, blob->slots);
+   const model_blob_name_t * entries;
+
+   if (
+      !in_blob (blob, blob->names, 1, sizeof (*names)) ||
+      names->n_buckets == 0 || names->n_entries == 0 ||
+      !in_blob (blob, names->displacement, names->n_buckets, 2) ||
+      !in_blob (blob, names->entries, names->n_entries, sizeof (*entries)))
+   {
+      return false;
+   }
+
+   entries = at (blob, names->entries);
+   for (uint32_t i = 0; i < names->n_entries; i++)
+   {
+      const model_blob_name_t * e = &entries[i];
+      uint16_t n;
+
+      if (e->kind == MODEL_BLOB_KIND_EMPTY)
+      {
+         continue;
+      }
+      if (e->slot >= blob->n_slots || e->ix >= blob->n_vars)
+      {
+         return false;
+      }
+
+      switch (e->kind)
+      {
+      case MODEL_BLOB_KIND_INPUT:
+         n = slots[e->slot].n_inputs;
+         break;
+      case MODEL_BLOB_KIND_OUTPUT:
+         n = slots[e->slot].n_outputs;
+         break;
+      case MODEL_BLOB_KIND_PARAM:
+         n = slots[e->slot].n_params;
+         break;
+      default:
+         return false;
+      }
+
+      if (e->index >= n)
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static bool check_swaps (const model_blob_header_t * blob)
+{
+   const model_blob_swap_t * swaps = at (blob, blob->swaps);
+
+   if (!in_blob (blob, blob->swaps, 2 * blob->n_slots, sizeof (*swaps)))
+   {
+      return false;
+   }
+
+   for (uint32_t i = 0; i < 2u * blob->n_slots; i++)
+   {
+      const model_blob_swap_run_t * runs = at (blob, swaps[i].runs);
+
+      if (!in_blob (blob, swaps[i].runs, swaps[i].n_runs, sizeof (*runs)))
+      {
+         return false;
+      }
+
+      for (uint16_t j = 0; j < swaps[i].n_runs; j++)
+      {
+         const model_blob_swap_run_t * run = &runs[j];
+
+         if (
+            (run->width != 2 && run->width != 4 && run->width != 8) ||
+            run->offset > blob->data_size ||
+            (uint32_t)run->width * run->count >
+               blob->data_size - run->offset)
+         {
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+static bool check_conditioning (const model_blob_header_t * blob)
+{
+   const model_blob_conditioning_t * c = at (blob, blob->conditioning);
+   const model_blob_var_t * vars = at (blob, blob->vars);
+   const model_blob_channel_t * channels;
+   uint32_t n;
+
+   if (!in_blob (blob, blob->conditioning, 1, sizeof (*c)) || c->window == 0)
+   {
+      return false;
+   }
+
+   n = c->n_iir + c->n_avg + c->n_none;
+   if (!in_blob (blob, c->channels, n, sizeof (*channels)))
+   {
+      return false;
+   }
+
+   channels = at (blob, c->channels);
+   for (uint32_t i = 0; i < n; i++)
+   {
+      const model_blob_var_t * var;
+
+      if (channels[i].ix >= blob->n_vars)
+      {
+         return false;
+      }
+
+      /* Channel value is a float in the process image */
+      var = &vars[channels[i].ix];
+      if (
+         var->status == MODEL_BLOB_NO_STATUS ||
+         blob->data_size < sizeof (float) ||
+         var->value > blob->data_size - sizeof (float))
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static bool check_blob (const model_blob_header_t * blob, size_t size)
+{
+   const model_blob_slot_t * slots;
+   const model_blob_var_t * vars;
+
+   if (
+      size < sizeof (*blob) || blob->magic != MODEL_BLOB_MAGIC ||
+      blob->version != MODEL_BLOB_VERSION ||
+      blob->header_size != sizeof (*blob) || blob->size > size ||
+      blob->size < sizeof (*blob))
+   {
+      return false;
+   }
+
+   if (crc32 (at (blob, CRC_START), blob->size - CRC_START) != blob->crc)
+   {
+      return false;
+   }
+
+   if (
+      !is_str (blob, blob->name) || !is_str (blob, blob->serial_number) ||
+      !in_blob (blob, blob->slots, blob->n_slots, sizeof (*slots)) ||
+      !in_blob (blob, blob->vars, blob->n_vars, sizeof (*vars)) ||
+      !in_blob (blob, blob->data_init, blob->data_size, 1))
+   {
+      return false;
+   }
+
+   vars = at (blob, blob->vars);
+   for (uint16_t i = 0; i < blob->n_vars; i++)
+   {
+      if (
+         vars[i].value >= blob->data_size ||
+         (vars[i].status != MODEL_BLOB_NO_STATUS &&
+          vars[i].status >= blob->data_size))
+      {
+         return false;
+      }
+   }
+
+   if (
+      (blob->evk_input_ix != MODEL_BLOB_NO_IX &&
+       blob->evk_input_ix >= blob->n_vars) ||
+      (blob->evk_output_ix != MODEL_BLOB_NO_IX &&
+       blob->evk_output_ix >= blob->n_vars))
+   {
+      return false;
+   }
+
+   if (
+      blob->layout > MODEL_BLOB_LAYOUT_SOA ||
+      !in_image (blob, &blob->inputs) || !in_image (blob, &blob->outputs))
+   {
+      return false;
+   }
+
+   slots = at (blob, blob->slots);
+   for (uint16_t i = 0; i < blob->n_slots; i++)
+   {
+      if (
+         !is_str (blob, slots[i].name) ||
+         !check_signals (blob, slots[i].inputs, slots[i].n_inputs) ||
+         !check_signals (blob, slots[i].outputs, slots[i].n_outputs) ||
+         !check_signals (blob, slots[i].params, slots[i].n_params))
+      {
+         return false;
+      }
+   }
+
+   if (blob->profinet != 0)
+   {
+      const model_blob_profinet_t * pn = at (blob, blob->profinet);
+      const model_blob_pn_module_t * modules;
+
+      if (
+         !in_blob (blob, blob->profinet, 1, sizeof (*pn)) ||
+         !is_str (blob, pn->default_stationname) ||
+         !is_str (blob, pn->order_id) ||
+         !in_blob (blob, pn->modules, pn->n_modules, sizeof (*modules)) ||
+         !in_blob (blob, pn->slots, pn->n_slots, sizeof (uint16_t)))
+      {
+         return false;
+      }
+
+      modules = at (blob, pn->modules);
+      for (uint16_t i = 0; i < pn->n_modules; i++)
+      {
+         if (!in_blob (blob, modules[i].params, modules[i].n_params, 4))
+         {
+            return false;
+         }
+      }
+   }
+
+   if (blob->names != 0 && !check_names (blob))
+   {
+      return false;
+   }
+
+   if (blob->swaps != 0 && !check_swaps (blob))
+   {
+      return false;
+   }
+
+   if (blob->conditioning != 0 && !check_conditioning (blob))
+   {
+      return false;
+   }
+
+   if (
+      blob->ethernetip != 0 &&
+      !in_blob (blob, blob->ethernetip, 1, sizeof (model_blob_ethernetip_t)))
+   {
+      return false;
+   }
+
+   return blob->modbus == 0 ||
+          in_blob (blob, blob->modbus, 1, sizeof (model_blob_modbus_t));
+}
+
+static size_t arena_size_needed (const model_blob_header_t * blob)
+{
+   const model_blob_slot_t * slots = at (blob, blob->slots);
+   size_t size = 0;
+
+   size += arena_size (blob->n_slots, sizeof (up_slot_t));
+   for (uint16_t i = 0; i < blob->n_slots; i++)
+   {
+      size += arena_size (slots[i].n_inputs, sizeof (up_signal_t));
+      size += arena_size (slots[i].n_outputs, sizeof (up_signal_t));
+      size += arena_size (slots[i].n_params, sizeof (up_param_t));
+   }
+   size += arena_size (blob->n_vars, sizeof (up_signal_info_t));
+   size += arena_size (blob->data_size, 1);
+
+   if (blob->profinet != 0)
+   {
+      const model_blob_profinet_t * pn = at (blob, blob->profinet);
+      const model_blob_pn_module_t * modules = at (blob, pn->modules);
+
+      size += arena_size (pn->n_modules, sizeof (up_pn_module_t));
+      size += arena_size (pn->n_slots, sizeof (up_pn_slot_t));
+      for (uint16_t i = 0; i < pn->n_modules; i++)
+      {
+         size += arena_size (modules[i].n_params, sizeof (up_pn_param_t));
+      }
+   }
+
+   return size;
+}
+
+static void set_signals (
+   const model_blob_header_t * blob,
+   up_signal_t * signals,
+   uint32_t offset,
+   uint16_t n)
+{
+   const model_blob_signal_t * s = at (blob, offset);
+
+   for (uint16_t i = 0; i < n; i++)
+   {
+      signals[i].name = model_blob_str (blob, s[i].name);
+      signals[i].ix = s[i].ix;
+      signals[i].datatype = dtypes[s[i].datatype];
+      signals[i].bitlength = s[i].bitlength;
+      signals[i].flags = s[i].flags;
+      signals[i].frame_offset = s[i].frame_offset;
+   }
+}
+
+static void set_params (
+   const model_blob_header_t * blob,
+   up_param_t * params,
+   uint32_t offset,
+   uint16_t n)
+{
+   const model_blob_signal_t * s = at (blob, offset);
+
+   for (uint16_t i = 0; i < n; i++)
+   {
+      params[i].name = model_blob_str (blob, s[i].name);
+      params[i].ix = s[i].ix;
+      params[i].datatype = dtypes[s[i].datatype];
+      params[i].bitlength = s[i].bitlength;
+      params[i].frame_offset = s[i].frame_offset;
+   }
+}
+
+static void set_profinet (
+   model_blob_model_t * model,
+   const model_blob_header_t * blob,
+   arena_t * arena)
+{
+   const model_blob_profinet_t * pn = at (blob, blob->profinet);
+   const model_blob_pn_module_t * modules = at (blob, pn->modules);
+   const uint16_t * slots = at (blob, pn->slots);
+   up_profinet_config_t * config = &model->profinet;
+   up_pn_module_t * pn_modules;
+   up_pn_slot_t * pn_slots;
+
+   pn_modules = arena_get (arena, pn->n_modules, sizeof (*pn_modules));
+   pn_slots = arena_get (arena, pn->n_slots, sizeof (*pn_slots));
+
+   for (uint16_t i = 0; i < pn->n_modules; i++)
+   {
+      const uint32_t * index = at (blob, modules[i].params);
+      up_pn_param_t * params;
+
+      params = arena_get (arena, modules[i].n_params, sizeof (*params));
+      for (uint16_t j = 0; j < modules[i].n_params; j++)
+      {
+         params[j].pn_index = index[j];
+      }
+
+      pn_modules[i].module_id = modules[i].module_id;
+      pn_modules[i].submodule_id = modules[i].submodule_id;
+      pn_modules[i].n_params = modules[i].n_params;
+      pn_modules[i].params = modules[i].n_params > 0 ? params : NULL;
+   }
+
+   for (uint16_t i = 0; i < pn->n_slots; i++)
+   {
+      pn_slots[i].module_ix = slots[i];
+   }
+
+   config->vendor_id = pn->vendor_id;
+   config->device_id = pn->device_id;
+   config->dap_module_id = pn->dap_module_id;
+   config->dap_identity_submodule_id = pn->dap_identity_submodule_id;
+   config->dap_interface_submodule_id = pn->dap_interface_submodule_id;
+   config->dap_port_1_submodule_id = pn->dap_port_1_submodule_id;
+   config->dap_port_2_submodule_id = pn->dap_port_2_submodule_id;
+   config->profile_id = pn->profile_id;
+   config->profile_specific_type = pn->profile_specific_type;
+   config->min_device_interval = pn->min_device_interval;
+   config->default_stationname =
+      model_blob_str (blob, pn->default_stationname);
+   config->order_id = model_blob_str (blob, pn->order_id);
+   config->hw_revision = pn->hw_revision;
+   config->sw_revision_prefix = pn->sw_revision_prefix;
+   config->sw_revision_functional_enhancement =
+      pn->sw_revision_functional_enhancement;
+   config->sw_revision_bug_fix = pn->sw_revision_bug_fix;
+   config->sw_revision_internal_change = pn->sw_revision_internal_change;
+   config->revision_counter = pn->revision_counter;
+   config->n_modules = pn->n_modules;
+   config->n_slots = pn->n_slots;
+   config->modules = pn_modules;
+   config->slots = pn_slots;
+}
+
+static void set_ethernetip (
+   model_blob_model_t * model,
+   const model_blob_header_t * blob)
+{
+   const model_blob_ethernetip_t * eip = at (blob, blob->ethernetip);
+   up_ethernetip_config_t * config = &model->ethernetip;
+
+   config->vendor_id = eip->vendor_id;
+   config->device_type = eip->device_type;
+   config->product_code = eip->product_code;
+   config->major_revision = eip->major_revision;
+   config->minor_revision = eip->minor_revision;
+   config->min_data_interval = eip->min_data_interval;
+   config->default_data_interval = eip->default_data_interval;
+   config->input_assembly_id = eip->input_assembly_id;
+   config->output_assembly_id = eip->output_assembly_id;
+   config->config_assembly_id = eip->config_assembly_id;
+   config->input_only_heartbeat_assembly_id =
+      eip->input_only_heartbeat_assembly_id;
+   config->listen_only_heartbeat_assembly_id =
+      eip->listen_only_heartbeat_assembly_id;
+}
+
+int model_blob_map (
+   model_blob_model_t * model,
+   const void * data,
+   size_t size)
+{
+   const model_blob_header_t * blob = data;
+   const model_blob_slot_t * slots;
+   const model_blob_var_t * vars;
+   up_slot_t * up_slots;
+   arena_t arena;
+   size_t arena_bytes;
+
+   if (((uintptr_t)data & 3) != 0 || !check_blob (blob, size))
+   {
+      return -1;
+   }
+
+   arena_bytes = arena_size_needed (blob);
+   arena.next = calloc (1, arena_bytes > 0 ? arena_bytes : 1);
+   arena.left = arena_bytes;
+   if (arena.next == NULL)
+   {
+      return -1;
+   }
+
+   memset (model, 0, sizeof (*model));
+   model->blob = blob;
+
+   slots = at (blob, blob->slots);
+   up_slots = arena_get (&arena, blob->n_slots, sizeof (*up_slots));
+   for (uint16_t i = 0; i < blob->n_slots; i++)
+   {
+      up_signal_t * inputs;
+      up_signal_t * outputs;
+      up_param_t * params;
+
+      inputs = arena_get (&arena, slots[i].n_inputs, sizeof (*inputs));
+      outputs = arena_get (&arena, slots[i].n_outputs, sizeof (*outputs));
+      params = arena_get (&arena, slots[i].n_params, sizeof (*params));
+
+      set_signals (blob, inputs, slots[i].inputs, slots[i].n_inputs);
+      set_signals (blob, outputs, slots[i].outputs, slots[i].n_outputs);
+      set_params (blob, params, slots[i].params, slots[i].n_params);
+
+      up_slots[i].name = model_blob_str (blob, slots[i].name);
+      up_slots[i].input_bitlength = slots[i].input_bitlength;
+      up_slots[i].output_bitlength = slots[i].output_bitlength;
+      up_slots[i].n_inputs = slots[i].n_inputs;
+      up_slots[i].inputs = slots[i].n_inputs > 0 ? inputs : NULL;
+      up_slots[i].n_outputs = slots[i].n_outputs;
+      up_slots[i].outputs = slots[i].n_outputs > 0 ? outputs : NULL;
+      up_slots[i].n_params = slots[i].n_params;
+      up_slots[i].params = slots[i].n_params > 0 ? params : NULL;
+   }
+
+   model->vars = arena_get (&arena, blob->n_vars, sizeof (*model->vars));
+   model->data = arena_get (&arena, blob->data_size, 1);
+   if (blob->data_size > 0)
+   {
+      memcpy (model->data, at (blob, blob->data_init), blob->data_size);
+   }
+
+   vars = at (blob, blob->vars);
+   for (uint16_t i = 0; i < blob->n_vars; i++)
+   {
+      model->vars[i].value = model->data + vars[i].value;
+      model->vars[i].status = (vars[i].status != MODEL_BLOB_NO_STATUS)
+                                 ? model->data + vars[i].status
+                                 : NULL;
+   }
+
+   model->device.name = model_blob_str (blob, blob->name);
+   model->device.cfg.serial_number = model_blob_str (blob, blob->serial_number);
+   model->device.cfg.webgui_enable =
+      (blob->flags & MODEL_BLOB_FLAG_WEBGUI) != 0;
+   model->device.bustype = UP_BUSTYPE_MOCK;
+   model->device.n_slots = blob->n_slots;
+   model->device.slots = up_slots;
+
+   if (blob->profinet != 0)
+   {
+      model->has_profinet = true;
+      set_profinet (model, blob, &arena);
+   }
+
+   if (blob->ethernetip != 0)
+   {
+      model->has_ethernetip = true;
+      set_ethernetip (model, blob);
+   }
+
+   if (blob->modbus != 0)
+   {
+      const model_blob_modbus_t * modbus = at (blob, blob->modbus);
+
+      model->has_modbus = true;
+      model->modbus.port = modbus->port;
+   }
+
+   active = model;
+   return 0;
+}
+
+static int load_file (model_blob_model_t * model)
+{
+   model_blob_header_t header;
+   RTE_FILE * f;
+   void * blob;
+   size_t n;
+
+   f = rte_fs_fopen (MODEL_FILE, "r");
+   if (f == NULL)
+   {
+      return -1;
+   }
+
+   /* The header gives the size, then read the rest in one go */
+   n = rte_fs_fread (&header, 1, sizeof (header), f);
+   if (
+      n != sizeof (header) || header.magic != MODEL_BLOB_MAGIC ||
+      header.size < sizeof (header))
+   {
+      rte_fs_fclose (f);
+      return -1;
+   }
+
+   blob = malloc (header.size);
+   if (blob == NULL)
+   {
+      rte_fs_fclose (f);
+      return -1;
+   }
+
+   memcpy (blob, &header, sizeof (header));
+   n = sizeof (header);
+   n += rte_fs_fread (
+      (uint8_t *)blob + sizeof (header),
+      1,
+      header.size - sizeof (header),
+      f);
+   rte_fs_fclose (f);
+
+   if (n != header.size || model_blob_map (model, blob, n) != 0)
+   {
+      printf ("Invalid model blob %s\n", MODEL_FILE);
+      free (blob);
+      return -1;
+   }
+
+   model->source = MODEL_FILE;
+   return 0;
+}
+
+int model_blob_load (model_blob_model_t * model)
+{
+   const model_blob_header_t * blob =
+      (const model_blob_header_t *)__model_blob_start__;
+   size_t size = __model_blob_end__ - __model_blob_start__;
+
+   if (load_file (model) == 0)
+   {
+      return 0;
+   }
+
+   /* Erased flash does not match the magic */
+   if (size < sizeof (*blob) || blob->magic != MODEL_BLOB_MAGIC)
+   {
+      return -1;
+   }
+
+   if (model_blob_map (model, blob, size) != 0)
+   {
+      printf ("Invalid model blob in flash\n");
+      return -1;
+   }
+
+   model->source = "flash";
+   return 0;
+}
+
+static int _cmd_model (int argc, char * argv[])
+{
+   const model_blob_header_t * blob;
+
+   if (active == NULL)
+   {
+      printf ("Using compiled in model\n");
+      return 0;
+   }
+
+   blob = active->blob;
+   printf ("Source     : %s at %p\n", active->source, (void *)blob);
+   printf ("Device     : %s\n", active->device.name);
+   printf ("Version    : %" PRIu16 "\n", blob->version);
+   printf ("Size       : %" PRIu32 " bytes\n", blob->size);
+   printf ("CRC        : 0x%08" PRIx32 "\n", blob->crc);
+   printf ("Slots      : %" PRIu16 "\n", blob->n_slots);
+   printf ("Signals    : %" PRIu16 "\n", blob->n_vars);
+   printf ("Data       : %" PRIu32 " bytes\n", blob->data_size);
+   printf (
+      "Protocols  :%s%s%s\n",
+      active->has_profinet ? " profinet" : "",
+      active->has_ethernetip ? " ethernetip" : "",
+      active->has_modbus ? " modbus" : "");
+
+   return 0;
+}
+
+const shell_cmd_t cmd_model = {
+   .cmd = _cmd_model,
+   .name = "model",
+   .help_short = "show runtime loaded device model",
+   .help_long = "Show the device model blob in use, if any.\n"
+                "Usage: model\n"};
+
+SHELL_CMD (cmd_model);
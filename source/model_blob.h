@@ -0,0 +1,353 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef MODEL_BLOB_H_
+#define MODEL_BLOB_H_
+
+#include "up_types.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Binary device model.
+ *
+ * The blob is produced from the model json file by uphy-model-blob.py
+ * and describes the same device as generated/model.c. All multi-byte
+ * fields are little-endian and all records are 4-byte aligned. References
+ * between records are byte offsets from the start of the blob, with 0
+ * meaning "not present", so the blob is position independent and can be
+ * used in place wherever it is stored. Strings are NUL terminated.
+ *
+ * The layout must be kept in sync with uphy-model-blob.py.
+ */
+
+#define MODEL_BLOB_MAGIC   0x424D5055 /* "UPMB" */
+#define MODEL_BLOB_VERSION 5
+
+#define MODEL_BLOB_NO_STATUS 0xFFFFFFFF
+#define MODEL_BLOB_NO_IX     0xFFFF
+
+/* Header flags */
+#define MODEL_BLOB_FLAG_WEBGUI (1U << 0)
+
+/* Process image layout */
+typedef enum model_blob_layout
+{
+   /* Value and status interleaved per signal, as in generated/model.h */
+   MODEL_BLOB_LAYOUT_AOS = 0,
+   /* Values packed per direction, followed by dense status arrays */
+   MODEL_BLOB_LAYOUT_SOA,
+} model_blob_layout_t;
+
+typedef enum model_blob_dtype
+{
+   MODEL_BLOB_DTYPE_UINT8 = 0,
+   MODEL_BLOB_DTYPE_UINT16,
+   MODEL_BLOB_DTYPE_UINT32,
+   MODEL_BLOB_DTYPE_INT8,
+   MODEL_BLOB_DTYPE_INT16,
+   MODEL_BLOB_DTYPE_INT32,
+   MODEL_BLOB_DTYPE_REAL32,
+   MODEL_BLOB_DTYPE_OCTET_STRING,
+   MODEL_BLOB_DTYPE_MAX,
+} model_blob_dtype_t;
+
+/* Process image region of one direction, MODEL_BLOB_LAYOUT_SOA only.
+ * Offsets are relative to the start of the process image. */
+typedef struct model_blob_region
+{
+   uint32_t values;      /* Packed values, in signal index order */
+   uint32_t values_size; /* Size of packed values */
+   uint32_t status;      /* up_signal_status_t[n] */
+   uint32_t n;           /* Number of signals */
+} model_blob_region_t;
+
+typedef struct model_blob_header
+{
+   uint32_t magic;
+   uint16_t version;
+   uint16_t header_size;
+   uint32_t size; /* Total size of blob, including header */
+   uint32_t crc;  /* CRC-32 of all bytes following this field */
+
+   uint32_t name;          /* Device name */
+   uint32_t serial_number; /* String */
+   uint32_t flags;
+   uint16_t n_slots;
+   uint16_t n_vars;
+   uint32_t slots; /* model_blob_slot_t[n_slots] */
+   uint32_t vars;  /* model_blob_var_t[n_vars] */
+
+   uint32_t data_size; /* Size of process image */
+   uint32_t data_init; /* Initial process image, data_size bytes */
+
+   /* Signals mapped to EVK buttons and LEDs, MODEL_BLOB_NO_IX if none */
+   uint16_t evk_input_ix;
+   uint16_t evk_output_ix;
+
+   uint8_t layout; /* model_blob_layout_t */
+   uint8_t reserved[3];
+   model_blob_region_t inputs;
+   model_blob_region_t outputs;
+
+   /* Protocol configuration, 0 if protocol is not supported */
+   uint32_t profinet;   /* model_blob_profinet_t */
+   uint32_t ethernetip; /* model_blob_ethernetip_t */
+   uint32_t modbus;     /* model_blob_modbus_t */
+
+   uint32_t names; /* model_blob_names_t, 0 if no name index */
+
+   /* Byte swap plans, model_blob_swap_t[n_slots][2] for inputs and
+    * outputs of each slot, 0 if none */
+   uint32_t swaps;
+
+   uint32_t conditioning; /* model_blob_conditioning_t, 0 if none */
+} model_blob_header_t;
+
+typedef struct model_blob_slot
+{
+   uint32_t name;
+   uint16_t input_bitlength;
+   uint16_t output_bitlength;
+   uint16_t n_inputs;
+   uint16_t n_outputs;
+   uint16_t n_params;
+   uint16_t reserved;
+   uint32_t inputs;  /* model_blob_signal_t[n_inputs] */
+   uint32_t outputs; /* model_blob_signal_t[n_outputs] */
+   uint32_t params;  /* model_blob_signal_t[n_params] */
+} model_blob_slot_t;
+
+/* Signal or parameter */
+typedef struct model_blob_signal
+{
+   uint32_t name;
+   uint16_t ix; /* Index in var table */
+   uint8_t datatype; /* model_blob_dtype_t */
+   uint8_t reserved;
+   uint16_t bitlength;
+   uint16_t frame_offset;
+   uint32_t flags;
+} model_blob_signal_t;
+
+/* Location of a signal or parameter in the process image */
+typedef struct model_blob_var
+{
+   uint32_t value;
+   uint32_t status; /* MODEL_BLOB_NO_STATUS for parameters */
+} model_blob_var_t;
+
+/* Signal kind in name index */
+typedef enum model_blob_kind
+{
+   MODEL_BLOB_KIND_INPUT = 0,
+   MODEL_BLOB_KIND_OUTPUT,
+   MODEL_BLOB_KIND_PARAM,
+   MODEL_BLOB_KIND_EMPTY = 0xFF,
+} model_blob_kind_t;
+
+/**
+ * Perfect hash index of "slot.signal" names.
+ *
+ * Names are hashed with FNV-1a after replacing spaces by underscores,
+ * with the seed xor:ed into the offset basis. A key goes to bucket
+ * hash(key, 0) % n_buckets and then to entry
+ * hash(key, displacement[bucket]) % n_entries. Every name has its own
+ * entry, unused entries have kind MODEL_BLOB_KIND_EMPTY.
+ */
+typedef struct model_blob_names
+{
+   uint32_t n_buckets;
+   uint32_t n_entries;
+   uint32_t displacement; /* uint16_t[n_buckets] */
+   uint32_t entries;      /* model_blob_name_t[n_entries] */
+} model_blob_names_t;
+
+typedef struct model_blob_name
+{
+   uint16_t slot;
+   uint8_t kind; /* model_blob_kind_t */
+   uint8_t reserved;
+   uint16_t index; /* Index in inputs, outputs or params of slot */
+   uint16_t ix;    /* Signal index */
+} model_blob_name_t;
+
+/* Byte swap plan of the inputs or outputs of a slot */
+typedef struct model_blob_swap
+{
+   uint16_t n_runs;
+   uint16_t reserved;
+   uint32_t runs; /* model_blob_swap_run_t[n_runs] */
+} model_blob_swap_t;
+
+/* Consecutive fields of the same width in the process image */
+typedef struct model_blob_swap_run
+{
+   uint32_t offset; /* Offset of first field in process image */
+   uint16_t width;  /* Field width in bytes, 2, 4 or 8 */
+   uint16_t count;  /* Number of fields */
+} model_blob_swap_run_t;
+
+/**
+ * Conditioning of analog inputs, see conditioning.h. Channels are
+ * ordered by filter: n_iir with IIR filter, n_avg with moving average
+ * over window samples, then n_none without filter.
+ */
+typedef struct model_blob_conditioning
+{
+   uint16_t n_iir;
+   uint16_t n_avg;
+   uint16_t n_none;
+   uint16_t window;
+   uint32_t channels; /* model_blob_channel_t[n_iir + n_avg + n_none] */
+} model_blob_conditioning_t;
+
+typedef struct model_blob_channel
+{
+   uint16_t ix; /* REAL32 input signal */
+   uint16_t reserved;
+   float gain;
+   float offset;
+   float min;
+   float max;
+   float alpha;
+} model_blob_channel_t;
+
+typedef struct model_blob_profinet
+{
+   uint16_t vendor_id;
+   uint16_t device_id;
+   uint32_t dap_module_id;
+   uint32_t dap_identity_submodule_id;
+   uint32_t dap_interface_submodule_id;
+   uint32_t dap_port_1_submodule_id;
+   uint32_t dap_port_2_submodule_id;
+   uint16_t profile_id;
+   uint16_t profile_specific_type;
+   uint16_t min_device_interval;
+   uint16_t hw_revision;
+   uint32_t default_stationname; /* String */
+   uint32_t order_id;            /* String */
+   uint8_t sw_revision_prefix;
+   uint8_t sw_revision_functional_enhancement;
+   uint8_t sw_revision_bug_fix;
+   uint8_t sw_revision_internal_change;
+   uint16_t revision_counter;
+   uint16_t n_modules;
+   uint16_t n_slots;
+   uint16_t reserved;
+   uint32_t modules; /* model_blob_pn_module_t[n_modules] */
+   uint32_t slots;   /* uint16_t module_ix[n_slots] */
+} model_blob_profinet_t;
+
+typedef struct model_blob_pn_module
+{
+   uint32_t module_id;
+   uint32_t submodule_id;
+   uint16_t n_params;
+   uint16_t reserved;
+   uint32_t params; /* uint32_t pn_index[n_params] */
+} model_blob_pn_module_t;
+
+typedef struct model_blob_ethernetip
+{
+   uint16_t vendor_id;
+   uint16_t device_type;
+   uint16_t product_code;
+   uint8_t major_revision;
+   uint8_t minor_revision;
+   uint32_t min_data_interval;
+   uint32_t default_data_interval;
+   uint16_t input_assembly_id;
+   uint16_t output_assembly_id;
+   uint16_t config_assembly_id;
+   uint16_t input_only_heartbeat_assembly_id;
+   uint16_t listen_only_heartbeat_assembly_id;
+   uint16_t reserved;
+} model_blob_ethernetip_t;
+
+typedef struct model_blob_modbus
+{
+   uint16_t port;
+   uint16_t reserved;
+} model_blob_modbus_t;
+
+/**
+ * Device model created from a blob.
+ *
+ * The U-Phy API takes the model as up_device_t and friends, so the
+ * descriptor tables are set up once at load. Names and other strings
+ * point into the blob and are not copied.
+ */
+typedef struct model_blob_model
+{
+   const model_blob_header_t * blob;
+   const char * source; /* Where the blob was found */
+
+   up_device_t device;
+   up_signal_info_t * vars;
+   uint8_t * data; /* Process image */
+
+   bool has_profinet;
+   bool has_ethernetip;
+   bool has_modbus;
+   up_profinet_config_t profinet;
+   up_ethernetip_config_t ethernetip;
+   up_modbus_config_t modbus;
+} model_blob_model_t;
+
+/**
+ * Load the device model blob.
+ *
+ * The file STORAGE_ROOT "model.bin" is used if present, which is handy
+ * during development. Otherwise the blob is used in place from the
+ * model region at the end of code flash, see uphy-linker-script.ld.
+ *
+ * @param model      Model to set up
+ * @return 0 if a valid blob was loaded, -1 if the compiled in model
+ *         should be used
+ */
+extern int model_blob_load (model_blob_model_t * model);
+
+/**
+ * Validate a blob and set up a model from it.
+ *
+ * The blob must be 4-byte aligned and must stay valid as long as the
+ * model is used.
+ *
+ * @param model      Model to set up
+ * @param blob       Blob
+ * @param size       Number of bytes available at @a blob
+ * @return 0 on success, -1 if the blob is invalid or out of memory
+ */
+extern int model_blob_map (
+   model_blob_model_t * model,
+   const void * blob,
+   size_t size);
+
+/**
+ * Get a string from a blob.
+ *
+ * @param blob       Blob
+ * @param offset     Offset of string
+ * @return String, or "" if offset is 0
+ */
+static inline const char * model_blob_str (
+   const model_blob_header_t * blob,
+   uint32_t offset)
+{
+   return offset == 0 ? "" : (const char *)blob + offset;
+}
+
+#endif /* MODEL_BLOB_H_ */
@@ -0,0 +1,258 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Network statistics.
+ *
+ * Collects the lwIP link, IP, TCP and UDP counters, memory pool usage and
+ * Ethernet MAC error counters in one snapshot. The 'netstat' shell command
+ * prints totals together with the delta and rate since the previous
+ * invocation.
+ */
+
+#include "netstat.h"
+#include "shell.h"
+
+#include "cy_device.h"
+#include "lwip/opt.h"
+#include "lwip/stats.h"
+#include "lwip/tcpip.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Ethernet MAC instance used by the EVK (eth[1] in design.modus) */
+#define NETSTAT_ETH ETH1
+
+static netstat_eth_t eth_totals;
+static netstat_t previous;
+
+static void read_eth (netstat_eth_t * eth)
+{
+   taskENTER_CRITICAL();
+   eth_totals.rx_overruns += NETSTAT_ETH->RECEIVE_OVERRUNS;
+   eth_totals.rx_resource_errors += NETSTAT_ETH->RECEIVE_RESOURCE_ERRORS;
+   eth_totals.fcs_errors += NETSTAT_ETH->FCS_ERRORS;
+   *eth = eth_totals;
+   taskEXIT_CRITICAL();
+}
+
+#if LWIP_STATS
+static void read_proto (netstat_proto_t * p, const struct stats_proto * s)
+{
+   p->xmit = s->xmit;
+   p->recv = s->recv;
+   p->drop = s->drop;
+   p->chkerr = s->chkerr;
+   p->memerr = s->memerr;
+   p->err = s->err;
+}
+#endif
+
+void netstat_snapshot (netstat_t * snap)
+{
+   memset (snap, 0, sizeof (*snap));
+
+   snap->time_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+   read_eth (&snap->eth);
+
+#if LWIP_STATS
+   LOCK_TCPIP_CORE();
+
+#if LINK_STATS
+   read_proto (&snap->link, &lwip_stats.link);
+#endif
+#if IP_STATS
+   read_proto (&snap->ip, &lwip_stats.ip);
+#endif
+#if TCP_STATS
+   read_proto (&snap->tcp, &lwip_stats.tcp);
+#endif
+#if UDP_STATS
+   read_proto (&snap->udp, &lwip_stats.udp);
+#endif
+
+#if MEMP_STATS
+   for (int i = 0; i < MEMP_MAX; i++)
+   {
+      const struct stats_mem * m = lwip_stats.memp[i];
+      netstat_pool_t * pool = &snap->pools[snap->n_pools++];
+
+      pool->name = m->name;
+      pool->avail = m->avail;
+      pool->used = m->used;
+      pool->max = m->max;
+      pool->err = m->err;
+   }
+#endif
+
+   UNLOCK_TCPIP_CORE();
+#endif /* LWIP_STATS */
+}
+
+static void delta_proto (
+   const netstat_proto_t * now,
+   const netstat_proto_t * prev,
+   netstat_proto_t * delta)
+{
+   delta->xmit = now->xmit - prev->xmit;
+   delta->recv = now->recv - prev->recv;
+   delta->drop = now->drop - prev->drop;
+   delta->chkerr = now->chkerr - prev->chkerr;
+   delta->memerr = now->memerr - prev->memerr;
+   delta->err = now->err - prev->err;
+}
+
+void netstat_delta (
+   const netstat_t * now,
+   const netstat_t * prev,
+   netstat_t * delta)
+{
+   delta->time_ms = now->time_ms - prev->time_ms;
+
+   delta_proto (&now->link, &prev->link, &delta->link);
+   delta_proto (&now->ip, &prev->ip, &delta->ip);
+   delta_proto (&now->tcp, &prev->tcp, &delta->tcp);
+   delta_proto (&now->udp, &prev->udp, &delta->udp);
+
+   delta->eth.rx_overruns = now->eth.rx_overruns - prev->eth.rx_overruns;
+   delta->eth.rx_resource_errors =
+      now->eth.rx_resource_errors - prev->eth.rx_resource_errors;
+   delta->eth.fcs_errors = now->eth.fcs_errors - prev->eth.fcs_errors;
+
+   delta->n_pools = now->n_pools;
+   for (uint16_t i = 0; i < now->n_pools; i++)
+   {
+      delta->pools[i] = now->pools[i];
+      if (i < prev->n_pools)
+      {
+         delta->pools[i].err = now->pools[i].err - prev->pools[i].err;
+      }
+   }
+}
+
+static uint32_t rate (uint32_t count, uint32_t time_ms)
+{
+   return (time_ms > 0) ? (uint32_t)(((uint64_t)count * 1000) / time_ms) : 0;
+}
+
+static void print_proto (
+   const char * name,
+   const netstat_proto_t * total,
+   const netstat_proto_t * delta,
+   uint32_t time_ms)
+{
+   printf (
+      "%-5s %10" PRIu32 " %10" PRIu32 " %7" PRIu32 "/s %10" PRIu32
+      " %7" PRIu32 "/s %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32
+      "\n",
+      name,
+      total->xmit,
+      delta->xmit,
+      rate (delta->xmit, time_ms),
+      delta->recv,
+      rate (delta->recv, time_ms),
+      delta->drop,
+      delta->chkerr,
+      delta->memerr,
+      delta->err);
+}
+
+static int _cmd_netstat (int argc, char * argv[])
+{
+   static netstat_t now;
+   static netstat_t delta;
+
+   netstat_snapshot (&now);
+
+   if (argc == 2 && strcmp (argv[1], "reset") == 0)
+   {
+      previous = now;
+      return 0;
+   }
+
+   netstat_delta (&now, &previous, &delta);
+   previous = now;
+
+#if !LWIP_STATS
+   printf ("lwIP statistics disabled (LWIP_STATS)\n");
+#endif
+
+   printf ("Interval %" PRIu32 " ms\n\n", delta.time_ms);
+   printf (
+      "%-5s %10s %10s %9s %10s %9s %8s %8s %8s %8s\n",
+      "proto",
+      "tx total",
+      "tx",
+      "",
+      "rx",
+      "",
+      "drop",
+      "chkerr",
+      "memerr",
+      "err");
+   print_proto ("link", &now.link, &delta.link, delta.time_ms);
+   print_proto ("ip", &now.ip, &delta.ip, delta.time_ms);
+   print_proto ("tcp", &now.tcp, &delta.tcp, delta.time_ms);
+   print_proto ("udp", &now.udp, &delta.udp, delta.time_ms);
+
+   printf (
+      "\neth   rx overruns %" PRIu32 " (+%" PRIu32 ")"
+      ", rx resource errors %" PRIu32 " (+%" PRIu32 ")"
+      ", fcs errors %" PRIu32 " (+%" PRIu32 ")\n",
+      now.eth.rx_overruns,
+      delta.eth.rx_overruns,
+      now.eth.rx_resource_errors,
+      delta.eth.rx_resource_errors,
+      now.eth.fcs_errors,
+      delta.eth.fcs_errors);
+
+   if (now.n_pools > 0)
+   {
+      printf (
+         "\n%-20s %8s %8s %8s %8s %8s\n",
+         "pool",
+         "avail",
+         "used",
+         "max",
+         "err",
+         "err/int");
+      for (uint16_t i = 0; i < now.n_pools; i++)
+      {
+         printf (
+            "%-20s %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32
+            " %8" PRIu32 "\n",
+            now.pools[i].name,
+            now.pools[i].avail,
+            now.pools[i].used,
+            now.pools[i].max,
+            now.pools[i].err,
+            delta.pools[i].err);
+      }
+   }
+
+   return 0;
+}
+
+const shell_cmd_t cmd_netstat = {
+   .cmd = _cmd_netstat,
+   .name = "netstat",
+   .help_short = "show network statistics",
+   .help_long = "Show network statistics. Rates and deltas are computed\n"
+                "since the previous invocation.\n"
+                "Usage: netstat [reset]\n"};
+
+SHELL_CMD (cmd_netstat);
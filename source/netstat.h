@@ -0,0 +1,88 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef NETSTAT_H_
+#define NETSTAT_H_
+
+#include "lwip/memp.h"
+
+#include <stdint.h>
+
+/* Number of lwIP memory pools in a snapshot, one per pool in memp_std.h */
+#define NETSTAT_MAX_POOLS MEMP_MAX
+
+typedef struct netstat_proto
+{
+   uint32_t xmit;
+   uint32_t recv;
+   uint32_t drop;
+   uint32_t chkerr;
+   uint32_t memerr;
+   uint32_t err;
+} netstat_proto_t;
+
+typedef struct netstat_pool
+{
+   const char * name;
+   uint32_t avail;
+   uint32_t used;
+   uint32_t max; /* High-water mark */
+   uint32_t err; /* Allocation failures */
+} netstat_pool_t;
+
+/* Ethernet MAC counters, accumulated as the hardware counters are
+ * cleared on read */
+typedef struct netstat_eth
+{
+   uint32_t rx_overruns;
+   uint32_t rx_resource_errors;
+   uint32_t fcs_errors;
+} netstat_eth_t;
+
+typedef struct netstat
+{
+   uint32_t time_ms;
+   netstat_proto_t link;
+   netstat_proto_t ip;
+   netstat_proto_t tcp;
+   netstat_proto_t udp;
+   netstat_eth_t eth;
+   uint16_t n_pools;
+   netstat_pool_t pools[NETSTAT_MAX_POOLS];
+} netstat_t;
+
+/**
+ * Take a snapshot of the network statistics.
+ *
+ * Requires LWIP_STATS, otherwise only the time and Ethernet MAC
+ * counters are filled in.
+ *
+ * @param snap    Snapshot to fill in
+ */
+extern void netstat_snapshot (netstat_t * snap);
+
+/**
+ * Compute the difference between two snapshots.
+ *
+ * Counters are subtracted. Pool levels (avail, used and max) are taken
+ * from the newest snapshot.
+ *
+ * @param now     Newest snapshot
+ * @param prev    Previous snapshot
+ * @param delta   Difference, may be the same as now
+ */
+extern void netstat_delta (
+   const netstat_t * now,
+   const netstat_t * prev,
+   netstat_t * delta);
+
+#endif /* NETSTAT_H_ */
@@ -0,0 +1,370 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "param_log.h"
+#include "crc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_LOG (-1)
+
+#define RECORD_HEADER 0x5048 /* "PH" */
+#define RECORD_VALUE  0x5056 /* "PV" */
+#define RECORD_COMMIT 0x5043 /* "PC" */
+
+typedef struct param_record
+{
+   uint16_t type;
+   uint16_t ix; /* Parameter index in store */
+   uint16_t len;
+   uint16_t reserved;
+   uint32_t crc; /* CRC of record with crc set to 0, and data */
+} param_record_t;
+
+typedef struct param_log_header
+{
+   uint32_t generation;
+   uint32_t model;
+} param_log_header_t;
+
+static int write_record (
+   param_log_t * log,
+   void * f,
+   uint16_t type,
+   uint16_t ix,
+   const void * data,
+   uint16_t len)
+{
+   param_record_t rec = {.type = type, .ix = ix, .len = len};
+
+   rec.crc = crc32_update (CRC32_INIT, &rec, sizeof (rec));
+   rec.crc = crc32_update (rec.crc, data, len) ^ CRC32_INIT;
+
+   if (
+      log->fs->write (&rec, sizeof (rec), f) != sizeof (rec) ||
+      log->fs->write (data, len, f) != len)
+   {
+      log->stats.errors++;
+      return -1;
+   }
+
+   log->stats.records++;
+   log->stats.bytes += sizeof (rec) + len;
+   return 0;
+}
+
+/* Read one record. Returns record type or 0 at end of log / bad record */
+static uint16_t read_record (
+   param_log_t * log,
+   void * f,
+   param_record_t * rec,
+   void * data)
+{
+   uint32_t crc;
+
+   if (log->fs->read (rec, sizeof (*rec), f) != sizeof (*rec))
+   {
+      return 0;
+   }
+
+   if (
+      rec->len > log->max_size ||
+      log->fs->read (data, rec->len, f) != rec->len)
+   {
+      return 0;
+   }
+
+   crc = rec->crc;
+   rec->crc = 0;
+   rec->crc = crc32_update (CRC32_INIT, rec, sizeof (*rec));
+   rec->crc = crc32_update (rec->crc, data, rec->len) ^ CRC32_INIT;
+   if (rec->crc != crc)
+   {
+      return 0;
+   }
+
+   return rec->type;
+}
+
+/* Copy parameter value to scratch, protected from concurrent writes. The
+ * dirty flag is cleared here so that a write while the value is stored
+ * marks it dirty again, and restored by end_flush() if storing fails. */
+static void copy_value (param_log_t * log, uint16_t ix)
+{
+   param_log_entry_t * entry = &log->entries[ix];
+
+   log->fs->lock();
+   entry->flushing = entry->dirty;
+   entry->dirty = false;
+   memcpy (log->scratch, entry->value, entry->size);
+   log->fs->unlock();
+}
+
+static void end_flush (param_log_t * log, bool written)
+{
+   for (uint16_t ix = 0; ix < log->n_entries; ix++)
+   {
+      param_log_entry_t * entry = &log->entries[ix];
+
+      if (entry->flushing && !written)
+      {
+         entry->dirty = true;
+      }
+      entry->flushing = false;
+   }
+}
+
+/* Write a complete snapshot to the alternate log, then remove the old */
+static int compact (param_log_t * log)
+{
+   int file = (log->active == NO_LOG) ? 0 : 1 - log->active;
+   param_log_header_t header = {
+      .generation = log->generation + 1,
+      .model = log->model};
+   uint32_t size = 0;
+   void * f;
+   int error = 0;
+
+   f = log->fs->open (log->files[file], "w");
+   if (f == NULL)
+   {
+      log->stats.errors++;
+      return -1;
+   }
+
+   error = write_record (log, f, RECORD_HEADER, 0, &header, sizeof (header));
+   size += sizeof (param_record_t) + sizeof (header);
+   for (uint16_t ix = 0; ix < log->n_entries && error == 0; ix++)
+   {
+      copy_value (log, ix);
+      error = write_record (
+         log,
+         f,
+         RECORD_VALUE,
+         ix,
+         log->scratch,
+         log->entries[ix].size);
+      size += sizeof (param_record_t) + log->entries[ix].size;
+   }
+   if (error == 0)
+   {
+      error = write_record (log, f, RECORD_COMMIT, 0, NULL, 0);
+      size += sizeof (param_record_t);
+   }
+   if (log->fs->close (f) != 0 && error == 0)
+   {
+      log->stats.errors++;
+      error = -1;
+   }
+
+   /* The old log stays in use until the snapshot is committed */
+   end_flush (log, error == 0);
+   if (error != 0)
+   {
+      return -1;
+   }
+
+   if (log->active != NO_LOG)
+   {
+      log->fs->remove (log->files[log->active]);
+   }
+
+   log->active = file;
+   log->generation = header.generation;
+   log->size = size;
+   log->compact = false;
+   log->stats.compactions++;
+   return 0;
+}
+
+/* Append dirty values to the active log */
+static int append (param_log_t * log)
+{
+   uint32_t size = 0;
+   void * f;
+   int error = 0;
+
+   f = log->fs->open (log->files[log->active], "a");
+   if (f == NULL)
+   {
+      log->stats.errors++;
+      return -1;
+   }
+
+   for (uint16_t ix = 0; ix < log->n_entries && error == 0; ix++)
+   {
+      if (log->entries[ix].dirty)
+      {
+         copy_value (log, ix);
+         error = write_record (
+            log,
+            f,
+            RECORD_VALUE,
+            ix,
+            log->scratch,
+            log->entries[ix].size);
+         size += sizeof (param_record_t) + log->entries[ix].size;
+      }
+   }
+   if (log->fs->close (f) != 0 && error == 0)
+   {
+      log->stats.errors++;
+      error = -1;
+   }
+
+   end_flush (log, error == 0);
+   if (error != 0)
+   {
+      /* Records after a partly written one would not be replayed */
+      log->compact = true;
+      return -1;
+   }
+
+   log->size += size;
+   return 0;
+}
+
+int param_log_flush (param_log_t * log)
+{
+   if (log->active == NO_LOG || log->compact || log->size >= log->compact_size)
+   {
+      /* Compaction writes all values, including the dirty ones */
+      return compact (log);
+   }
+
+   return append (log);
+}
+
+/* Returns 0 if log is valid for this model and was replayed */
+static int replay (param_log_t * log, int file, bool apply, uint32_t * gen)
+{
+   param_record_t rec;
+   param_log_header_t header;
+   bool committed = false;
+   uint32_t size = 0;
+   void * f;
+
+   f = log->fs->open (log->files[file], "r");
+   if (f == NULL)
+   {
+      return -1;
+   }
+
+   if (
+      read_record (log, f, &rec, log->scratch) != RECORD_HEADER ||
+      rec.len != sizeof (header))
+   {
+      log->fs->close (f);
+      return -1;
+   }
+
+   memcpy (&header, log->scratch, sizeof (header));
+   if (header.model != log->model)
+   {
+      log->fs->close (f);
+      return -1;
+   }
+
+   size = sizeof (rec) + rec.len;
+   for (;;)
+   {
+      uint16_t type = read_record (log, f, &rec, log->scratch);
+
+      if (type == RECORD_COMMIT)
+      {
+         committed = true;
+      }
+      else if (
+         type == RECORD_VALUE && rec.ix < log->n_entries &&
+         rec.len == log->entries[rec.ix].size)
+      {
+         if (apply)
+         {
+            memcpy (log->entries[rec.ix].value, log->scratch, rec.len);
+         }
+      }
+      else
+      {
+         break;
+      }
+
+      size += sizeof (rec) + rec.len;
+   }
+   log->fs->close (f);
+
+   if (!committed)
+   {
+      return -1;
+   }
+
+   *gen = header.generation;
+   log->size = size;
+   return 0;
+}
+
+int param_log_load (param_log_t * log)
+{
+   uint32_t gen0 = 0;
+   uint32_t gen1 = 0;
+   bool valid0 = replay (log, 0, false, &gen0) == 0;
+   bool valid1 = replay (log, 1, false, &gen1) == 0;
+
+   if (valid0 && (!valid1 || gen0 > gen1))
+   {
+      log->active = 0;
+   }
+   else if (valid1)
+   {
+      log->active = 1;
+   }
+   else
+   {
+      return -1;
+   }
+
+   return replay (log, log->active, true, &log->generation);
+}
+
+int param_log_init (
+   param_log_t * log,
+   const param_log_fs_t * fs,
+   const char * file0,
+   const char * file1,
+   param_log_entry_t * entries,
+   uint16_t n_entries,
+   uint32_t model,
+   uint32_t compact_size)
+{
+   memset (log, 0, sizeof (*log));
+   log->fs = fs;
+   log->files[0] = file0;
+   log->files[1] = file1;
+   log->entries = entries;
+   log->n_entries = n_entries;
+   log->model = model;
+   log->compact_size = compact_size;
+   log->active = NO_LOG;
+
+   /* Scratch buffer also holds the log header */
+   log->max_size = sizeof (param_log_header_t);
+   for (uint16_t ix = 0; ix < n_entries; ix++)
+   {
+      if (entries[ix].size > log->max_size)
+      {
+         log->max_size = entries[ix].size;
+      }
+   }
+
+   log->scratch = malloc (log->max_size);
+   return (log->scratch != NULL) ? 0 : -1;
+}
@@ -0,0 +1,135 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef PARAM_LOG_H_
+#define PARAM_LOG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Append-only log of parameter values, used by the parameter store.
+ *
+ * Log format, all records are CRC protected:
+ *   HEADER  generation and device model fingerprint
+ *   VALUE   parameter value (repeated)
+ *   COMMIT  end of compacted snapshot
+ *   VALUE   parameter value appended after compaction (repeated)
+ *
+ * A flush appends a record for each dirty parameter. When the log grows
+ * beyond the compaction size, or after a failed write, a snapshot of all
+ * parameters is written to the alternate log file with an incremented
+ * generation instead, after which the old file is removed. On load the
+ * valid log with the highest generation is replayed until the first bad
+ * record.
+ *
+ * A parameter is only considered written once its record is, and for a
+ * compaction once the COMMIT record is. Until then it stays dirty and is
+ * written again by the next flush.
+ *
+ * Files are accessed through callbacks, so the log can be tested on the
+ * host, see bench/param_log_bench.c.
+ */
+
+typedef struct param_log_entry
+{
+   void * value;
+   uint16_t size;
+   volatile bool dirty; /* Set by writer, cleared when copied to log */
+   bool flushing;       /* Was dirty when copied by the ongoing flush */
+} param_log_entry_t;
+
+/* File access, with the semantics of the C library functions */
+typedef struct param_log_fs
+{
+   void * (*open) (const char * name, const char * mode);
+   size_t (*read) (void * data, size_t len, void * f);
+   size_t (*write) (const void * data, size_t len, void * f);
+   int (*close) (void * f);
+   int (*remove) (const char * name);
+
+   /* Protect a parameter value from concurrent writes while copied */
+   void (*lock) (void);
+   void (*unlock) (void);
+} param_log_fs_t;
+
+typedef struct param_log_stats
+{
+   uint32_t records;     /* Records written */
+   uint32_t bytes;       /* Bytes written */
+   uint32_t compactions; /* Compactions */
+   uint32_t errors;      /* Failed file operations */
+} param_log_stats_t;
+
+typedef struct param_log
+{
+   /* Constant after init */
+   const param_log_fs_t * fs;
+   const char * files[2];
+   param_log_entry_t * entries;
+   uint16_t n_entries;
+   uint16_t max_size;
+   uint8_t * scratch;
+   uint32_t model;
+   uint32_t compact_size;
+
+   /* Log state */
+   int active; /* Index of file in use, -1 if none */
+   uint32_t generation;
+   uint32_t size; /* Bytes in active file */
+   bool compact;  /* Next flush compacts */
+   param_log_stats_t stats;
+} param_log_t;
+
+/**
+ * Initialise parameter log. Does not access the files.
+ *
+ * @param log           Parameter log
+ * @param fs            File access
+ * @param file0         Name of first log file
+ * @param file1         Name of alternate log file
+ * @param entries       Parameters, value and size set
+ * @param n_entries     Number of parameters
+ * @param model         Fingerprint of parameter layout, logs with
+ *                      another fingerprint are ignored
+ * @param compact_size  Log size that triggers compaction, in bytes
+ * @return 0 on success, -1 on out of memory
+ */
+extern int param_log_init (
+   param_log_t * log,
+   const param_log_fs_t * fs,
+   const char * file0,
+   const char * file1,
+   param_log_entry_t * entries,
+   uint16_t n_entries,
+   uint32_t model,
+   uint32_t compact_size);
+
+/**
+ * Restore parameter values from the newest valid log.
+ *
+ * @param log           Parameter log
+ * @return 0 if values were restored, -1 if no valid log was found
+ */
+extern int param_log_load (param_log_t * log);
+
+/**
+ * Write dirty parameters to the log, compacting it if needed.
+ *
+ * @param log           Parameter log
+ * @return 0 on success, -1 if a write failed, in which case the
+ *         parameters that were not written stay dirty
+ */
+extern int param_log_flush (param_log_t * log);
+
+#endif /* PARAM_LOG_H_ */
@@ -0,0 +1,317 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Persistent parameter store.
+ *
+ * Parameter writes from the PLC update the signal table in RAM and mark
+ * the parameter dirty. A background task writes dirty parameters to an
+ * append-only log on the littlefs filesystem (see param_log.h) once no
+ * write has been received for PARAM_STORE_QUIET_PERIOD, or at the latest
+ * after PARAM_STORE_MAX_DELAY. Repeated writes of the same parameter in
+ * between are coalesced into one record.
+ */
+
+#include "param_store.h"
+#include "param_log.h"
+#include "crc.h"
+#include "shell.h"
+#include "rte_fs.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct param_store_stats
+{
+   uint32_t writes;  /* Parameter writes from PLC */
+   uint32_t flushes; /* Flushes */
+   uint32_t flush_max_ms;
+   uint32_t flush_last_ms;
+} param_store_stats_t;
+
+static param_log_entry_t * entries;
+static uint16_t n_entries;
+static uint16_t * slot_first; /* Index of first entry for each slot */
+static param_log_t param_log;
+
+static TaskHandle_t task_hdl;
+static SemaphoreHandle_t flush_mutex;
+static volatile TickType_t first_write;
+static volatile TickType_t last_write;
+static volatile bool pending;
+
+static param_store_stats_t stats;
+
+static void * fs_open (const char * name, const char * mode)
+{
+   return rte_fs_fopen (name, mode);
+}
+
+static size_t fs_read (void * data, size_t len, void * f)
+{
+   return rte_fs_fread (data, 1, len, f);
+}
+
+static size_t fs_write (const void * data, size_t len, void * f)
+{
+   return rte_fs_fwrite (data, 1, len, f);
+}
+
+static int fs_close (void * f)
+{
+   return rte_fs_fclose (f);
+}
+
+static void fs_lock (void)
+{
+   taskENTER_CRITICAL();
+}
+
+static void fs_unlock (void)
+{
+   taskEXIT_CRITICAL();
+}
+
+static const param_log_fs_t fs = {
+   .open = fs_open,
+   .read = fs_read,
+   .write = fs_write,
+   .close = fs_close,
+   .remove = rte_fs_remove,
+   .lock = fs_lock,
+   .unlock = fs_unlock,
+};
+
+static int flush (void)
+{
+   TickType_t start = xTaskGetTickCount();
+   uint32_t elapsed;
+   int error;
+
+   xSemaphoreTake (flush_mutex, portMAX_DELAY);
+   pending = false;
+
+   error = param_log_flush (&param_log);
+
+   elapsed = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+   stats.flushes++;
+   stats.flush_last_ms = elapsed;
+   if (elapsed > stats.flush_max_ms)
+   {
+      stats.flush_max_ms = elapsed;
+   }
+
+   xSemaphoreGive (flush_mutex);
+   return error;
+}
+
+void param_store_flush (void)
+{
+   flush();
+}
+
+void param_store_changed (uint16_t slot_ix, uint16_t param_ix)
+{
+   TickType_t now = xTaskGetTickCount();
+
+   if (entries == NULL)
+   {
+      return;
+   }
+
+   entries[slot_first[slot_ix] + param_ix].dirty = true;
+   stats.writes++;
+
+   last_write = now;
+   if (!pending)
+   {
+      first_write = now;
+      pending = true;
+   }
+
+   xTaskNotifyGive (task_hdl);
+}
+
+static void param_store_task (void * arg)
+{
+   const TickType_t quiet = pdMS_TO_TICKS (PARAM_STORE_QUIET_PERIOD);
+   const TickType_t max_delay = pdMS_TO_TICKS (PARAM_STORE_MAX_DELAY);
+   TickType_t now;
+   TickType_t wait;
+
+   (void)arg;
+
+   for (;;)
+   {
+      ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+
+      /* Wait for writes to settle, bounded by max delay */
+      for (;;)
+      {
+         now = xTaskGetTickCount();
+         if (now - last_write >= quiet || now - first_write >= max_delay)
+         {
+            break;
+         }
+
+         wait = quiet - (now - last_write);
+         ulTaskNotifyTake (pdTRUE, wait);
+      }
+
+      /* Parameters that were not written are still dirty */
+      while (flush() != 0)
+      {
+         vTaskDelay (max_delay);
+      }
+   }
+}
+
+int param_store_init (const up_device_t * device, up_signal_info_t * vars)
+{
+   uint32_t model_fingerprint;
+   uint16_t ix = 0;
+
+   if (entries != NULL)
+   {
+      return 0;
+   }
+
+   slot_first = calloc (device->n_slots, sizeof (*slot_first));
+   for (uint16_t i = 0; i < device->n_slots; i++)
+   {
+      n_entries += device->slots[i].n_params;
+   }
+
+   entries = calloc (n_entries > 0 ? n_entries : 1, sizeof (*entries));
+   if (slot_first == NULL || entries == NULL)
+   {
+      return -1;
+   }
+
+   /* The fingerprint identifies the parameter layout of the model so that
+    * values stored by another model are not restored */
+   model_fingerprint = CRC32_INIT;
+   for (uint16_t i = 0; i < device->n_slots; i++)
+   {
+      const up_slot_t * slot = &device->slots[i];
+
+      slot_first[i] = ix;
+      for (uint16_t j = 0; j < slot->n_params; j++)
+      {
+         const up_param_t * p = &slot->params[j];
+
+         entries[ix].value = vars[p->ix].value;
+         entries[ix].size = (p->bitlength + 7) / 8;
+
+         model_fingerprint =
+            crc32_update (model_fingerprint, &p->ix, sizeof (p->ix));
+         model_fingerprint = crc32_update (
+            model_fingerprint,
+            &entries[ix].size,
+            sizeof (entries[ix].size));
+         ix++;
+      }
+   }
+
+   flush_mutex = xSemaphoreCreateMutex();
+   if (
+      flush_mutex == NULL ||
+      param_log_init (
+         &param_log,
+         &fs,
+         STORAGE_ROOT "params.0",
+         STORAGE_ROOT "params.1",
+         entries,
+         n_entries,
+         model_fingerprint,
+         PARAM_STORE_COMPACT_SIZE) != 0)
+   {
+      return -1;
+   }
+
+   if (param_log_load (&param_log) == 0)
+   {
+      printf (
+         "Restored parameters from %s (generation %" PRIu32 ")\n",
+         param_log.files[param_log.active],
+         param_log.generation);
+   }
+   else
+   {
+      printf ("No stored parameters\n");
+   }
+
+   if (
+      xTaskCreate (
+         param_store_task,
+         "param_store",
+         PARAM_STORE_TASK_STACK_SIZE,
+         NULL,
+         PARAM_STORE_TASK_PRIORITY,
+         &task_hdl) != pdPASS)
+   {
+      return -1;
+   }
+
+   return 0;
+}
+
+static int _cmd_param_store (int argc, char * argv[])
+{
+   if (entries == NULL)
+   {
+      printf ("Parameter store not started\n");
+      return 0;
+   }
+
+   if (argc == 2 && strcmp (argv[1], "flush") == 0)
+   {
+      param_store_flush();
+      return 0;
+   }
+
+   printf (
+      "Log            : %s\n",
+      (param_log.active >= 0) ? param_log.files[param_log.active] : "-");
+   printf ("Generation     : %" PRIu32 "\n", param_log.generation);
+   printf ("Log size       : %" PRIu32 " bytes\n", param_log.size);
+   printf ("Parameters     : %" PRIu16 "\n", n_entries);
+   printf ("PLC writes     : %" PRIu32 "\n", stats.writes);
+   printf ("Flushes        : %" PRIu32 "\n", stats.flushes);
+   printf ("Records        : %" PRIu32 "\n", param_log.stats.records);
+   printf ("Bytes written  : %" PRIu32 "\n", param_log.stats.bytes);
+   printf ("Compactions    : %" PRIu32 "\n", param_log.stats.compactions);
+   printf ("Errors         : %" PRIu32 "\n", param_log.stats.errors);
+   printf (
+      "Flush time     : %" PRIu32 " ms (max %" PRIu32 " ms)\n",
+      stats.flush_last_ms,
+      stats.flush_max_ms);
+
+   return 0;
+}
+
+const shell_cmd_t cmd_param_store = {
+   .cmd = _cmd_param_store,
+   .name = "param_store",
+   .help_short = "show persistent parameter store",
+   .help_long = "Show persistent parameter store statistics or write\n"
+                "pending parameters to flash.\n"
+                "Usage: param_store [flush]\n"};
+
+SHELL_CMD (cmd_param_store);
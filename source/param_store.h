@@ -0,0 +1,62 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef PARAM_STORE_H_
+#define PARAM_STORE_H_
+
+#include "up_types.h"
+
+#include <stdint.h>
+
+/* Parameter writes are flushed to flash when no write has been received
+ * for this period, in milliseconds */
+#define PARAM_STORE_QUIET_PERIOD 500
+
+/* Max time a written parameter stays in RAM only, in milliseconds */
+#define PARAM_STORE_MAX_DELAY 5000
+
+/* The log is compacted when it grows beyond this size, in bytes */
+#define PARAM_STORE_COMPACT_SIZE 4096
+
+#define PARAM_STORE_TASK_PRIORITY   (tskIDLE_PRIORITY + 1)
+#define PARAM_STORE_TASK_STACK_SIZE 1024
+
+/**
+ * Initialize the persistent parameter store.
+ *
+ * Restores parameter values saved in the filesystem into the signal
+ * table and starts the background flush task. Values saved for a
+ * different device model are ignored.
+ *
+ * @param device  Device model
+ * @param vars    Signal table holding the parameter values
+ * @return 0 on success, -1 on error
+ */
+extern int param_store_init (const up_device_t * device, up_signal_info_t * vars);
+
+/**
+ * Notify the store that a parameter value in the signal table has been
+ * updated. Never blocks, the value is written to flash by the background
+ * task once writes have settled.
+ *
+ * @param slot_ix    Slot index
+ * @param param_ix   Parameter index within slot
+ */
+extern void param_store_changed (uint16_t slot_ix, uint16_t param_ix);
+
+/**
+ * Write all pending parameter values to flash.
+ * Called from the background task, blocks on flash.
+ */
+extern void param_store_flush (void);
+
+#endif /* PARAM_STORE_H_ */
@@ -0,0 +1,496 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Whole image operations on a struct-of-arrays process image.
+ *
+ * With values packed per direction and statuses in a dense array, copy,
+ * compare and status handling of the complete image become loops over
+ * contiguous memory instead of walks through the per-signal pointers in
+ * the var table.
+ */
+
+#include "process_image.h"
+#include "cycle_stats.h"
+#include "shell.h"
+
+#include "cy_device.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Shift that moves the UP_STATUS_OK bit of a status byte to bit 7 */
+#define STATUS_OK_SHIFT (7 - __builtin_ctz (UP_STATUS_OK))
+
+#define BENCH_DEFAULT_SIGNALS 1024
+#define BENCH_MAX_SIGNALS     16384
+
+/* Process image of the active model, for the shell command */
+static process_image_t * active;
+
+static inline uint32_t load32 (const void * p)
+{
+   uint32_t x;
+
+   memcpy (&x, p, sizeof (x));
+   return x;
+}
+
+/* Gather the UP_STATUS_OK bit of four status bytes into bits 0-3 */
+static inline uint32_t gather4 (uint32_t x)
+{
+   x = (x << STATUS_OK_SHIFT) & 0x80808080u;
+   return ((x >> 7) * 0x10204080u) >> 28;
+}
+
+static int init_dir (
+   process_image_dir_t * dir,
+   const model_blob_model_t * model,
+   const model_blob_region_t * region)
+{
+   dir->values = model->data + region->values;
+   dir->size = region->values_size;
+   dir->status = model->data + region->status;
+   dir->n = region->n;
+   if (dir->size > UINT16_MAX)
+   {
+      /* Offsets are 16-bit */
+      return -1;
+   }
+   dir->signals = calloc (dir->n > 0 ? dir->n : 1, sizeof (*dir->signals));
+
+   return (dir->signals != NULL) ? 0 : -1;
+}
+
+/* Returns -1 if a signal is not in the region of the direction */
+static int add_signals (
+   process_image_dir_t * dir,
+   const model_blob_model_t * model,
+   const up_signal_t * signals,
+   uint16_t n)
+{
+   for (uint16_t i = 0; i < n; i++)
+   {
+      const up_signal_info_t * var = &model->vars[signals[i].ix];
+      uint32_t k = var->status - dir->status;
+      uint32_t offset = (uint8_t *)var->value - dir->values;
+      uint32_t size = (signals[i].bitlength + 7) / 8;
+
+      if (k >= dir->n || offset >= dir->size || size > dir->size - offset)
+      {
+         return -1;
+      }
+
+      dir->signals[k].offset = offset;
+      dir->signals[k].size = size;
+   }
+
+   return 0;
+}
+
+static void free_dirs (process_image_t * pi)
+{
+   free (pi->inputs.signals);
+   free (pi->outputs.signals);
+   pi->inputs.signals = NULL;
+   pi->outputs.signals = NULL;
+}
+
+int process_image_init (
+   process_image_t * pi,
+   const model_blob_model_t * model)
+{
+   const model_blob_header_t * blob = model->blob;
+
+   if (blob == NULL || blob->layout != MODEL_BLOB_LAYOUT_SOA)
+   {
+      return -1;
+   }
+
+   if (
+      init_dir (&pi->inputs, model, &blob->inputs) != 0 ||
+      init_dir (&pi->outputs, model, &blob->outputs) != 0)
+   {
+      free_dirs (pi);
+      return -1;
+   }
+
+   for (uint16_t i = 0; i < model->device.n_slots; i++)
+   {
+      const up_slot_t * slot = &model->device.slots[i];
+
+      if (
+         add_signals (&pi->inputs, model, slot->inputs, slot->n_inputs) != 0 ||
+         add_signals (&pi->outputs, model, slot->outputs, slot->n_outputs) !=
+            0)
+      {
+         free_dirs (pi);
+         return -1;
+      }
+   }
+
+   active = pi;
+   return 0;
+}
+
+void process_image_set_status (
+   process_image_dir_t * dir,
+   up_signal_status_t status)
+{
+   memset (dir->status, status, dir->n * sizeof (*dir->status));
+}
+
+uint32_t process_image_status_bitmap (
+   const process_image_dir_t * dir,
+   uint32_t * bitmap)
+{
+   const uint8_t * status = (const uint8_t *)dir->status;
+   uint32_t n_words = dir->n / 32;
+   uint32_t good = 0;
+   uint32_t i;
+
+   for (i = 0; i < n_words; i++)
+   {
+      uint32_t bits = 0;
+
+      for (uint32_t j = 0; j < 32; j += 4)
+      {
+         bits |= gather4 (load32 (status + j)) << j;
+      }
+      status += 32;
+      bitmap[i] = bits;
+      good += __builtin_popcount (bits);
+   }
+
+   if (dir->n % 32 != 0)
+   {
+      uint32_t bits = 0;
+
+      for (uint32_t j = 0; j < dir->n % 32; j++)
+      {
+         if (status[j] & UP_STATUS_OK)
+         {
+            bits |= 1u << j;
+         }
+      }
+      bitmap[i] = bits;
+      good += __builtin_popcount (bits);
+   }
+
+   return good;
+}
+
+uint32_t process_image_diff (
+   const void * a,
+   const void * b,
+   uint32_t size,
+   uint32_t * changed)
+{
+   const uint32_t * pa = a;
+   const uint32_t * pb = b;
+   uint32_t n_words = size / 4;
+   uint32_t n_changed = 0;
+
+   if (changed != NULL)
+   {
+      memset (changed, 0, PROCESS_IMAGE_BITMAP_WORDS (n_words) * 4);
+   }
+
+   for (uint32_t i = 0; i < n_words; i++)
+   {
+      if (pa[i] != pb[i])
+      {
+         n_changed++;
+         if (changed != NULL)
+         {
+            changed[i / 32] |= 1u << (i % 32);
+         }
+      }
+   }
+
+   return n_changed;
+}
+
+void process_image_substitute (
+   process_image_dir_t * dir,
+   const uint8_t * substitute,
+   const uint32_t * good)
+{
+   for (uint32_t w = 0; w < PROCESS_IMAGE_BITMAP_WORDS (dir->n); w++)
+   {
+      uint32_t bad = ~good[w];
+
+      if (w == dir->n / 32)
+      {
+         bad &= (1u << (dir->n % 32)) - 1;
+      }
+
+      /* Skips 32 good signals per iteration */
+      while (bad != 0)
+      {
+         const process_image_signal_t * s =
+            &dir->signals[w * 32 + __builtin_ctz (bad)];
+
+         memcpy (dir->values + s->offset, substitute + s->offset, s->size);
+         bad &= bad - 1;
+      }
+   }
+}
+
+static void show_dir (const char * name, const process_image_dir_t * dir)
+{
+   uint32_t * bitmap;
+   uint32_t good;
+
+   bitmap = malloc (PROCESS_IMAGE_BITMAP_WORDS (dir->n) * 4 + 4);
+   if (bitmap == NULL)
+   {
+      return;
+   }
+
+   good = process_image_status_bitmap (dir, bitmap);
+   printf (
+      "%-8s: %" PRIu32 " signals, %" PRIu32 " bytes, %" PRIu32 " good\n",
+      name,
+      dir->n,
+      dir->size,
+      good);
+   free (bitmap);
+}
+
+static int _cmd_pi (int argc, char * argv[])
+{
+   if (active == NULL)
+   {
+      printf ("No struct-of-arrays process image\n");
+      return 0;
+   }
+
+   show_dir ("Inputs", &active->inputs);
+   show_dir ("Outputs", &active->outputs);
+   return 0;
+}
+
+const shell_cmd_t cmd_pi = {
+   .cmd = _cmd_pi,
+   .name = "pi",
+   .help_short = "show process image",
+   .help_long = "Show size and signal status of the struct-of-arrays\n"
+                "process image.\n"
+                "Usage: pi\n"};
+
+SHELL_CMD (cmd_pi);
+
+/*
+ * Benchmark of whole image operations on n 8-bit signals, in the
+ * interleaved layout of generated/model.h accessed through the var
+ * table, and in the struct-of-arrays layout.
+ */
+
+typedef struct bench
+{
+   uint32_t n;
+
+   /* Interleaved */
+   struct
+   {
+      uint8_t value;
+      up_signal_status_t status;
+   } * aos;
+   up_signal_info_t * vars;
+
+   /* Struct-of-arrays */
+   process_image_dir_t dir;
+
+   uint8_t * copy;
+   uint32_t * bitmap;
+   uint32_t result;
+} bench_t;
+
+static void aos_mark (bench_t * b)
+{
+   for (uint32_t i = 0; i < b->n; i++)
+   {
+      *b->vars[i].status = UP_STATUS_OK;
+   }
+}
+
+static void soa_mark (bench_t * b)
+{
+   process_image_set_status (&b->dir, UP_STATUS_OK);
+}
+
+static void aos_bitmap (bench_t * b)
+{
+   memset (b->bitmap, 0, PROCESS_IMAGE_BITMAP_WORDS (b->n) * 4);
+   for (uint32_t i = 0; i < b->n; i++)
+   {
+      if (*b->vars[i].status & UP_STATUS_OK)
+      {
+         b->bitmap[i / 32] |= 1u << (i % 32);
+      }
+   }
+}
+
+static void soa_bitmap (bench_t * b)
+{
+   b->result = process_image_status_bitmap (&b->dir, b->bitmap);
+}
+
+static void aos_copy (bench_t * b)
+{
+   for (uint32_t i = 0; i < b->n; i++)
+   {
+      b->copy[i] = *(uint8_t *)b->vars[i].value;
+   }
+}
+
+static void soa_copy (bench_t * b)
+{
+   memcpy (b->copy, b->dir.values, b->dir.size);
+}
+
+static void aos_diff (bench_t * b)
+{
+   uint32_t changed = 0;
+
+   for (uint32_t i = 0; i < b->n; i++)
+   {
+      if (b->copy[i] != *(uint8_t *)b->vars[i].value)
+      {
+         changed++;
+      }
+   }
+   b->result = changed;
+}
+
+static void soa_diff (bench_t * b)
+{
+   b->result = process_image_diff (b->copy, b->dir.values, b->dir.size, NULL);
+}
+
+static void flush (const void * p, size_t size)
+{
+   SCB_CleanInvalidateDCache_by_Addr ((void *)p, size);
+}
+
+static void flush_all (bench_t * b)
+{
+   flush (b->aos, b->n * sizeof (*b->aos));
+   flush (b->vars, b->n * sizeof (*b->vars));
+   flush (b->dir.values, b->dir.size);
+   flush (b->dir.status, b->dir.n);
+   flush (b->copy, b->dir.size);
+   flush (b->bitmap, PROCESS_IMAGE_BITMAP_WORDS (b->n) * 4);
+}
+
+static uint32_t run (bench_t * b, void (*fn) (bench_t *), bool cold)
+{
+   uint32_t start;
+
+   /* Warm up instruction cache and branch prediction */
+   fn (b);
+
+   if (cold)
+   {
+      flush_all (b);
+   }
+
+   start = cycle_stats_now();
+   fn (b);
+   return cycle_stats_now() - start;
+}
+
+static int _cmd_pi_bench (int argc, char * argv[])
+{
+   static const struct
+   {
+      const char * name;
+      void (*aos) (bench_t *);
+      void (*soa) (bench_t *);
+   } ops[] = {
+      {"mark good", aos_mark, soa_mark},
+      {"status bitmap", aos_bitmap, soa_bitmap},
+      {"copy values", aos_copy, soa_copy},
+      {"diff values", aos_diff, soa_diff},
+   };
+   bench_t b = {0};
+   uint32_t size;
+
+   b.n = (argc == 2) ? strtoul (argv[1], NULL, 0) : BENCH_DEFAULT_SIGNALS;
+   if (b.n == 0 || b.n > BENCH_MAX_SIGNALS)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   size = (b.n + 3) & ~3u;
+   b.aos = malloc (b.n * sizeof (*b.aos));
+   b.vars = malloc (b.n * sizeof (*b.vars));
+   b.dir.values = calloc (1, size);
+   b.dir.status = calloc (1, size);
+   b.copy = calloc (1, size);
+   b.bitmap = malloc (PROCESS_IMAGE_BITMAP_WORDS (b.n) * 4);
+   b.dir.size = size;
+   b.dir.n = b.n;
+
+   if (
+      b.aos == NULL || b.vars == NULL || b.dir.values == NULL ||
+      b.dir.status == NULL || b.copy == NULL || b.bitmap == NULL)
+   {
+      printf ("Out of memory\n");
+   }
+   else
+   {
+      memset (b.aos, 0, b.n * sizeof (*b.aos));
+      for (uint32_t i = 0; i < b.n; i++)
+      {
+         b.vars[i].value = &b.aos[i].value;
+         b.vars[i].status = &b.aos[i].status;
+      }
+
+      printf ("%" PRIu32 " signals, cycles (warm / cold cache)\n", b.n);
+      printf ("                 interleaved           struct-of-arrays\n");
+      for (size_t i = 0; i < sizeof (ops) / sizeof (ops[0]); i++)
+      {
+         printf (
+            "%-14s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n",
+            ops[i].name,
+            run (&b, ops[i].aos, false),
+            run (&b, ops[i].aos, true),
+            run (&b, ops[i].soa, false),
+            run (&b, ops[i].soa, true));
+      }
+   }
+
+   free (b.aos);
+   free (b.vars);
+   free (b.dir.values);
+   free (b.dir.status);
+   free (b.copy);
+   free (b.bitmap);
+   return 0;
+}
+
+const shell_cmd_t cmd_pi_bench = {
+   .cmd = _cmd_pi_bench,
+   .name = "pi_bench",
+   .help_short = "benchmark process image layouts",
+   .help_long =
+      "Measure whole image operations on n 8-bit signals, in the\n"
+      "interleaved layout of generated/model.h and in the\n"
+      "struct-of-arrays layout. Cold runs start with a flushed data cache.\n"
+      "Usage: pi_bench [n]\n"};
+
+SHELL_CMD (cmd_pi_bench);
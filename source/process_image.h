@@ -0,0 +1,115 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef PROCESS_IMAGE_H_
+#define PROCESS_IMAGE_H_
+
+#include "model_blob.h"
+#include "up_types.h"
+
+#include <stdint.h>
+
+/* Number of 32-bit words in a bitmap of n signals */
+#define PROCESS_IMAGE_BITMAP_WORDS(n) (((n) + 31) / 32)
+
+/* Location of a value in the packed values of a direction */
+typedef struct process_image_signal
+{
+   uint16_t offset;
+   uint16_t size;
+} process_image_signal_t;
+
+/**
+ * Process data of one direction in the struct-of-arrays layout.
+ *
+ * Signal i of the direction has its value at values + signals[i].offset
+ * and its status at status[i]. Signals are ordered by signal index.
+ */
+typedef struct process_image_dir
+{
+   uint8_t * values;
+   uint32_t size; /* Size of values, multiple of 4 */
+   up_signal_status_t * status;
+   uint32_t n;
+   process_image_signal_t * signals;
+} process_image_dir_t;
+
+typedef struct process_image
+{
+   process_image_dir_t inputs;
+   process_image_dir_t outputs;
+} process_image_t;
+
+/**
+ * Set up whole image access to a model loaded from a blob.
+ *
+ * @param pi         Process image to set up
+ * @param model      Model with MODEL_BLOB_LAYOUT_SOA process image
+ * @return 0 on success, -1 if the model has another layout or out of
+ *         memory
+ */
+extern int process_image_init (
+   process_image_t * pi,
+   const model_blob_model_t * model);
+
+/**
+ * Set the status of all signals of a direction.
+ *
+ * @param dir        Direction
+ * @param status     Status
+ */
+extern void process_image_set_status (
+   process_image_dir_t * dir,
+   up_signal_status_t status);
+
+/**
+ * Build a bitmap of the signals with good status, bit i set if signal i
+ * has UP_STATUS_OK set.
+ *
+ * @param dir        Direction
+ * @param bitmap     Bitmap, PROCESS_IMAGE_BITMAP_WORDS(dir->n) words
+ * @return Number of signals with good status
+ */
+extern uint32_t process_image_status_bitmap (
+   const process_image_dir_t * dir,
+   uint32_t * bitmap);
+
+/**
+ * Compare two copies of packed values, 32 bits at a time.
+ *
+ * @param a          Values, 4-byte aligned
+ * @param b          Values, 4-byte aligned
+ * @param size       Size of values, multiple of 4
+ * @param changed    Bitmap with one bit per 32-bit word, may be NULL.
+ *                   PROCESS_IMAGE_BITMAP_WORDS(size / 4) words.
+ * @return Number of changed 32-bit words
+ */
+extern uint32_t process_image_diff (
+   const void * a,
+   const void * b,
+   uint32_t size,
+   uint32_t * changed);
+
+/**
+ * Replace the value of every signal without good status by its value in
+ * a substitute copy of the packed values.
+ *
+ * @param dir        Direction
+ * @param substitute Substitute values, same layout as dir->values
+ * @param good       Bitmap from process_image_status_bitmap()
+ */
+extern void process_image_substitute (
+   process_image_dir_t * dir,
+   const uint8_t * substitute,
+   const uint32_t * good);
+
+#endif /* PROCESS_IMAGE_H_ */
@@ -0,0 +1,493 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Triggered process data recorder, see recorder.h for the format.
+ *
+ * recorder_sample() runs in the U-Phy task while the shell only reads
+ * the recording once it is stopped. The state is the only field written
+ * by both, and the recording is configured before the state is set.
+ * Also used by bench/recorder_bench.c on the host.
+ */
+
+#include "recorder.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define BLOCK_HEADER_SIZE offsetof (recorder_block_t, key)
+
+static recorder_block_t * block_at (const recorder_t * r, uint16_t ix)
+{
+   return (recorder_block_t *)(r->buf + ix * RECORDER_BLOCK_SIZE);
+}
+
+static uint32_t zigzag (uint32_t delta)
+{
+   return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+static uint32_t unzigzag (uint32_t z)
+{
+   return (z >> 1) ^ (0u - (z & 1));
+}
+
+static uint8_t * put_varint (uint8_t * p, uint32_t v)
+{
+   while (v >= 0x80)
+   {
+      *p++ = (v & 0x7F) | 0x80;
+      v >>= 7;
+   }
+   *p++ = v;
+   return p;
+}
+
+static const uint8_t * get_varint (const uint8_t * p, uint32_t * v)
+{
+   uint32_t x = 0;
+
+   for (int shift = 0; shift < 35; shift += 7)
+   {
+      x |= (uint32_t)(*p & 0x7F) << shift;
+      if ((*p++ & 0x80) == 0)
+      {
+         break;
+      }
+   }
+   *v = x;
+   return p;
+}
+
+static int compare (uint8_t type, uint32_t a, uint32_t b)
+{
+   switch (type)
+   {
+   case RECORDER_INT:
+      return ((int32_t)a > (int32_t)b) - ((int32_t)a < (int32_t)b);
+   case RECORDER_REAL:
+   {
+      float fa;
+      float fb;
+
+      memcpy (&fa, &a, sizeof (fa));
+      memcpy (&fb, &b, sizeof (fb));
+      return (fa > fb) - (fa < fb);
+   }
+   default:
+      return (a > b) - (a < b);
+   }
+}
+
+static uint32_t window_start (const recorder_t * r)
+{
+   return (r->trigger_cycle >= r->pre) ? r->trigger_cycle - r->pre : 0;
+}
+
+int recorder_init (recorder_t * r, void * buf, uint32_t size)
+{
+   memset (r, 0, sizeof (*r));
+   if (size / RECORDER_BLOCK_SIZE < 2)
+   {
+      return -1;
+   }
+   r->buf = buf;
+   r->n_blocks = size / RECORDER_BLOCK_SIZE;
+   return 0;
+}
+
+int recorder_add_channel (
+   recorder_t * r,
+   const char * name,
+   const void * value,
+   uint8_t size,
+   recorder_type_t type)
+{
+   recorder_channel_t * ch;
+
+   if (
+      recorder_active (r) || r->n_channels == RECORDER_MAX_CHANNELS ||
+      (size != 1 && size != 2 && size != 4) ||
+      (type == RECORDER_REAL && size != 4))
+   {
+      return -1;
+   }
+
+   ch = &r->channels[r->n_channels];
+   ch->name = name;
+   ch->value = value;
+   ch->size = size;
+   ch->type = type;
+
+   r->count = 0;
+   r->state = RECORDER_IDLE;
+   return r->n_channels++;
+}
+
+void recorder_clear (recorder_t * r)
+{
+   if (!recorder_active (r))
+   {
+      r->n_channels = 0;
+      r->count = 0;
+      r->state = RECORDER_IDLE;
+   }
+}
+
+uint32_t recorder_load (const recorder_channel_t * ch, const void * value)
+{
+   switch (ch->size)
+   {
+   case 1:
+   {
+      uint8_t u8;
+
+      memcpy (&u8, value, 1);
+      return (ch->type == RECORDER_INT) ? (uint32_t)(int8_t)u8 : u8;
+   }
+   case 2:
+   {
+      uint16_t u16;
+
+      memcpy (&u16, value, 2);
+      return (ch->type == RECORDER_INT) ? (uint32_t)(int16_t)u16 : u16;
+   }
+   default:
+   {
+      uint32_t u32;
+
+      memcpy (&u32, value, 4);
+      return u32;
+   }
+   }
+}
+
+int recorder_arm (
+   recorder_t * r,
+   recorder_trigger_t trigger,
+   uint8_t ch,
+   uint32_t level,
+   uint32_t pre,
+   uint32_t post)
+{
+   if (
+      recorder_active (r) || r->n_channels == 0 ||
+      (trigger != RECORDER_TRIGGER_NONE && ch >= r->n_channels))
+   {
+      return -1;
+   }
+
+   r->trigger = trigger;
+   r->trigger_ch = ch;
+   r->level = level;
+   r->pre = pre;
+   r->post = post;
+   r->force = false;
+   r->triggered = false;
+   r->truncated = false;
+   r->head = 0;
+   r->tail = 0;
+   r->count = 0;
+   r->cycle = 0;
+   r->trigger_cycle = 0;
+   r->gap = 0;
+   r->records = 0;
+   r->key_frames = 0;
+   r->dropped = 0;
+
+   __atomic_store_n (&r->state, RECORDER_ARMED, __ATOMIC_RELEASE);
+   return 0;
+}
+
+void recorder_force (recorder_t * r)
+{
+   r->force = true;
+}
+
+void recorder_stop (recorder_t * r)
+{
+   if (recorder_active (r))
+   {
+      r->state = RECORDER_DONE;
+   }
+}
+
+/* Start a block with a key frame. Drops the oldest block if the ring is
+ * full, unless it holds the pre-trigger window */
+static bool open_block (recorder_t * r, const uint32_t * value)
+{
+   recorder_block_t * b;
+
+   if (r->count == r->n_blocks)
+   {
+      if (r->triggered && block_at (r, r->tail)->end > window_start (r))
+      {
+         r->truncated = true;
+         return false;
+      }
+      r->tail = (r->tail + 1) % r->n_blocks;
+      r->count--;
+      r->dropped++;
+   }
+
+   r->head = (r->count == 0) ? r->tail : (r->head + 1) % r->n_blocks;
+   r->count++;
+
+   b = block_at (r, r->head);
+   b->cycle = r->cycle;
+   b->end = r->cycle;
+   b->used = BLOCK_HEADER_SIZE + r->n_channels * sizeof (uint32_t);
+   b->reserved = 0;
+   memcpy (b->key, value, r->n_channels * sizeof (uint32_t));
+
+   r->gap = 0;
+   r->key_frames++;
+   return true;
+}
+
+static bool triggers (const recorder_t * r, const uint32_t * value)
+{
+   uint8_t type = r->channels[r->trigger_ch].type;
+   uint32_t prev = r->prev[r->trigger_ch];
+   uint32_t cur = value[r->trigger_ch];
+
+   switch (r->trigger)
+   {
+   case RECORDER_TRIGGER_CHANGE:
+      return cur != prev;
+   case RECORDER_TRIGGER_RISE:
+      return compare (type, prev, r->level) < 0 &&
+             compare (type, cur, r->level) >= 0;
+   case RECORDER_TRIGGER_FALL:
+      return compare (type, prev, r->level) > 0 &&
+             compare (type, cur, r->level) <= 0;
+   default:
+      return false;
+   }
+}
+
+void recorder_sample (recorder_t * r)
+{
+   uint8_t state = __atomic_load_n (&r->state, __ATOMIC_ACQUIRE);
+   uint32_t value[RECORDER_MAX_CHANNELS];
+   uint8_t record[RECORDER_MAX_RECORD];
+   uint8_t * p = record;
+   uint8_t mask = 0;
+   recorder_block_t * b;
+
+   if (state != RECORDER_ARMED && state != RECORDER_TRIGGERED)
+   {
+      return;
+   }
+
+   for (uint8_t i = 0; i < r->n_channels; i++)
+   {
+      value[i] = recorder_load (&r->channels[i], r->channels[i].value);
+   }
+
+   if (
+      state == RECORDER_ARMED &&
+      (r->force || (r->count > 0 && triggers (r, value))))
+   {
+      r->force = false;
+      r->triggered = true;
+      r->trigger_cycle = r->cycle;
+      state = RECORDER_TRIGGERED;
+   }
+
+   if (r->count == 0)
+   {
+      open_block (r, value);
+   }
+   else
+   {
+      for (uint8_t i = 0; i < r->n_channels; i++)
+      {
+         if (value[i] != r->prev[i])
+         {
+            mask |= 1 << i;
+         }
+      }
+
+      if (mask == 0)
+      {
+         r->gap++;
+      }
+      else
+      {
+         b = block_at (r, r->head);
+         p = put_varint (p, r->gap);
+         *p++ = mask;
+         for (uint8_t i = 0; i < r->n_channels; i++)
+         {
+            if (mask & (1 << i))
+            {
+               p = put_varint (p, zigzag (value[i] - r->prev[i]));
+            }
+         }
+
+         if (b->used + (p - record) <= RECORDER_BLOCK_SIZE)
+         {
+            memcpy ((uint8_t *)b + b->used, record, p - record);
+            b->used += p - record;
+            r->gap = 0;
+            r->records++;
+         }
+         else if (!open_block (r, value))
+         {
+            r->state = RECORDER_DONE;
+            return;
+         }
+      }
+   }
+
+   memcpy (r->prev, value, r->n_channels * sizeof (uint32_t));
+   block_at (r, r->head)->end = ++r->cycle;
+
+   if (state == RECORDER_TRIGGERED && r->cycle > r->trigger_cycle + r->post)
+   {
+      state = RECORDER_DONE;
+   }
+   if (state != r->state && recorder_active (r))
+   {
+      r->state = state;
+   }
+}
+
+uint32_t recorder_first (const recorder_t * r)
+{
+   uint32_t oldest;
+
+   if (r->count == 0)
+   {
+      return 0;
+   }
+
+   oldest = block_at (r, r->tail)->cycle;
+   if (r->triggered && window_start (r) > oldest)
+   {
+      return window_start (r);
+   }
+   return oldest;
+}
+
+const recorder_block_t * recorder_block (const recorder_t * r, uint16_t i)
+{
+   return block_at (r, (r->tail + i) % r->n_blocks);
+}
+
+static void read_gap (recorder_reader_t * rd, const recorder_block_t * b)
+{
+   const uint8_t * p = (const uint8_t *)b + rd->pos;
+   uint32_t gap;
+
+   if (rd->pos >= rd->used)
+   {
+      rd->next = UINT32_MAX;
+      return;
+   }
+   p = get_varint (p, &gap);
+   rd->pos = p - (const uint8_t *)b;
+   rd->next = rd->cycle + 1 + gap;
+}
+
+static void load_block (
+   const recorder_t * r,
+   recorder_reader_t * rd,
+   uint16_t i)
+{
+   const recorder_block_t * b = recorder_block (r, i);
+
+   rd->block = i;
+   rd->cycle = b->cycle;
+   rd->end = b->end;
+   rd->used = b->used;
+   rd->pos = BLOCK_HEADER_SIZE + r->n_channels * sizeof (uint32_t);
+   memcpy (rd->value, b->key, r->n_channels * sizeof (uint32_t));
+   read_gap (rd, b);
+}
+
+static bool advance (const recorder_t * r, recorder_reader_t * rd)
+{
+   const recorder_block_t * b;
+   const uint8_t * p;
+   uint8_t mask;
+
+   if (++rd->cycle >= rd->end)
+   {
+      if (rd->block + 1 >= r->count)
+      {
+         return false;
+      }
+      load_block (r, rd, rd->block + 1);
+      return true;
+   }
+
+   if (rd->cycle == rd->next)
+   {
+      b = recorder_block (r, rd->block);
+      p = (const uint8_t *)b + rd->pos;
+      mask = *p++;
+      for (uint8_t i = 0; i < r->n_channels; i++)
+      {
+         if (mask & (1 << i))
+         {
+            uint32_t z;
+
+            p = get_varint (p, &z);
+            rd->value[i] += unzigzag (z);
+         }
+      }
+      rd->pos = p - (const uint8_t *)b;
+      read_gap (rd, b);
+   }
+   return true;
+}
+
+int recorder_read_start (const recorder_t * r, recorder_reader_t * rd)
+{
+   uint32_t first = recorder_first (r);
+   uint16_t i = 0;
+
+   memset (rd, 0, sizeof (*rd));
+   if (r->count == 0)
+   {
+      return -1;
+   }
+
+   /* Skip blocks before the pre-trigger window */
+   while (i + 1 < r->count && recorder_block (r, i)->end <= first)
+   {
+      i++;
+   }
+   load_block (r, rd, i);
+
+   while (rd->cycle < first)
+   {
+      if (!advance (r, rd))
+      {
+         return -1;
+      }
+   }
+   rd->pending = rd->cycle < rd->end;
+   return 0;
+}
+
+bool recorder_read_next (const recorder_t * r, recorder_reader_t * rd)
+{
+   if (rd->pending)
+   {
+      rd->pending = false;
+      return true;
+   }
+   return advance (r, rd);
+}
@@ -0,0 +1,285 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Triggered recorder of process data, one sample per exchange.
+ *
+ * Selected signals of up to 32 bits are recorded into a preallocated
+ * ring of fixed size blocks. Each block starts with a key frame holding
+ * all values. Each following record holds the number of unchanged
+ * cycles before it, a mask of the changed channels and the zigzag
+ * varint delta of each changed value, so a cycle where nothing changed
+ * costs no memory. When the ring is full the oldest block is dropped.
+ * Every block can be decoded on its own.
+ *
+ * Once triggered, recording continues for the post-trigger depth. Blocks
+ * holding the pre-trigger depth are kept. If the post-trigger window does
+ * not fit in the rest of the ring, recording stops early and the
+ * recording is marked as truncated.
+ *
+ * The work per sample is bounded by the number of channels: at most one
+ * record of RECORDER_MAX_RECORD bytes or one key frame is written.
+ */
+
+#define RECORDER_MAX_CHANNELS 8
+#define RECORDER_BLOCK_SIZE   512
+#define RECORDER_MAX_RECORD   (5 + 1 + RECORDER_MAX_CHANNELS * 5)
+
+/* Binary export, see recorder_file_header_t */
+#define RECORDER_FILE_MAGIC   0x43525055 /* "UPRC" */
+#define RECORDER_FILE_VERSION 1
+#define RECORDER_NAME_SIZE    48
+
+typedef enum recorder_type
+{
+   RECORDER_UINT,
+   RECORDER_INT,
+   RECORDER_REAL,
+} recorder_type_t;
+
+typedef enum recorder_trigger
+{
+   RECORDER_TRIGGER_NONE,   /* Record until stopped */
+   RECORDER_TRIGGER_CHANGE, /* Any change of the channel */
+   RECORDER_TRIGGER_RISE,   /* From below the level to at or above */
+   RECORDER_TRIGGER_FALL,   /* From above the level to at or below */
+} recorder_trigger_t;
+
+typedef enum recorder_state
+{
+   RECORDER_IDLE,
+   RECORDER_ARMED,     /* Recording, waiting for trigger */
+   RECORDER_TRIGGERED, /* Recording post-trigger window */
+   RECORDER_DONE,
+} recorder_state_t;
+
+typedef struct recorder_channel
+{
+   const char * name;
+   const void * value;
+   uint8_t size; /* 1, 2 or 4 bytes */
+   uint8_t type; /* recorder_type_t */
+} recorder_channel_t;
+
+/* Start of each block, followed by the key frame and the records */
+typedef struct recorder_block
+{
+   uint32_t cycle; /* Cycle of the key frame */
+   uint32_t end;   /* Cycle after the last one recorded */
+   uint16_t used;  /* Bytes used, including this header */
+   uint16_t reserved;
+   uint32_t key[];
+} recorder_block_t;
+
+typedef struct recorder
+{
+   /* Constant after init */
+   uint8_t * buf;
+   uint16_t n_blocks;
+
+   /* Set while idle or done */
+   recorder_channel_t channels[RECORDER_MAX_CHANNELS];
+   uint8_t n_channels;
+   uint8_t trigger;    /* recorder_trigger_t */
+   uint8_t trigger_ch; /* Channel index */
+   uint32_t level;     /* Trigger level, same encoding as values */
+   uint32_t pre;       /* Cycles kept before trigger */
+   uint32_t post;      /* Cycles recorded after trigger */
+
+   /* Updated by recorder_sample() */
+   volatile uint8_t state; /* recorder_state_t */
+   volatile bool force;    /* Trigger at next sample */
+   bool triggered;
+   bool truncated;
+   uint16_t head; /* Block written */
+   uint16_t tail; /* Oldest block */
+   uint16_t count;
+   uint32_t cycle; /* Samples since armed */
+   uint32_t trigger_cycle;
+   uint32_t gap; /* Unchanged cycles since last record */
+   uint32_t prev[RECORDER_MAX_CHANNELS];
+   uint32_t records;
+   uint32_t key_frames;
+   uint32_t dropped; /* Blocks overwritten */
+} recorder_t;
+
+/* Decoder state, see recorder_read_start() */
+typedef struct recorder_reader
+{
+   bool pending; /* Current cycle not returned yet */
+   uint16_t block; /* Blocks read */
+   uint16_t pos;   /* Next record in block */
+   uint16_t used;
+   uint32_t end;
+   uint32_t next; /* Cycle of next record */
+   uint32_t cycle;
+   uint32_t value[RECORDER_MAX_CHANNELS];
+} recorder_reader_t;
+
+/* Binary export: header, channels, then the blocks from oldest to newest,
+ * RECORDER_BLOCK_SIZE bytes each. Little endian. */
+typedef struct recorder_file_header
+{
+   uint32_t magic;
+   uint16_t version;
+   uint16_t block_size;
+   uint16_t n_blocks;
+   uint8_t n_channels;
+   uint8_t flags; /* RECORDER_FILE_TRIGGERED, RECORDER_FILE_TRUNCATED */
+   uint32_t first; /* First cycle of the pre-trigger window */
+   uint32_t trigger_cycle;
+} recorder_file_header_t;
+
+#define RECORDER_FILE_TRIGGERED 0x01
+#define RECORDER_FILE_TRUNCATED 0x02
+
+typedef struct recorder_file_channel
+{
+   char name[RECORDER_NAME_SIZE];
+   uint8_t type;
+   uint8_t size;
+   uint16_t reserved;
+} recorder_file_channel_t;
+
+/**
+ * Initialise a recorder.
+ *
+ * @param r          Recorder
+ * @param buf        Ring buffer, 32-bit aligned
+ * @param size       Size of buffer, at least two blocks
+ * @return 0 on success, -1 if the buffer is too small
+ */
+extern int recorder_init (recorder_t * r, void * buf, uint32_t size);
+
+/**
+ * Add a channel. Only while idle or done, discards the recording.
+ *
+ * @param r          Recorder
+ * @param name       Name, used for export
+ * @param value      Value in the signal table
+ * @param size       Size of value, 1, 2 or 4 bytes
+ * @param type       recorder_type_t
+ * @return index of channel, -1 if full, busy or invalid
+ */
+extern int recorder_add_channel (
+   recorder_t * r,
+   const char * name,
+   const void * value,
+   uint8_t size,
+   recorder_type_t type);
+
+/**
+ * Remove all channels. Only while idle or done.
+ */
+extern void recorder_clear (recorder_t * r);
+
+/**
+ * Convert a value to the encoding used for recorded values and trigger
+ * levels: zero extended for RECORDER_UINT, sign extended for
+ * RECORDER_INT and the bits of a float for RECORDER_REAL.
+ *
+ * @param ch         Channel
+ * @param value      Value as stored in the signal table
+ * @return encoded value
+ */
+extern uint32_t recorder_load (
+   const recorder_channel_t * ch,
+   const void * value);
+
+/**
+ * Start recording. Only while idle or done, discards the recording.
+ *
+ * @param r          Recorder
+ * @param trigger    recorder_trigger_t
+ * @param ch         Trigger channel
+ * @param level      Trigger level, see recorder_load()
+ * @param pre        Cycles to keep before the trigger
+ * @param post       Cycles to record after the trigger
+ * @return 0 on success, -1 if busy or invalid
+ */
+extern int recorder_arm (
+   recorder_t * r,
+   recorder_trigger_t trigger,
+   uint8_t ch,
+   uint32_t level,
+   uint32_t pre,
+   uint32_t post);
+
+/**
+ * Trigger at the next sample, if armed.
+ */
+extern void recorder_force (recorder_t * r);
+
+/**
+ * Stop recording, keeping what is recorded.
+ */
+extern void recorder_stop (recorder_t * r);
+
+/**
+ * True while recording.
+ */
+static inline bool recorder_active (const recorder_t * r)
+{
+   return r->state == RECORDER_ARMED || r->state == RECORDER_TRIGGERED;
+}
+
+/**
+ * Record one cycle. Called from the cyclic callbacks once per exchange,
+ * does nothing unless recording.
+ *
+ * @param r          Recorder
+ */
+extern void recorder_sample (recorder_t * r);
+
+/**
+ * First cycle to export: the start of the pre-trigger window, or the
+ * oldest cycle recorded if less was kept.
+ */
+extern uint32_t recorder_first (const recorder_t * r);
+
+/**
+ * Block of the recording, oldest first. Only while not recording.
+ *
+ * @param r          Recorder
+ * @param i          Index, less than r->count
+ * @return the block
+ */
+extern const recorder_block_t * recorder_block (
+   const recorder_t * r,
+   uint16_t i);
+
+/**
+ * Start decoding the recording from recorder_first(). Only while not
+ * recording.
+ *
+ * @param r          Recorder
+ * @param rd         Decoder state
+ * @return 0 on success, -1 if nothing recorded
+ */
+extern int recorder_read_start (const recorder_t * r, recorder_reader_t * rd);
+
+/**
+ * Decode the next cycle. The cycle and values are found in rd.
+ *
+ * @param r          Recorder
+ * @param rd         Decoder state
+ * @return true if a cycle was decoded, false at the end
+ */
+extern bool recorder_read_next (const recorder_t * r, recorder_reader_t * rd);
+
+#endif /* RECORDER_H_ */
@@ -0,0 +1,509 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+
+/*
+ * Process data recorder, sampled once per exchange, and the 'rec' shell
+ * command.
+ */
+
+#include "recorder_cmd.h"
+#include "cycle_stats.h"
+#include "mem_sections.h"
+#include "recorder.h"
+#include "shell.h"
+#include "signal_index.h"
+#include "rte_fs.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const up_signal_info_t * rec_vars;
+static uint32_t recorder_buf[RECORDER_CMD_BUFFER_SIZE / sizeof (uint32_t)];
+static char recorder_names[RECORDER_MAX_CHANNELS][RECORDER_NAME_SIZE];
+static recorder_t recorder;
+
+static cycle_stats_t recorder_stats APP_DTCM_DATA =
+   CYCLE_STATS_INIT ("recorder");
+
+void recorder_cmd_init (const up_signal_info_t * vars)
+{
+   rec_vars = vars;
+   recorder_init (&recorder, recorder_buf, sizeof (recorder_buf));
+   cycle_stats_register (&recorder_stats);
+}
+
+APP_ITCM_FUNC void recorder_cmd_sample (void)
+{
+   uint32_t start;
+
+   if (!recorder_active (&recorder))
+   {
+      return;
+   }
+
+   start = cycle_stats_now();
+   recorder_sample (&recorder);
+   cycle_stats_add (&recorder_stats, start);
+}
+
+static const char * recorder_state_str (uint8_t state)
+{
+   switch (state)
+   {
+   case RECORDER_ARMED:
+      return "armed";
+   case RECORDER_TRIGGERED:
+      return "triggered";
+   case RECORDER_DONE:
+      return "done";
+   default:
+      return "idle";
+   }
+}
+
+static int recorder_add (const char * key)
+{
+   signal_ref_t ref;
+   uint16_t size;
+   recorder_type_t type = RECORDER_UINT;
+   int ix;
+
+   if (signal_index_find (key, &ref) != 0)
+   {
+      printf ("No signal or parameter \"%s\"\n", key);
+      return -1;
+   }
+
+   size = (ref.bitlength + 7) / 8;
+   if (ref.datatype == UP_DTYPE_OCTET_STRING || size == 3 || size > 4)
+   {
+      printf ("Only signals of up to 32 bits can be recorded\n");
+      return -1;
+   }
+   if (
+      ref.datatype == UP_DTYPE_INT8 || ref.datatype == UP_DTYPE_INT16 ||
+      ref.datatype == UP_DTYPE_INT32)
+   {
+      type = RECORDER_INT;
+   }
+   else if (ref.datatype == UP_DTYPE_REAL32)
+   {
+      type = RECORDER_REAL;
+   }
+
+   ix = recorder.n_channels;
+   if (ix < RECORDER_MAX_CHANNELS)
+   {
+      snprintf (recorder_names[ix], RECORDER_NAME_SIZE, "%s", key);
+   }
+   if (
+      recorder_add_channel (
+         &recorder,
+         recorder_names[ix],
+         rec_vars[ref.ix].value,
+         size,
+         type) < 0)
+   {
+      printf ("At most %d channels\n", RECORDER_MAX_CHANNELS);
+      return -1;
+   }
+   return 0;
+}
+
+static int recorder_parse_level (uint8_t ch, const char * s, uint32_t * level)
+{
+   char * end;
+
+   switch (recorder.channels[ch].type)
+   {
+   case RECORDER_REAL:
+   {
+      float f = strtof (s, &end);
+
+      memcpy (level, &f, sizeof (*level));
+      break;
+   }
+   case RECORDER_INT:
+      *level = (uint32_t)strtol (s, &end, 0);
+      break;
+   default:
+      *level = strtoul (s, &end, 0);
+      break;
+   }
+   return (*end == '\0' && end != s) ? 0 : -1;
+}
+
+static int recorder_arm_args (int argc, char * argv[])
+{
+   static const char * triggers[] = {"none", "change", "rise", "fall"};
+   recorder_trigger_t trigger = RECORDER_TRIGGER_NONE;
+   uint32_t pre = strtoul (argv[2], NULL, 0);
+   uint32_t post = strtoul (argv[3], NULL, 0);
+   uint32_t level = 0;
+   uint8_t ch = 0;
+
+   if (argc >= 6)
+   {
+      ch = strtoul (argv[4], NULL, 0);
+      for (int i = 0; i < (int)(sizeof (triggers) / sizeof (triggers[0])); i++)
+      {
+         if (strcmp (argv[5], triggers[i]) == 0)
+         {
+            trigger = i;
+         }
+      }
+      if (ch >= recorder.n_channels || trigger == RECORDER_TRIGGER_NONE)
+      {
+         printf ("error - try \"help %s\"\n", argv[0]);
+         return -1;
+      }
+      if (trigger != RECORDER_TRIGGER_CHANGE)
+      {
+         if (argc != 7 || recorder_parse_level (ch, argv[6], &level) != 0)
+         {
+            printf ("Missing or invalid level\n");
+            return -1;
+         }
+      }
+   }
+
+   cycle_stats_reset (&recorder_stats);
+   if (recorder_arm (&recorder, trigger, ch, level, pre, post) != 0)
+   {
+      printf ("Add channels first, or stop the recording\n");
+      return -1;
+   }
+   return 0;
+}
+
+static void recorder_show (void)
+{
+   uint32_t used = 0;
+   uint32_t cycles;
+
+   for (uint16_t i = 0; i < recorder.count; i++)
+   {
+      used += recorder_block (&recorder, i)->used;
+   }
+   cycles = recorder.count > 0 ? recorder.cycle - recorder_first (&recorder)
+                               : 0;
+
+   printf (
+      "State    : %s%s\n",
+      recorder_state_str (recorder.state),
+      recorder.truncated ? ", truncated" : "");
+   printf (
+      "Buffer   : %" PRIu32 " of %u bytes, %u of %u blocks, %" PRIu32
+      " blocks dropped\n",
+      used,
+      (unsigned int)sizeof (recorder_buf),
+      recorder.count,
+      recorder.n_blocks,
+      recorder.dropped);
+   printf (
+      "Cycles   : %" PRIu32 " recorded, %" PRIu32 " in window",
+      recorder.cycle,
+      cycles);
+   if (cycles > 0)
+   {
+      printf (
+         ", %" PRIu32 ".%02" PRIu32 " bytes/cycle",
+         used / cycles,
+         (used % cycles) * 100 / cycles);
+   }
+   printf ("\n");
+   if (recorder.triggered)
+   {
+      printf (
+         "Trigger  : at cycle %" PRIu32 ", pre %" PRIu32 ", post %" PRIu32
+         "\n",
+         recorder.trigger_cycle,
+         recorder.pre,
+         recorder.post);
+   }
+   if (recorder_stats.count > 0)
+   {
+      printf (
+         "Cost     : avg %" PRIu32 " max %" PRIu32 " cycles (%" PRIu32
+         " us), record max %d bytes\n",
+         (uint32_t)(recorder_stats.total / recorder_stats.count),
+         recorder_stats.max,
+         cycle_stats_to_us (recorder_stats.max),
+         RECORDER_MAX_RECORD);
+   }
+   for (uint8_t i = 0; i < recorder.n_channels; i++)
+   {
+      static const char * types[] = {"uint", "int", "real"};
+
+      printf (
+         "%-3u %-4s%-2u %s\n",
+         i,
+         types[recorder.channels[i].type],
+         recorder.channels[i].size * 8,
+         recorder.channels[i].name);
+   }
+}
+
+static int recorder_write (RTE_FILE * f, const char * line, int len)
+{
+   if (f == NULL)
+   {
+      printf ("%s", line);
+      return 0;
+   }
+   return (rte_fs_fwrite (line, 1, len, f) == (size_t)len) ? 0 : -1;
+}
+
+/* CSV with cycle relative to the trigger, to the shell if f is NULL */
+static int recorder_csv (RTE_FILE * f)
+{
+   recorder_reader_t rd;
+   char line[32 + RECORDER_MAX_CHANNELS * 16];
+   uint32_t origin = recorder.triggered ? recorder.trigger_cycle
+                                        : recorder_first (&recorder);
+   int len;
+
+   if (recorder_read_start (&recorder, &rd) != 0)
+   {
+      printf ("Nothing recorded\n");
+      return -1;
+   }
+
+   len = snprintf (line, sizeof (line), "cycle");
+   for (uint8_t i = 0; i < recorder.n_channels; i++)
+   {
+      len += snprintf (
+         line + len,
+         sizeof (line) - len,
+         ",%s",
+         recorder.channels[i].name);
+      if (len >= (int)sizeof (line) - 2)
+      {
+         len = sizeof (line) - 2;
+      }
+   }
+   len += snprintf (line + len, sizeof (line) - len, "\n");
+   if (recorder_write (f, line, len) != 0)
+   {
+      return -1;
+   }
+
+   while (recorder_read_next (&recorder, &rd))
+   {
+      len = snprintf (
+         line,
+         sizeof (line),
+         "%" PRIi32,
+         (int32_t)(rd.cycle - origin));
+      for (uint8_t i = 0; i < recorder.n_channels; i++)
+      {
+         uint32_t v = rd.value[i];
+         float real;
+
+         switch (recorder.channels[i].type)
+         {
+         case RECORDER_REAL:
+            memcpy (&real, &v, sizeof (real));
+            len += snprintf (line + len, sizeof (line) - len, ",%g", real);
+            break;
+         case RECORDER_INT:
+            len += snprintf (
+               line + len,
+               sizeof (line) - len,
+               ",%" PRIi32,
+               (int32_t)v);
+            break;
+         default:
+            len += snprintf (line + len, sizeof (line) - len, ",%" PRIu32, v);
+            break;
+         }
+      }
+      len += snprintf (line + len, sizeof (line) - len, "\n");
+      if (recorder_write (f, line, len) != 0)
+      {
+         return -1;
+      }
+   }
+   return 0;
+}
+
+/* Header, channels and the blocks as recorded, see recorder.h */
+static int recorder_bin (RTE_FILE * f)
+{
+   recorder_file_header_t header = {
+      .magic = RECORDER_FILE_MAGIC,
+      .version = RECORDER_FILE_VERSION,
+      .block_size = RECORDER_BLOCK_SIZE,
+      .n_blocks = recorder.count,
+      .n_channels = recorder.n_channels,
+      .first = recorder_first (&recorder),
+      .trigger_cycle = recorder.trigger_cycle,
+   };
+
+   if (recorder.count == 0)
+   {
+      printf ("Nothing recorded\n");
+      return -1;
+   }
+
+   header.flags = (recorder.triggered ? RECORDER_FILE_TRIGGERED : 0) |
+                  (recorder.truncated ? RECORDER_FILE_TRUNCATED : 0);
+   if (rte_fs_fwrite (&header, 1, sizeof (header), f) != sizeof (header))
+   {
+      return -1;
+   }
+
+   for (uint8_t i = 0; i < recorder.n_channels; i++)
+   {
+      recorder_file_channel_t ch = {
+         .type = recorder.channels[i].type,
+         .size = recorder.channels[i].size,
+      };
+
+      snprintf (ch.name, sizeof (ch.name), "%s", recorder.channels[i].name);
+      if (rte_fs_fwrite (&ch, 1, sizeof (ch), f) != sizeof (ch))
+      {
+         return -1;
+      }
+   }
+
+   for (uint16_t i = 0; i < recorder.count; i++)
+   {
+      if (
+         rte_fs_fwrite (
+            recorder_block (&recorder, i),
+            1,
+            RECORDER_BLOCK_SIZE,
+            f) != RECORDER_BLOCK_SIZE)
+      {
+         return -1;
+      }
+   }
+   return 0;
+}
+
+static int recorder_export (const char * format, const char * file)
+{
+   bool csv = strcmp (format, "csv") == 0;
+   RTE_FILE * f = NULL;
+   int error;
+
+   if (recorder_active (&recorder))
+   {
+      printf ("Stop the recording first\n");
+      return -1;
+   }
+
+   if (file != NULL)
+   {
+      f = rte_fs_fopen (file, "w");
+      if (f == NULL)
+      {
+         printf ("Failed to open %s\n", file);
+         return -1;
+      }
+   }
+
+   error = csv ? recorder_csv (f) : recorder_bin (f);
+
+   if (f != NULL)
+   {
+      rte_fs_fclose (f);
+      if (error != 0)
+      {
+         printf ("Failed to write %s\n", file);
+         rte_fs_remove (file);
+      }
+   }
+   return error;
+}
+
+int _cmd_rec (int argc, char * argv[])
+{
+   if (recorder.buf == NULL)
+   {
+      printf ("U-Phy not started\n");
+      return -1;
+   }
+
+   if (argc == 1)
+   {
+      recorder_show();
+      return 0;
+   }
+
+   if (strcmp (argv[1], "add") == 0 && argc >= 3)
+   {
+      if (recorder_active (&recorder))
+      {
+         printf ("Stop the recording first\n");
+         return -1;
+      }
+      for (int i = 2; i < argc; i++)
+      {
+         if (recorder_add (argv[i]) != 0)
+         {
+            return -1;
+         }
+      }
+   }
+   else if (strcmp (argv[1], "clear") == 0 && argc == 2)
+   {
+      recorder_clear (&recorder);
+   }
+   else if (strcmp (argv[1], "arm") == 0 && argc >= 4 && argc <= 7)
+   {
+      return recorder_arm_args (argc, argv);
+   }
+   else if (strcmp (argv[1], "trig") == 0 && argc == 2)
+   {
+      recorder_force (&recorder);
+   }
+   else if (strcmp (argv[1], "stop") == 0 && argc == 2)
+   {
+      recorder_stop (&recorder);
+   }
+   else if (strcmp (argv[1], "csv") == 0 && argc <= 3)
+   {
+      return recorder_export (argv[1], argc == 3 ? argv[2] : NULL);
+   }
+   else if (strcmp (argv[1], "bin") == 0 && argc == 3)
+   {
+      return recorder_export (argv[1], argv[2]);
+   }
+   else
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   recorder_show();
+   return 0;
+}
+
+const shell_cmd_t cmd_rec = {
+   .cmd = _cmd_rec,
+   .name = "rec",
+   .help_short = "record process data",
+   .help_long =
+      "Record signals of up to 32 bits once per exchange, with pre- and\n"
+      "post-trigger depth in cycles. Without a trigger the latest cycles\n"
+      "are kept until stopped. Export the recording as CSV to the shell\n"
+      "or a file, or as binary to a file (see uphy-rec-decode.py).\n"
+      "Usage: rec [add <slot.name>... | clear | trig | stop]\n"
+      "       rec arm <pre> <post> [<ch> change | <ch> rise|fall <level>]\n"
+      "       rec csv [file] | rec bin <file>\n"};
+
+SHELL_CMD (cmd_rec);
@@ -0,0 +1,37 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+
+#ifndef RECORDER_CMD_H_
+#define RECORDER_CMD_H_
+
+#include "up_types.h"
+
+/* RAM ring for recorded process data */
+#define RECORDER_CMD_BUFFER_SIZE (32 * 1024)
+
+/**
+ * Initialise the process data recorder. Nothing is recorded until armed
+ * by the 'rec' shell command.
+ *
+ * @param vars       Signal table
+ */
+extern void recorder_cmd_init (const up_signal_info_t * vars);
+
+/**
+ * Record the process data of this exchange. Called from the cyclic
+ * callbacks after the inputs have been written, does nothing unless the
+ * recorder is armed.
+ */
+extern void recorder_cmd_sample (void);
+
+#endif /* RECORDER_CMD_H_ */
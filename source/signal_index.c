@@ -0,0 +1,630 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Lookup of signals and parameters by name.
+ *
+ * A model blob carries a perfect hash index built by uphy-model-blob.py,
+ * so a lookup is two hashes of the key and one name compare. For the
+ * compiled in model the same hash is used to build an open addressing
+ * table at startup.
+ */
+
+#include "signal_index.h"
+#include "param_store.h"
+#include "shell.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_BASIS 0x811C9DC5u
+#define FNV_PRIME 0x01000193u
+
+/* Largest value handled by the shell commands */
+#define MAX_VALUE_SIZE 64
+
+#define WATCH_DEFAULT_COUNT    10
+#define WATCH_DEFAULT_INTERVAL 500 /* ms */
+
+static const up_device_t * device;
+static up_signal_info_t * vars;
+
+/* Perfect hash index from blob, or NULL */
+static const uint16_t * displacement;
+static uint32_t n_buckets;
+
+/* Entries of perfect hash index, or of open addressing table */
+static const model_blob_name_t * entries;
+static uint32_t n_entries;
+
+static uint32_t hash_update (uint32_t h, const char * s)
+{
+   for (; *s != '\0'; s++)
+   {
+      h ^= (*s == ' ') ? '_' : (uint8_t)*s;
+      h *= FNV_PRIME;
+   }
+   return h;
+}
+
+static uint32_t hash (const char * key, uint32_t seed)
+{
+   return hash_update (FNV_BASIS ^ seed, key);
+}
+
+static inline char normalize (char c)
+{
+   return (c == ' ') ? '_' : c;
+}
+
+/* Compare start of key with name, return rest of key or NULL */
+static const char * match (const char * key, const char * name)
+{
+   for (; *name != '\0'; key++, name++)
+   {
+      if (normalize (*key) != normalize (*name))
+      {
+         return NULL;
+      }
+   }
+   return key;
+}
+
+static void get_ref (const model_blob_name_t * e, signal_ref_t * ref)
+{
+   const up_slot_t * slot = &device->slots[e->slot];
+
+   ref->slot_ix = e->slot;
+   ref->kind = e->kind;
+   ref->index = e->index;
+   ref->ix = e->ix;
+
+   if (e->kind == MODEL_BLOB_KIND_PARAM)
+   {
+      const up_param_t * p = &slot->params[e->index];
+
+      ref->name = p->name;
+      ref->datatype = p->datatype;
+      ref->bitlength = p->bitlength;
+   }
+   else
+   {
+      const up_signal_t * s = (e->kind == MODEL_BLOB_KIND_INPUT)
+                                 ? &slot->inputs[e->index]
+                                 : &slot->outputs[e->index];
+
+      ref->name = s->name;
+      ref->datatype = s->datatype;
+      ref->bitlength = s->bitlength;
+   }
+}
+
+static bool is_match (const char * key, const model_blob_name_t * e)
+{
+   signal_ref_t ref;
+
+   get_ref (e, &ref);
+   key = match (key, device->slots[e->slot].name);
+   if (key == NULL || *key != '.')
+   {
+      return false;
+   }
+   key = match (key + 1, ref.name);
+   return key != NULL && *key == '\0';
+}
+
+static void insert (
+   model_blob_name_t * table,
+   uint32_t mask,
+   uint32_t h,
+   const model_blob_name_t * e)
+{
+   uint32_t i = h & mask;
+
+   while (table[i].kind != MODEL_BLOB_KIND_EMPTY)
+   {
+      i = (i + 1) & mask;
+   }
+   table[i] = *e;
+}
+
+static void insert_kind (
+   model_blob_name_t * table,
+   uint32_t mask,
+   uint16_t slot_ix,
+   uint8_t kind)
+{
+   const up_slot_t * slot = &device->slots[slot_ix];
+   uint32_t h = hash_update (FNV_BASIS, slot->name);
+   uint16_t n;
+
+   h = hash_update (h, ".");
+   switch (kind)
+   {
+   case MODEL_BLOB_KIND_INPUT:
+      n = slot->n_inputs;
+      break;
+   case MODEL_BLOB_KIND_OUTPUT:
+      n = slot->n_outputs;
+      break;
+   default:
+      n = slot->n_params;
+      break;
+   }
+
+   for (uint16_t i = 0; i < n; i++)
+   {
+      model_blob_name_t e = {.slot = slot_ix, .kind = kind, .index = i};
+      const char * name;
+
+      if (kind == MODEL_BLOB_KIND_PARAM)
+      {
+         name = slot->params[i].name;
+         e.ix = slot->params[i].ix;
+      }
+      else
+      {
+         const up_signal_t * s = (kind == MODEL_BLOB_KIND_INPUT)
+                                    ? &slot->inputs[i]
+                                    : &slot->outputs[i];
+         name = s->name;
+         e.ix = s->ix;
+      }
+
+      insert (table, mask, hash_update (h, name), &e);
+   }
+}
+
+/* Build open addressing table with at least twice as many entries as
+ * names, for the compiled in model */
+static int build_table (void)
+{
+   model_blob_name_t * table;
+   uint32_t n = 0;
+   uint32_t size = 1;
+
+   for (uint16_t i = 0; i < device->n_slots; i++)
+   {
+      const up_slot_t * slot = &device->slots[i];
+      n += slot->n_inputs + slot->n_outputs + slot->n_params;
+   }
+
+   while (size < 2 * n)
+   {
+      size *= 2;
+   }
+
+   table = malloc (size * sizeof (*table));
+   if (table == NULL)
+   {
+      return -1;
+   }
+   memset (table, MODEL_BLOB_KIND_EMPTY, size * sizeof (*table));
+
+   for (uint16_t i = 0; i < device->n_slots; i++)
+   {
+      insert_kind (table, size - 1, i, MODEL_BLOB_KIND_INPUT);
+      insert_kind (table, size - 1, i, MODEL_BLOB_KIND_OUTPUT);
+      insert_kind (table, size - 1, i, MODEL_BLOB_KIND_PARAM);
+   }
+
+   entries = table;
+   n_entries = size;
+   return 0;
+}
+
+int signal_index_init (
+   const up_device_t * dev,
+   up_signal_info_t * signal_vars,
+   const model_blob_header_t * blob)
+{
+   device = dev;
+   vars = signal_vars;
+
+   if (blob != NULL && blob->names != 0)
+   {
+      const uint8_t * base = (const uint8_t *)blob;
+      const model_blob_names_t * names = (const void *)(base + blob->names);
+
+      displacement = (const void *)(base + names->displacement);
+      n_buckets = names->n_buckets;
+      entries = (const void *)(base + names->entries);
+      n_entries = names->n_entries;
+      return 0;
+   }
+
+   displacement = NULL;
+   return build_table();
+}
+
+int signal_index_find (const char * key, signal_ref_t * ref)
+{
+   const model_blob_name_t * e;
+   uint32_t h = hash (key, 0);
+
+   if (entries == NULL)
+   {
+      return -1;
+   }
+
+   if (displacement != NULL)
+   {
+      e = &entries[hash (key, displacement[h % n_buckets]) % n_entries];
+      if (e->kind == MODEL_BLOB_KIND_EMPTY || !is_match (key, e))
+      {
+         return -1;
+      }
+   }
+   else
+   {
+      uint32_t mask = n_entries - 1;
+      uint32_t i = h & mask;
+
+      for (;;)
+      {
+         e = &entries[i];
+         if (e->kind == MODEL_BLOB_KIND_EMPTY)
+         {
+            return -1;
+         }
+         if (is_match (key, e))
+         {
+            break;
+         }
+         i = (i + 1) & mask;
+      }
+   }
+
+   get_ref (e, ref);
+   return 0;
+}
+
+static size_t value_size (const signal_ref_t * ref)
+{
+   size_t size = (ref->bitlength + 7) / 8;
+
+   return (size > MAX_VALUE_SIZE) ? MAX_VALUE_SIZE : size;
+}
+
+static void print_value (const signal_ref_t * ref, const uint8_t * value)
+{
+   union
+   {
+      uint8_t u8;
+      uint16_t u16;
+      uint32_t u32;
+      int8_t i8;
+      int16_t i16;
+      int32_t i32;
+      float f;
+   } v;
+
+   switch (ref->datatype)
+   {
+   case UP_DTYPE_UINT8:
+      memcpy (&v.u8, value, sizeof (v.u8));
+      printf ("%u", v.u8);
+      break;
+   case UP_DTYPE_UINT16:
+      memcpy (&v.u16, value, sizeof (v.u16));
+      printf ("%u", v.u16);
+      break;
+   case UP_DTYPE_UINT32:
+      memcpy (&v.u32, value, sizeof (v.u32));
+      printf ("%" PRIu32, v.u32);
+      break;
+   case UP_DTYPE_INT8:
+      memcpy (&v.i8, value, sizeof (v.i8));
+      printf ("%d", v.i8);
+      break;
+   case UP_DTYPE_INT16:
+      memcpy (&v.i16, value, sizeof (v.i16));
+      printf ("%d", v.i16);
+      break;
+   case UP_DTYPE_INT32:
+      memcpy (&v.i32, value, sizeof (v.i32));
+      printf ("%" PRId32, v.i32);
+      break;
+   case UP_DTYPE_REAL32:
+      memcpy (&v.f, value, sizeof (v.f));
+      printf ("%g", (double)v.f);
+      break;
+   default:
+      for (size_t i = 0; i < value_size (ref); i++)
+      {
+         printf ("%02x", value[i]);
+      }
+      break;
+   }
+}
+
+/* Parse value for datatype, return size or 0 if invalid */
+static size_t parse_value (
+   const signal_ref_t * ref,
+   const char * s,
+   uint8_t * value)
+{
+   char * end;
+   size_t size = value_size (ref);
+
+   if (ref->datatype == UP_DTYPE_REAL32)
+   {
+      float f = strtof (s, &end);
+
+      memcpy (value, &f, sizeof (f));
+      return (*end == '\0' && end != s) ? sizeof (f) : 0;
+   }
+
+   if (ref->datatype == UP_DTYPE_OCTET_STRING)
+   {
+      if (size < (ref->bitlength + 7u) / 8)
+      {
+         return 0;
+      }
+      for (size_t i = 0; i < size; i++)
+      {
+         char byte[3] = {s[2 * i], s[2 * i + 1], '\0'};
+
+         if (byte[0] == '\0' || byte[1] == '\0')
+         {
+            return 0;
+         }
+         value[i] = strtoul (byte, &end, 16);
+         if (*end != '\0')
+         {
+            return 0;
+         }
+      }
+      return (s[2 * size] == '\0') ? size : 0;
+   }
+
+   if (
+      ref->datatype == UP_DTYPE_INT8 || ref->datatype == UP_DTYPE_INT16 ||
+      ref->datatype == UP_DTYPE_INT32)
+   {
+      long long x = strtoll (s, &end, 0);
+      long long max = (1LL << (ref->bitlength - 1)) - 1;
+
+      if (*end != '\0' || end == s || x > max || x < -max - 1)
+      {
+         return 0;
+      }
+      if (size == 1)
+      {
+         int8_t i8 = x;
+         memcpy (value, &i8, size);
+      }
+      else if (size == 2)
+      {
+         int16_t i16 = x;
+         memcpy (value, &i16, size);
+      }
+      else
+      {
+         int32_t i32 = x;
+         memcpy (value, &i32, size);
+      }
+      return size;
+   }
+   else
+   {
+      unsigned long long x = strtoull (s, &end, 0);
+      unsigned long long max = (1ULL << ref->bitlength) - 1;
+
+      if (*end != '\0' || end == s || *s == '-' || x > max)
+      {
+         return 0;
+      }
+      if (size == 1)
+      {
+         uint8_t u8 = x;
+         memcpy (value, &u8, size);
+      }
+      else if (size == 2)
+      {
+         uint16_t u16 = x;
+         memcpy (value, &u16, size);
+      }
+      else
+      {
+         uint32_t u32 = x;
+         memcpy (value, &u32, size);
+      }
+      return size;
+   }
+}
+
+static const char * kind_name (uint8_t kind)
+{
+   switch (kind)
+   {
+   case MODEL_BLOB_KIND_INPUT:
+      return "in";
+   case MODEL_BLOB_KIND_OUTPUT:
+      return "out";
+   default:
+      return "par";
+   }
+}
+
+/* Print current value, copied out so that the cyclic callbacks never
+ * leave a torn value */
+static void show (const signal_ref_t * ref)
+{
+   up_signal_info_t * var = &vars[ref->ix];
+   uint8_t value[MAX_VALUE_SIZE];
+   up_signal_status_t status = 0;
+
+   taskENTER_CRITICAL();
+   memcpy (value, var->value, value_size (ref));
+   if (var->status != NULL)
+   {
+      status = *var->status;
+   }
+   taskEXIT_CRITICAL();
+
+   printf ("[%s] %s = ", kind_name (ref->kind), ref->name);
+   print_value (ref, value);
+   if (var->status != NULL)
+   {
+      printf (" (status 0x%02x)", status);
+   }
+   printf ("\n");
+}
+
+static int find_arg (const char * key, signal_ref_t * ref)
+{
+   if (signal_index_find (key, ref) != 0)
+   {
+      printf ("No signal or parameter \"%s\"\n", key);
+      return -1;
+   }
+   return 0;
+}
+
+static int _cmd_up_get (int argc, char * argv[])
+{
+   signal_ref_t ref;
+
+   if (argc != 2)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   if (find_arg (argv[1], &ref) != 0)
+   {
+      return -1;
+   }
+
+   show (&ref);
+   return 0;
+}
+
+const shell_cmd_t cmd_up_get = {
+   .cmd = _cmd_up_get,
+   .name = "up_get",
+   .help_short = "get signal or parameter value",
+   .help_long = "Print value and status of a signal or parameter.\n"
+                "Spaces in names may be given as underscores.\n"
+                "Usage: up_get <slot.name>\n"};
+
+SHELL_CMD (cmd_up_get);
+
+static int _cmd_up_set (int argc, char * argv[])
+{
+   signal_ref_t ref;
+   uint8_t value[MAX_VALUE_SIZE];
+   size_t size;
+
+   if (argc != 3)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   if (find_arg (argv[1], &ref) != 0)
+   {
+      return -1;
+   }
+
+   if (ref.kind == MODEL_BLOB_KIND_OUTPUT)
+   {
+      printf ("Outputs are written by the PLC\n");
+      return -1;
+   }
+
+   size = parse_value (&ref, argv[2], value);
+   if (size == 0)
+   {
+      printf ("Invalid value \"%s\"\n", argv[2]);
+      return -1;
+   }
+
+   taskENTER_CRITICAL();
+   memcpy (vars[ref.ix].value, value, size);
+   taskEXIT_CRITICAL();
+
+   if (ref.kind == MODEL_BLOB_KIND_PARAM)
+   {
+      param_store_changed (ref.slot_ix, ref.index);
+   }
+
+   show (&ref);
+   return 0;
+}
+
+const shell_cmd_t cmd_up_set = {
+   .cmd = _cmd_up_set,
+   .name = "up_set",
+   .help_short = "set input or parameter value",
+   .help_long =
+      "Set value of an input signal or a parameter. Inputs are sent to\n"
+      "the PLC in the next cycle, unless overwritten by the application.\n"
+      "Parameters are changed in the application and stored in flash.\n"
+      "Octet strings are given as hex bytes.\n"
+      "Usage: up_set <slot.name> <value>\n"};
+
+SHELL_CMD (cmd_up_set);
+
+static int _cmd_up_watch (int argc, char * argv[])
+{
+   signal_ref_t ref;
+   uint32_t count = WATCH_DEFAULT_COUNT;
+   uint32_t interval = WATCH_DEFAULT_INTERVAL;
+
+   if (argc < 2 || argc > 4)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   if (find_arg (argv[1], &ref) != 0)
+   {
+      return -1;
+   }
+
+   if (argc > 2)
+   {
+      count = strtoul (argv[2], NULL, 0);
+   }
+   if (argc > 3)
+   {
+      interval = strtoul (argv[3], NULL, 0);
+   }
+
+   for (uint32_t i = 0; i < count; i++)
+   {
+      if (i > 0)
+      {
+         vTaskDelay (pdMS_TO_TICKS (interval));
+      }
+      show (&ref);
+   }
+   return 0;
+}
+
+const shell_cmd_t cmd_up_watch = {
+   .cmd = _cmd_up_watch,
+   .name = "up_watch",
+   .help_short = "watch signal or parameter value",
+   .help_long = "Print value and status of a signal or parameter count\n"
+                "times, with interval ms in between. Default is 10 times\n"
+                "every 500 ms.\n"
+                "Usage: up_watch <slot.name> [count] [interval]\n"};
+
+SHELL_CMD (cmd_up_watch);
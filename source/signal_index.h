@@ -0,0 +1,59 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef SIGNAL_INDEX_H_
+#define SIGNAL_INDEX_H_
+
+#include "model_blob.h"
+#include "up_types.h"
+
+#include <stdint.h>
+
+/* Signal, output or parameter found by name */
+typedef struct signal_ref
+{
+   uint16_t slot_ix;
+   uint8_t kind; /* model_blob_kind_t */
+   uint16_t index; /* Index in inputs, outputs or params of slot */
+   uint16_t ix;    /* Signal index */
+   const char * name;
+   up_dtype_t datatype;
+   uint16_t bitlength;
+} signal_ref_t;
+
+/**
+ * Set up lookup of signals by "slot.signal" name.
+ *
+ * Uses the perfect hash index of a model blob in place if available,
+ * otherwise a hash table is built from the device model. Spaces in names
+ * may be given as underscores.
+ *
+ * @param device     Device model
+ * @param vars       Signal values and statuses
+ * @param blob       Model blob, or NULL for the compiled in model
+ * @return 0 on success, -1 if out of memory
+ */
+extern int signal_index_init (
+   const up_device_t * device,
+   up_signal_info_t * vars,
+   const model_blob_header_t * blob);
+
+/**
+ * Find a signal by name.
+ *
+ * @param key        Name as "slot.signal"
+ * @param ref        Found signal
+ * @return 0 if found, -1 if not
+ */
+extern int signal_index_find (const char * key, signal_ref_t * ref);
+
+#endif /* SIGNAL_INDEX_H_ */
@@ -0,0 +1,78 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Triple buffered snapshots.
+ *
+ * The writer and the reader each own one buffer, the third is the
+ * latest published one. Publishing and acquiring swap the own buffer
+ * with the published one in a single atomic exchange, LDREXB/STREXB on
+ * Cortex-M7, so a slow reader never blocks the cyclic writer.
+ */
+
+#include "snapshot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int snapshot_init (snapshot_t * s, uint32_t size)
+{
+   memset (s, 0, sizeof (*s));
+
+   s->buf[0] = calloc (3, size);
+   if (s->buf[0] == NULL)
+   {
+      return -1;
+   }
+   s->buf[1] = s->buf[0] + size;
+   s->buf[2] = s->buf[1] + size;
+   s->size = size;
+   s->write = 0;
+   s->ready = 1;
+   s->read = 2;
+   s->next_seq = 1;
+   return 0;
+}
+
+void snapshot_free (snapshot_t * s)
+{
+   free (s->buf[0]);
+   memset (s, 0, sizeof (*s));
+}
+
+void snapshot_publish (snapshot_t * s)
+{
+   uint8_t old;
+
+   s->seq[s->write] = s->next_seq++;
+   old = __atomic_exchange_n (
+      &s->ready,
+      s->write | SNAPSHOT_FRESH,
+      __ATOMIC_ACQ_REL);
+   s->write = old & ~SNAPSHOT_FRESH;
+}
+
+const uint8_t * snapshot_acquire (snapshot_t * s, uint32_t * seq)
+{
+   if (__atomic_load_n (&s->ready, __ATOMIC_ACQUIRE) & SNAPSHOT_FRESH)
+   {
+      uint8_t old = __atomic_exchange_n (&s->ready, s->read, __ATOMIC_ACQ_REL);
+
+      s->read = old & ~SNAPSHOT_FRESH;
+   }
+
+   if (seq != NULL)
+   {
+      *seq = s->seq[s->read];
+   }
+   return s->buf[s->read];
+}
@@ -0,0 +1,84 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Lock free snapshots of a buffer, passed from one writer to one reader
+ * with three buffers. The writer always has a buffer to fill and the
+ * reader always sees the latest complete snapshot; neither ever waits
+ * for the other. Several consumers served from one reader task share
+ * the snapshot of that task.
+ */
+typedef struct snapshot
+{
+   uint8_t * buf[3];
+   uint32_t size;
+   uint32_t seq[3]; /* Sequence number of the snapshot in each buffer */
+   uint32_t next_seq;
+   uint8_t write;   /* Owned by writer */
+   uint8_t read;    /* Owned by reader */
+   uint8_t ready;   /* Latest published buffer, | SNAPSHOT_FRESH if unread */
+} snapshot_t;
+
+#define SNAPSHOT_FRESH 0x80
+
+/**
+ * Allocate the buffers of a snapshot.
+ *
+ * @param s          Snapshot
+ * @param size       Size of each buffer
+ * @return 0 on success, -1 if out of memory
+ */
+extern int snapshot_init (snapshot_t * s, uint32_t size);
+
+/**
+ * Free the buffers of a snapshot. Neither the writer nor the reader may
+ * use the snapshot any longer.
+ *
+ * @param s          Snapshot
+ */
+extern void snapshot_free (snapshot_t * s);
+
+/**
+ * Buffer for the writer to fill with the next snapshot.
+ *
+ * @param s          Snapshot
+ */
+static inline uint8_t * snapshot_write_buffer (snapshot_t * s)
+{
+   return s->buf[s->write];
+}
+
+/**
+ * Publish the filled write buffer. Called by the writer only.
+ *
+ * @param s          Snapshot
+ */
+extern void snapshot_publish (snapshot_t * s);
+
+/**
+ * Latest published snapshot. Called by the reader only. The buffer
+ * stays valid until the next call.
+ *
+ * @param s          Snapshot
+ * @param seq        Set to the sequence number of the snapshot, 0 if
+ *                   none has been published yet. May be NULL.
+ * @return the snapshot
+ */
+extern const uint8_t * snapshot_acquire (snapshot_t * s, uint32_t * seq);
+
+#endif /* SNAPSHOT_H_ */
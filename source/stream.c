@@ -0,0 +1,727 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Server-Sent Events stream of process data, see stream.h.
+ *
+ * Free of lwIP and RTOS dependencies so that it can be tested on a host
+ * with many viewers, see bench/stream_bench.c. The sockets, the task
+ * and the snapshot published by the cyclic callbacks are found in
+ * stream_net.c.
+ */
+
+#include "stream.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define SSE_HEADERS                                                            \
+   "HTTP/1.1 200 OK\r\n"                                                       \
+   "Content-Type: text/event-stream\r\n"                                       \
+   "Cache-Control: no-cache\r\n"                                               \
+   "Access-Control-Allow-Origin: *\r\n"                                        \
+   "\r\n"                                                                      \
+   "retry: 2000\n\n"
+
+#define ASSET_HEADERS                                                          \
+   "HTTP/1.1 200 OK\r\n"                                                       \
+   "Content-Type: %s\r\n"                                                      \
+   "Content-Encoding: gzip\r\n"                                                \
+   "Content-Length: %u\r\n"                                                    \
+   "ETag: %s\r\n"                                                              \
+   "Cache-Control: %s\r\n"                                                     \
+   "Vary: Accept-Encoding\r\n"                                                 \
+   "\r\n"
+
+#define NOT_MODIFIED_HEADERS                                                   \
+   "HTTP/1.1 304 Not Modified\r\n"                                             \
+   "ETag: %s\r\n"                                                              \
+   "Cache-Control: %s\r\n"                                                     \
+   "\r\n"
+
+/* Assets other than pages are referred to with their ETag */
+#define CACHE_IMMUTABLE "public, max-age=31536000, immutable"
+#define CACHE_REVALIDATE "no-cache"
+
+static const char not_found[] = "HTTP/1.1 404 Not Found\r\n"
+                                "Content-Length: 0\r\n"
+                                "Connection: close\r\n"
+                                "\r\n";
+
+static const char not_acceptable[] = "HTTP/1.1 406 Not Acceptable\r\n"
+                                     "Content-Length: 0\r\n"
+                                     "Connection: close\r\n"
+                                     "\r\n";
+
+static const char bad_request[] = "HTTP/1.1 400 Bad Request\r\n"
+                                  "Content-Length: 0\r\n"
+                                  "Connection: close\r\n"
+                                  "\r\n";
+
+static const char keepalive[] = ":\n\n";
+
+static const char * const type_names[] = {"uint", "int", "real", "octets"};
+
+/* Longest encoding of a value of each type and size */
+static uint16_t value_max (const stream_field_t * f)
+{
+   switch (f->type)
+   {
+   case STREAM_UINT:
+      return (f->size == 1) ? 3 : (f->size == 2) ? 5 : 10;
+   case STREAM_INT:
+      return (f->size == 1) ? 4 : (f->size == 2) ? 6 : 11;
+   case STREAM_REAL:
+      return 15; /* -1.23456789e+38 */
+   default:
+      return 2 + 2 * f->size;
+   }
+}
+
+static int encode_value (
+   const stream_field_t * f,
+   const uint8_t * image,
+   char * p,
+   size_t size)
+{
+   const uint8_t * v = image + f->offset;
+   union
+   {
+      uint8_t u8;
+      uint16_t u16;
+      uint32_t u32;
+      int8_t i8;
+      int16_t i16;
+      int32_t i32;
+      float f;
+   } x;
+   int len;
+
+   memcpy (&x, v, (f->size <= sizeof (x)) ? f->size : sizeof (x));
+
+   switch (f->type)
+   {
+   case STREAM_UINT:
+      return snprintf (
+         p,
+         size,
+         "%lu",
+         (unsigned long)((f->size == 1)   ? x.u8
+                         : (f->size == 2) ? x.u16
+                                          : x.u32));
+   case STREAM_INT:
+      return snprintf (
+         p,
+         size,
+         "%ld",
+         (long)((f->size == 1) ? x.i8 : (f->size == 2) ? x.i16 : x.i32));
+   case STREAM_REAL:
+      if (!isfinite (x.f))
+      {
+         return snprintf (p, size, "null");
+      }
+      return snprintf (p, size, "%.9g", (double)x.f);
+   default:
+      len = snprintf (p, size, "\"");
+      for (uint8_t i = 0; i < f->size; i++)
+      {
+         len += snprintf (p + len, size - len, "%02x", v[i]);
+      }
+      return len + snprintf (p + len, size - len, "\"");
+   }
+}
+
+void stream_init (
+   stream_t * s,
+   stream_field_t * fields,
+   uint16_t max_fields,
+   uint8_t * prev,
+   stream_client_t * clients,
+   uint16_t n_clients,
+   const stream_ops_t * ops,
+   const web_asset_t * assets,
+   uint16_t n_assets)
+{
+   memset (s, 0, sizeof (*s));
+   s->fields = fields;
+   s->max_fields = max_fields;
+   s->prev = prev;
+   s->clients = clients;
+   s->n_clients = n_clients;
+   s->ops = ops;
+   s->assets = assets;
+   s->n_assets = n_assets;
+   s->full_max =
+      sizeof ("event: full\ndata: {\"seq\":4294967295,\"v\":[]}\n\n");
+
+   for (uint16_t i = 0; i < n_clients; i++)
+   {
+      clients[i].phase = STREAM_CLOSED;
+   }
+}
+
+int stream_add_field (
+   stream_t * s,
+   const char * slot,
+   const char * name,
+   stream_type_t type,
+   uint8_t size,
+   bool output)
+{
+   stream_field_t * f = &s->fields[s->n_fields];
+   uint16_t max;
+
+   if (s->n_fields == s->max_fields)
+   {
+      return -1;
+   }
+
+   f->slot = slot;
+   f->name = name;
+   f->type = type;
+   f->size = size;
+   f->output = output;
+   f->offset = s->image_size;
+
+   /* The meta entry of a field must fit the buffer of a viewer */
+   max = value_max (f) + 1;
+   if (
+      s->full_max + max > STREAM_MAX_EVENT ||
+      strlen (slot) + strlen (name) + 48 > STREAM_MAX_EVENT)
+   {
+      return -1;
+   }
+
+   s->full_max += max;
+   s->image_size += size;
+   s->n_fields++;
+   return f->offset;
+}
+
+stream_client_t * stream_open (stream_t * s, int fd)
+{
+   for (uint16_t i = 0; i < s->n_clients; i++)
+   {
+      stream_client_t * c = &s->clients[i];
+
+      if (c->phase == STREAM_CLOSED)
+      {
+         memset (c, 0, sizeof (*c) - sizeof (c->buf));
+         c->fd = fd;
+         c->phase = STREAM_REQUEST;
+         s->stats.accepted++;
+         return c;
+      }
+   }
+   s->stats.refused++;
+   return NULL;
+}
+
+void stream_close (stream_t * s, stream_client_t * c)
+{
+   if (c->phase != STREAM_CLOSED)
+   {
+      s->ops->close (c->fd);
+      c->phase = STREAM_CLOSED;
+      c->out_len = 0;
+   }
+}
+
+uint16_t stream_viewers (const stream_t * s)
+{
+   uint16_t n = 0;
+
+   for (uint16_t i = 0; i < s->n_clients; i++)
+   {
+      n += (s->clients[i].phase == STREAM_LIVE) ? 1 : 0;
+   }
+   return n;
+}
+
+static void client_send (stream_client_t * c, const void * data, uint16_t len)
+{
+   c->out = data;
+   c->out_len = len;
+}
+
+static bool is_shared (const stream_t * s, const uint8_t * p)
+{
+   return (p >= s->delta && p < s->delta + sizeof (s->delta)) ||
+          (p >= s->full && p < s->full + sizeof (s->full));
+}
+
+/* Send what the connection takes, keep the rest. Return -1 on error */
+static int client_flush (stream_t * s, stream_client_t * c)
+{
+   int n;
+
+   if (c->out_len == 0)
+   {
+      return 0;
+   }
+
+   n = s->ops->send (c->fd, c->out, c->out_len);
+   if (n < 0)
+   {
+      return -1;
+   }
+
+   s->stats.bytes += n;
+   c->out += n;
+   c->out_len -= n;
+   if (n > 0)
+   {
+      c->stall = 0;
+   }
+
+   /* The shared events are overwritten at the next tick */
+   if (c->out_len > 0 && is_shared (s, c->out))
+   {
+      memmove (c->buf, c->out, c->out_len);
+      c->out = c->buf;
+   }
+   return 0;
+}
+
+/* Next part of the headers and the meta event, as many fields as fit */
+static void client_meta (stream_t * s, stream_client_t * c)
+{
+   char * p = (char *)c->buf;
+   size_t size = sizeof (c->buf);
+   size_t len = 0;
+
+   if (c->meta_ix == 0)
+   {
+      len = snprintf (p, size, "%sevent: meta\ndata: [", SSE_HEADERS);
+   }
+
+   while (c->meta_ix < s->n_fields)
+   {
+      const stream_field_t * f = &s->fields[c->meta_ix];
+      size_t entry = strlen (f->slot) + strlen (f->name) + 48;
+
+      if (len + entry > size)
+      {
+         break;
+      }
+      len += snprintf (
+         p + len,
+         size - len,
+         "%s{\"name\":\"%s.%s\",\"type\":\"%s%u\",\"dir\":\"%s\"}",
+         c->meta_ix ? "," : "",
+         f->slot,
+         f->name,
+         type_names[f->type],
+         f->size * 8,
+         f->output ? "out" : "in");
+      c->meta_ix++;
+   }
+
+   if (c->meta_ix == s->n_fields && len + 4 <= size)
+   {
+      len += snprintf (p + len, size - len, "]\n\n");
+      c->phase = STREAM_LIVE;
+      c->seq = 0;
+   }
+   client_send (c, c->buf, len);
+}
+
+/* Progress a connection that is not live. Return -1 to close */
+static int client_pump (stream_t * s, stream_client_t * c)
+{
+   while (c->phase != STREAM_LIVE)
+   {
+      if (client_flush (s, c) != 0)
+      {
+         return -1;
+      }
+      if (c->out_len > 0)
+      {
+         return 0;
+      }
+
+      switch (c->phase)
+      {
+      case STREAM_META:
+         client_meta (s, c);
+         break;
+      case STREAM_ASSET:
+         if (c->asset != NULL)
+         {
+            /* Sent from flash, a remainder is not copied */
+            client_send (c, c->asset->data, c->asset->size);
+            c->asset = NULL;
+            break;
+         }
+         c->phase = STREAM_REQUEST;
+         return 0;
+      case STREAM_CLOSING:
+         return -1;
+      default:
+         return 0;
+      }
+   }
+   return 0;
+}
+
+/* Value of a request header, NULL if missing */
+static const char * request_header (const char * req, const char * name)
+{
+   size_t len = strlen (name);
+   const char * p = strchr (req, '\n');
+
+   while (p != NULL && p[1] != '\r' && p[1] != '\n' && p[1] != '\0')
+   {
+      p++;
+      if (strncasecmp (p, name, len) == 0 && p[len] == ':')
+      {
+         return p + len + 1;
+      }
+      p = strchr (p, '\n');
+   }
+   return NULL;
+}
+
+/* True if the header value contains token */
+static bool header_contains (const char * value, const char * token)
+{
+   size_t len = (value != NULL) ? strcspn (value, "\r\n") : 0;
+   size_t n = strlen (token);
+
+   for (size_t i = 0; i + n <= len; i++)
+   {
+      if (strncmp (value + i, token, n) == 0)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+static const web_asset_t * find_asset (
+   const stream_t * s,
+   const char * path,
+   size_t len)
+{
+   for (uint16_t i = 0; i < s->n_assets; i++)
+   {
+      const web_asset_t * a = &s->assets[i];
+
+      if (strlen (a->path) == len && strncmp (a->path, path, len) == 0)
+      {
+         return a;
+      }
+   }
+   return NULL;
+}
+
+/* Answer with a static asset, the headers are written over the
+ * request */
+static void client_asset (
+   stream_t * s,
+   stream_client_t * c,
+   const web_asset_t * a)
+{
+   const char * req = (const char *)c->buf;
+   const char * match = request_header (req, "If-None-Match");
+   const char * encoding = request_header (req, "Accept-Encoding");
+   const char * cache = a->immutable ? CACHE_IMMUTABLE : CACHE_REVALIDATE;
+   bool modified = !header_contains (match, a->etag);
+   int len;
+
+   if (modified && !header_contains (encoding, "gzip"))
+   {
+      /* Only the compressed asset is kept */
+      c->phase = STREAM_CLOSING;
+      client_send (c, not_acceptable, sizeof (not_acceptable) - 1);
+      return;
+   }
+
+   if (modified)
+   {
+      len = snprintf (
+         (char *)c->buf,
+         sizeof (c->buf),
+         ASSET_HEADERS,
+         a->type,
+         (unsigned)a->size,
+         a->etag,
+         cache);
+      c->asset = a;
+      s->stats.assets++;
+   }
+   else
+   {
+      len = snprintf (
+         (char *)c->buf,
+         sizeof (c->buf),
+         NOT_MODIFIED_HEADERS,
+         a->etag,
+         cache);
+      c->asset = NULL;
+      s->stats.not_modified++;
+   }
+
+   c->phase = STREAM_ASSET;
+   client_send (c, c->buf, len);
+}
+
+static void client_request (stream_t * s, stream_client_t * c)
+{
+   const char * req = (const char *)c->buf;
+   const web_asset_t * a = NULL;
+
+   if (strncmp (req, "GET ", 4) != 0)
+   {
+      c->phase = STREAM_CLOSING;
+      client_send (c, bad_request, sizeof (bad_request) - 1);
+      return;
+   }
+
+   if (
+      strncmp (req, "GET /stream", 11) == 0 &&
+      (req[11] == ' ' || req[11] == '?'))
+   {
+      c->phase = STREAM_META;
+      c->meta_ix = 0;
+      return;
+   }
+
+   a = find_asset (s, req + 4, strcspn (req + 4, " ?\r\n"));
+   if (a != NULL)
+   {
+      client_asset (s, c, a);
+      return;
+   }
+
+   c->phase = STREAM_CLOSING;
+   client_send (c, not_found, sizeof (not_found) - 1);
+}
+
+void stream_receive (
+   stream_t * s,
+   stream_client_t * c,
+   const void * data,
+   uint16_t len)
+{
+   uint16_t n;
+
+   if (c->phase != STREAM_REQUEST)
+   {
+      return;
+   }
+
+   /* Keep room for the terminator */
+   n = sizeof (c->buf) - 1 - c->len;
+   n = (len < n) ? len : n;
+   memcpy (c->buf + c->len, data, n);
+   c->len += n;
+   c->buf[c->len] = '\0';
+
+   if (strstr ((char *)c->buf, "\r\n\r\n") || strstr ((char *)c->buf, "\n\n"))
+   {
+      client_request (s, c);
+   }
+   else if (c->len >= STREAM_MAX_REQUEST)
+   {
+      c->phase = STREAM_CLOSING;
+      client_send (c, bad_request, sizeof (bad_request) - 1);
+   }
+   else
+   {
+      return;
+   }
+
+   c->len = 0;
+   if (client_pump (s, c) != 0)
+   {
+      stream_close (s, c);
+   }
+}
+
+void stream_writable (stream_t * s, stream_client_t * c)
+{
+   if (c->phase == STREAM_CLOSED || c->phase == STREAM_LIVE)
+   {
+      return;
+   }
+   if (client_pump (s, c) != 0)
+   {
+      stream_close (s, c);
+   }
+}
+
+/* Encode the changes since the previous tick, false if too large */
+static bool encode_delta (stream_t * s, const uint8_t * image)
+{
+   char * p = (char *)s->delta;
+   size_t size = sizeof (s->delta);
+   size_t len;
+   uint16_t n = 0;
+
+   len = snprintf (
+      p,
+      size,
+      "event: delta\ndata: {\"seq\":%lu,\"v\":{",
+      (unsigned long)s->seq);
+
+   for (uint16_t i = 0; i < s->n_fields; i++)
+   {
+      const stream_field_t * f = &s->fields[i];
+
+      if (memcmp (image + f->offset, s->prev + f->offset, f->size) == 0)
+      {
+         continue;
+      }
+      if (len + value_max (f) + 16 > size)
+      {
+         return false;
+      }
+      len += snprintf (p + len, size - len, "%s\"%u\":", n ? "," : "", i);
+      len += encode_value (f, image, p + len, size - len);
+      n++;
+   }
+
+   len += snprintf (p + len, size - len, "}}\n\n");
+   s->delta_len = (n > 0) ? len : 0;
+   s->stats.deltas += (n > 0) ? 1 : 0;
+   return true;
+}
+
+static void encode_full (stream_t * s, const uint8_t * image)
+{
+   char * p = (char *)s->full;
+   size_t size = sizeof (s->full);
+   size_t len;
+
+   len = snprintf (
+      p,
+      size,
+      "event: full\ndata: {\"seq\":%lu,\"v\":[",
+      (unsigned long)s->seq);
+   for (uint16_t i = 0; i < s->n_fields; i++)
+   {
+      len += snprintf (p + len, size - len, "%s", i ? "," : "");
+      len += encode_value (&s->fields[i], image, p + len, size - len);
+   }
+   len += snprintf (p + len, size - len, "]}\n\n");
+   s->full_len = len;
+   s->stats.fulls++;
+}
+
+/* Send the event of this tick that brings the viewer up to date */
+static void client_update (
+   stream_t * s,
+   stream_client_t * c,
+   const uint8_t * image)
+{
+   if (c->out_len > 0)
+   {
+      c->skipped++;
+      return;
+   }
+
+   if (c->seq == s->seq)
+   {
+      if (++c->idle >= STREAM_KEEPALIVE_TICK)
+      {
+         client_send (c, keepalive, sizeof (keepalive) - 1);
+         c->idle = 0;
+      }
+      return;
+   }
+
+   if (c->seq != 0 && c->seq == s->prev_seq && s->delta_valid)
+   {
+      if (s->delta_len > 0)
+      {
+         client_send (c, s->delta, s->delta_len);
+         c->deltas++;
+      }
+   }
+   else
+   {
+      if (s->full_len == 0)
+      {
+         encode_full (s, image);
+      }
+      client_send (c, s->full, s->full_len);
+      c->fulls++;
+   }
+   c->seq = s->seq;
+   c->idle = 0;
+}
+
+void stream_tick (stream_t * s, const uint8_t * image, uint32_t seq)
+{
+   s->stats.ticks++;
+   s->full_len = 0;
+
+   if (seq != 0 && seq != s->seq)
+   {
+      s->prev_seq = s->seq;
+      s->seq = seq;
+      s->delta_valid = (s->prev_seq != 0) && encode_delta (s, image);
+   }
+
+   for (uint16_t i = 0; i < s->n_clients; i++)
+   {
+      stream_client_t * c = &s->clients[i];
+
+      if (c->phase == STREAM_CLOSED)
+      {
+         continue;
+      }
+
+      /* Cleared by any progress */
+      c->stall++;
+
+      if (client_pump (s, c) != 0 || client_flush (s, c) != 0)
+      {
+         stream_close (s, c);
+         continue;
+      }
+
+      if (c->phase == STREAM_LIVE && s->seq != 0)
+      {
+         client_update (s, c, image);
+         if (client_flush (s, c) != 0)
+         {
+            stream_close (s, c);
+            continue;
+         }
+      }
+
+      if (c->out_len == 0 && c->phase != STREAM_REQUEST)
+      {
+         c->stall = 0;
+      }
+      else if (c->stall >= STREAM_STALL_TICKS)
+      {
+         /* Not an idle connection waiting for its next request */
+         s->stats.stalled += (c->len > 0 || c->out_len > 0) ? 1 : 0;
+         stream_close (s, c);
+      }
+   }
+
+   if (seq != 0)
+   {
+      for (uint16_t i = 0; i < s->n_fields; i++)
+      {
+         const stream_field_t * f = &s->fields[i];
+
+         memcpy (s->prev + f->offset, image + f->offset, f->size);
+      }
+   }
+}
@@ -0,0 +1,249 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include "web_assets.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Server-Sent Events stream of process data to web viewers.
+ *
+ * Once per tick the latest image of the signals is compared to the
+ * image of the previous tick and the changed signals are encoded once,
+ * as a "delta" event shared by all viewers. A viewer that has not
+ * received the previous tick, because it is new or its connection
+ * could not take more data, is sent a "full" event instead, also
+ * encoded at most once per tick. The work per tick is thus one pass
+ * over the image, at most two encodings and one non-blocking send per
+ * viewer, whatever the number of viewers.
+ *
+ * A viewer first gets a "meta" event with the name, type and direction
+ * of each signal, in the order used by the other events:
+ *   event: meta   data: [{"name":"<slot>.<signal>","type":"uint8",
+ *                         "dir":"in"},...]
+ *   event: full   data: {"seq":<n>,"v":[<value>,...]}
+ *   event: delta  data: {"seq":<n>,"v":{"<index>":<value>,...}}
+ * Octet strings are sent as hex strings, other values as numbers.
+ *
+ * Data that a connection cannot take is kept per viewer and sent
+ * first at the next tick. Viewers whose connection takes nothing for
+ * STREAM_STALL_TICKS ticks are closed.
+ *
+ * Other paths are served from a table of gzip compressed static assets
+ * in flash, see web_assets.h. The connection is kept open for the next
+ * request, and a request with the current ETag in If-None-Match gets
+ * 304 Not Modified without the body.
+ */
+
+#define STREAM_MAX_EVENT      1536 /* Largest event, limits the fields */
+#define STREAM_MAX_REQUEST    1024 /* Browsers send about 500 bytes */
+#define STREAM_KEEPALIVE_TICK 150 /* Comment sent to idle viewers */
+#define STREAM_STALL_TICKS    300
+
+typedef enum stream_type
+{
+   STREAM_UINT,
+   STREAM_INT,
+   STREAM_REAL,
+   STREAM_OCTETS,
+} stream_type_t;
+
+typedef enum stream_phase
+{
+   STREAM_CLOSED,
+   STREAM_REQUEST, /* Receiving the HTTP request */
+   STREAM_ASSET,   /* Sending a static asset, then a new request */
+   STREAM_META,    /* Sending the headers and meta event */
+   STREAM_LIVE,
+   STREAM_CLOSING, /* Sending an error, then closing */
+} stream_phase_t;
+
+typedef struct stream_field
+{
+   const char * slot;
+   const char * name;
+   uint16_t offset; /* In image */
+   uint8_t size;
+   uint8_t type; /* stream_type_t */
+   bool output;
+} stream_field_t;
+
+/* Connection operations, provided by the network layer */
+typedef struct stream_ops
+{
+   /* Send without blocking, return bytes sent or -1 on error */
+   int (*send) (int fd, const void * buf, uint16_t len);
+   void (*close) (int fd);
+} stream_ops_t;
+
+typedef struct stream_client
+{
+   int fd;
+   uint8_t phase; /* stream_phase_t */
+   uint32_t seq;  /* Tick the viewer has when out is sent, 0 if none */
+   uint16_t meta_ix;
+   const web_asset_t * asset; /* Body to send after the headers */
+   uint16_t idle;  /* Ticks without an event */
+   uint16_t stall; /* Ticks without progress */
+   const uint8_t * out;
+   uint16_t out_len;
+   uint16_t len; /* Request received or output kept in buf */
+   uint8_t buf[STREAM_MAX_EVENT];
+
+   uint32_t deltas;
+   uint32_t fulls;
+   uint32_t skipped; /* Ticks not sent, connection busy */
+} stream_client_t;
+
+typedef struct stream_stats
+{
+   uint32_t accepted;
+   uint32_t refused;
+   uint32_t stalled;
+   uint32_t assets;       /* Sent with body */
+   uint32_t not_modified; /* Sent without body, 304 */
+   uint32_t ticks;
+   uint32_t deltas; /* Encoded */
+   uint32_t fulls;
+   uint32_t bytes;
+} stream_stats_t;
+
+typedef struct stream
+{
+   /* Set at init */
+   stream_field_t * fields;
+   uint16_t max_fields;
+   uint16_t n_fields;
+   uint16_t image_size;
+   uint16_t full_max; /* Worst case size of a full event */
+   uint8_t * prev;    /* Image of the previous tick */
+   uint32_t prev_seq;
+   stream_client_t * clients;
+   uint16_t n_clients;
+   const stream_ops_t * ops;
+   const web_asset_t * assets;
+   uint16_t n_assets;
+
+   /* Encoded at each tick */
+   uint32_t seq;
+   uint16_t delta_len;
+   uint16_t full_len; /* 0 until needed */
+   bool delta_valid;  /* False if too large or no previous tick */
+   uint8_t delta[STREAM_MAX_EVENT];
+   uint8_t full[STREAM_MAX_EVENT];
+
+   stream_stats_t stats;
+} stream_t;
+
+/**
+ * Initialise a stream.
+ *
+ * @param s          Stream
+ * @param fields     Field table
+ * @param max_fields Size of field table
+ * @param prev       Previous image, at least the size of the image
+ * @param clients    Viewers
+ * @param n_clients  Number of viewers
+ * @param ops        Connection operations
+ * @param assets     Static assets, NULL for none
+ * @param n_assets   Number of static assets
+ */
+extern void stream_init (
+   stream_t * s,
+   stream_field_t * fields,
+   uint16_t max_fields,
+   uint8_t * prev,
+   stream_client_t * clients,
+   uint16_t n_clients,
+   const stream_ops_t * ops,
+   const web_asset_t * assets,
+   uint16_t n_assets);
+
+/**
+ * Add a field. The fields are laid out in the image in the order they
+ * are added. Only before any viewer is connected.
+ *
+ * @param s          Stream
+ * @param slot       Slot name
+ * @param name       Signal name
+ * @param type       stream_type_t
+ * @param size       Size in bytes, 1, 2 or 4 unless STREAM_OCTETS
+ * @param output     True for an output signal
+ * @return offset in image, -1 if full or a full event would not fit
+ */
+extern int stream_add_field (
+   stream_t * s,
+   const char * slot,
+   const char * name,
+   stream_type_t type,
+   uint8_t size,
+   bool output);
+
+/**
+ * Open a viewer connection.
+ *
+ * @param s          Stream
+ * @param fd         Connection, passed to the operations
+ * @return viewer, NULL if all are busy
+ */
+extern stream_client_t * stream_open (stream_t * s, int fd);
+
+/**
+ * Close a viewer connection.
+ */
+extern void stream_close (stream_t * s, stream_client_t * c);
+
+/**
+ * Number of open viewer connections.
+ */
+extern uint16_t stream_viewers (const stream_t * s);
+
+/**
+ * Pass data received on a viewer connection. The request is handled
+ * when complete, data received while it is answered is ignored.
+ *
+ * @param s          Stream
+ * @param c          Viewer
+ * @param data       Received data
+ * @param len        Length of data
+ */
+extern void stream_receive (
+   stream_t * s,
+   stream_client_t * c,
+   const void * data,
+   uint16_t len);
+
+/**
+ * Continue sending a response, when the connection can take more data.
+ * Events to live viewers are only sent by stream_tick().
+ *
+ * @param s          Stream
+ * @param c          Viewer
+ */
+extern void stream_writable (stream_t * s, stream_client_t * c);
+
+/**
+ * Send the changes since the previous tick to all viewers. Called at
+ * the maximum event rate.
+ *
+ * @param s          Stream
+ * @param image      Latest image
+ * @param seq        Sequence number of image, 0 if none
+ */
+extern void stream_tick (stream_t * s, const uint8_t * image, uint32_t seq);
+
+#endif /* STREAM_H_ */
@@ -0,0 +1,501 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Process data streaming to web viewers, see source/stream.c.
+ *
+ * While a viewer is connected the cyclic callbacks copy the signals to
+ * a triple buffered snapshot, like the Modbus TCP gateway. The stream
+ * task wakes at the event rate, takes the latest snapshot and passes it
+ * to all viewers with one call of stream_tick(), so the cost of the
+ * viewers is bounded by the rate and STREAM_MAX_CLIENTS whatever they
+ * do. Sockets are written without blocking; a viewer whose connection
+ * is full skips ticks instead of delaying the others.
+ *
+ * The same port serves the viewer page and its assets from web/, gzip
+ * compressed into flash at build time. Responses are continued as soon
+ * as the socket is writable, not at the next tick, so that a page loads
+ * at the speed of the network.
+ */
+
+#include "stream_net.h"
+#include "cycle_stats.h"
+#include "mem_sections.h"
+#include "shell.h"
+#include "snapshot.h"
+#include "stream.h"
+#include "web_assets.h"
+
+#include "lwip/sockets.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Copy of one signal to the snapshot */
+typedef struct source
+{
+   const uint8_t * src;
+   uint16_t offset;
+   uint8_t size;
+} source_t;
+
+static stream_t stream;
+static stream_field_t fields[STREAM_NET_MAX_FIELDS];
+static stream_client_t clients[STREAM_MAX_CLIENTS];
+static uint8_t * prev;
+static uint16_t n_skipped; /* Signals not streamed, event too large */
+static uint16_t server_port;
+static uint16_t rate = STREAM_NET_RATE;
+
+static source_t * sources APP_DTCM_DATA;
+static uint16_t n_sources APP_DTCM_DATA;
+static volatile bool publishing APP_DTCM_DATA;
+static snapshot_t snapshot APP_DTCM_DATA;
+
+static cycle_stats_t publish_stats APP_DTCM_DATA =
+   CYCLE_STATS_INIT ("stream publish");
+static cycle_stats_t tick_stats = CYCLE_STATS_INIT ("stream tick");
+
+static stream_type_t field_type (up_dtype_t datatype)
+{
+   switch (datatype)
+   {
+   case UP_DTYPE_INT8:
+   case UP_DTYPE_INT16:
+   case UP_DTYPE_INT32:
+      return STREAM_INT;
+   case UP_DTYPE_REAL32:
+      return STREAM_REAL;
+   case UP_DTYPE_OCTET_STRING:
+      return STREAM_OCTETS;
+   default:
+      return STREAM_UINT;
+   }
+}
+
+static void add_fields (
+   const up_slot_t * slot,
+   const up_signal_t * signals,
+   uint16_t n,
+   const up_signal_info_t * vars,
+   bool output)
+{
+   for (uint16_t i = 0; i < n; i++)
+   {
+      uint16_t size = (signals[i].bitlength + 7) / 8;
+      stream_type_t type = field_type (signals[i].datatype);
+      int offset = -1;
+
+      if (type == STREAM_OCTETS || size == 1 || size == 2 || size == 4)
+      {
+         offset = stream_add_field (
+            &stream,
+            slot->name,
+            signals[i].name,
+            type,
+            size,
+            output);
+      }
+      if (offset < 0)
+      {
+         n_skipped++;
+         continue;
+      }
+
+      sources[n_sources].src = vars[signals[i].ix].value;
+      sources[n_sources].offset = offset;
+      sources[n_sources].size = size;
+      n_sources++;
+   }
+}
+
+APP_ITCM_FUNC void stream_net_publish (void)
+{
+   uint32_t start;
+   uint8_t * buf;
+
+   if (!publishing)
+   {
+      return;
+   }
+
+   start = cycle_stats_now();
+   buf = snapshot_write_buffer (&snapshot);
+   for (uint16_t i = 0; i < n_sources; i++)
+   {
+      const source_t * s = &sources[i];
+
+      memcpy (buf + s->offset, s->src, s->size);
+   }
+   snapshot_publish (&snapshot);
+   cycle_stats_add (&publish_stats, start);
+}
+
+/* Connection operations */
+static int viewer_send (int fd, const void * buf, uint16_t len)
+{
+   int n = lwip_send (fd, buf, len, MSG_DONTWAIT);
+
+   if (n < 0 && (errno == EWOULDBLOCK || errno == EAGAIN))
+   {
+      return 0;
+   }
+   return n;
+}
+
+static void viewer_close (int fd)
+{
+   lwip_close (fd);
+}
+
+static const stream_ops_t ops = {
+   .send = viewer_send,
+   .close = viewer_close,
+};
+
+static void viewer_accept (int listen_fd)
+{
+   int fd = lwip_accept (listen_fd, NULL, NULL);
+   int one = 1;
+
+   if (fd < 0)
+   {
+      return;
+   }
+
+   if (stream_open (&stream, fd) == NULL)
+   {
+      lwip_close (fd);
+      return;
+   }
+   lwip_setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+}
+
+static int server_open (uint16_t port)
+{
+   struct sockaddr_in addr = {0};
+   int fd;
+
+   fd = lwip_socket (AF_INET, SOCK_STREAM, 0);
+   if (fd < 0)
+   {
+      return -1;
+   }
+
+   addr.sin_family = AF_INET;
+   addr.sin_port = lwip_htons (port);
+   addr.sin_addr.s_addr = lwip_htonl (INADDR_ANY);
+   if (
+      lwip_bind (fd, (struct sockaddr *)&addr, sizeof (addr)) != 0 ||
+      lwip_listen (fd, STREAM_MAX_CLIENTS) != 0)
+   {
+      lwip_close (fd);
+      return -1;
+   }
+   return fd;
+}
+
+/* Pass the latest snapshot to all viewers */
+static void stream_net_tick (void)
+{
+   const uint8_t * image;
+   uint32_t seq;
+   uint32_t start = cycle_stats_now();
+   bool open = false;
+
+   image = snapshot_acquire (&snapshot, &seq);
+   stream_tick (&stream, image, seq);
+
+   for (int i = 0; i < STREAM_MAX_CLIENTS; i++)
+   {
+      open = open || clients[i].phase != STREAM_CLOSED;
+   }
+   publishing = open;
+   cycle_stats_add (&tick_stats, start);
+}
+
+static void stream_task (void * arg)
+{
+   int listen_fd = (int)(intptr_t)arg;
+   TickType_t next = xTaskGetTickCount();
+
+   for (;;)
+   {
+      int32_t left = (int32_t)(next - xTaskGetTickCount());
+      struct timeval timeout = {0};
+      fd_set fds;
+      fd_set wfds;
+      int max_fd = listen_fd;
+
+      if (left > 0)
+      {
+         timeout.tv_usec = left * portTICK_PERIOD_MS * 1000;
+      }
+
+      /* Viewers are only written at each tick. Data received after the
+       * request is dropped, reading detects closed connections. */
+      FD_ZERO (&fds);
+      FD_ZERO (&wfds);
+      FD_SET (listen_fd, &fds);
+      for (int i = 0; i < STREAM_MAX_CLIENTS; i++)
+      {
+         const stream_client_t * c = &clients[i];
+
+         if (c->phase != STREAM_CLOSED)
+         {
+            FD_SET (c->fd, &fds);
+            max_fd = (c->fd > max_fd) ? c->fd : max_fd;
+         }
+         if (
+            c->phase != STREAM_CLOSED && c->phase != STREAM_LIVE &&
+            c->out_len > 0)
+         {
+            FD_SET (c->fd, &wfds);
+         }
+      }
+
+      if (lwip_select (max_fd + 1, &fds, &wfds, NULL, &timeout) > 0)
+      {
+         for (int i = 0; i < STREAM_MAX_CLIENTS; i++)
+         {
+            stream_client_t * c = &clients[i];
+            uint8_t buf[64];
+            int n;
+
+            if (c->phase != STREAM_CLOSED && FD_ISSET (c->fd, &wfds))
+            {
+               stream_writable (&stream, c);
+            }
+            if (c->phase == STREAM_CLOSED || !FD_ISSET (c->fd, &fds))
+            {
+               continue;
+            }
+
+            n = lwip_recv (c->fd, buf, sizeof (buf), 0);
+            if (n <= 0)
+            {
+               stream_close (&stream, c);
+               continue;
+            }
+            stream_receive (&stream, c, buf, n);
+         }
+
+         if (FD_ISSET (listen_fd, &fds))
+         {
+            viewer_accept (listen_fd);
+         }
+      }
+
+      if ((int32_t)(next - xTaskGetTickCount()) <= 0)
+      {
+         TickType_t period = pdMS_TO_TICKS (1000) / rate;
+
+         stream_net_tick();
+
+         /* Skip ticks that are late rather than catching up */
+         next += period;
+         if ((int32_t)(next - xTaskGetTickCount()) <= 0)
+         {
+            next = xTaskGetTickCount() + period;
+         }
+      }
+   }
+}
+
+int stream_net_init (
+   const up_device_t * device,
+   const up_signal_info_t * vars,
+   uint16_t port)
+{
+   int listen_fd;
+
+   if (server_port != 0)
+   {
+      return -1;
+   }
+
+   /* The image is smaller than a full event */
+   sources = calloc (STREAM_NET_MAX_FIELDS, sizeof (*sources));
+   prev = calloc (1, STREAM_MAX_EVENT);
+   if (sources == NULL || prev == NULL)
+   {
+      goto free_buffers;
+   }
+
+   stream_init (
+      &stream,
+      fields,
+      STREAM_NET_MAX_FIELDS,
+      prev,
+      clients,
+      STREAM_MAX_CLIENTS,
+      &ops,
+      web_assets,
+      web_n_assets);
+   for (uint16_t i = 0; i < device->n_slots; i++)
+   {
+      const up_slot_t * slot = &device->slots[i];
+
+      add_fields (slot, slot->inputs, slot->n_inputs, vars, false);
+   }
+   for (uint16_t i = 0; i < device->n_slots; i++)
+   {
+      const up_slot_t * slot = &device->slots[i];
+
+      add_fields (slot, slot->outputs, slot->n_outputs, vars, true);
+   }
+
+   if (snapshot_init (&snapshot, stream.image_size) != 0)
+   {
+      goto free_buffers;
+   }
+
+   listen_fd = server_open (port);
+   if (listen_fd < 0)
+   {
+      printf ("Stream failed to listen on port %" PRIu16 "\n", port);
+      goto free_snapshot;
+   }
+
+   if (
+      xTaskCreate (
+         stream_task,
+         "stream",
+         STREAM_NET_TASK_STACK_SIZE,
+         (void *)(intptr_t)listen_fd,
+         STREAM_NET_TASK_PRIORITY,
+         NULL) != pdPASS)
+   {
+      printf ("Stream failed to create task\n");
+      goto close_listen;
+   }
+
+   server_port = port;
+   cycle_stats_register (&publish_stats);
+   cycle_stats_register (&tick_stats);
+
+   return 0;
+
+close_listen:
+   lwip_close (listen_fd);
+free_snapshot:
+   snapshot_free (&snapshot);
+free_buffers:
+   free (sources);
+   free (prev);
+   sources = NULL;
+   prev = NULL;
+   n_sources = 0;
+   n_skipped = 0;
+   return -1;
+}
+
+static void stream_show (void)
+{
+   printf ("Port            : %" PRIu16 "\n", server_port);
+   printf (
+      "Signals         : %" PRIu16 " streamed, %" PRIu16 " skipped\n",
+      stream.n_fields,
+      n_skipped);
+   printf ("Rate            : %" PRIu16 " events/s\n", rate);
+   printf (
+      "Viewers         : %" PRIu16 " of %d\n",
+      stream_viewers (&stream),
+      STREAM_MAX_CLIENTS);
+   printf (
+      "Connections     : %" PRIu32 " accepted, %" PRIu32 " refused, %" PRIu32
+      " stalled\n",
+      stream.stats.accepted,
+      stream.stats.refused,
+      stream.stats.stalled);
+   printf (
+      "Events          : %" PRIu32 " deltas, %" PRIu32 " fulls encoded\n",
+      stream.stats.deltas,
+      stream.stats.fulls);
+   printf (
+      "Assets          : %" PRIu32 " sent, %" PRIu32 " not modified\n",
+      stream.stats.assets,
+      stream.stats.not_modified);
+   printf ("Sent            : %" PRIu32 " bytes\n", stream.stats.bytes);
+   if (tick_stats.count > 0)
+   {
+      printf (
+         "Tick            : avg %" PRIu32 " max %" PRIu32 " cycles\n",
+         (uint32_t)(tick_stats.total / tick_stats.count),
+         tick_stats.max);
+   }
+
+   for (int i = 0; i < STREAM_MAX_CLIENTS; i++)
+   {
+      const stream_client_t * c = &clients[i];
+
+      if (c->phase == STREAM_LIVE)
+      {
+         printf (
+            "Viewer %d        : %" PRIu32 " deltas, %" PRIu32 " fulls, %" PRIu32
+            " ticks skipped\n",
+            i,
+            c->deltas,
+            c->fulls,
+            c->skipped);
+      }
+   }
+}
+
+static int _cmd_stream (int argc, char * argv[])
+{
+   if (argc == 3 && strcmp (argv[1], "rate") == 0)
+   {
+      int hz = atoi (argv[2]);
+
+      if (hz < 1 || hz > STREAM_NET_MAX_RATE)
+      {
+         printf ("Rate must be 1 to %d events/s\n", STREAM_NET_MAX_RATE);
+         return -1;
+      }
+      rate = hz;
+   }
+   else if (argc != 1)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   if (server_port == 0)
+   {
+      printf ("Stream not started\n");
+      return 0;
+   }
+
+   stream_show();
+   return 0;
+}
+
+const shell_cmd_t cmd_stream = {
+   .cmd = _cmd_stream,
+   .name = "stream",
+   .help_short = "show process data stream to web viewers",
+   .help_long =
+      "Show viewers and statistics of the process data stream, or set\n"
+      "the maximum number of events per second. Viewers connect to\n"
+      "http://<ip>:<port>/, served with its assets from web/, or read\n"
+      "Server-Sent Events from /stream.\n"
+      "Started when the device model enables the web GUI.\n"
+      "Usage: stream [rate <hz>]\n"};
+
+SHELL_CMD (cmd_stream);
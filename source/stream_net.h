@@ -0,0 +1,54 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef STREAM_NET_H_
+#define STREAM_NET_H_
+
+#include "up_types.h"
+
+#include <stdint.h>
+
+#define STREAM_NET_TASK_PRIORITY   (tskIDLE_PRIORITY + 1)
+#define STREAM_NET_TASK_STACK_SIZE 1024
+
+#define STREAM_NET_PORT       8080
+#define STREAM_NET_RATE       10 /* Default events per second */
+#define STREAM_NET_MAX_RATE   50
+#define STREAM_NET_MAX_FIELDS 128
+
+/**
+ * Start streaming process data to web viewers.
+ *
+ * Serves the changed signals as Server-Sent Events at "/stream" and a
+ * minimal viewer page at "/", on its own TCP port next to the web GUI
+ * of U-Phy. Up to STREAM_MAX_CLIENTS (lwipopts.h) viewers are served,
+ * at most STREAM_NET_RATE events per second, changed with the 'stream'
+ * shell command.
+ *
+ * @param device     Device model
+ * @param vars       Signal table
+ * @param port       TCP port
+ * @return 0 on success, -1 on error
+ */
+extern int stream_net_init (
+   const up_device_t * device,
+   const up_signal_info_t * vars,
+   uint16_t port);
+
+/**
+ * Publish the process image to viewers. Called from the cyclic
+ * callbacks after the inputs have been updated, does nothing unless a
+ * viewer is connected.
+ */
+extern void stream_net_publish (void);
+
+#endif /* STREAM_NET_H_ */
@@ -19,9 +19,31 @@
 #include "model.h"
 
 #include "uphy_demo_app.h"
+#include "app_config.h"
+#include "bitpack.h"
+#include "byteswap.h"
+#include "capture_net.h"
+#include "conditioning.h"
+#include "cycle_stats.h"
+#include "gateway.h"
+#include "iomode_cmd.h"
+#include "logic_cmd.h"
+#include "mem_sections.h"
+#include "modbus_conn.h"
+#include "model_blob.h"
+#include "param_store.h"
+#include "process_image.h"
+#include "recorder_cmd.h"
 #include "shell.h"
+#include "signal_index.h"
+#include "stream_net.h"
+#include "worker_cmd.h"
 #include "rte_fs.h"
 #include "network.h"
+#include "lwip/lwip_chksum_net.h"
+#include "lwip/netif.h"
+#include "lwip/netifapi.h"
+#include "lwip/tcpip.h"
 #include "math.h"
 #include "osal.h"
 #include <inttypes.h>
@@ -35,9 +57,6 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
-/* Enable to run synchronous operation mode */
-#define APPLICATION_MODE_SYNCHRONOUS
-
 /* U-Phy callbacks */
 static void cb_avail (up_t * up, void * user_arg);
 static void cb_sync (up_t * up, void * user_arg);
@@ -51,12 +70,13 @@ static void cb_loop_ind (up_t * up, void * user_arg);
 extern void up_core_init (void);
 extern void up_core_set_status (uint32_t status);
 
+
 static up_busconf_t up_busconf;
 
 static up_cfg_t cfg = {
    .device = &up_device,
    .busconf = &up_busconf,
-   .vars = up_vars,
+   .vars = (up_signal_info_t *)up_vars,
    .sync = cb_sync,
    .avail = cb_avail,
    .param_write_ind = cb_param_write_ind,
@@ -66,12 +86,83 @@ static up_cfg_t cfg = {
    .profinet_signal_led_ind = cb_profinet_signal_led_ind,
 };
 
-/* Use EVK user LEDs and BTNs are only mapped to process data for the DIGIO
- * device. */
-static bool is_digio_sample_device = true;
+/* Device model loaded at runtime, replaces the compiled in model */
+static model_blob_model_t blob_model;
+
+/* Whole image access, for models with a struct-of-arrays process image */
+static process_image_t process_image;
+
+/* Bit packing plans for boolean signals, inputs and outputs of each slot */
+static bitpack_plan_t * bit_plans;
+
+/* Byte swap plans, inputs and outputs of each slot, and the process
+ * image they refer to */
+static byteswap_plan_t * swap_plans;
+static uint8_t * image;
+static uint32_t image_size;
+
+/* Conditioning of analog inputs, run before the inputs are written */
+static conditioning_t conditioning;
+
+/* Process data mapped to the EVK user BTNs and LEDs, NULL if not mapped */
+static uint8_t * evk_input APP_DTCM_DATA;
+static uint8_t * evk_output APP_DTCM_DATA;
 
 static TaskHandle_t uphy_task_hdl = NULL;
 
+/* Protocol switchover, see 'up_start'. The U-Phy task, network
+ * interface, device model and parameter store are kept, only the U-Phy
+ * instance and the IP configuration are changed. Phases are stamped with
+ * the cycle counter in order.
+ *
+ * The shell sets switch_requested and wakes the U-Phy task. The task
+ * accepts the request when it leaves the event loop, after which it can
+ * no longer be cancelled, and clears both flags once the new instance is
+ * started. A request that is not accepted in time is cancelled. */
+#define SWITCH_TIMEOUT_MS 5000
+
+typedef enum switch_phase
+{
+   SWITCH_REQUEST,
+   SWITCH_STOPPED,
+   SWITCH_TEARDOWN,
+   SWITCH_NETWORK,
+   SWITCH_INIT,
+   SWITCH_STARTED,
+   SWITCH_FIRST_EXCHANGE,
+   SWITCH_N_PHASES,
+} switch_phase_t;
+
+/* Resources in use, to show that repeated switchovers do not leak */
+typedef struct switch_resources
+{
+   int heap_used; /* Bytes, -1 if not measured */
+   UBaseType_t tasks;
+} switch_resources_t;
+
+typedef struct switch_timeline
+{
+   up_bustype_t from;
+   up_bustype_t to;
+   uint32_t t[SWITCH_N_PHASES];
+   uint8_t n; /* Phases done */
+   switch_resources_t before; /* At request */
+   switch_resources_t after;  /* When the device is started */
+} switch_timeline_t;
+
+static switch_timeline_t switch_timeline;
+static switch_resources_t switch_first; /* Before the first switchover */
+static volatile bool switch_requested;
+static volatile bool switch_accepted;
+static volatile bool uphy_running;
+static bool switch_wait_exchange APP_DTCM_DATA;
+
+/* Execution time of the cyclic callbacks, see 'cycles' shell command */
+static cycle_stats_t cb_avail_stats APP_DTCM_DATA =
+   CYCLE_STATS_INIT ("cb_avail");
+static cycle_stats_t cb_sync_stats APP_DTCM_DATA =
+   CYCLE_STATS_INIT ("cb_sync");
+
 static const char * error_code_to_str (up_error_t error_code)
 {
    switch (error_code)
@@ -95,31 +186,118 @@ static const char * error_code_to_str (up_error_t error_code)
    }
 }
 
+static void switch_mark (switch_phase_t phase)
+{
+   switch_timeline.t[phase] = cycle_stats_now();
+   switch_timeline.n = phase + 1;
+}
+
+#if defined(PRINT_HEAP_USAGE)
+int get_heap_usage (void);
+#endif
+
+static void switch_resources (switch_resources_t * resources)
+{
+#if defined(PRINT_HEAP_USAGE)
+   resources->heap_used = get_heap_usage();
+#else
+   resources->heap_used = -1;
+#endif
+   resources->tasks = uxTaskGetNumberOfTasks();
+}
+
+/* Accept a pending switchover request. Called by the U-Phy task, the
+ * shell cancels the request only while it is not accepted */
+static bool switch_accept (void)
+{
+   bool accepted;
+
+   /* No request, the common case in the event loop */
+   if (!switch_requested)
+   {
+      return false;
+   }
+
+   taskENTER_CRITICAL();
+   switch_accepted = switch_requested;
+   accepted = switch_accepted;
+   taskEXIT_CRITICAL();
+
+   return accepted;
+}
+
+/* Receive outputs from U-Phy and apply them to the device */
+APP_ITCM_FUNC static void read_outputs (up_t * up)
+{
+   up_read_outputs (up);
+
+   /* Local logic may override outputs, e.g. for interlocks */
+   logic_cmd_run_avail();
+
+   /* Apply process data to actual device outputs  */
+   if (evk_output != NULL)
+   {
+      digio_set_output (*evk_output);
+   }
+}
+
+/* Sample device inputs and send them to U-Phy */
+APP_ITCM_FUNC static void write_inputs (up_t * up)
+{
+   uint32_t now = cycle_stats_now();
+
+   if (evk_input != NULL)
+   {
+      *evk_input = digio_get_input();
+   }
+   conditioning_run (&conditioning);
+   logic_cmd_run_sync();
+   up_write_inputs (up);
+   gateway_publish();
+   stream_net_publish();
+
+   recorder_cmd_sample();
+
+   if (switch_wait_exchange)
+   {
+      switch_wait_exchange = false;
+      switch_mark (SWITCH_FIRST_EXCHANGE);
+   }
+
+   iomode_cmd_exchanged (now);
+}
+
 /*
  * Callback indicating that output data (from PLc) is available.
- * Called every U-Phy cycle.
+ * Called every U-Phy cycle in synchronous mode.
  */
-static void cb_avail (up_t * up, void * user_arg)
+APP_ITCM_FUNC static void cb_avail (up_t * up, void * user_arg)
 {
-   up_read_outputs (up);
+   uint32_t start = cycle_stats_now();
 
-   /* Apply process data to actual device outputs  */
-   if (is_digio_sample_device)
+   if (iomode_cmd_avail_due())
    {
-      digio_set_output (up_data.O8.Output_8_bits.value);
+      read_outputs (up);
    }
+
+   cycle_stats_add (&cb_avail_stats, start);
 }
 /*
  * Callback indicating that input data (to PLC) shall be updated.
- * Called every U-Phy cycle.
+ * Called every U-Phy cycle in synchronous mode.
  */
-static void cb_sync (up_t * up, void * user_arg)
+APP_ITCM_FUNC static void cb_sync (up_t * up, void * user_arg)
 {
-   if (is_digio_sample_device)
+   uint32_t start = cycle_stats_now();
+
+   worker_cmd_wakeup (start);
+
+   if (iomode_cmd_sync_due())
    {
-      up_data.I8.Input_8_bits.value = digio_get_input();
+      write_inputs (up);
    }
-   up_write_inputs (up);
+
+   cycle_stats_add (&cb_sync_stats, start);
 }
 
 static void cb_param_write_ind (up_t * up, void * user_arg)
@@ -131,8 +309,9 @@ static void cb_param_write_ind (up_t * up, void * user_arg)
 
    while (up_param_get_write_req (up, &slot_ix, &param_ix, &data) == 0)
    {
-      p = &up_device.slots[slot_ix].params[param_ix];
-      memcpy (up_vars[p->ix].value, data.data, data.dataLength);
+      p = &cfg.device->slots[slot_ix].params[param_ix];
+      memcpy (cfg.vars[p->ix].value, data.data, data.dataLength);
+      param_store_changed (slot_ix, param_ix);
    }
 }
 
@@ -156,63 +335,369 @@ static void cb_profinet_signal_led_ind (up_t * up, void * user_arg)
 
 static void cb_loop_ind (up_t * up, void * user_arg)
 {
-#if !defined(APPLICATION_MODE_SYNCHRONOUS)
-   up_write_inputs (up);
-   up_read_outputs (up);
-#endif
+   if (iomode_cmd_is_async())
+   {
+      write_inputs (up);
+      read_outputs (up);
+   }
 }
 
+/* Run the U-Phy instance until it fails or a switchover is requested */
 void up_app_main (up_t * up)
 {
+   static bool params_restored = false;
+
    if (up_init_device (up) != 0)
    {
       printf ("Failed to configure device\n");
       exit (EXIT_FAILURE);
    }
 
-   if (up_util_init (&up_device, up, up_vars) != 0)
+   if (up_util_init (cfg.device, up, cfg.vars) != 0)
    {
       printf ("Failed to init up utils\n");
       exit (EXIT_FAILURE);
    }
 
+   /* Restore parameters saved in flash, kept in the signal table over
+    * a switchover */
+   if (!params_restored && param_store_init (cfg.device, cfg.vars) != 0)
+   {
+      printf ("Failed to init parameter store\n");
+   }
+   params_restored = true;
+
    if (up_start_device (up) != 0)
    {
       printf ("Failed to start device\n");
       exit (EXIT_FAILURE);
    }
 
-#if defined(APPLICATION_MODE_SYNCHRONOUS)
-   if (up_write_event_mask(up, UP_EVENT_MASK_SYNCHRONOUS_MODE) != 0)
+   if (
+      !iomode_cmd_is_async() &&
+      up_write_event_mask (up, UP_EVENT_MASK_SYNCHRONOUS_MODE) != 0)
    {
       printf ("Failed to write eventmask mode\n");
       exit (EXIT_FAILURE);
    }
-#endif
 
    /* Write input signals to set initial values and status */
    up_write_inputs (up);
 
+   if (switch_accepted)
+   {
+      switch_mark (SWITCH_STARTED);
+      switch_resources (&switch_timeline.after);
+      switch_wait_exchange = true;
+      taskENTER_CRITICAL();
+      switch_accepted = false;
+      switch_requested = false;
+      taskEXIT_CRITICAL();
+   }
+
+   worker_cmd_init();
+
    printf ("Run event loop\n");
 
-   while (up_worker (up) == true)
+   /* The loop is left when woken by a switchover request, whether
+    * up_worker() then reports an event or the aborted wait */
+   uphy_running = true;
+   while (!switch_accept() && up_worker (up) == true)
       ;
+   uphy_running = false;
+
+   if (switch_accept())
+   {
+      return;
+   }
 
    printf ("Unexpected error in U-Phy library.\n");
    printf ("Restart device\n");
 }
 
-up_t * up_app_init (up_bustype_t bustype)
+static bool is_bits (const up_signal_t * signal)
 {
-   up_t * up;
+   return signal->bitlength > 0 && signal->bitlength <= BITPACK_MAX_WIDTH;
+}
+
+/* Add the signals of less than 8 bits of a slot to a plan, in signal
+ * order */
+static int add_bits (
+   bitpack_plan_t * plan,
+   const up_signal_t * signals,
+   uint16_t n)
+{
+   uint16_t bit = 0;
+
+   for (uint16_t i = 0; i < n; i++)
+   {
+      if (!is_bits (&signals[i]))
+      {
+         continue;
+      }
+
+      if (
+         bitpack_plan_add_field (
+            plan,
+            cfg.vars[signals[i].ix].value,
+            bit,
+            signals[i].bitlength) != 0)
+      {
+         printf ("Failed to add signal %s to bit plan\n", signals[i].name);
+         return -1;
+      }
+      bit += signals[i].bitlength;
+   }
+
+   return 0;
+}
+
+/* Build bit packing plans for the signals of less than 8 bits of each
+ * slot, shown by up_bits */
+static void build_bit_plans (void)
+{
+   const up_device_t * device = cfg.device;
+   bitpack_run_t * runs;
+   bitpack_run_t * first;
+   uint32_t n = 0;
+
+   for (uint16_t i = 0; i < device->n_slots; i++)
+   {
+      const up_slot_t * slot = &device->slots[i];
+
+      for (uint16_t j = 0; j < slot->n_inputs; j++)
+      {
+         n += is_bits (&slot->inputs[j]);
+      }
+      for (uint16_t j = 0; j < slot->n_outputs; j++)
+      {
+         n += is_bits (&slot->outputs[j]);
+      }
+   }
+
+   if (n == 0)
+   {
+      return;
+   }
+
+   bit_plans = calloc (2 * device->n_slots, sizeof (*bit_plans));
+   runs = malloc (n * sizeof (*runs));
+   if (bit_plans == NULL || runs == NULL)
+   {
+      free (bit_plans);
+      free (runs);
+      bit_plans = NULL;
+      return;
+   }
+
+   first = runs;
+   for (uint16_t i = 0; i < device->n_slots; i++)
+   {
+      const up_slot_t * slot = &device->slots[i];
+      bitpack_plan_t * in = &bit_plans[2 * i];
+      bitpack_plan_t * out = &bit_plans[2 * i + 1];
+      int error;
+
+      bitpack_plan_init (in, runs, slot->n_inputs);
+      error = add_bits (in, slot->inputs, slot->n_inputs);
+      runs += in->n_runs;
+
+      bitpack_plan_init (out, runs, slot->n_outputs);
+      error |= add_bits (out, slot->outputs, slot->n_outputs);
+      runs += out->n_runs;
+
+      if (error != 0)
+      {
+         free (bit_plans);
+         free (first);
+         bit_plans = NULL;
+         return;
+      }
+   }
+}
 
-   /* User LEDs and buttons are only mapped to process io data for the default
-    * DIGIO sample
-    */
-   if (strcmp (cfg.device->name, "U-Phy DIGIO Sample") != 0)
+/* Use the byte swap plans of the blob, or build them for the compiled in
+ * model */
+static void build_swap_plans (void)
+{
+   const model_blob_header_t * blob = blob_model.blob;
+   uint16_t n_slots = cfg.device->n_slots;
+
+   swap_plans = calloc (2 * n_slots, sizeof (*swap_plans));
+   if (swap_plans == NULL)
+   {
+      return;
+   }
+
+   if (blob != NULL)
+   {
+      image = blob_model.data;
+      image_size = blob->data_size;
+   }
+   else
+   {
+      image = (uint8_t *)&up_data;
+      image_size = sizeof (up_data);
+   }
+
+   for (uint16_t i = 0; i < n_slots; i++)
+   {
+      const up_slot_t * slot = &cfg.device->slots[i];
+
+      if (blob != NULL && blob->swaps != 0)
+      {
+         const uint8_t * base = (const uint8_t *)blob;
+         const model_blob_swap_t * swaps = (const void *)(base + blob->swaps);
+
+         for (int j = 0; j < 2; j++)
+         {
+            swap_plans[2 * i + j].runs =
+               (const void *)(base + swaps[2 * i + j].runs);
+            swap_plans[2 * i + j].n_runs = swaps[2 * i + j].n_runs;
+         }
+      }
+      else if (
+         byteswap_plan_build (
+            &swap_plans[2 * i],
+            slot->inputs,
+            slot->n_inputs,
+            cfg.vars,
+            image) != 0 ||
+         byteswap_plan_build (
+            &swap_plans[2 * i + 1],
+            slot->outputs,
+            slot->n_outputs,
+            cfg.vars,
+            image) != 0)
+      {
+         printf ("Failed to build byte swap plans\n");
+         return;
+      }
+   }
+}
+
+/* Set up conditioning of analog inputs as configured in the blob */
+static void init_conditioning (const model_blob_header_t * blob)
+{
+   const uint8_t * base = (const uint8_t *)blob;
+   const model_blob_conditioning_t * c =
+      (const void *)(base + blob->conditioning);
+   const model_blob_channel_t * channels = (const void *)(base + c->channels);
+
+   if (
+      conditioning_init (
+         &conditioning,
+         c->n_iir,
+         c->n_avg,
+         c->n_none,
+         c->window) != 0)
+   {
+      printf ("Failed to set up input conditioning\n");
+      return;
+   }
+
+   for (uint16_t i = 0; i < conditioning.n; i++)
    {
-      is_digio_sample_device = false;
+      const model_blob_channel_t * ch = &channels[i];
+      conditioning_channel_t channel = {
+         .gain = ch->gain,
+         .offset = ch->offset,
+         .min = ch->min,
+         .max = ch->max,
+         .alpha = ch->alpha,
+      };
+
+      conditioning_set (&conditioning, i, &channel, cfg.vars[ch->ix].value);
    }
+}
+
+/* Select the device model and the process data mapped to the EVK */
+static void select_model (void)
+{
+   static bool selected = false;
+   const model_blob_header_t * blob;
+
+   if (selected)
+   {
+      return;
+   }
+   selected = true;
+
+   if (model_blob_load (&blob_model) == 0)
+   {
+      printf ("Using device model from %s\n", blob_model.source);
+
+      blob = blob_model.blob;
+      cfg.device = &blob_model.device;
+      cfg.vars = blob_model.vars;
+
+      if (process_image_init (&process_image, &blob_model) == 0)
+      {
+         printf ("Process image layout is struct-of-arrays\n");
+      }
+
+      if (blob->conditioning != 0)
+      {
+         init_conditioning (blob);
+      }
+
+      if (blob->evk_input_ix != MODEL_BLOB_NO_IX)
+      {
+         evk_input = cfg.vars[blob->evk_input_ix].value;
+      }
+      if (blob->evk_output_ix != MODEL_BLOB_NO_IX)
+      {
+         evk_output = cfg.vars[blob->evk_output_ix].value;
+      }
+   }
+   else if (strcmp (cfg.device->name, "U-Phy DIGIO Sample") == 0)
+   {
+      /* The compiled in DIGIO sample maps I8 and O8 */
+      evk_input = cfg.vars[0].value;
+      evk_output = cfg.vars[1].value;
+   }
+
+   if (signal_index_init (cfg.device, cfg.vars, blob_model.blob) != 0)
+   {
+      printf ("Failed to build signal name index\n");
+   }
+
+   build_bit_plans();
+   build_swap_plans();
+   logic_cmd_load (cfg.device, cfg.vars);
+}
+
+/* Whether the device model has a configuration for the bustype */
+static bool model_supports (up_bustype_t bustype)
+{
+   bool is_blob = (blob_model.blob != NULL);
+
+   switch (bustype)
+   {
+   case UP_BUSTYPE_MOCK:
+      return true;
+   case UP_BUSTYPE_PROFINET:
+      return !is_blob || blob_model.has_profinet;
+   case UP_BUSTYPE_ETHERNETIP:
+      return !is_blob || blob_model.has_ethernetip;
+   case UP_BUSTYPE_MODBUS:
+      return !is_blob || blob_model.has_modbus;
+   case UP_BUSTYPE_CCLINK:
+      return !is_blob;
+   default:
+      return false;
+   }
+}
+
+up_t * up_app_init (up_bustype_t bustype)
+{
+   static bool core_initialised = false;
+   up_t * up;
+   bool is_blob;
+
+   select_model();
+   iomode_cmd_select (bustype);
+   is_blob = (blob_model.blob != NULL);
 
    cfg.device->bustype = bustype;
 
@@ -222,15 +707,48 @@ up_t * up_app_init (up_bustype_t bustype)
       up_busconf.mock = up_mock_config;
       break;
    case UP_BUSTYPE_PROFINET:
-      up_busconf.profinet = up_profinet_config;
+      if (!model_supports (bustype))
+      {
+         printf ("Profinet not supported by device model\n");
+         break;
+      }
+      up_busconf.profinet = is_blob ? blob_model.profinet : up_profinet_config;
+      if (app_config.station_name[0] != '\0')
+      {
+         if (app_config_station_name_valid (app_config.station_name))
+         {
+            up_busconf.profinet.default_stationname = app_config.station_name;
+         }
+         else
+         {
+            printf ("Invalid station name in configuration, not used\n");
+         }
+      }
       break;
    case UP_BUSTYPE_ETHERNETIP:
-      up_busconf.ethernetip = up_ethernetip_config;
+      if (!model_supports (bustype))
+      {
+         printf ("EtherNet/IP not supported by device model\n");
+         break;
+      }
+      up_busconf.ethernetip =
+         is_blob ? blob_model.ethernetip : up_ethernetip_config;
       break;
    case UP_BUSTYPE_MODBUS:
-	  up_busconf.modbus = up_modbus_config;
-	  break;
+      if (!model_supports (bustype))
+      {
+         printf ("Modbus TCP not supported by device model\n");
+         break;
+      }
+      up_busconf.modbus = is_blob ? blob_model.modbus : up_modbus_config;
+      modbus_conn_init (up_busconf.modbus.port);
+      break;
    case UP_BUSTYPE_CCLINK:
+      if (!model_supports (bustype))
+      {
+         printf ("CC-Link not supported by device model blob\n");
+         break;
+      }
       up_busconf.cclink = up_cclink_config;
       break;
    case UP_BUSTYPE_ECAT:
@@ -239,7 +757,13 @@ up_t * up_app_init (up_bustype_t bustype)
       break;
    }
 
-   up_core_init();
+   /* The U-Phy core is initialised once. At a switchover the stopped
+    * instance is disconnected from it, see stop_uphy() */
+   if (!core_initialised)
+   {
+      up_core_init();
+      core_initialised = true;
+   }
    up_core_set_status (UP_CORE_CONNECTED);
 
    up = up_init (&cfg);
@@ -247,23 +771,110 @@ up_t * up_app_init (up_bustype_t bustype)
    return up;
 }
 
-void uphy_task (void * type)
+/* Serve the process image read-only over Modbus TCP next to the
+ * running protocol, if configured */
+static void start_gateway (up_bustype_t bustype)
 {
-   up_t * up;
-   up_bustype_t bustype = (up_bustype_t)type;
-   cy_rslt_t result;
-   ip_config_t ip_config;
+   uint16_t port = app_config.gateway_port;
 
-   if (bustype == UP_BUSTYPE_PROFINET || bustype == UP_BUSTYPE_CCLINK)
+   if (port == 0)
+   {
+      return;
+   }
+   if (bustype == UP_BUSTYPE_MODBUS && port == up_busconf.modbus.port)
+   {
+      printf ("Gateway port %" PRIu16 " used by Modbus TCP\n", port);
+      return;
+   }
+   if (gateway_init (cfg.device, cfg.vars, port) == 0)
+   {
+      printf ("Gateway listening on port %" PRIu16 "\n", port);
+   }
+}
+
+static ip_config_t bustype_ip_config (up_bustype_t bustype)
+{
+   if (app_config.ip_mode == APP_CONFIG_IP_STATIC)
+   {
+      return IP_CONFIG_STATIC;
+   }
+   else if (app_config.ip_mode == APP_CONFIG_IP_DHCP)
+   {
+      return IP_CONFIG_DYNAMIC;
+   }
+   else if (bustype == UP_BUSTYPE_PROFINET || bustype == UP_BUSTYPE_CCLINK)
    {
       /* Protocol stack will handle IP addresses */
-      ip_config = IP_CONFIG_STATIC;
+      return IP_CONFIG_STATIC;
    }
    else
    {
       /* Use DHCP */
-      ip_config = IP_CONFIG_DYNAMIC;
+      return IP_CONFIG_DYNAMIC;
+   }
+}
+
+/* Set the static address of the configuration, or the default of
+ * network.h if none is configured */
+static void set_static_addr (void)
+{
+   ip4_addr_t ip = {.addr = APP_STATIC_IP_ADDR};
+   ip4_addr_t netmask = {.addr = APP_NETMASK};
+   ip4_addr_t gw = {.addr = APP_STATIC_GATEWAY};
+
+   if (app_config.static_ip != 0)
+   {
+      ip.addr = app_config.static_ip;
+      netmask.addr = app_config.static_netmask;
+      gw.addr = app_config.static_gateway;
+   }
+
+   netifapi_netif_set_addr (netif_default, &ip, &netmask, &gw);
+}
+
+/* Change the IP configuration of the connected interface, instead of
+ * connecting to the network from scratch */
+static void switch_ip_config (ip_config_t from, ip_config_t to)
+{
+   struct netif * netif = netif_default;
+
+   if (from == to)
+   {
+      return;
+   }
+
+   if (to == IP_CONFIG_STATIC)
+   {
+      netifapi_dhcp_release_and_stop (netif);
+      set_static_addr();
    }
+   else
+   {
+      /* Address is assigned in the background */
+      netifapi_dhcp_start (netif);
+   }
+}
+
+/* Leave the outputs in a safe state while no protocol owns them and
+ * disconnect the stopped instance from the U-Phy core */
+static void stop_uphy (void)
+{
+   if (evk_output != NULL)
+   {
+      *evk_output = 0;
+      digio_set_output (0);
+   }
+   up_core_set_status (0);
+   led_set_running_mode (false);
+   modbus_conn_stop();
+}
+
+void uphy_task (void * type)
+{
+   up_t * up;
+   up_bustype_t bustype = (up_bustype_t)type;
+   cy_rslt_t result;
+   ip_config_t ip_config = bustype_ip_config (bustype);
 
    printf ("Init network\n");
    printf ("Application will hang until ethernet cable is inserted\n");
@@ -279,20 +890,102 @@ void uphy_task (void * type)
    }
 
    printf ("Ethernet connected.\n");
+
+   /* connect_to_ethernet() sets the default static address */
+   if (ip_config == IP_CONFIG_STATIC && app_config.static_ip != 0)
+   {
+      set_static_addr();
+   }
+
+   LOCK_TCPIP_CORE();
+   lwip_checksum_offload_init (netif_default, ETH1);
+   UNLOCK_TCPIP_CORE();
+
+   if (capture_net_init() != 0)
+   {
+      printf ("Failed to init frame capture\n");
+   }
+
    printf ("Starting U-Phy Demo\n");
    printf ("Active device model: \"%s\"\n", cfg.device->name);
 
    printf ("Init U-Phy Device \n");
    up = up_app_init (bustype);
 
-   printf ("Run U-Phy Device \n");
-   up_app_main (up);
+   cycle_stats_register (&cb_avail_stats);
+   cycle_stats_register (&cb_sync_stats);
+
+   recorder_cmd_init (cfg.vars);
+
+   start_gateway (bustype);
+
+   /* Next to the web GUI of U-Phy, the device model is the same for all
+    * protocols */
+   if (cfg.device->cfg.webgui_enable)
+   {
+      if (stream_net_init (cfg.device, cfg.vars, STREAM_NET_PORT) == 0)
+      {
+         printf ("Stream listening on port %d\n", STREAM_NET_PORT);
+      }
+   }
+
+   for (;;)
+   {
+      ip_config_t next_ip_config;
+
+      printf ("Run U-Phy Device \n");
+      up_app_main (up);
+
+      if (!switch_accepted)
+      {
+         break;
+      }
+      switch_mark (SWITCH_STOPPED);
+
+      stop_uphy();
+      switch_mark (SWITCH_TEARDOWN);
+
+      bustype = switch_timeline.to;
+      next_ip_config = bustype_ip_config (bustype);
+      switch_ip_config (ip_config, next_ip_config);
+      ip_config = next_ip_config;
+      switch_mark (SWITCH_NETWORK);
+
+      printf ("Switch U-Phy Device to %s\n", bus_config_to_str (bustype));
+      up = up_app_init (bustype);
+      switch_mark (SWITCH_INIT);
+
+      /* Gateway is kept running, start it if the previous protocol had
+       * its port */
+      start_gateway (bustype);
+   }
 
    printf ("Error - unexpected return from up_app_main()\n");
    CY_ASSERT (0);
 }
 
-static int str_to_bus_config (const char * str, up_bustype_t * bustype)
+const char * bus_config_to_str (up_bustype_t bustype)
+{
+   switch (bustype)
+   {
+   case UP_BUSTYPE_PROFINET:
+      return "profinet";
+   case UP_BUSTYPE_ECAT:
+      return "ethercat";
+   case UP_BUSTYPE_ETHERNETIP:
+      return "ethernetip";
+   case UP_BUSTYPE_MODBUS:
+      return "modbus";
+   case UP_BUSTYPE_CCLINK:
+      return "cclink";
+   case UP_BUSTYPE_MOCK:
+      return "mock";
+   default:
+      return "unknown";
+   }
+}
+
+int str_to_bus_config (const char * str, up_bustype_t * bustype)
 {
    if (str == NULL || bustype == NULL)
    {
@@ -350,7 +1043,10 @@ static int str_to_bus_config (const char * str, up_bustype_t * bustype)
 }
 
 /**
- * Read auto start configuration file.
+ * Load configuration and read auto start setting.
+ *
+ * An autostart file written by earlier versions of the application is
+ * migrated to the configuration blob.
  *
  * @param bustype pointer to bustype to be filled in
  *
@@ -359,28 +1055,31 @@ static int str_to_bus_config (const char * str, up_bustype_t * bustype)
 int auto_start (up_bustype_t * bustype)
 {
    char buf[32];
-   RTE_FILE * f = rte_fs_fopen (STORAGE_ROOT "autostart", "r");
-   if (f > 0)
-   {
-      rte_fs_fread (buf, 1, sizeof (buf), f);
-      rte_fs_fclose (f);
 
-      if (str_to_bus_config (buf, bustype) == 0)
-      {
-         printf ("Autostart enabled - %s\n", buf);
-         return 0;
-      }
+   if (
+      app_config_load() != 0 &&
+      app_config_read_legacy_autostart (buf, sizeof (buf)) == 0 &&
+      str_to_bus_config (buf, bustype) == 0)
+   {
+      app_config.autostart = true;
+      app_config.bustype = *bustype;
+      app_config_save();
    }
-   else
+
+   if (app_config.autostart)
    {
-      printf (
-         "Autostart disabled, start U-Phy using console command 'up_start'\n");
+      *bustype = (up_bustype_t)app_config.bustype;
+      printf ("Autostart enabled - %s\n", bus_config_to_str (*bustype));
+      return 0;
    }
+
+   printf (
+      "Autostart disabled, start U-Phy using console command 'up_start'\n");
    return -1;
 }
 static void start_uphy (up_bustype_t bustype)
 {
-   /* Only allow starting uphy once */
+   /* Only allow starting uphy once, then switch protocol instead */
    if (uphy_task_hdl == NULL)
    {
       xTaskCreate (
@@ -447,34 +1146,34 @@ SHELL_CMD (cmd_about);
 
 int _cmd_show_device (int argc, char * argv[])
 {
-   printf ("\"%s\"\r\n", up_device.name);
+   printf ("\"%s\"\r\n", cfg.device->name);
 
-   for (int i = 0; i < up_device.n_slots; i++)
+   for (int i = 0; i < cfg.device->n_slots; i++)
    {
-      up_slot_t slot = up_device.slots[i];
-      printf ("Slot[%d]: %s\r\n", i + 1, slot.name);
+      const up_slot_t * slot = &cfg.device->slots[i];
+      printf ("Slot[%d]: %s\r\n", i + 1, slot->name);
 
-      if (slot.n_inputs > 0)
+      if (slot->n_inputs > 0)
       {
-         for (int j = 0; j < slot.n_inputs; j++)
+         for (int j = 0; j < slot->n_inputs; j++)
          {
-            printf ("   [in] %s\r\n", slot.inputs[j].name);
+            printf ("   [in] %s\r\n", slot->inputs[j].name);
          }
       }
 
-      if (slot.n_outputs > 0)
+      if (slot->n_outputs > 0)
       {
-         for (int j = 0; j < slot.n_outputs; j++)
+         for (int j = 0; j < slot->n_outputs; j++)
          {
-            printf ("  [out] %s\r\n", slot.outputs[j].name);
+            printf ("  [out] %s\r\n", slot->outputs[j].name);
          }
       }
 
-      if (slot.n_params > 0)
+      if (slot->n_params > 0)
       {
-         for (int j = 0; j < slot.n_params; j++)
+         for (int j = 0; j < slot->n_params; j++)
          {
-            printf ("  [par] %s\r\n", slot.params[j].name);
+            printf ("  [par] %s\r\n", slot->params[j].name);
          }
       }
    }
@@ -489,11 +1188,392 @@ const shell_cmd_t cmd_show_device = {
 
 SHELL_CMD (cmd_show_device);
 
+static void show_bits (const char * name, const bitpack_plan_t * plan)
+{
+   uint8_t * frame = calloc (BITPACK_BYTES (plan->n_bits), 1);
+
+   if (frame == NULL)
+   {
+      return;
+   }
+   bitpack_pack (plan, frame);
+
+   printf ("  %5s %3u bits:", name, plan->n_bits);
+   for (uint16_t i = 0; i < BITPACK_BYTES (plan->n_bits); i++)
+   {
+      printf (" %02x", frame[i]);
+   }
+   printf ("\n");
+   free (frame);
+}
+
+int _cmd_bits (int argc, char * argv[])
+{
+   if (bit_plans == NULL)
+   {
+      printf ("No signals of less than 8 bits\n");
+      return 0;
+   }
+
+   for (int i = 0; i < cfg.device->n_slots; i++)
+   {
+      const bitpack_plan_t * in = &bit_plans[2 * i];
+      const bitpack_plan_t * out = &bit_plans[2 * i + 1];
+
+      if (in->n_bits == 0 && out->n_bits == 0)
+      {
+         continue;
+      }
+
+      printf ("Slot[%d]: %s\n", i + 1, cfg.device->slots[i].name);
+      if (in->n_bits > 0)
+      {
+         show_bits ("[in]", in);
+      }
+      if (out->n_bits > 0)
+      {
+         show_bits ("[out]", out);
+      }
+   }
+   return 0;
+}
+
+const shell_cmd_t cmd_bits = {
+   .cmd = _cmd_bits,
+   .name = "up_bits",
+   .help_short = "show bit signals packed per slot",
+   .help_long = "Show the signals of less than 8 bits of each slot packed\n"
+                "into bits, first signal from bit 0.\n"
+                "Usage: up_bits\n"};
+
+SHELL_CMD (cmd_bits);
+
+static void show_swapped (
+   const char * kind,
+   const up_signal_t * signals,
+   uint16_t n,
+   const uint8_t * converted)
+{
+   for (uint16_t i = 0; i < n; i++)
+   {
+      const uint8_t * value = cfg.vars[signals[i].ix].value;
+      uint32_t offset = value - image;
+
+      printf ("  %5s %s:", kind, signals[i].name);
+      for (uint16_t j = 0; j < (signals[i].bitlength + 7) / 8 && j < 16; j++)
+      {
+         printf (" %02x", converted[offset + j]);
+      }
+      printf ("\n");
+   }
+}
+
+int _cmd_frame (int argc, char * argv[])
+{
+   byteswap_order_t order = BYTESWAP_BIG_ENDIAN;
+   const up_slot_t * slot;
+   uint8_t * converted;
+   int slot_ix;
+
+   if (argc < 2 || argc > 3)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   slot_ix = atoi (argv[1]) - 1;
+   if (slot_ix < 0 || slot_ix >= cfg.device->n_slots || swap_plans == NULL)
+   {
+      printf ("No slot %s\n", argv[1]);
+      return -1;
+   }
+   slot = &cfg.device->slots[slot_ix];
+
+   if (argc == 3 && strcmp (argv[2], "words") == 0)
+   {
+      order = BYTESWAP_WORDS;
+   }
+   else if (argc == 3 && strcmp (argv[2], "be") != 0)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   converted = malloc (image_size);
+   if (converted == NULL)
+   {
+      return -1;
+   }
+
+   memcpy (converted, image, image_size);
+   byteswap_convert (&swap_plans[2 * slot_ix], converted, converted, order);
+   byteswap_convert (
+      &swap_plans[2 * slot_ix + 1],
+      converted,
+      converted,
+      order);
+
+   printf ("Slot[%d]: %s\n", slot_ix + 1, slot->name);
+   show_swapped ("[in]", slot->inputs, slot->n_inputs, converted);
+   show_swapped ("[out]", slot->outputs, slot->n_outputs, converted);
+
+   free (converted);
+   return 0;
+}
+
+const shell_cmd_t cmd_frame = {
+   .cmd = _cmd_frame,
+   .name = "up_frame",
+   .help_short = "show slot process data in frame byte order",
+   .help_long =
+      "Show the input and output values of a slot converted to big\n"
+      "endian (be), or to 16-bit big endian words with the least\n"
+      "significant word first (words). Default is be. Slots are numbered\n"
+      "from 1 as in up_device.\n"
+      "Usage: up_frame <slot> [be|words]\n"};
+
+SHELL_CMD (cmd_frame);
+
+/* Name of the input signal with value at the given address */
+static const char * input_name (const void * value)
+{
+   for (uint16_t i = 0; i < cfg.device->n_slots; i++)
+   {
+      const up_slot_t * slot = &cfg.device->slots[i];
+
+      for (uint16_t j = 0; j < slot->n_inputs; j++)
+      {
+         if (cfg.vars[slot->inputs[j].ix].value == value)
+         {
+            return slot->inputs[j].name;
+         }
+      }
+   }
+   return "-";
+}
+
+int _cmd_cond (int argc, char * argv[])
+{
+   static const char * filter[] = {"iir", "avg", "none"};
+
+   if (argc == 3)
+   {
+      uint32_t i = strtoul (argv[1], NULL, 0);
+
+      if (i >= conditioning.n)
+      {
+         printf ("No channel %s\n", argv[1]);
+         return -1;
+      }
+      conditioning.raw[i] = strtof (argv[2], NULL);
+   }
+   else if (argc != 1)
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+
+   if (conditioning.n == 0)
+   {
+      printf ("No conditioned inputs\n");
+      return 0;
+   }
+
+   printf ("Moving average window: %u\n", conditioning.window);
+   printf ("Ch  Filter  Raw           Value         Signal\n");
+   for (uint16_t i = 0; i < conditioning.n; i++)
+   {
+      int f = CONDITIONING_FILTER_NONE;
+
+      if (i < conditioning.n_iir)
+      {
+         f = CONDITIONING_FILTER_IIR;
+      }
+      else if (i < conditioning.n_iir + conditioning.n_avg)
+      {
+         f = CONDITIONING_FILTER_AVG;
+      }
+
+      printf (
+         "%-3u %-7s %-13g %-13g %s\n",
+         i,
+         filter[f],
+         (double)conditioning.raw[i],
+         (double)conditioning.value[i],
+         input_name (conditioning.output[i]));
+   }
+   return 0;
+}
+
+const shell_cmd_t cmd_cond = {
+   .cmd = _cmd_cond,
+   .name = "cond",
+   .help_short = "show or feed conditioned analog inputs",
+   .help_long =
+      "Show raw and conditioned value of each analog input channel.\n"
+      "With arguments, set the raw sample of a channel, e.g. to test\n"
+      "scaling and filters without analog hardware.\n"
+      "Usage: cond [<channel> <raw>]\n"};
+
+SHELL_CMD (cmd_cond);
+
+static const char * switch_phase_names[] = {
+   [SWITCH_REQUEST] = "request",
+   [SWITCH_STOPPED] = "event loop stopped",
+   [SWITCH_TEARDOWN] = "outputs safe",
+   [SWITCH_NETWORK] = "network configured",
+   [SWITCH_INIT] = "u-phy initialised",
+   [SWITCH_STARTED] = "device started",
+   [SWITCH_FIRST_EXCHANGE] = "first exchange",
+};
+
+static void show_switch_timeline (void)
+{
+   switch_timeline_t timeline = switch_timeline;
+
+   if (timeline.n == 0)
+   {
+      printf ("No switchover since boot\n");
+      return;
+   }
+
+   printf (
+      "Switchover %s -> %s\n",
+      bus_config_to_str (timeline.from),
+      bus_config_to_str (timeline.to));
+   for (int i = 0; i < SWITCH_N_PHASES; i++)
+   {
+      if (i < timeline.n)
+      {
+         printf (
+            "  %-20s %8" PRIu32 " us  +%" PRIu32 " us\n",
+            switch_phase_names[i],
+            cycle_stats_to_us (timeline.t[i] - timeline.t[0]),
+            cycle_stats_to_us (timeline.t[i] - timeline.t[i > 0 ? i - 1 : 0]));
+      }
+      else
+      {
+         printf ("  %-20s        -\n", switch_phase_names[i]);
+      }
+   }
+   if (timeline.n == SWITCH_FIRST_EXCHANGE)
+   {
+      printf ("First exchange waits for the PLC to connect\n");
+   }
+
+   /* Compare after repeated switchovers, nothing should accumulate */
+   if (timeline.n > SWITCH_STARTED)
+   {
+      if (timeline.after.heap_used >= 0)
+      {
+         printf (
+            "Heap in use : %d -> %d bytes, %+d since first switchover\n",
+            timeline.before.heap_used,
+            timeline.after.heap_used,
+            timeline.after.heap_used - switch_first.heap_used);
+      }
+      printf (
+         "Tasks       : %u -> %u, %+d since first switchover\n",
+         (unsigned)timeline.before.tasks,
+         (unsigned)timeline.after.tasks,
+         (int)timeline.after.tasks - (int)switch_first.tasks);
+   }
+}
+
+/* Switch the running U-Phy instance to another protocol and wait until
+ * the device is started */
+static int switch_uphy (up_bustype_t bustype)
+{
+   bool cancelled;
+   bool in_progress;
+   uint16_t modbus_port = (blob_model.blob != NULL)
+                             ? blob_model.modbus.port
+                             : up_modbus_config.port;
+
+   if (cfg.device->bustype == bustype)
+   {
+      printf ("%s already running\n", bus_config_to_str (bustype));
+      return 0;
+   }
+   if (!uphy_running || switch_requested)
+   {
+      printf ("U-Phy is starting, try again\n");
+      return -1;
+   }
+   if (!model_supports (bustype))
+   {
+      printf (
+         "%s not supported by device model\n",
+         bus_config_to_str (bustype));
+      return -1;
+   }
+   if (
+      bustype == UP_BUSTYPE_MODBUS && app_config.gateway_port != 0 &&
+      app_config.gateway_port == modbus_port)
+   {
+      printf ("Modbus TCP port %" PRIu16 " used by gateway\n", modbus_port);
+      return -1;
+   }
+
+   memset (&switch_timeline, 0, sizeof (switch_timeline));
+   switch_timeline.from = cfg.device->bustype;
+   switch_timeline.to = bustype;
+   switch_resources (&switch_timeline.before);
+   if (switch_first.tasks == 0)
+   {
+      switch_first = switch_timeline.before;
+   }
+   switch_mark (SWITCH_REQUEST);
+   switch_requested = true;
+
+   /* up_worker() blocks until the next event from the U-Phy core, which
+    * may not come for long without a connected PLC. Abort the wait of the
+    * U-Phy task until it has accepted the request, in case it was not
+    * yet blocked. */
+   for (int i = 0; i < SWITCH_TIMEOUT_MS / 10 && switch_requested; i++)
+   {
+      if (!switch_accepted)
+      {
+         xTaskAbortDelay (uphy_task_hdl);
+      }
+      vTaskDelay (pdMS_TO_TICKS (10));
+   }
+
+   taskENTER_CRITICAL();
+   cancelled = switch_requested && !switch_accepted;
+   if (cancelled)
+   {
+      switch_requested = false;
+   }
+   in_progress = switch_requested;
+   taskEXIT_CRITICAL();
+
+   if (cancelled)
+   {
+      printf ("Switchover timed out, cancelled\n");
+      return -1;
+   }
+
+   show_switch_timeline();
+   if (in_progress)
+   {
+      printf ("Switchover timed out, still in progress\n");
+      return -1;
+   }
+   return 0;
+}
+
 int _cmd_start (int argc, char * argv[])
 {
    char * fieldbus;
    up_bustype_t bustype;
 
+   if (argc == 1)
+   {
+      show_switch_timeline();
+      return 0;
+   }
+
    /* Check command line arguments */
    if (argc != 2)
    {
@@ -505,6 +1585,10 @@ int _cmd_start (int argc, char * argv[])
 
    if (str_to_bus_config (fieldbus, &bustype) == 0)
    {
+      if (uphy_task_hdl != NULL)
+      {
+         return switch_uphy (bustype);
+      }
       start_uphy (bustype);
    }
 
@@ -516,8 +1600,11 @@ const shell_cmd_t cmd_start = {
    .name = "up_start",
    .help_short = "start u-phy protocol",
    .help_long = "Start u-phy host device.\n"
-                "Usage: up_start <protocol>\n"
-                "where protocol can be profinet, ethernetip, modbus, cclink or mock\n"};
+                "Usage: up_start [<protocol>]\n"
+                "where protocol can be profinet, ethernetip, modbus, cclink or mock\n"
+                "When U-Phy is running, switches to the given protocol without\n"
+                "restart and shows the timeline of the switchover. Without\n"
+                "arguments, shows the timeline of the last switchover.\n"};
 
 SHELL_CMD (cmd_start);
 
@@ -535,9 +1622,9 @@ int _cmd_autostart (int argc, char * argv[])
    fieldbus = argv[1];
    if ((argc == 2) && (str_to_bus_config (fieldbus, &bustype) == 0))
    {
-      RTE_FILE * f = rte_fs_fopen (STORAGE_ROOT "autostart", "w");
-      rte_fs_fwrite (fieldbus, 1, strlen (fieldbus) + 1, f);
-      rte_fs_fclose (f);
+      app_config.autostart = true;
+      app_config.bustype = bustype;
+      app_config_save();
 
       printf ("%s autostart added\n", fieldbus);
    }
@@ -545,7 +1632,8 @@ int _cmd_autostart (int argc, char * argv[])
    {
       printf ("autostart disabled\n");
 
-      rte_fs_remove (STORAGE_ROOT "autostart");
+      app_config.autostart = false;
+      app_config_save();
       return -1;
    }
 
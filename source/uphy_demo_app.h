@@ -14,6 +14,11 @@
 #ifndef UPHY_DEMO_APP_H_
 #define UPHY_DEMO_APP_H_
 
+#include "up_types.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
 extern void led_profinet_signal (void);
 
 extern void led_set_running_mode (bool on);
@@ -24,4 +29,10 @@ extern uint8_t digio_get_input (void);
 
 extern void start_demo (void);
 
+/* Protocol name as used by the shell commands, e.g. "profinet" */
+extern const char * bus_config_to_str (up_bustype_t bustype);
+
+/* Returns 0 if str names a protocol supported by this build */
+extern int str_to_bus_config (const char * str, up_bustype_t * bustype);
+
 #endif /* UPHY_DEMO_APP_H_ */
@@ -0,0 +1,42 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef WEB_ASSETS_H_
+#define WEB_ASSETS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Static web asset, gzip compressed at build time.
+ *
+ * The files in web/ are compressed and embedded as const arrays in
+ * generated/web_assets.c by uphy-web-assets.py, so they stay in flash
+ * and are sent from there. The ETag is a hash of the compressed data.
+ * Pages refer to the other assets as "<file>?v=<etag>", so those can be
+ * cached by the browser for good and a new build is fetched anyway.
+ */
+typedef struct web_asset
+{
+   const char * path; /* "/" for index.html */
+   const char * type; /* Content-Type */
+   const char * etag; /* Quoted */
+   const uint8_t * data;
+   uint16_t size;
+   bool immutable; /* Cached for a year, else revalidated with the ETag */
+} web_asset_t;
+
+/* Generated by uphy-web-assets.py */
+extern const web_asset_t web_assets[];
+extern const uint16_t web_n_assets;
+
+#endif /* WEB_ASSETS_H_ */
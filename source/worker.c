@@ -0,0 +1,199 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Wait policy of the cyclic worker.
+ *
+ * Only the policy and the statistics are kept here, sleeping and polling
+ * are done by the caller. On the target that is the FreeRTOS idle hook,
+ * on the host bench/worker_bench.c.
+ */
+
+#include "worker.h"
+
+#include <string.h>
+
+static const char * mode_names[] = {
+   [WORKER_BLOCKING] = "blocking",
+   [WORKER_POLL] = "poll",
+   [WORKER_ADAPTIVE] = "adaptive",
+};
+
+void worker_reset (worker_t * w, uint32_t now)
+{
+   memset (&w->stats, 0, sizeof (w->stats));
+   w->stats.latency_min = UINT32_MAX;
+   w->now = now;
+}
+
+/* Track elapsed time in 64 bits, the counter wraps within seconds */
+static void update_elapsed (worker_t * w, uint32_t now)
+{
+   w->stats.elapsed += now - w->now;
+   w->now = now;
+}
+
+void worker_init (
+   worker_t * w,
+   worker_mode_t mode,
+   uint32_t window,
+   uint32_t now)
+{
+   memset (w, 0, sizeof (*w));
+   worker_set_mode (w, mode, window, now);
+}
+
+void worker_set_mode (
+   worker_t * w,
+   worker_mode_t mode,
+   uint32_t window,
+   uint32_t now)
+{
+   w->mode = mode;
+   w->window = window;
+   worker_reset (w, now);
+}
+
+/* Average the period over about 16 cycles */
+static void update_period (worker_t * w, uint32_t delta)
+{
+   if (w->period == 0)
+   {
+      w->period = delta;
+   }
+   else
+   {
+      w->period += ((int32_t)delta - (int32_t)w->period) / 16;
+   }
+}
+
+void worker_wakeup (worker_t * w, uint32_t now, const uint32_t * edge)
+{
+   uint32_t e = (edge != NULL) ? *edge : now;
+   uint32_t latency;
+
+   if (w->has_edge)
+   {
+      uint32_t since = e - w->edge;
+      uint32_t n = 1;
+
+      /* Cycles since last edge, some may have been missed */
+      if (w->period != 0)
+      {
+         n = (since + w->period / 2) / w->period;
+         n = (n == 0) ? 1 : n;
+      }
+
+      if (edge == NULL && w->period != 0)
+      {
+         uint32_t expected = w->edge + n * w->period;
+
+         /* Lock to the earliest wake-ups, drift slowly towards later
+          * ones in case the period is slightly underestimated */
+         if ((int32_t)(now - expected) > 0)
+         {
+            e = expected + (now - expected) / 16;
+         }
+      }
+
+      update_period (w, since / n);
+   }
+
+   update_elapsed (w, now);
+   latency = now - e;
+   w->edge = e;
+   w->has_edge = true;
+
+   w->stats.n_wakeups++;
+   w->stats.latency_total += latency;
+   if (latency < w->stats.latency_min)
+   {
+      w->stats.latency_min = latency;
+   }
+   if (latency > w->stats.latency_max)
+   {
+      w->stats.latency_max = latency;
+   }
+}
+
+uint32_t worker_sleep_time (const worker_t * w, uint32_t now)
+{
+   uint32_t since;
+
+   switch (w->mode)
+   {
+   case WORKER_POLL:
+      return 0;
+   case WORKER_ADAPTIVE:
+      if (!w->has_edge || w->period <= w->window)
+      {
+         return (w->has_edge) ? 0 : WORKER_FOREVER;
+      }
+      since = now - w->edge;
+      if (since < w->period - w->window)
+      {
+         return w->period - w->window - since;
+      }
+      if (since <= w->period + w->window)
+      {
+         return 0;
+      }
+      /* Missed the edge, wait for the next notification */
+      return WORKER_FOREVER;
+   case WORKER_BLOCKING:
+   default:
+      return WORKER_FOREVER;
+   }
+}
+
+void worker_idle (
+   worker_t * w,
+   uint32_t now,
+   uint32_t duration,
+   bool slept)
+{
+   update_elapsed (w, now);
+   w->stats.idle += duration;
+   if (slept)
+   {
+      w->stats.asleep += duration;
+      w->stats.n_sleeps++;
+   }
+}
+
+uint32_t worker_load (worker_t * w, uint32_t now)
+{
+   update_elapsed (w, now);
+   if (w->stats.elapsed == 0 || w->stats.idle >= w->stats.elapsed)
+   {
+      return 0;
+   }
+   return 100 - (uint32_t)(w->stats.idle * 100 / w->stats.elapsed);
+}
+
+const char * worker_mode_name (worker_mode_t mode)
+{
+   return (mode <= WORKER_ADAPTIVE) ? mode_names[mode] : "unknown";
+}
+
+int worker_mode_parse (const char * name, worker_mode_t * mode)
+{
+   for (int i = 0; i <= WORKER_ADAPTIVE; i++)
+   {
+      if (strcmp (name, mode_names[i]) == 0)
+      {
+         *mode = (worker_mode_t)i;
+         return 0;
+      }
+   }
+   return -1;
+}
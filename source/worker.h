@@ -0,0 +1,151 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef WORKER_H_
+#define WORKER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Wait policy of the worker serving the cyclic U-Phy events.
+ *
+ * The worker learns the cycle period from its wake-ups and decides, for
+ * each idle period, whether to sleep until notified or to poll. All
+ * times are in ticks of a free running 32-bit counter, CPU cycles on the
+ * target.
+ */
+
+typedef enum worker_mode
+{
+   WORKER_BLOCKING, /* Sleep until notified, least CPU */
+   WORKER_POLL,     /* Never sleep, least latency */
+   WORKER_ADAPTIVE, /* Poll within window of the expected edge */
+} worker_mode_t;
+
+/* Returned by worker_sleep_time() to sleep until notified */
+#define WORKER_FOREVER UINT32_MAX
+
+typedef struct worker_stats
+{
+   uint32_t n_wakeups;
+   uint32_t latency_min; /* From cycle edge to wake-up */
+   uint32_t latency_max;
+   uint64_t latency_total;
+   uint64_t idle;   /* Time not spent working */
+   uint64_t asleep; /* Part of idle time spent sleeping */
+   uint32_t n_sleeps;
+   uint64_t elapsed; /* Time since last reset */
+} worker_stats_t;
+
+typedef struct worker
+{
+   worker_mode_t mode;
+   uint32_t window; /* Half width of polling window around edge */
+   uint32_t period; /* Estimated cycle period, 0 until known */
+   uint32_t edge;   /* Time of last cycle edge */
+   bool has_edge;
+   uint32_t now; /* Time of last update of elapsed */
+   worker_stats_t stats;
+} worker_t;
+
+/**
+ * Initialise a worker.
+ *
+ * @param w          Worker
+ * @param mode       Wait policy
+ * @param window     Polling window, before and after the expected edge
+ * @param now        Current time
+ */
+extern void worker_init (
+   worker_t * w,
+   worker_mode_t mode,
+   uint32_t window,
+   uint32_t now);
+
+/**
+ * Change wait policy and reset statistics.
+ *
+ * @param w          Worker
+ * @param mode       Wait policy
+ * @param window     Polling window, before and after the expected edge
+ * @param now        Current time
+ */
+extern void worker_set_mode (
+   worker_t * w,
+   worker_mode_t mode,
+   uint32_t window,
+   uint32_t now);
+
+/**
+ * Reset statistics.
+ *
+ * @param w          Worker
+ * @param now        Current time
+ */
+extern void worker_reset (worker_t * w, uint32_t now);
+
+/**
+ * Record a wake-up for a cycle event.
+ *
+ * When the time of the edge is not known, it is estimated from the
+ * period. The estimate is locked to the earliest wake-ups, so latency
+ * is relative to the best case.
+ *
+ * @param w          Worker
+ * @param now        Time of wake-up
+ * @param edge       Time of cycle edge, or NULL if not known
+ */
+extern void worker_wakeup (worker_t * w, uint32_t now, const uint32_t * edge);
+
+/**
+ * How long the worker may sleep, when idle.
+ *
+ * @param w          Worker
+ * @param now        Current time
+ * @return 0 to poll, WORKER_FOREVER to sleep until notified or the
+ *         time until polling should start
+ */
+extern uint32_t worker_sleep_time (const worker_t * w, uint32_t now);
+
+/**
+ * Account idle time. Called at least once per counter wrap.
+ *
+ * @param w          Worker
+ * @param now        Current time
+ * @param duration   Time spent idle
+ * @param slept      True if the time was spent sleeping
+ */
+extern void worker_idle (
+   worker_t * w,
+   uint32_t now,
+   uint32_t duration,
+   bool slept);
+
+/**
+ * Percentage of time spent working since last reset.
+ *
+ * @param w          Worker
+ * @param now        Current time
+ */
+extern uint32_t worker_load (worker_t * w, uint32_t now);
+
+extern const char * worker_mode_name (worker_mode_t mode);
+
+/**
+ * Parse a mode name, as returned by worker_mode_name().
+ *
+ * @return 0 on success, -1 if unknown
+ */
+extern int worker_mode_parse (const char * name, worker_mode_t * mode);
+
+#endif /* WORKER_H_ */
@@ -0,0 +1,188 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+
+/*
+ * WFI policy of the idle task while the U-Phy task waits in up_worker(),
+ * and the 'worker' shell command.
+ */
+
+#include "cyhal.h"
+
+#include "worker_cmd.h"
+#include "cycle_stats.h"
+#include "mem_sections.h"
+#include "shell.h"
+#include "worker.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static worker_t worker APP_DTCM_DATA;
+static bool worker_started APP_DTCM_DATA;
+
+void worker_cmd_init (void)
+{
+   if (worker_started)
+   {
+      return;
+   }
+
+   worker_init (
+      &worker,
+      WORKER_POLL,
+      WORKER_CMD_DEFAULT_WINDOW_US * (SystemCoreClock / 1000000u),
+      cycle_stats_now());
+   worker_started = true;
+}
+
+APP_ITCM_FUNC void worker_cmd_wakeup (uint32_t now)
+{
+   worker_wakeup (&worker, now, NULL);
+}
+
+uint32_t worker_cmd_load (void)
+{
+   uint32_t load;
+
+   taskENTER_CRITICAL();
+   load = worker_load (&worker, cycle_stats_now());
+   taskEXIT_CRITICAL();
+
+   return load;
+}
+
+/*
+ * FreeRTOS idle hook. up_worker() blocks on the notification from the
+ * U-Phy core whatever the mode, which only decides what the idle task
+ * does meanwhile: sleep in WFI until the next interrupt, which saves
+ * power but adds wake-up time, or keep running for the lowest latency.
+ * Idle time is accounted for the CPU load shown by the 'worker' command.
+ */
+void vApplicationIdleHook (void)
+{
+   static uint32_t last;
+   uint32_t start = cycle_stats_now();
+   uint32_t end;
+   uint32_t idle;
+   bool slept = false;
+
+   if (!worker_started)
+   {
+      return;
+   }
+
+   if (worker_sleep_time (&worker, start) != 0)
+   {
+      __WFI();
+      slept = true;
+   }
+   end = cycle_stats_now();
+
+   /* Time since the previous call is idle too, unless the idle task was
+    * preempted in between */
+   idle = end - start;
+   if (start - last < WORKER_CMD_IDLE_GAP)
+   {
+      idle += start - last;
+   }
+   last = end;
+
+   taskENTER_CRITICAL();
+   worker_idle (&worker, end, idle, slept);
+   taskEXIT_CRITICAL();
+}
+
+int _cmd_worker (int argc, char * argv[])
+{
+   uint32_t cycles_per_us = SystemCoreClock / 1000000u;
+   worker_mode_t mode = worker.mode;
+   uint32_t window_us = worker.window / cycles_per_us;
+   worker_stats_t stats;
+   uint32_t load;
+
+   if (argc > 3 || (argc > 1 && worker_mode_parse (argv[1], &mode) != 0))
+   {
+      printf ("error - try \"help %s\"\n", argv[0]);
+      return -1;
+   }
+   if (argc == 3)
+   {
+      window_us = strtoul (argv[2], NULL, 0);
+   }
+
+   taskENTER_CRITICAL();
+   if (argc > 1)
+   {
+      worker_set_mode (
+         &worker,
+         mode,
+         window_us * cycles_per_us,
+         cycle_stats_now());
+   }
+   load = worker_load (&worker, cycle_stats_now());
+   stats = worker.stats;
+   taskEXIT_CRITICAL();
+
+   if (argc > 1)
+   {
+      printf ("Worker mode %s, statistics reset\n", worker_mode_name (mode));
+      return 0;
+   }
+
+   printf (
+      "Mode     : %s, window %" PRIu32 " us\n",
+      worker_mode_name (worker.mode),
+      window_us);
+   printf (
+      "Period   : %" PRIu32 " us\n",
+      cycle_stats_to_us (worker.period));
+   printf (
+      "CPU      : %" PRIu32 "%% load, %" PRIu32 "%% asleep (%" PRIu32
+      " sleeps)\n",
+      load,
+      (stats.elapsed > 0) ? (uint32_t)(stats.asleep * 100 / stats.elapsed)
+                          : 0,
+      stats.n_sleeps);
+   if (stats.n_wakeups > 0)
+   {
+      printf (
+         "Latency  : min %" PRIu32 " avg %" PRIu32 " max %" PRIu32
+         " cycles over %" PRIu32 " wake-ups\n",
+         stats.latency_min,
+         (uint32_t)(stats.latency_total / stats.n_wakeups),
+         stats.latency_max,
+         stats.n_wakeups);
+   }
+   return 0;
+}
+
+const shell_cmd_t cmd_worker = {
+   .cmd = _cmd_worker,
+   .name = "worker",
+   .help_short = "show or set idle WFI policy",
+   .help_long =
+      "Show CPU load and wake-up latency of the U-Phy worker, or set\n"
+      "the WFI policy of the idle task. up_worker() blocks until the\n"
+      "next event in every mode; the mode selects whether the idle\n"
+      "CPU sleeps in WFI (blocking), never sleeps (poll) or stays\n"
+      "awake within a window around the expected cycle edge\n"
+      "(adaptive). Latency is measured in cb_sync relative to the\n"
+      "earliest wake-ups. Setting a mode resets the statistics.\n"
+      "Usage: worker [blocking|poll|adaptive [<window_us>]]\n"};
+
+SHELL_CMD (cmd_worker);
@@ -0,0 +1,47 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+
+#ifndef WORKER_CMD_H_
+#define WORKER_CMD_H_
+
+#include <stdint.h>
+
+#define WORKER_CMD_DEFAULT_WINDOW_US 50
+#define WORKER_CMD_IDLE_GAP          200 /* Cycles, longest idle loop turn */
+
+/**
+ * Start accounting the U-Phy worker. The policy is changed with the
+ * 'worker' shell command, the default is to never sleep.
+ *
+ * up_worker() blocks on the notification from the U-Phy core in every
+ * mode. The mode is a WFI policy of the FreeRTOS idle hook: it decides
+ * whether the CPU sleeps in WFI or keeps running while no task is ready.
+ *
+ * Called by the U-Phy task before entering the event loop, the first
+ * call only has effect.
+ */
+extern void worker_cmd_init (void);
+
+/**
+ * Record a wake-up of the U-Phy worker. Called from cb_sync.
+ *
+ * @param now        Cycle counter at start of callback
+ */
+extern void worker_cmd_wakeup (uint32_t now);
+
+/**
+ * Percentage of CPU time spent working since the statistics were reset.
+ */
+extern uint32_t worker_cmd_load (void);
+
+#endif /* WORKER_CMD_H_ */
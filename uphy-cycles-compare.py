@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+# ********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+# *******************************************************************/
+#
+# Compare two outputs of the 'cycles' shell command.
+#
+# Save the console output of 'cycles' from a reference build and from the
+# build to evaluate, e.g. with and without APP_DISABLE_TCM, and print the
+# average and maximum cycle count of each entry side by side together
+# with the speedup. Entries found in one file only are listed with '-'.
+#
+# Only the Python standard library is used.
+#
+# Example:
+#   ./uphy-cycles-compare.py cycles-notcm.txt cycles-tcm.txt
+#
+
+import argparse
+
+
+def parse(path):
+    entries = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) < 5 or fields[0] == "name":
+                continue
+            try:
+                count, cmin, avg, cmax = (int(x) for x in fields[-4:])
+            except ValueError:
+                continue
+            name = " ".join(fields[:-4])
+            entries[name] = (count, cmin, avg, cmax)
+    return entries
+
+
+def ratio(before, after):
+    if before is None or after is None or after == 0:
+        return "-"
+    return "%.2f" % (before / after)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare two 'cycles' outputs")
+    parser.add_argument("before", help="cycles output of reference build")
+    parser.add_argument("after", help="cycles output of evaluated build")
+    parser.add_argument("--all", action="store_true",
+                        help="include entries with no samples")
+    args = parser.parse_args()
+
+    before = parse(args.before)
+    after = parse(args.after)
+    names = list(before) + [n for n in after if n not in before]
+
+    print("%-20s %10s %10s %8s %10s %10s %8s" % (
+        "name", "avg before", "avg after", "speedup",
+        "max before", "max after", "speedup"))
+    for name in names:
+        b = before.get(name)
+        a = after.get(name)
+        if not args.all and (b is None or b[0] == 0) and \
+           (a is None or a[0] == 0):
+            continue
+        b_avg = b[2] if b and b[0] > 0 else None
+        b_max = b[3] if b and b[0] > 0 else None
+        a_avg = a[2] if a and a[0] > 0 else None
+        a_max = a[3] if a and a[0] > 0 else None
+        print("%-20s %10s %10s %8s %10s %10s %8s" % (
+            name,
+            "-" if b_avg is None else b_avg,
+            "-" if a_avg is None else a_avg,
+            ratio(b_avg, a_avg),
+            "-" if b_max is None else b_max,
+            "-" if a_max is None else a_max,
+            ratio(b_max, a_max)))
+
+
+if __name__ == "__main__":
+    main()
@@ -23,6 +23,10 @@
 # Note that the path to rtlabs-uphy-lib including version in the
 # modus workspace is used to locate the upgen executable.
 #
+# The generated model tables are made const by uphy-model-const.py so
+# that they stay in flash. The binary device model (model.bin) loaded by
+# the firmware at runtime is generated by uphy-model-blob.py.
+#
 
 if [[ $# -eq 0 ]] ;
   then
@@ -66,6 +70,8 @@ fi
 echo "Run U-Phy Generator"
 set -x
 $($tool export -d $destination --generator Code $model)
+python3 uphy-model-const.py $destination/model.c $destination/model.h
 $($tool export -d $destination --generator Profinet $model)
 $($tool export -d $destination --generator EtherNetIP $model)
 $($tool export -d $destination --generator CC-Link $model)
+python3 uphy-model-blob.py $model $destination/model.bin
@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+# ********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+# *******************************************************************/
+#
+# Assemble a local logic program for the firmware, see source/logic.h.
+#
+# Copy the output to the filesystem as "logic.bin". The program is loaded
+# at startup and runs on the process image every cycle, so a reaction
+# such as a button driving a LED does not have to go through the PLC.
+#
+# One instruction per line, # starts a comment. The .sync section runs
+# before the inputs are sent, the .avail section after the outputs are
+# received. Signals are given as "slot.signal" names of the model, which
+# must be the one used by the device. Labels end with ":" and may only be
+# jumped to forwards. Each section must end with "end".
+#
+# Example, LED 0 is kept off while button 0 is pressed:
+#
+#   .avail
+#   load O8.Output 8 bits
+#   load I8.Input 8 bits
+#   bit 0
+#   jz done
+#   push 0xfe
+#   and
+#   done:
+#   store O8.Output 8 bits
+#   end
+#
+# Instructions:
+#   push <n>               push -32768..32767
+#   load <signal>          push value
+#   store <signal>         pop to input or output signal
+#   status <signal>        push status byte (0x80 is good)
+#   ldm <n> / stm <n>      push / pop memory cell 0-15, kept between cycles
+#   dup, drop
+#   bit <n>                replace top with bit n of top
+#   not, inv               logical and bitwise not of top
+#   add sub mul and or xor shl shr eq ne lt le gt ge min max
+#                          pop y, pop x, push x op y
+#   jmp <label>            jump
+#   jz <label>             pop, jump if 0
+#   end
+#
+# Only the Python standard library is used.
+#
+# Example:
+#   ./uphy-logic-asm.py model/digio.json interlock.s logic.bin
+#
+
+import argparse
+import json
+import struct
+import sys
+import zlib
+
+MAGIC = 0x474C5055  # "UPLG"
+VERSION = 1
+
+OPS = [
+    "end",
+    "push",
+    "load",
+    "store",
+    "status",
+    "ldm",
+    "stm",
+    "dup",
+    "drop",
+    "bit",
+    "not",
+    "inv",
+    "add",
+    "sub",
+    "mul",
+    "and",
+    "or",
+    "xor",
+    "shl",
+    "shr",
+    "eq",
+    "ne",
+    "lt",
+    "le",
+    "gt",
+    "ge",
+    "min",
+    "max",
+    "jmp",
+    "jz",
+]
+
+SIGNAL_OPS = ("load", "store", "status")
+CELL_OPS = ("ldm", "stm", "bit")
+JUMP_OPS = ("jmp", "jz")
+
+
+def signal_indexes(model, device_ix):
+    """Map "slot.signal" to signal index, numbered as by the generators"""
+    device = model["devices"][device_ix]
+    modules = {m["id"]: m for m in model["modules"]}
+    ixs = {}
+    ix = 0
+    for slot in device["slots"]:
+        module = modules[slot["module"]]
+        for kind in ("inputs", "outputs", "parameters"):
+            for s in module.get(kind, []):
+                ixs.setdefault("%s.%s" % (slot["name"], s["name"]), ix)
+                ix += 1
+    return ixs
+
+
+def assemble(lines, ixs):
+    sections = {"sync": [], "avail": []}
+    labels = {}
+    code = sections["sync"]
+    section = "sync"
+
+    def error(line_no, msg):
+        sys.exit("line %d: %s" % (line_no, msg))
+
+    # Pass 1, collect instructions and label positions
+    for line_no, line in enumerate(lines, 1):
+        line = line.split("#")[0].strip()
+        if not line:
+            continue
+        if line in (".sync", ".avail"):
+            section = line[1:]
+            code = sections[section]
+            continue
+        if line.endswith(":"):
+            labels[(section, line[:-1].strip())] = len(code)
+            continue
+        op, _, arg = line.partition(" ")
+        op = op.lower()
+        if op not in OPS:
+            error(line_no, "unknown instruction %s" % op)
+        code.append((line_no, op, arg.strip()))
+
+    # Pass 2, encode
+    data = {}
+    for section, code in sections.items():
+        out = []
+        for pos, (line_no, op, arg) in enumerate(code):
+            a = 0
+            b = 0
+            try:
+                if op in SIGNAL_OPS:
+                    if arg not in ixs:
+                        error(line_no, "unknown signal %s" % arg)
+                    b = ixs[arg]
+                elif op in CELL_OPS:
+                    a = int(arg, 0)
+                elif op == "push":
+                    b = int(arg, 0)
+                    if not -32768 <= b <= 32767:
+                        error(line_no, "value out of range")
+                elif op in JUMP_OPS:
+                    if (section, arg) not in labels:
+                        error(line_no, "unknown label %s" % arg)
+                    b = labels[(section, arg)] - pos
+                    if b <= 0:
+                        error(line_no, "backward jump")
+                elif arg:
+                    error(line_no, "unexpected operand")
+            except ValueError:
+                error(line_no, "invalid number %s" % arg)
+            if not 0 <= a <= 255:
+                error(line_no, "operand out of range")
+            out.append(struct.pack("<BBh", OPS.index(op), a, b))
+        if out and code[-1][1] != "end":
+            error(code[-1][0], "section %s does not end with end" % section)
+        data[section] = b"".join(out)
+
+    insns = data["sync"] + data["avail"]
+    header = struct.pack(
+        "<IHHIHH",
+        MAGIC,
+        VERSION,
+        len(insns) // 4,
+        zlib.crc32(insns),
+        len(data["sync"]) // 4,
+        0,
+    )
+    return header + insns, len(data["sync"]) // 4, len(data["avail"]) // 4
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Assemble local logic program for U-Phy device"
+    )
+    parser.add_argument("model", help="model json file")
+    parser.add_argument("source", help="logic source file")
+    parser.add_argument("output", help="output file, e.g. logic.bin")
+    parser.add_argument("--device", type=int, default=0, help="device index")
+    args = parser.parse_args()
+
+    with open(args.model) as f:
+        model = json.load(f)
+    with open(args.source) as f:
+        lines = f.readlines()
+
+    data, n_sync, n_avail = assemble(lines, signal_indexes(model, args.device))
+    with open(args.output, "wb") as f:
+        f.write(data)
+
+    print(
+        "%s: %d bytes, %d sync and %d avail instructions"
+        % (args.output, len(data), n_sync, n_avail)
+    )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+# ********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+# *******************************************************************/
+#
+# Modbus TCP load generator.
+#
+# Connects an increasing number of concurrent clients to the device and
+# polls holding registers as fast as possible. Reports requests per second,
+# median and p99 latency and failed connections for each client count.
+#
+# Only the Python standard library is used.
+#
+# Example:
+#   ./uphy-modbus-loadgen.py 192.168.0.50 --clients 1 2 4 8 12 --duration 10
+#
+
+import argparse
+import socket
+import struct
+import threading
+import time
+
+
+def poll(host, port, unit, address, count, duration, result):
+    latencies = []
+    try:
+        s = socket.create_connection((host, port), timeout=2.0)
+    except OSError:
+        result["failed"] = True
+        return
+
+    s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    tid = 0
+    end = time.monotonic() + duration
+    try:
+        while time.monotonic() < end:
+            tid = (tid + 1) & 0xFFFF
+            # MBAP header + read holding registers (function code 3)
+            req = struct.pack(">HHHBBHH", tid, 0, 6, unit, 3, address, count)
+            t0 = time.perf_counter()
+            s.sendall(req)
+            hdr = recv_exact(s, 7)
+            _, _, length, _ = struct.unpack(">HHHB", hdr)
+            recv_exact(s, length - 1)
+            latencies.append(time.perf_counter() - t0)
+    except OSError:
+        result["errors"] = result.get("errors", 0) + 1
+    finally:
+        s.close()
+
+    result["latencies"] = latencies
+
+
+def recv_exact(s, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = s.recv(n - len(buf))
+        if not chunk:
+            raise OSError("connection closed")
+        buf += chunk
+    return buf
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    k = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[k]
+
+
+def run(args, n_clients):
+    results = [{} for _ in range(n_clients)]
+    threads = [
+        threading.Thread(
+            target=poll,
+            args=(args.host, args.port, args.unit, args.address,
+                  args.count, args.duration, results[i]))
+        for i in range(n_clients)
+    ]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    latencies = [l for r in results for l in r.get("latencies", [])]
+    failed = sum(1 for r in results if r.get("failed"))
+    errors = sum(r.get("errors", 0) for r in results)
+    rps = len(latencies) / args.duration
+    print("%8d %10.1f %10.2f %10.2f %8d %8d" % (
+        n_clients, rps,
+        percentile(latencies, 50) * 1000,
+        percentile(latencies, 99) * 1000,
+        failed, errors))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Modbus TCP load generator")
+    parser.add_argument("host", help="device IP address")
+    parser.add_argument("--port", type=int, default=502)
+    parser.add_argument("--unit", type=int, default=1)
+    parser.add_argument("--address", type=int, default=0,
+                        help="first holding register")
+    parser.add_argument("--count", type=int, default=1,
+                        help="number of registers per request")
+    parser.add_argument("--clients", type=int, nargs="+",
+                        default=[1, 2, 4, 8],
+                        help="concurrent client counts to run")
+    parser.add_argument("--duration", type=float, default=5.0,
+                        help="seconds per client count")
+    args = parser.parse_args()
+
+    print("%8s %10s %10s %10s %8s %8s" % (
+        "clients", "req/s", "p50 [ms]", "p99 [ms]", "refused", "errors"))
+    for n in args.clients:
+        run(args, n)
+        # Let the device release closed connections
+        time.sleep(1.0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,587 @@
+#!/usr/bin/env python3
+# ********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+# *******************************************************************/
+#
+# Generate a binary device model from a U-Phy model json file.
+#
+# The blob holds the same information as generated/model.c for the
+# Profinet, EtherNet/IP and Modbus TCP protocols and is loaded by the
+# firmware at boot, see source/model_blob.h for the layout. Program it
+# to the model region at the end of code flash, or copy it to the
+# filesystem as "model.bin".
+#
+# The first UINT8 input and output signals are mapped to the EVK buttons
+# and LEDs unless --no-evk-io is given.
+#
+# By default the process image has the same layout as up_data_t, with the
+# status following the value of each signal. With --layout soa the values
+# of each direction are packed together, followed by dense arrays of
+# statuses, which suits whole image operations (see process_image.h).
+#
+# A perfect hash index of "slot.signal" names is included, for lookup of
+# signals by name in constant time (see model_blob_names_t), and byte
+# swap plans of the multi-byte fields of each slot (model_blob_swap_t).
+#
+# With --conditioning, REAL32 inputs are scaled, clamped and filtered by
+# the application each cycle (see source/conditioning.h). The file maps
+# "slot.signal" to the conditioning of the signal:
+#
+#   {
+#     "window": 8,
+#     "signals": {
+#       "AI.Temperature": {"gain": 0.1, "offset": -40, "min": -40,
+#                          "max": 125, "filter": "iir", "alpha": 0.2}
+#     }
+#   }
+#
+# filter is iir, avg (moving average over window samples) or none.
+#
+# Only the Python standard library is used.
+#
+# Example:
+#   ./uphy-model-blob.py model/digio.json generated/model.bin
+#
+
+import argparse
+import json
+import struct
+import sys
+import zlib
+
+MAGIC = 0x424D5055  # "UPMB"
+VERSION = 5
+
+NO_STATUS = 0xFFFFFFFF
+NO_IX = 0xFFFF
+FLAG_WEBGUI = 1 << 0
+
+LAYOUT_AOS = 0
+LAYOUT_SOA = 1
+
+KIND_INPUT = 0
+KIND_OUTPUT = 1
+KIND_PARAM = 2
+KIND_EMPTY = 0xFF
+
+# Datatype: (blob code, size in bytes, struct format for default value)
+DTYPES = {
+    "UINT8": (0, 1, "<B"),
+    "UINT16": (1, 2, "<H"),
+    "UINT32": (2, 4, "<I"),
+    "INT8": (3, 1, "<b"),
+    "INT16": (4, 2, "<h"),
+    "INT32": (5, 4, "<i"),
+    "REAL32": (6, 4, "<f"),
+    "OCTET_STRING": (7, None, None),
+}
+
+# Width of fields that change with byte order, by blob datatype code
+SWAP_WIDTH = {1: 2, 2: 4, 4: 2, 5: 4, 6: 4}
+
+# Conditioning filters, same order as the channels in the blob
+FILTERS = ("iir", "avg", "none")
+
+HEADER = struct.Struct("<IHHIIIIIHHIIIIHHB3xIIIIIIIIIIIIII")
+SLOT = struct.Struct("<IHHHHHHIII")
+SIGNAL = struct.Struct("<IHBBHHI")
+VAR = struct.Struct("<II")
+PROFINET = struct.Struct("<HHIIIIIHHHHIIBBBBHHHHII")
+PN_MODULE = struct.Struct("<IIHHI")
+ETHERNETIP = struct.Struct("<HHHBBIIHHHHHH")
+MODBUS = struct.Struct("<HH")
+NAMES = struct.Struct("<IIII")
+NAME = struct.Struct("<HBBHH")
+SWAP = struct.Struct("<HHI")
+SWAP_RUN = struct.Struct("<IHH")
+CONDITIONING = struct.Struct("<HHHHI")
+CHANNEL = struct.Struct("<HHfffff")
+
+KINDS = {
+    "inputs": KIND_INPUT,
+    "outputs": KIND_OUTPUT,
+    "parameters": KIND_PARAM,
+}
+
+# Fixed values used by the code generator
+PN_DAP_IDENTITY_SUBMODULE_ID = 0x00000001
+PN_DAP_INTERFACE_SUBMODULE_ID = 0x00008000
+PN_DAP_PORT_1_SUBMODULE_ID = 0x00008001
+PN_DAP_PORT_2_SUBMODULE_ID = 0x00008002
+EIP_DEVICE_TYPE = 43
+EIP_ASSEMBLY_IDS = (100, 101, 102, 103, 104)
+
+
+def num(value, default=0):
+    """Parse a number from the model, e.g. "0x0493", "#x1337" or "32"."""
+    if value is None:
+        return default
+    if isinstance(value, (int, float)):
+        return int(value)
+    value = value.strip()
+    if value.startswith("#x"):
+        return int(value[2:], 16)
+    return int(value, 0)
+
+
+class Blob:
+    def __init__(self):
+        self.buf = bytearray(HEADER.size)
+        self.strings = {}
+
+    def alloc(self, size):
+        while len(self.buf) % 4:
+            self.buf.append(0)
+        offset = len(self.buf)
+        self.buf.extend(bytes(size))
+        return offset
+
+    def put(self, fmt, records):
+        if not records:
+            return 0
+        offset = self.alloc(fmt.size * len(records))
+        for i, r in enumerate(records):
+            fmt.pack_into(self.buf, offset + i * fmt.size, *r)
+        return offset
+
+    def string(self, s):
+        if s is None:
+            return 0
+        if s not in self.strings:
+            data = s.encode("utf-8") + b"\0"
+            offset = len(self.buf)
+            self.buf.extend(data)
+            self.strings[s] = offset
+        return self.strings[s]
+
+
+class Image:
+    """Process image layout, same rules as a C struct."""
+
+    def __init__(self):
+        self.data = bytearray()
+
+    def add(self, size, align):
+        while len(self.data) % align:
+            self.data.append(0)
+        offset = len(self.data)
+        self.data.extend(bytes(size))
+        return offset
+
+
+def layout_image(signals, soa):
+    """Place values and statuses in the process image.
+
+    signals is a list of (kind, size, default) in signal index order.
+    Returns the image, the var table and the input and output regions.
+    """
+    image = Image()
+    vars = [None] * len(signals)
+    regions = []
+
+    if not soa:
+        for ix, (kind, size, default) in enumerate(signals):
+            value = image.add(size, min(size, 4))
+            image.data[value : value + size] = default
+            status = NO_STATUS if kind == "parameters" else image.add(1, 1)
+            vars[ix] = (value, status)
+        return image.data, vars, [(0, 0, 0, 0), (0, 0, 0, 0)]
+
+    for kind in ("inputs", "outputs"):
+        ixs = [ix for ix, s in enumerate(signals) if s[0] == kind]
+        start = image.add(0, 4)
+        for ix in ixs:
+            size = signals[ix][1]
+            vars[ix] = image.add(size, min(size, 4))
+        regions.append([start, image.add(0, 4) - start, 0, len(ixs), ixs])
+
+    for ix, (kind, size, default) in enumerate(signals):
+        if kind == "parameters":
+            value = image.add(size, min(size, 4))
+            image.data[value : value + size] = default
+            vars[ix] = (value, NO_STATUS)
+
+    for region in regions:
+        region[2] = image.add(len(region[4]), 4)
+        for i, ix in enumerate(region.pop()):
+            vars[ix] = (vars[ix], region[2] + i)
+
+    return image.data, vars, [tuple(r) for r in regions]
+
+
+def name_hash(key, seed):
+    """FNV-1a with seed, spaces hash as underscores."""
+    h = 0x811C9DC5 ^ seed
+    for b in key.replace(" ", "_").encode("utf-8"):
+        h = ((h ^ b) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def name_index(names):
+    """Hash and displace perfect hash of (key, entry) pairs.
+
+    Returns n_buckets, n_entries, displacements and entries.
+    """
+    n_entries = max(1, (len(names) * 5 + 3) // 4)
+    n_buckets = max(1, (len(names) + 3) // 4)
+    buckets = [[] for _ in range(n_buckets)]
+    for key, entry in names:
+        buckets[name_hash(key, 0) % n_buckets].append((key, entry))
+
+    displacement = [0] * n_buckets
+    entries = [None] * n_entries
+    for b in sorted(range(n_buckets), key=lambda b: -len(buckets[b])):
+        if not buckets[b]:
+            continue
+        for d in range(1, 0x10000):
+            pos = [name_hash(key, d) % n_entries for key, _ in buckets[b]]
+            free = all(entries[p] is None for p in pos)
+            if free and len(set(pos)) == len(pos):
+                break
+        else:
+            sys.exit("Failed to build name index")
+        displacement[b] = d
+        for p, (_, entry) in zip(pos, buckets[b]):
+            entries[p] = entry
+
+    empty = (0, KIND_EMPTY, 0, 0, 0)
+    return n_buckets, n_entries, displacement, [e or empty for e in entries]
+
+
+def swap_runs(fields):
+    """Merge (offset, width) fields into runs of consecutive fields of the
+    same width, as (offset, width, count)."""
+    runs = []
+    for offset, width in sorted(fields):
+        if runs:
+            start, w, count = runs[-1]
+            if w == width and start + w * count == offset and count < 0xFFFF:
+                runs[-1] = (start, w, count + 1)
+                continue
+        runs.append((offset, width, 1))
+    return runs
+
+
+def conditioning_channels(conditioning, info):
+    """Channel records for the conditioning configuration, ordered by
+    filter, and the number of channels per filter."""
+    channels = {f: [] for f in FILTERS}
+    for key, c in conditioning.get("signals", {}).items():
+        if key not in info:
+            sys.exit("Conditioning of unknown signal %s" % key)
+        kind, code, ix = info[key]
+        if kind != "inputs" or code != DTYPES["REAL32"][0]:
+            sys.exit("Conditioned signal %s must be a REAL32 input" % key)
+        f = c.get("filter", "none")
+        if f not in FILTERS:
+            sys.exit("Unknown filter %s for %s" % (f, key))
+        alpha = float(c.get("alpha", 1))
+        if not 0 < alpha <= 1:
+            sys.exit("Filter alpha for %s must be in (0, 1]" % key)
+        channels[f].append(
+            (
+                ix,
+                0,
+                float(c.get("gain", 1)),
+                float(c.get("offset", 0)),
+                float(c.get("min", -3.4e38)),
+                float(c.get("max", 3.4e38)),
+                alpha,
+            )
+        )
+    counts = [len(channels[f]) for f in FILTERS]
+    return sum((channels[f] for f in FILTERS), []), counts
+
+
+def signal_size(signal):
+    code, size, _ = DTYPES[signal["datatype"]]
+    if size is None:
+        size = num(signal.get("length"), 1)
+    return code, size
+
+
+def default_value(param, size):
+    _, _, fmt = DTYPES[param["datatype"]]
+    value = param.get("default")
+    if value is None or value == "":
+        return bytes(size)
+    if fmt is None:
+        return value.encode("utf-8")[:size].ljust(size, b"\0")
+    if fmt == "<f":
+        return struct.pack(fmt, float(value))
+    return struct.pack(fmt, num(value))
+
+
+def generate(model, device_ix, evk_io, soa, conditioning):
+    device = model["devices"][device_ix]
+    modules = {m["id"]: (i, m) for i, m in enumerate(model["modules"])}
+    blob = Blob()
+    signals = []
+    slots = []
+    names = []
+    keys = set()
+    info = {}
+    evk_input_ix = NO_IX
+    evk_output_ix = NO_IX
+    frame_offset = {"inputs": 0, "outputs": 0}
+
+    def add_signals(slot_ix, module, kind):
+        nonlocal evk_input_ix, evk_output_ix
+        records = []
+        param_offset = 0
+        for i, s in enumerate(module.get(kind, [])):
+            if s["datatype"] not in DTYPES:
+                sys.exit("Unsupported datatype %s" % s["datatype"])
+            code, size = signal_size(s)
+            ix = len(signals)
+            if kind == "parameters":
+                default = default_value(s, size)
+                offset = param_offset
+                param_offset += size
+            else:
+                default = bytes(size)
+                offset = frame_offset[kind]
+                frame_offset[kind] += size
+            signals.append((kind, size, default))
+            key = "%s.%s" % (device["slots"][slot_ix]["name"], s["name"])
+            if key in keys:
+                print("Warning - duplicate signal name %s" % key)
+            else:
+                keys.add(key)
+                info[key] = (kind, code, ix)
+                names.append((key, (slot_ix, KINDS[kind], 0, i, ix)))
+            if evk_io and s["datatype"] == "UINT8":
+                if kind == "inputs" and evk_input_ix == NO_IX:
+                    evk_input_ix = ix
+                if kind == "outputs" and evk_output_ix == NO_IX:
+                    evk_output_ix = ix
+            records.append(
+                (blob.string(s["name"]), ix, code, 0, size * 8, offset, 0)
+            )
+        return records
+
+    for slot_ix, slot in enumerate(device["slots"]):
+        _, module = modules[slot["module"]]
+        inputs = add_signals(slot_ix, module, "inputs")
+        outputs = add_signals(slot_ix, module, "outputs")
+        params = add_signals(slot_ix, module, "parameters")
+        slots.append((slot, inputs, outputs, params))
+
+    image, vars, regions = layout_image(signals, soa)
+
+    slot_records = []
+    for slot, inputs, outputs, params in slots:
+        slot_records.append(
+            (
+                blob.string(slot["name"]),
+                sum(r[4] for r in inputs),
+                sum(r[4] for r in outputs),
+                len(inputs),
+                len(outputs),
+                len(params),
+                0,
+                blob.put(SIGNAL, inputs),
+                blob.put(SIGNAL, outputs),
+                blob.put(SIGNAL, params),
+            )
+        )
+
+    swaps = []
+    for _, inputs, outputs, _ in slots:
+        for records in (inputs, outputs):
+            fields = [
+                (vars[r[1]][0], SWAP_WIDTH[r[2]])
+                for r in records
+                if r[2] in SWAP_WIDTH
+            ]
+            runs = swap_runs(fields)
+            swaps.append((len(runs), 0, blob.put(SWAP_RUN, runs)))
+
+    cond = 0
+    if conditioning:
+        channels, counts = conditioning_channels(conditioning, info)
+        window = int(conditioning.get("window", 1))
+        if not 0 < window <= 0xFFFF:
+            sys.exit("Invalid moving average window %d" % window)
+        cond = blob.put(
+            CONDITIONING, [(*counts, window, blob.put(CHANNEL, channels))]
+        )
+
+    profinet = 0
+    if "profinet" in model and "profinet" in device:
+        pn = device["profinet"]
+        pn_modules = []
+        for m in model["modules"]:
+            index = [
+                num(p.get("profinet", {}).get("index"))
+                for p in m.get("parameters", [])
+            ]
+            params = blob.put(struct.Struct("<I"), [(i,) for i in index])
+            pn_modules.append(
+                (
+                    num(m["profinet"]["module_id"]),
+                    num(m["profinet"]["submodule_id"]),
+                    len(index),
+                    0,
+                    params,
+                )
+            )
+        pn_slots = [(modules[s["module"]][0],) for s in device["slots"]]
+        revision = pn.get("sw_revision_prefix", "V")
+        fields = (
+            num(model["profinet"]["vendor_id"]),
+            num(model["profinet"]["device_id"]),
+            num(pn.get("dap_module_id"), 1),
+            PN_DAP_IDENTITY_SUBMODULE_ID,
+            PN_DAP_INTERFACE_SUBMODULE_ID,
+            PN_DAP_PORT_1_SUBMODULE_ID,
+            PN_DAP_PORT_2_SUBMODULE_ID,
+            num(pn.get("profile_id")),
+            num(pn.get("profile_specific_type")),
+            num(pn.get("min_device_interval"), 32),
+            num(pn.get("hw_revision"), 1),
+            blob.string(pn.get("default_stationname")),
+            blob.string(pn.get("order_id")),
+            ord(revision[0]) if revision else ord("V"),
+            num(pn.get("sw_revision_functional_enhancement")),
+            num(pn.get("sw_revision_bug_fix")),
+            num(pn.get("sw_revision_internal_change")),
+            num(pn.get("revision_counter")),
+            len(pn_modules),
+            len(pn_slots),
+            0,
+            blob.put(PN_MODULE, pn_modules),
+            blob.put(struct.Struct("<H"), pn_slots),
+        )
+        profinet = blob.put(PROFINET, [fields])
+
+    ethernetip = 0
+    if "ethernetip" in model and "ethernetip" in device:
+        eip = device["ethernetip"]
+        major, _, minor = eip.get("revision", "1.1").partition(".")
+        fields = (
+            num(model["ethernetip"]["vendor_id"]),
+            EIP_DEVICE_TYPE,
+            num(eip.get("product_code")),
+            num(major, 1),
+            num(minor or None, 1),
+            num(eip.get("min_data_interval")),
+            num(eip.get("default_data_interval")),
+        ) + EIP_ASSEMBLY_IDS + (0,)
+        ethernetip = blob.put(ETHERNETIP, [fields])
+
+    modbus = 0
+    if "modbus" in device:
+        modbus = blob.put(MODBUS, [(num(device["modbus"].get("port"), 502), 0)])
+
+    n_buckets, n_entries, displacement, entries = name_index(names)
+    names = blob.put(
+        NAMES,
+        [
+            (
+                n_buckets,
+                n_entries,
+                blob.put(struct.Struct("<H"), [(d,) for d in displacement]),
+                blob.put(NAME, entries),
+            )
+        ],
+    )
+
+    header = [
+        MAGIC,
+        VERSION,
+        HEADER.size,
+        0,  # size
+        0,  # crc
+        blob.string(device["name"]),
+        blob.string(device.get("serial")),
+        FLAG_WEBGUI if device.get("webgui_enable") else 0,
+        len(slot_records),
+        len(vars),
+        blob.put(SLOT, slot_records),
+        blob.put(VAR, vars),
+        len(image),
+        0,  # data_init
+        evk_input_ix,
+        evk_output_ix,
+        LAYOUT_SOA if soa else LAYOUT_AOS,
+        *regions[0],
+        *regions[1],
+        profinet,
+        ethernetip,
+        modbus,
+        names,
+        blob.put(SWAP, swaps),
+        cond,
+    ]
+    if image:
+        header[13] = blob.alloc(len(image))
+        blob.buf[header[13] : header[13] + len(image)] = image
+
+    blob.alloc(0)
+    header[3] = len(blob.buf)
+    HEADER.pack_into(blob.buf, 0, *header)
+    header[4] = zlib.crc32(blob.buf[16:]) & 0xFFFFFFFF
+    HEADER.pack_into(blob.buf, 0, *header)
+    return blob.buf, header
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Generate binary device model from U-Phy model file"
+    )
+    parser.add_argument("model", help="model json file")
+    parser.add_argument("output", help="output file, e.g. generated/model.bin")
+    parser.add_argument("--device", type=int, default=0, help="device index")
+    parser.add_argument(
+        "--no-evk-io",
+        action="store_true",
+        help="do not map signals to EVK buttons and LEDs",
+    )
+    parser.add_argument(
+        "--layout",
+        choices=("aos", "soa"),
+        default="aos",
+        help="process image layout, default aos",
+    )
+    parser.add_argument(
+        "--conditioning",
+        metavar="FILE",
+        help="json file with conditioning of analog inputs",
+    )
+    args = parser.parse_args()
+
+    with open(args.model) as f:
+        model = json.load(f)
+
+    conditioning = None
+    if args.conditioning:
+        with open(args.conditioning) as f:
+            conditioning = json.load(f)
+
+    data, header = generate(
+        model,
+        args.device,
+        not args.no_evk_io,
+        args.layout == "soa",
+        conditioning,
+    )
+    with open(args.output, "wb") as f:
+        f.write(data)
+
+    print(
+        "%s: %d bytes, %d slots, %d signals, crc 0x%08x"
+        % (args.output, len(data), header[8], header[9], header[4])
+    )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+# ********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+# *******************************************************************/
+#
+# Const-qualify the static model tables in generated code.
+#
+# upgen declares all model tables as mutable globals, so they are placed
+# in .data and copied from flash to RAM at startup. This script rewrites
+# generated/model.c and generated/model.h so that every table except
+# up_device (which holds the mutable bustype) and the process image
+# up_data is const and stays in flash.
+#
+# The U-Phy API takes non-const pointers to the tables but never writes
+# through them, so references between tables are cast.
+#
+# The script is run by uphy-device-generator.sh and can be run again on
+# already converted files.
+#
+# Example:
+#   ./uphy-model-const.py generated/model.c generated/model.h
+#
+
+import re
+import sys
+
+CONST_TYPES = (
+    "up_signal_info_t",
+    "up_signal_t",
+    "up_param_t",
+    "up_slot_t",
+    "up_pn_param_t",
+    "up_pn_module_t",
+    "up_pn_slot_t",
+    "up_profinet_config_t",
+    "up_ciaobject_t",
+    "up_ciapdo_t",
+    "up_ecat_module_t",
+    "up_ecat_slot_t",
+    "up_ecat_device_t",
+    "up_ethernetip_config_t",
+    "up_modbus_config_t",
+    "up_cclink_item_t",
+    "up_cclink_module_t",
+    "up_cclink_station_t",
+    "up_cclink_config_t",
+    "up_mockadapter_config_t",
+)
+
+TYPES = "|".join(CONST_TYPES)
+
+# Table definition, e.g. "static up_signal_t inputs_I8[] = {"
+DEFINITION = re.compile(
+    r"^(static )?(const )?(" + TYPES + r") (\w+)(\[\])? =", re.MULTILINE
+)
+
+# Declaration in header, e.g. "extern up_profinet_config_t up_profinet_config;"
+DECLARATION = re.compile(r"^extern (const )?(" + TYPES + r") (\w+)", re.MULTILINE)
+
+
+def convert_source(text):
+    tables = {}
+
+    def definition(m):
+        static, _, type, name, array = m.groups()
+        tables[name] = type
+        return "%sconst %s %s%s =" % (static or "", type, name, array or "")
+
+    text = DEFINITION.sub(definition, text)
+
+    # Cast references to const tables in initializers
+    def reference(m):
+        field, name, end = m.groups()
+        if name not in tables:
+            return m.group(0)
+        return "%s = (%s *)%s%s" % (field, tables[name], name, end)
+
+    return re.sub(r"(\.\w+) = (?:\(\w+ \*\))?(\w+)([,;])", reference, text)
+
+
+def convert_header(text):
+    return DECLARATION.sub(lambda m: "extern const %s %s" % m.group(2, 3), text)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("Syntax : %s <model.c> <model.h>" % sys.argv[0])
+        sys.exit(1)
+
+    files = ((sys.argv[1], convert_source), (sys.argv[2], convert_header))
+    for path, convert in files:
+        with open(path) as f:
+            text = f.read()
+        with open(path, "w") as f:
+            f.write(convert(text))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+# ********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+# *******************************************************************/
+#
+# Decode a binary process data recording to CSV.
+#
+# The recording is written by 'rec bin <file>' on the device, see
+# source/recorder.h for the format. The first column is the cycle
+# relative to the trigger, or to the first cycle if not triggered.
+#
+# Only the Python standard library is used.
+#
+# Example:
+#   ./uphy-rec-decode.py rec.bin -o rec.csv
+#
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x43525055
+HEADER = struct.Struct("<IHHHBBII")
+CHANNEL = struct.Struct("<48sBBH")
+BLOCK = struct.Struct("<IIHH")
+
+TRIGGERED = 0x01
+TRUNCATED = 0x02
+
+UINT, INT, REAL = range(3)
+
+
+def varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if b & 0x80 == 0 or shift >= 35:
+            return value & 0xFFFFFFFF, pos
+
+
+def unzigzag(z):
+    return (z >> 1) ^ (-(z & 1) & 0xFFFFFFFF)
+
+
+def decode_block(block, n):
+    """Yield (cycle, values) for each cycle of a block"""
+    cycle, end, used, _ = BLOCK.unpack_from(block)
+    pos = BLOCK.size
+    values = list(struct.unpack_from("<%dI" % n, block, pos))
+    pos += 4 * n
+
+    while cycle < end:
+        if pos < used:
+            gap, pos = varint(block, pos)
+            next_cycle = cycle + 1 + gap
+        else:
+            next_cycle = end
+        while cycle < min(next_cycle, end):
+            yield cycle, values
+            cycle += 1
+        if cycle >= end:
+            return
+        mask = block[pos]
+        pos += 1
+        for i in range(n):
+            if mask & (1 << i):
+                z, pos = varint(block, pos)
+                values[i] = (values[i] + unzigzag(z)) & 0xFFFFFFFF
+
+
+def format_value(value, ctype):
+    if ctype == REAL:
+        return "%g" % struct.unpack("<f", struct.pack("<I", value))[0]
+    if ctype == INT:
+        return str(value - (1 << 32) if value & 0x80000000 else value)
+    return str(value)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Decode a binary process data recording to CSV"
+    )
+    parser.add_argument("file", help="recording from 'rec bin'")
+    parser.add_argument("-o", "--output", help="CSV file, default stdout")
+    args = parser.parse_args()
+
+    with open(args.file, "rb") as f:
+        data = f.read()
+
+    magic, version, block_size, n_blocks, n, flags, first, trigger = (
+        HEADER.unpack_from(data)
+    )
+    if magic != MAGIC or version != 1:
+        sys.exit("%s: not a recording" % args.file)
+
+    pos = HEADER.size
+    names = []
+    types = []
+    for _ in range(n):
+        name, ctype, _, _ = CHANNEL.unpack_from(data, pos)
+        names.append(name.split(b"\0")[0].decode())
+        types.append(ctype)
+        pos += CHANNEL.size
+
+    origin = trigger if flags & TRIGGERED else first
+    out = open(args.output, "w") if args.output else sys.stdout
+    out.write(",".join(["cycle"] + names) + "\n")
+    for _ in range(n_blocks):
+        block = data[pos : pos + block_size]
+        pos += block_size
+        for cycle, values in decode_block(block, n):
+            if cycle < first:
+                continue
+            row = [str(cycle - origin)]
+            row += [format_value(v, t) for v, t in zip(values, types)]
+            out.write(",".join(row) + "\n")
+
+    if flags & TRUNCATED:
+        print("Recording truncated, post-trigger window did not fit",
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
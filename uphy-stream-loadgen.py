@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+# ********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+# *******************************************************************/
+#
+# Process data stream load generator.
+#
+# Connects an increasing number of concurrent viewers to the process
+# data stream of the device, see source/stream_net.c, and applies the
+# events to a copy of the signals like the viewer page does. A share of
+# the viewers can be made slow, reading only a few hundred bytes per
+# second, to check that they do not hold back the others. Reports
+# events per second, the share of full events, received kB/s and gaps
+# in the sequence numbers per viewer for each viewer count.
+#
+# Only the Python standard library is used.
+#
+# Example:
+#   ./uphy-stream-loadgen.py 192.168.0.50 --viewers 1 2 4 --slow 1
+#
+
+import argparse
+import json
+import socket
+import threading
+import time
+
+
+def view(host, port, duration, slow, result):
+    try:
+        s = socket.create_connection((host, port), timeout=2.0)
+    except OSError:
+        result["failed"] = True
+        return
+
+    if slow:
+        # Keep the receive window small so the device sees the backlog
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1024)
+    s.sendall(b"GET /stream HTTP/1.1\r\nHost: %s\r\n\r\n" % host.encode())
+
+    buf = b""
+    values = None
+    seq = None
+    end = time.monotonic() + duration
+    try:
+        while time.monotonic() < end:
+            chunk = s.recv(64 if slow else 4096)
+            if not chunk:
+                result["closed"] = True
+                break
+            result["bytes"] = result.get("bytes", 0) + len(chunk)
+            buf += chunk
+            if slow:
+                time.sleep(0.2)
+
+            if values is None and b"\r\n\r\n" in buf:
+                head, buf = buf.split(b"\r\n\r\n", 1)
+                if not head.startswith(b"HTTP/1.1 200"):
+                    result["errors"] = result.get("errors", 0) + 1
+                    break
+                values = []
+
+            while values is not None and b"\n\n" in buf:
+                event, buf = buf.split(b"\n\n", 1)
+                kind, data = parse(event)
+                if kind == "meta":
+                    values = [None] * len(json.loads(data))
+                elif kind in ("full", "delta"):
+                    msg = json.loads(data)
+                    if kind == "full":
+                        values[:] = msg["v"]
+                        result["fulls"] = result.get("fulls", 0) + 1
+                    else:
+                        if seq is None or msg["seq"] != seq + 1:
+                            result["errors"] = result.get("errors", 0) + 1
+                        for ix, v in msg["v"].items():
+                            values[int(ix)] = v
+                    if seq is not None and msg["seq"] > seq + 1:
+                        result["gaps"] = result.get("gaps", 0) + 1
+                    seq = msg["seq"]
+                    result["events"] = result.get("events", 0) + 1
+    except OSError:
+        result["closed"] = True
+    except (ValueError, KeyError, IndexError):
+        result["errors"] = result.get("errors", 0) + 1
+    finally:
+        s.close()
+
+
+def parse(event):
+    kind = None
+    data = ""
+    for line in event.decode().split("\n"):
+        if line.startswith("event: "):
+            kind = line[7:]
+        elif line.startswith("data: "):
+            data += line[6:]
+    return kind, data
+
+
+def run(args, n_viewers):
+    results = [{} for _ in range(n_viewers)]
+    threads = [
+        threading.Thread(
+            target=view,
+            args=(args.host, args.port, args.duration, i < args.slow,
+                  results[i]))
+        for i in range(n_viewers)
+    ]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    fast = [r for i, r in enumerate(results)
+            if i >= args.slow and not r.get("failed")]
+    events = sum(r.get("events", 0) for r in fast)
+    fulls = sum(r.get("fulls", 0) for r in fast)
+    gaps = sum(r.get("gaps", 0) for r in fast)
+    kbytes = sum(r.get("bytes", 0) for r in fast) / 1000.0
+    failed = sum(1 for r in results if r.get("failed"))
+    closed = sum(1 for r in results if r.get("closed"))
+    errors = sum(r.get("errors", 0) for r in results)
+    n = max(1, len(fast))
+    print("%8d %10.1f %8.1f %10.1f %8d %8d %8d %8d" % (
+        n_viewers,
+        events / args.duration / n,
+        100.0 * fulls / max(1, events),
+        kbytes / args.duration / n,
+        gaps, failed, closed, errors))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Process data stream load generator")
+    parser.add_argument("host", help="device IP address")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--viewers", type=int, nargs="+",
+                        default=[1, 2, 4],
+                        help="concurrent viewer counts to run")
+    parser.add_argument("--slow", type=int, default=0,
+                        help="number of slow viewers in each run")
+    parser.add_argument("--duration", type=float, default=5.0,
+                        help="seconds per viewer count")
+    args = parser.parse_args()
+
+    # Figures are per fast viewer
+    print("%8s %10s %8s %10s %8s %8s %8s %8s" % (
+        "viewers", "events/s", "full %", "kB/s", "gaps", "refused",
+        "closed", "errors"))
+    for n in args.viewers:
+        run(args, n)
+        # Let the device release closed connections
+        time.sleep(1.0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,66 @@
+#!/bin/bash
+# ********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+# *******************************************************************/
+#
+# Report the code and data placed in CM7_0 ITCM and DTCM.
+#
+# Run as a post build step (see POSTBUILD in Makefile). Lists all symbols
+# located in the tightly coupled memories together with their size and
+# the total usage of each region.
+#
+# The nm tool can be selected using the NM environment variable.
+#
+
+if [[ $# -eq 0 ]] ;
+  then
+    echo "Syntax : $0 <elf file>"
+    exit 0
+fi
+
+elf=$1
+nm=${NM:-arm-none-eabi-nm}
+
+if ! test -f "$elf"; then
+  echo "Error - did not find elf file ($elf)"
+  exit -1
+fi
+
+report() {
+  local name=$1
+  local base=$2
+  local size=$3
+
+  echo "$name (0x$(printf '%08x' $base) - 0x$(printf '%08x' $((base + size))))"
+  "$nm" --print-size --numeric-sort --demangle "$elf" | \
+    awk -v base=$base -v size=$size -v name=$name '
+      function hex(s,    i, n) {
+        n = 0;
+        for (i = 1; i <= length(s); i++)
+          n = n * 16 + index("0123456789abcdef", tolower(substr(s, i, 1))) - 1;
+        return n;
+      }
+      {
+        addr = hex($1);
+        if (NF == 4 && addr >= base && addr < base + size) {
+          len = hex($2);
+          printf("  0x%08x %6d %s %s\n", addr, len, $3, $4);
+          used += len;
+        }
+      }
+      END {
+        printf("  %s used %d of %d bytes (%d%%)\n", name, used, size, int(used * 100 / size));
+      }'
+}
+
+echo "TCM placement report for $elf"
+report ITCM $((0x00000000)) $((0x4000))
+report DTCM $((0x20000000)) $((0x4000))
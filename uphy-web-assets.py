@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+# ********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+# *******************************************************************/
+#
+# Embed the static web assets as gzip compressed const arrays.
+#
+# Every file in the asset directory is compressed and written to a C
+# file as a const array, which stays in flash, with its content type
+# and an ETag computed from the compressed data. The table is declared
+# in source/web_assets.h and served by source/stream.c.
+#
+# In HTML files "{{<file>}}" is replaced by "<file>?v=<etag>", so pages
+# refer to the current build of the other assets and those can be
+# cached by the browser for good. HTML files are revalidated with their
+# ETag instead. index.html is served as "/".
+#
+# The output only changes when the assets do, so the script is run by
+# PREBUILD in the Makefile.
+#
+# Example:
+#   ./uphy-web-assets.py web generated/web_assets.c
+#
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".js": "text/javascript",
+    ".css": "text/css",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+}
+
+# Sent from a uint16_t length
+MAX_SIZE = 0xFFFF
+
+HEADER = """\
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \\ / __|
+ * | |   | |_  _ | || (_| || |_) |\\__ \\
+ * |_|    \\__|(_)|_| \\__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/* Generated by uphy-web-assets.py from %s/, do not edit */
+
+#include "web_assets.h"
+
+"""
+
+
+def compress(data):
+    # No timestamp and an unknown OS, so that every build host gives
+    # the same ETag
+    gz = gzip.compress(data, compresslevel=9, mtime=0)
+    return gz[:9] + b"\xff" + gz[10:]
+
+
+def etag(data):
+    return '"%s"' % hashlib.sha256(data).hexdigest()[:16]
+
+
+def c_name(name):
+    return "asset_" + re.sub(r"\W", "_", name)
+
+
+def c_array(name, data):
+    lines = ["static const uint8_t %s[] = {" % name]
+    for i in range(0, len(data), 12):
+        lines.append("   " + " ".join("0x%02x," % b for b in data[i:i + 12]))
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def load(directory):
+    assets = {}
+    for name in sorted(os.listdir(directory)):
+        ext = os.path.splitext(name)[1]
+        if ext not in TYPES:
+            continue
+        with open(os.path.join(directory, name), "rb") as f:
+            assets[name] = f.read()
+    return assets
+
+
+def build(assets):
+    out = []
+    tags = {}
+
+    # Pages last, they refer to the ETags of the others
+    names = sorted(assets, key=lambda n: (n.endswith(".html"), n))
+    for name in names:
+        data = assets[name]
+        if name.endswith(".html"):
+
+            def ref(m):
+                asset = m.group(1).decode()
+                if asset not in tags:
+                    sys.exit("%s: unknown asset %s" % (name, asset))
+                return ("%s?v=%s" % (asset, tags[asset].strip('"'))).encode()
+
+            data = re.sub(rb"\{\{([\w.-]+)\}\}", ref, data)
+
+        gz = compress(data)
+        if len(gz) > MAX_SIZE:
+            sys.exit("%s: %d bytes compressed, max %d" %
+                     (name, len(gz), MAX_SIZE))
+        tags[name] = etag(gz)
+        out.append((name, data, gz))
+    return out, tags
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("Syntax : %s <asset dir> <output.c>" % sys.argv[0])
+        sys.exit(1)
+
+    directory, output = sys.argv[1:]
+    assets = load(directory)
+    built, tags = build(assets)
+
+    text = HEADER % os.path.basename(os.path.normpath(directory))
+    for name, _, gz in built:
+        text += c_array(c_name(name), gz) + "\n"
+
+    text += "const web_asset_t web_assets[] = {\n"
+    for name, _, gz in built:
+        html = name.endswith(".html")
+        path = "/" if name == "index.html" else "/" + name
+        text += "   {\n"
+        text += '      .path = "%s",\n' % path
+        text += '      .type = "%s",\n' % TYPES[os.path.splitext(name)[1]]
+        text += '      .etag = "\\"%s\\"",\n' % tags[name].strip('"')
+        text += "      .data = %s,\n" % c_name(name)
+        text += "      .size = sizeof (%s),\n" % c_name(name)
+        text += "      .immutable = %s,\n" % ("false" if html else "true")
+        text += "   },\n"
+    text += "};\n\n"
+    text += "const uint16_t web_n_assets = sizeof (web_assets) / " \
+            "sizeof (web_assets[0]);\n"
+
+    # Keep the timestamp, and the build, if nothing changed
+    try:
+        with open(output) as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+
+    with open(output, "w") as f:
+        f.write(text)
+    for name, data, gz in built:
+        print("%-16s %6d -> %5d bytes %s" % (name, len(data), len(gz),
+                                              tags[name]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,59 @@
+// Process data viewer, reads the Server-Sent Events of /stream.
+// See source/stream.h for the events.
+
+(function () {
+  "use strict";
+
+  var body = document.getElementById("signals");
+  var state = document.getElementById("state");
+  var cells = [];
+  var events = new EventSource("/stream");
+
+  function update(ix, value) {
+    var cell = cells[ix];
+    if (cell === undefined) {
+      return;
+    }
+    cell.textContent = value === null ? "-" : value;
+    cell.parentNode.className = "changed";
+    setTimeout(function () {
+      cell.parentNode.className = "";
+    }, 300);
+  }
+
+  events.addEventListener("meta", function (e) {
+    body.textContent = "";
+    cells = [];
+    JSON.parse(e.data).forEach(function (field) {
+      var row = body.insertRow();
+      row.insertCell().textContent = field.name;
+      row.insertCell().textContent = field.dir;
+      row.insertCell().textContent = field.type;
+      cells.push(row.insertCell());
+    });
+  });
+
+  events.addEventListener("full", function (e) {
+    var data = JSON.parse(e.data);
+    data.v.forEach(function (value, ix) {
+      cells[ix].textContent = value === null ? "-" : value;
+    });
+    state.textContent = "#" + data.seq;
+  });
+
+  events.addEventListener("delta", function (e) {
+    var data = JSON.parse(e.data);
+    Object.keys(data.v).forEach(function (ix) {
+      update(ix, data.v[ix]);
+    });
+    state.textContent = "#" + data.seq;
+  });
+
+  events.onopen = function () {
+    state.textContent = "connected";
+  };
+
+  events.onerror = function () {
+    state.textContent = "disconnected, retrying";
+  };
+})();